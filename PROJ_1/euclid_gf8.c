@@ -4,8 +4,19 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include "instr.h"
+
 #include <bsd/stdlib.h>
 
+/*
+ * 과제 함수는 이 파일 안에서만 쓰므로 static으로 두어, 같은 이름의 64 비트 gcd()가 있는
+ * libcrypto_proj.a와 함께 링크해도 겹치지 않게 한다. unsigned 64 비트 역원 umul_inv()는
+ * PROJ_3/mod.c의 구현을 쓴다. miller_rabin.h는 gcd()의 선언이 이 파일의 int gcd()와
+ * 달라서 포함하지 않고 필요한 선언만 둔다.
+ */
+uint64_t umul_inv(uint64_t a, uint64_t m);
+
 /*
  * gcd() - Euclidean algorithm
  *
@@ -15,7 +26,7 @@
  * 재귀함수 호출을 사용하지 말고 while 루프를 사용하여 구현하는 것이 빠르고 좋다.
  */
 
-int gcd(int a, int b)
+static int gcd(int a, int b)
 {
     int temp = 0, result = 0;
     
@@ -41,7 +52,7 @@ int gcd(int a, int b)
  * x와 y를 계산하는 알고리즘이다. 강의노트를 참조하여 구현한다.
  * a, b가 모두 음이 아닌 정수라고 가정한다.
  */
-int xgcd(int a, int b, int *x, int *y)
+static int xgcd(int a, int b, int *x, int *y)
 {
     // d0, d1, d2 선언
     int d0 = a, d1 = b, d2;
@@ -51,6 +62,7 @@ int xgcd(int a, int b, int *x, int *y)
     int y0 = 0, y1 = 1, y2;
     // q 선언
     int q;
+    INSTR_BEGIN(INSTR_EUCLID);
     
     // d2의 값이 0이 될때까지 loop
     while (1){
@@ -64,6 +76,7 @@ int xgcd(int a, int b, int *x, int *y)
             *x = x1;
             *y = y1;
             
+            INSTR_END(INSTR_EUCLID);
             return d1;
         }
 
@@ -84,7 +97,7 @@ int xgcd(int a, int b, int *x, int *y)
  * 만일 역이 존재하지 않는다면 0을 리턴해야 한다.
  * 확장유클리드 알고리즘을 변형하면 구할 수 있다. 강의노트를 참조한다.
  */
-int mul_inv(int a, int m)
+static int mul_inv(int a, int m)
 {
     // d0, d1 선언
     int d0 = a, d1 = m;
@@ -95,6 +108,7 @@ int mul_inv(int a, int m)
     int q = d0 / d1;
     int d2 = d0 - q * d1;
     int x2 = x0 - q * x1;
+    INSTR_BEGIN(INSTR_EUCLID);
 
     // d2가 1 이하가 될때까지 loop
     while (d2 > 1){
@@ -109,6 +123,8 @@ int mul_inv(int a, int m)
         x1 = x2;
     }
 
+    INSTR_END(INSTR_EUCLID);
+
     // d2가 1인 경우 x2가 양수인 경우 x2를 그대로 return, 음수인 경우 m을 더해 양수 처리 후 return
     if (d2 == 1)
         return (x2 > 0 ? x2 : x2 + m);
@@ -117,44 +133,6 @@ int mul_inv(int a, int m)
         return 0;
 }
 
-/*
- * umul_inv() - computes multiplicative inverse a^-1 mod m
- *
- * 입력이 unsigned 64 비트 정수로 되어 있는 특수한 경우에
- * 모듈로 m에서 a의 곱의 역인 a^-1 mod m을 구한다.
- * 만일 역이 존재하지 않는다면 0을 리턴해야 한다.
- * 확장유클리드 알고리즘을 변형하면 구할 수 있다.
- * 입출력 모두가 unsigned 64 비트 정수임을 고려해서 구현한다.
- */
-
-uint64_t umul_inv(uint64_t a, uint64_t m)
-{
-    uint64_t d0 = a, d1 = m;
-    uint64_t x0 = 1, x1 = 0;
-
-    uint64_t q = d0 / d1;
-    uint64_t d2 = d0 - q * d1;
-    uint64_t x2 = x0 - q * x1;
-
-    while (d2 > 1){
-        q = d0 / d1;
-        d2 = d0 - q * d1;
-        x2 = x0 - q * x1;
-
-        d0 = d1;
-        d1 = d2;
-        x0 = x1;
-        x1 = x2;
-    }
-
-    // unsigned 64 비트 정수의 경우 음이 아닌 정수이므로 기존 mul_inv 함수의 경우 return문에서 x2 < 0인 케이스가 존재하지 않아 x2 + m이 실행되지 않음
-    // 따라서 조건문과 그 값들을 unsigned 64 비트 정수 입력에 맞춰 수정
-    if (d2 == 1)
-        return (x2 > (uint64_t)1<<63 ? x2 + m : x2);
-    //d2가 1이 아닌 경우 역이 없으므로 0을 return
-    else
-        return 0;
-}
 /*
  * gf8_mul(a, b) - a * b mod x^8+x^4+x^3+x+1
  *
@@ -164,12 +142,12 @@ uint64_t umul_inv(uint64_t a, uint64_t m)
 
 
 // gf8_mul, gf8_pow 함수 구현을 위한 xtime 함수 선언
-uint8_t xtime(uint8_t x)
+static uint8_t xtime(uint8_t x)
 {
     return ((x<<1) ^ ((x>>7) & 1 ? 0x1B : 0));
 }
 
-uint8_t gf8_mul(uint8_t a, uint8_t b)
+static uint8_t gf8_mul(uint8_t a, uint8_t b)
 {
     uint8_t r = 0;
 
@@ -189,7 +167,7 @@ uint8_t gf8_mul(uint8_t a, uint8_t b)
  * gf8_mul()과 "Square Multiplication" 알고리즘을 사용하여 구현한다.
  */
 
-uint8_t gf8_pow(uint8_t a, uint8_t b)
+static uint8_t gf8_pow(uint8_t a, uint8_t b)
 {
     uint8_t r = 1;
 
@@ -208,7 +186,7 @@ uint8_t gf8_pow(uint8_t a, uint8_t b)
  * 역을 구하는 가장 효율적인 방법은 다항식 확장유클리드 알고리즘을 사용하는 것이다.
  * 다만 여기서는 복잡성을 피하기 위해 느리지만 알기 쉬운 지수를 사용하여 구현하였다.
  */
-uint8_t gf8_inv(uint8_t a)
+static uint8_t gf8_inv(uint8_t a)
 {
     return gf8_pow(a, 0xfe);
 }
@@ -335,5 +313,6 @@ int main(void)
         printf(" OK\n");
 
     printf("Congratulations!\n");
+    instr_dump(stderr);
     return 0;
 }
@@ -5,6 +5,13 @@
 #include <stdio.h>
 #include <string.h>
 #include "aes.h"
+#include "instr.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define AES_X86
+#endif
 
 static const uint8_t sbox[256] = {
   0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
@@ -44,14 +51,13 @@ static const uint8_t isbox[256] = {
 
 static const uint8_t Rcon[11] = {0x8d, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
 
-static const uint8_t M[16] = {2, 3, 1, 1, 1, 2, 3, 1, 1, 1, 2, 3, 3, 1, 1, 2};
-
-static const uint8_t IM[16] = {0x0e, 0x0b, 0x0d, 0x09, 0x09, 0x0e, 0x0b, 0x0d, 0x0d, 0x09, 0x0e, 0x0b, 0x0b, 0x0d, 0x09, 0x0e};
-
 static void AddRoundKey(uint8_t *state, const uint32_t *roundKey, int round);
 static void SubBytes(uint8_t *state, int mode);
 static void ShiftRows(uint8_t *state, int mode);
 static void MixColumns(uint8_t *state, int mode);
+static void NextRoundKey(uint32_t *w, int round);
+static void PrevRoundKey(uint32_t *w, int round);
+static void RoundColumns(uint32_t *s, const uint32_t *roundKey, int round);
 
 /*
  * Generate an AES key schedule
@@ -61,6 +67,7 @@ void KeyExpansion(const uint8_t *key, uint32_t *roundKey)
   uint32_t temp;
   uint8_t sub[4];
   uint8_t *p;
+  INSTR_BEGIN(INSTR_AES_KEY);
 
   // uint8_t 자료형의 key를 uint32_t 자료형인 roundKey에 넣기 위해 자릿수를 맞춰줌
   // example : aa + bb + cc + dd > aa000000 + 00bb0000 + 0000cc00 + 000000dd > aabbccdd
@@ -91,6 +98,7 @@ void KeyExpansion(const uint8_t *key, uint32_t *roundKey)
       roundKey[i] = roundKey[i-Nk] ^ temp;
     }
   }
+  INSTR_END(INSTR_AES_KEY);
 }
 
 /*
@@ -105,6 +113,7 @@ void Cipher(uint8_t *state, const uint32_t *roundKey, int mode)
   // round 10에서는 MixColumns를 적용하지 않음
   if (mode == ENCRYPT){
     int round = 0;
+    INSTR_BEGIN(INSTR_AES_ENCRYPT);
     AddRoundKey(state, roundKey, round);
 
     round++;
@@ -120,6 +129,7 @@ void Cipher(uint8_t *state, const uint32_t *roundKey, int mode)
     SubBytes(state, mode);
     ShiftRows(state, mode);
     AddRoundKey(state, roundKey, round);
+    INSTR_END(INSTR_AES_ENCRYPT);
   }
 
   // 복호화
@@ -127,6 +137,7 @@ void Cipher(uint8_t *state, const uint32_t *roundKey, int mode)
   // round 0에서는 MixColumns를 적용하지 않음
   else if (mode == DECRYPT){
     int round = Nr;
+    INSTR_BEGIN(INSTR_AES_DECRYPT);
     AddRoundKey(state, roundKey, round);
 
     round--;
@@ -142,9 +153,184 @@ void Cipher(uint8_t *state, const uint32_t *roundKey, int mode)
     SubBytes(state, mode);
     ShiftRows(state, mode);
     AddRoundKey(state, roundKey, round);
+    INSTR_END(INSTR_AES_DECRYPT);
   }
 }
 
+/*
+ * Store the cipher key (ENCRYPT) or the last round key (DECRYPT) for CipherCompact()
+ * 복호화용 마지막 라운드 키는 키 스케줄을 Nk 워드 창으로 Nr번 진행하여 얻는다.
+ */
+void KeyCompact(const uint8_t *key, aes_compact_key *ck, int mode)
+{
+  INSTR_BEGIN(INSTR_AES_KEY);
+  for (int i=0; i<Nk; i++){
+    ck->w[i] = (uint32_t) key[4*i] | (uint32_t) key[4*i + 1] << 8 | (uint32_t) key[4*i + 2] << 16 | (uint32_t) key[4*i + 3] << 24;
+  }
+  if (mode == DECRYPT){
+    for (int round=1; round<=Nr; round++){
+      NextRoundKey(ck->w, round);
+    }
+  }
+  INSTR_END(INSTR_AES_KEY);
+}
+
+/*
+ * AES cipher function with round keys derived on the fly
+ * ck는 mode와 같은 mode로 KeyCompact()에서 만든 것이어야 한다. 라운드 순서는 Cipher()와 같다.
+ */
+void CipherCompact(uint8_t *state, const aes_compact_key *ck, int mode)
+{
+  uint32_t w[Nk];
+
+  memcpy(w, ck->w, sizeof(w));
+
+  // 암호화 : 라운드 0 키에서 시작해 라운드마다 다음 라운드 키를 만듦
+  if (mode == ENCRYPT){
+    INSTR_BEGIN(INSTR_AES_ENCRYPT);
+    AddRoundKey(state, w, 0);
+
+    for (int round=1; round<Nr; round++){
+      NextRoundKey(w, round);
+      SubBytes(state, mode);
+      ShiftRows(state, mode);
+      MixColumns(state, mode);
+      AddRoundKey(state, w, 0);
+    }
+    NextRoundKey(w, Nr);
+    SubBytes(state, mode);
+    ShiftRows(state, mode);
+    AddRoundKey(state, w, 0);
+    INSTR_END(INSTR_AES_ENCRYPT);
+  }
+
+  // 복호화 : 라운드 Nr 키에서 시작해 라운드마다 이전 라운드 키로 되돌림
+  else if (mode == DECRYPT){
+    INSTR_BEGIN(INSTR_AES_DECRYPT);
+    AddRoundKey(state, w, 0);
+
+    for (int round=Nr-1; round>0; round--){
+      PrevRoundKey(w, round+1);
+      SubBytes(state, mode);
+      ShiftRows(state, mode);
+      AddRoundKey(state, w, 0);
+      MixColumns(state, mode);
+    }
+    PrevRoundKey(w, 1);
+    SubBytes(state, mode);
+    ShiftRows(state, mode);
+    AddRoundKey(state, w, 0);
+    INSTR_END(INSTR_AES_DECRYPT);
+  }
+  explicit_bzero(w, sizeof(w));
+}
+
+/*
+ * CPU 기능 확인
+ * features가 -1이면 아직 확인하지 않은 상태이다. 여러 스레드가 동시에 확인해도 같은 값을 쓰므로 문제없다.
+ */
+static int features = -1;
+static int allowed = AES_NI;
+
+int aes_accel_features(void)
+{
+#ifdef AES_X86
+  unsigned int a, b, c, d;
+
+  if (features < 0)
+    features = (__get_cpuid(1, &a, &b, &c, &d) && ((c >> 25) & 1)) ? AES_NI : 0;
+  return features & allowed;
+#else
+  return 0;
+#endif
+}
+
+/*
+ * aes_accel_restrict() - limits the backends in use to mask (for testing and benchmarks)
+ */
+void aes_accel_restrict(int mask)
+{
+  allowed = mask;
+}
+
+#ifdef AES_X86
+/*
+ * AES encryption of n consecutive blocks with AES-NI
+ * roundKey의 워드는 열의 네 바이트를 리틀 엔디언으로 묶은 것이므로 x86 메모리에서는 라운드 키의 바이트
+ * 순서 그대로이다. aesenc는 지연 시간이 처리 간격보다 길어서 서로 독립인 블록 8개를 함께 돌린다.
+ */
+__attribute__((target("aes,sse2")))
+static void CipherBlocksNI(uint8_t *state, size_t n, const uint32_t *roundKey)
+{
+  __m128i k[Nr+1], b[8];
+  size_t j = 0;
+
+  for (int round=0; round<=Nr; round++){
+    k[round] = _mm_loadu_si128((const __m128i *)(roundKey + Nb*round));
+  }
+  for (; j + 8 <= n; j += 8){
+    INSTR_BEGIN(INSTR_AES_ENCRYPT);
+    for (int i=0; i<8; i++){
+      b[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(state + BLOCKLEN*(j+i))), k[0]);
+    }
+    for (int round=1; round<Nr; round++){
+      for (int i=0; i<8; i++){
+        b[i] = _mm_aesenc_si128(b[i], k[round]);
+      }
+    }
+    for (int i=0; i<8; i++){
+      _mm_storeu_si128((__m128i *)(state + BLOCKLEN*(j+i)), _mm_aesenclast_si128(b[i], k[Nr]));
+    }
+    INSTR_END(INSTR_AES_ENCRYPT);
+  }
+  for (; j < n; j++){
+    INSTR_BEGIN(INSTR_AES_ENCRYPT);
+    b[0] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(state + BLOCKLEN*j)), k[0]);
+    for (int round=1; round<Nr; round++){
+      b[0] = _mm_aesenc_si128(b[0], k[round]);
+    }
+    _mm_storeu_si128((__m128i *)(state + BLOCKLEN*j), _mm_aesenclast_si128(b[0], k[Nr]));
+    INSTR_END(INSTR_AES_ENCRYPT);
+  }
+  // 라운드 키와 상태가 레지스터에서 스택으로 넘친 경우를 지움
+  explicit_bzero(k, sizeof(k));
+  explicit_bzero(b, sizeof(b));
+}
+#endif
+
+/*
+ * AES encryption of n consecutive blocks
+ * Cipher(state + BLOCKLEN*j, roundKey, ENCRYPT)를 j = 0, ..., n-1에 대해 부른 것과 결과가 같다.
+ * AES-NI가 있으면 CipherBlocksNI()로 계산한다. 없으면 상태를 열 단위 32 비트 워드로 두고 SubBytes와
+ * ShiftRows는 S-Box 조회 한 번으로, MixColumns는 워드 안의 네 바이트를 한꺼번에 계산하므로
+ * CTR 모드처럼 블록을 여러 개 암호화할 때 쓴다.
+ */
+void CipherBlocks(uint8_t *state, size_t n, const uint32_t *roundKey)
+{
+  uint32_t s[Nb];
+
+#ifdef AES_X86
+  if (aes_accel_features() & AES_NI){
+    CipherBlocksNI(state, n, roundKey);
+    return;
+  }
+#endif
+  for (size_t j=0; j<n; j++, state += BLOCKLEN){
+    INSTR_BEGIN(INSTR_AES_ENCRYPT);
+    for (int i=0; i<Nb; i++){
+      s[i] = ((uint32_t) state[4*i] | (uint32_t) state[4*i + 1] << 8 | (uint32_t) state[4*i + 2] << 16 | (uint32_t) state[4*i + 3] << 24) ^ roundKey[i];
+    }
+    for (int round=1; round<=Nr; round++){
+      RoundColumns(s, roundKey, round);
+    }
+    for (int i=0; i<Nb; i++){
+      state[4*i] = s[i]; state[4*i + 1] = s[i] >> 8; state[4*i + 2] = s[i] >> 16; state[4*i + 3] = s[i] >> 24;
+    }
+    INSTR_END(INSTR_AES_ENCRYPT);
+  }
+  explicit_bzero(s, sizeof(s));
+}
+
 // 지역 함수 1 AddRoundKey : 라운드 키를 XOR 연산을 사용하여 state에 더함
 // round에 따라 roundKey를 구분해서 적용하기 위해 int round 인자를 추가
 static void AddRoundKey(uint8_t *state, const uint32_t *roundKey, int round)
@@ -219,48 +405,86 @@ static void ShiftRows(uint8_t *state, int mode)
   }
 }
 
-// gf8_mul : MixColumns를 구현하기 전 a * b modulo x^8 + x^4 + x^3 + x + 1 계산을 쉽게 하기 위해 project#1에서 구현한 gf8_mul 함수를 사용
-uint8_t gf8_mul(uint8_t a, uint8_t b){
-  uint8_t r = 0;
+// 지역 함수 4 MixColumns : 기약 다항식 x^8 + x^4 + x^3 + x + 1 을 사용한 GF(2^8)에서 행렬곱셈을 수행한다. mode가 DECRYPT이면 역행렬을 곱한다.
+// M의 한 행 (2, 3, 1, 1)은 s0 ^ t ^ XTIME(s0 ^ s1) (t = s0 ^ s1 ^ s2 ^ s3)로 계산되므로 gf8_mul 없이 XTIME 네 번으로 끝남
+// IM = M * (5, 0, 4, 0 순환 행렬)이므로 복호화는 s0 ^= XTIME(XTIME(s0 ^ s2)), s1 ^= XTIME(XTIME(s1 ^ s3)) 등을 먼저 적용한 뒤 M을 곱함
+static void MixColumns(uint8_t *state, int mode)
+{
+  uint8_t *s, t, u, v, s0;
+
+  for (int i=0; i<Nb; i++){
+    s = state + 4*i;
+
+    // 복호화 전처리
+    if (mode == DECRYPT){
+      u = XTIME(XTIME(s[0] ^ s[2]));
+      v = XTIME(XTIME(s[1] ^ s[3]));
+      s[0] ^= u; s[1] ^= v; s[2] ^= u; s[3] ^= v;
+    }
 
-  while (b>0){
-    if (b & 1) r = r ^ a;
-    b = b >> 1;
-    a = XTIME(a);
+    t = s[0] ^ s[1] ^ s[2] ^ s[3];
+    s0 = s[0];
+    s[0] ^= t ^ XTIME(s[0] ^ s[1]);
+    s[1] ^= t ^ XTIME(s[1] ^ s[2]);
+    s[2] ^= t ^ XTIME(s[2] ^ s[3]);
+    s[3] ^= t ^ XTIME(s[3] ^ s0);
   }
+}
 
-  return r;
+// 지역 함수 5 SubRotWord : KeyExpansion()의 g(w) = S-Box(LRotWord(w)) xor Rcon
+static uint32_t SubRotWord(uint32_t t, int round)
+{
+  return ((uint32_t) sbox[(t >> 8) & 0xff] ^ Rcon[round]) | (uint32_t) sbox[(t >> 16) & 0xff] << 8 |
+         (uint32_t) sbox[t >> 24] << 16 | (uint32_t) sbox[t & 0xff] << 24;
 }
 
-// 지역 함수 4 MixColumns : 기약 다항식 x^8 + x^4 + x^3 + x + 1 을 사용한 GF(2^8)에서 행렬곱셈을 수행한다. mode가 DECRYPT이면 역행렬을 곱한다.
-static void MixColumns(uint8_t *state, int mode)
+// 지역 함수 6 NextRoundKey : 라운드 round-1의 키 w를 라운드 round의 키로 바꿈
+// w(i) = w(i-4) xor w(i-1)이므로 앞 워드부터 차례로 갱신함 (AES-128, Nk = Nb = 4)
+static void NextRoundKey(uint32_t *w, int round)
 {
-  
-  // 암호화
-  if (mode == ENCRYPT){
-    uint8_t array[BLOCKLEN];
+  w[0] ^= SubRotWord(w[3], round);
+  w[1] ^= w[0];
+  w[2] ^= w[1];
+  w[3] ^= w[2];
+}
 
-    memcpy(array, state, sizeof(uint8_t) * BLOCKLEN);
+// 지역 함수 7 PrevRoundKey : 라운드 round의 키 w를 라운드 round-1의 키로 되돌림
+// w(i-4) = w(i) xor w(i-1)이므로 뒤 워드부터 되돌린 뒤, 되돌린 w[3]으로 w[0]을 복구함
+static void PrevRoundKey(uint32_t *w, int round)
+{
+  w[3] ^= w[2];
+  w[2] ^= w[1];
+  w[1] ^= w[0];
+  w[0] ^= SubRotWord(w[3], round);
+}
 
-    // 제공된 M matrix와 state 간 modulo x^8 + x^4 + x^3 + x + 1 안에서의 행렬곱셈을 계산 후 xor 처리
-    for (uint8_t i=0; i<4; i++){
-      for (int j=0; j<4; j++){
-        state[i*4 + j] = gf8_mul(M[j*4], array[i*4]) ^ gf8_mul(M[j*4 + 1], array[i*4 + 1]) ^ gf8_mul(M[j*4 + 2], array[i*4 + 2]) ^ gf8_mul(M[j*4 + 3], array[i*4 + 3]);
-      }
-    }
-  } 
+// 지역 함수 8 RoundColumns : 열 워드 s에 암호화 라운드 round 하나 (SubBytes, ShiftRows, MixColumns, AddRoundKey)를 적용
+// 새 열 c의 행 r 바이트는 ShiftRows에 의해 옛 열 (c+r) mod 4의 행 r 바이트이며, 워드는 리틀 엔디언이므로 행 r은 비트 8r부터임
+// 열 u의 MixColumns는 바이트마다 XTIME(u_r ^ u_r+1) ^ u_r+1 ^ u_r+2 ^ u_r+3이므로 u를 8, 16, 24 비트 회전한 워드로 한 번에 계산함
+// 마지막 라운드에서는 MixColumns를 건너뜀
+#define SHIFT_SUB(a, b, c, d) ((uint32_t) sbox[(a) & 0xff] | (uint32_t) sbox[((b) >> 8) & 0xff] << 8 | \
+                               (uint32_t) sbox[((c) >> 16) & 0xff] << 16 | (uint32_t) sbox[(d) >> 24] << 24)
+#define ROTR(u, n) ((u) >> (n) | (u) << (32 - (n)))
 
-  // 복호화
-  else if (mode == DECRYPT){
-    uint8_t array[BLOCKLEN];
+static inline uint32_t MixColumn(uint32_t u)
+{
+  uint32_t r1 = ROTR(u, 8), x = u ^ r1;
 
-    memcpy(array, state, sizeof(uint8_t) * BLOCKLEN);
+  x = ((x & 0x7f7f7f7f) << 1) ^ (((x >> 7) & 0x01010101) * 0x1b);
+  return x ^ r1 ^ ROTR(u, 16) ^ ROTR(u, 24);
+}
 
-    // 제공된 IM matrix와 state 간 modulo x^8 + x^4 + x^3 + x + 1 안에서의 행렬곱셈을 계산 후 xor 처리
-    for (uint8_t i=0; i<4; i++){
-      for (int j=0; j<4; j++){
-        state[i*4 + j] = gf8_mul(IM[j*4], array[i*4]) ^ gf8_mul(IM[j*4 + 1], array[i*4 + 1]) ^ gf8_mul(IM[j*4 + 2], array[i*4 + 2]) ^ gf8_mul(IM[j*4 + 3], array[i*4 + 3]);
-      }
-    }
-  }  
-}
\ No newline at end of file
+static void RoundColumns(uint32_t *s, const uint32_t *roundKey, int round)
+{
+  uint32_t t0, t1, t2, t3;
+
+  t0 = SHIFT_SUB(s[0], s[1], s[2], s[3]);
+  t1 = SHIFT_SUB(s[1], s[2], s[3], s[0]);
+  t2 = SHIFT_SUB(s[2], s[3], s[0], s[1]);
+  t3 = SHIFT_SUB(s[3], s[0], s[1], s[2]);
+  if (round < Nr){
+    t0 = MixColumn(t0); t1 = MixColumn(t1); t2 = MixColumn(t2); t3 = MixColumn(t3);
+  }
+  s[0] = t0 ^ roundKey[Nb*round]; s[1] = t1 ^ roundKey[Nb*round + 1];
+  s[2] = t2 ^ roundKey[Nb*round + 2]; s[3] = t3 ^ roundKey[Nb*round + 3];
+}
@@ -5,6 +5,7 @@
 #ifndef AES_H
 #define AES_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <bsd/stdlib.h>
@@ -27,7 +28,29 @@
 #define ENCRYPT 1
 #define DECRYPT 0
 
+/*
+ * CipherBlocks()의 하드웨어 가속
+ * AES_NI : x86 AES 명령어로 라운드를 수행. 지원 여부는 처음 사용할 때 CPUID로 확인하며,
+ * 지원하지 않으면 aes.c의 열 단위 구현으로 계산한다.
+ */
+#define AES_NI 0x01
+
+/*
+ * aes_compact_key - 라운드 키를 펼치지 않는 키 문맥 (KEYLEN 바이트)
+ * 암호화용은 암호 키 (라운드 0 키)를, 복호화용은 마지막 라운드 키 (라운드 Nr 키)를 저장하고
+ * CipherCompact()가 라운드마다 다음 (복호화는 이전) 라운드 키를 그 자리에서 만든다.
+ * KeyExpansion()의 RNDKEYSIZE 워드 대신 Nk 워드만 두므로 문맥이 많을 때 메모리와 캐시를 아낀다.
+ */
+typedef struct {
+    uint32_t w[Nk];
+} aes_compact_key;
+
 void KeyExpansion(const uint8_t *key, uint32_t *roundKey);
 void Cipher(uint8_t *state, const uint32_t *roundKey, int mode);
+void KeyCompact(const uint8_t *key, aes_compact_key *ck, int mode);
+void CipherCompact(uint8_t *state, const aes_compact_key *ck, int mode);
+void CipherBlocks(uint8_t *state, size_t n, const uint32_t *roundKey);
+int aes_accel_features(void);
+void aes_accel_restrict(int mask);
 
 #endif
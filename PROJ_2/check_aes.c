@@ -0,0 +1,166 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * AES 구현 교차 검증 : Cipher(), CipherCompact(), CipherBlocks()를 FIPS-197 부록의 검증 데이터와
+ * 맞춰 보고, 무작위 키와 블록에서 세 구현의 결과가 서로 같은지 확인한다. CipherBlocks()는 CPU가 지원하는
+ * 백엔드 (AES-NI, 열 단위 구현)마다 확인하며, 블록 수는 AES-NI가 8개씩 묶는 경계 앞뒤를 모두 지난다.
+ * 압축 키 문맥은 KeyCompact()가 저장한 키가 FIPS-197 A.1의 마지막 라운드 키, KeyExpansion()의 첫 (복호화는
+ * 마지막) 라운드 키와 같은지, CipherCompact()가 문맥을 바꾸지 않고 무작위 블록의 암호화와 복호화 모두에서
+ * Cipher()와 같은지 본다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다. make check가 실행한다.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "aes.h"
+
+#include <bsd/stdlib.h>
+
+/*
+ * FIPS-197 부록 B, C.1의 키, 평문, 암호문
+ */
+static const struct {
+    const char *name;
+    uint8_t key[KEYLEN], pt[BLOCKLEN], ct[BLOCKLEN];
+} kat[] = {
+    {"FIPS-197 B",
+     {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c},
+     {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34},
+     {0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb, 0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32}},
+    {"FIPS-197 C.1",
+     {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+     {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff},
+     {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a}},
+};
+
+#define NKAT (sizeof(kat) / sizeof(kat[0]))
+
+/*
+ * FIPS-197 부록 A.1 키 (부록 B의 키)의 마지막 라운드 키 w[40..43]
+ */
+static const uint8_t a1_last[BLOCKLEN] = {
+    0xd0, 0x14, 0xf9, 0xa8, 0xc9, 0xee, 0x25, 0x89, 0xe1, 0x3f, 0x0c, 0xc8, 0xb6, 0x63, 0x0c, 0xa6};
+
+#define MAXBLOCKS 37            /* CipherBlocks()에 한 번에 넘기는 최대 블록 수 */
+#define ROUNDS 20000
+
+/*
+ * check_kat() - encrypts and decrypts one known-answer vector with Cipher() and CipherBlocks()
+ */
+static int check_kat(int i)
+{
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t buf[BLOCKLEN];
+    int bad = 0;
+
+    KeyExpansion(kat[i].key, rk);
+    memcpy(buf, kat[i].pt, BLOCKLEN);
+    Cipher(buf, rk, ENCRYPT);
+    bad |= memcmp(buf, kat[i].ct, BLOCKLEN) != 0;
+    Cipher(buf, rk, DECRYPT);
+    bad |= memcmp(buf, kat[i].pt, BLOCKLEN) != 0;
+
+    memcpy(buf, kat[i].pt, BLOCKLEN);
+    CipherBlocks(buf, 1, rk);
+    bad |= memcmp(buf, kat[i].ct, BLOCKLEN) != 0;
+    return bad;
+}
+
+/*
+ * check_random() - compares CipherBlocks() with Cipher() per block on random keys and block runs
+ */
+static int check_random(void)
+{
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t key[KEYLEN], a[BLOCKLEN*MAXBLOCKS], b[BLOCKLEN*MAXBLOCKS];
+    int n;
+
+    for (int it = 0; it < ROUNDS; it++) {
+        arc4random_buf(key, KEYLEN);
+        KeyExpansion(key, rk);
+        n = it % MAXBLOCKS;
+        arc4random_buf(a, BLOCKLEN*n);
+        memcpy(b, a, BLOCKLEN*n);
+        CipherBlocks(a, n, rk);
+        for (int j = 0; j < n; j++)
+            Cipher(b + BLOCKLEN*j, rk, ENCRYPT);
+        if (memcmp(a, b, BLOCKLEN*n) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * check_compact() - checks KeyCompact() and CipherCompact() against the vectors and against Cipher()
+ */
+static int check_compact(void)
+{
+    uint32_t rk[RNDKEYSIZE];
+    aes_compact_key ce, cd, ck, save;
+    uint8_t key[KEYLEN], a[BLOCKLEN], b[BLOCKLEN];
+    int mode, bad = 0;
+
+    // 복호화 문맥은 마지막 라운드 키, 워드의 바이트 j는 열의 j번째 바이트
+    KeyCompact(kat[0].key, &cd, DECRYPT);
+    for (int i = 0; i < Nk; i++)
+        for (int j = 0; j < 4; j++)
+            bad |= ((cd.w[i] >> 8*j) & 0xff) != a1_last[4*i + j];
+    for (size_t i = 0; i < NKAT; i++) {
+        KeyCompact(kat[i].key, &ce, ENCRYPT);
+        KeyCompact(kat[i].key, &cd, DECRYPT);
+        memcpy(a, kat[i].pt, BLOCKLEN);
+        CipherCompact(a, &ce, ENCRYPT);
+        bad |= memcmp(a, kat[i].ct, BLOCKLEN) != 0;
+        CipherCompact(a, &cd, DECRYPT);
+        bad |= memcmp(a, kat[i].pt, BLOCKLEN) != 0;
+    }
+
+    // 짝수 번째는 암호화, 홀수 번째는 복호화 문맥과 방향을 확인
+    for (int it = 0; it < ROUNDS && !bad; it++) {
+        mode = (it & 1) ? DECRYPT : ENCRYPT;
+        arc4random_buf(key, KEYLEN);
+        KeyExpansion(key, rk);
+        KeyCompact(key, &ck, mode);
+        bad |= memcmp(ck.w, mode == ENCRYPT ? rk : rk + Nb*Nr, sizeof(ck.w)) != 0;
+        save = ck;
+        arc4random_buf(a, BLOCKLEN);
+        memcpy(b, a, BLOCKLEN);
+        CipherCompact(a, &ck, mode);
+        Cipher(b, rk, mode);
+        bad |= memcmp(a, b, BLOCKLEN) != 0;
+        bad |= memcmp(&save, &ck, sizeof(ck)) != 0;
+    }
+    return bad;
+}
+
+int main(void)
+{
+    const int masks[] = {AES_NI, 0};
+    const char *names[] = {"AES-NI", "generic"};
+    int features = aes_accel_features(), bad, fail = 0;
+    char label[64];
+
+    for (size_t k = 0; k < sizeof(masks) / sizeof(masks[0]); k++) {
+        // CPU가 지원하지 않는 백엔드는 건너뜀
+        if ((masks[k] & features) != masks[k])
+            continue;
+        aes_accel_restrict(masks[k]);
+        for (size_t i = 0; i < NKAT; i++) {
+            bad = check_kat(i);
+            snprintf(label, sizeof(label), "%s %s", kat[i].name, names[k]);
+            printf("AES %-36s -- %s\n", label, bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+        bad = check_random();
+        snprintf(label, sizeof(label), "Cipher/Blocks random %s", names[k]);
+        printf("AES %-36s -- %s\n", label, bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    aes_accel_restrict(features);
+    bad = check_compact();
+    printf("AES %-36s -- %s\n", "KeyCompact/CipherCompact", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    return fail;
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * CTR_DRBG 검증 : ctr_drbg_instantiate/reseed/generate()를 SP 800-90A 10.2.1의 단계를 Cipher()로 그대로
+ * 옮긴 참조 구현과 비교한다. 개인화 문자열과 추가 입력이 있을 때와 없을 때, 블록 경계 앞뒤와
+ * DRBG_MAX_REQUEST까지의 길이를 쓰며, CPU가 지원하는 CipherBlocks() 백엔드 (AES-NI, 열 단위 구현)마다
+ * 반복한다. 요청 한도와 재시드 주기를 넘으면 -1, 1을 리턴하는지, drbg_bytes()가 버퍼를 일부 쓴 뒤의
+ * 큰 요청과 작은 요청에서 같은 블록을 다시 내지 않는지, fork() 자식이 부모와 다른 값을 내는지도 본다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "aes.h"
+#include "drbg.h"
+
+#include <bsd/stdlib.h>
+
+#define ROUNDS 20
+
+static const size_t lens[] = {0, 1, 15, 16, 17, 31, 100, DRBG_BUFSIZE, DRBG_BUFSIZE + 5, DRBG_MAX_REQUEST};
+
+#define NLEN (sizeof(lens) / sizeof(lens[0]))
+
+/*
+ * ref - 참조 구현의 상태, 키는 바이트열로 두고 블록마다 Cipher()를 부른다
+ */
+struct ref {
+    uint8_t key[KEYLEN], V[BLOCKLEN];
+};
+
+static void ref_increment(uint8_t *V)
+{
+    for (int i = BLOCKLEN - 1; i >= 0 && ++V[i] == 0; i--)
+        ;
+}
+
+/*
+ * ref_update() - CTR_DRBG_Update (10.2.1.2), provided가 NULL이면 0
+ */
+static void ref_update(struct ref *r, const uint8_t *provided)
+{
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t temp[DRBG_SEEDLEN];
+
+    KeyExpansion(r->key, rk);
+    for (int i = 0; i < DRBG_SEEDLEN; i += BLOCKLEN) {
+        ref_increment(r->V);
+        memcpy(temp + i, r->V, BLOCKLEN);
+        Cipher(temp + i, rk, ENCRYPT);
+    }
+    for (int i = 0; provided && i < DRBG_SEEDLEN; i++)
+        temp[i] ^= provided[i];
+    memcpy(r->key, temp, KEYLEN);
+    memcpy(r->V, temp + KEYLEN, BLOCKLEN);
+}
+
+/*
+ * ref_generate() - CTR_DRBG_Generate (10.2.1.5.1) without the reseed counter
+ */
+static void ref_generate(struct ref *r, uint8_t *out, size_t len, const uint8_t *add)
+{
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t block[BLOCKLEN];
+
+    if (add)
+        ref_update(r, add);
+    KeyExpansion(r->key, rk);
+    for (size_t off = 0; off < len; off += BLOCKLEN) {
+        ref_increment(r->V);
+        memcpy(block, r->V, BLOCKLEN);
+        Cipher(block, rk, ENCRYPT);
+        memcpy(out + off, block, (len - off < BLOCKLEN) ? len - off : BLOCKLEN);
+    }
+    ref_update(r, add);
+}
+
+/*
+ * check_ref() - runs one instance and the reference side by side through every length
+ * 길이마다 추가 입력을 번갈아 넣고, 가운데에서 한 번 재시드한다.
+ */
+static int check_ref(int pers)
+{
+    static uint8_t got[DRBG_MAX_REQUEST], want[DRBG_MAX_REQUEST];
+    uint8_t entropy[DRBG_SEEDLEN], p[DRBG_SEEDLEN], add[DRBG_SEEDLEN];
+    struct ref r = {{0}, {0}};
+    ctr_drbg d;
+    int bad = 0;
+
+    arc4random_buf(entropy, sizeof(entropy));
+    arc4random_buf(p, sizeof(p));
+    ctr_drbg_instantiate(&d, entropy, pers ? p : NULL);
+    for (int i = 0; i < DRBG_SEEDLEN; i++)
+        entropy[i] ^= pers ? p[i] : 0;
+    ref_update(&r, entropy);
+
+    for (size_t i = 0; i < NLEN; i++) {
+        arc4random_buf(add, sizeof(add));
+        if (i == NLEN / 2) {
+            arc4random_buf(entropy, sizeof(entropy));
+            ctr_drbg_reseed(&d, entropy, add);
+            for (int k = 0; k < DRBG_SEEDLEN; k++)
+                entropy[k] ^= add[k];
+            ref_update(&r, entropy);
+        }
+        bad |= ctr_drbg_generate(&d, got, lens[i], (i & 1) ? add : NULL) != 0;
+        ref_generate(&r, want, lens[i], (i & 1) ? add : NULL);
+        bad |= memcmp(got, want, lens[i]) != 0;
+    }
+    ctr_drbg_uninstantiate(&d);
+    return bad;
+}
+
+/*
+ * check_limits() - checks the request limit and the reseed interval
+ */
+static int check_limits(void)
+{
+    static uint8_t out[DRBG_MAX_REQUEST + 1];
+    uint8_t entropy[DRBG_SEEDLEN];
+    ctr_drbg d;
+    int bad = 0;
+
+    arc4random_buf(entropy, sizeof(entropy));
+    ctr_drbg_instantiate(&d, entropy, NULL);
+    bad |= ctr_drbg_generate(&d, out, DRBG_MAX_REQUEST + 1, NULL) != -1;
+    d.reseed_counter = DRBG_RESEED_INTERVAL;
+    bad |= ctr_drbg_generate(&d, out, 16, NULL) != 0;
+    bad |= ctr_drbg_generate(&d, out, 16, NULL) != 1;
+    ctr_drbg_reseed(&d, entropy, NULL);
+    bad |= ctr_drbg_generate(&d, out, 16, NULL) != 0;
+    ctr_drbg_uninstantiate(&d);
+    return bad;
+}
+
+static int cmp_block(const void *a, const void *b)
+{
+    return memcmp(a, b, BLOCKLEN);
+}
+
+/*
+ * check_bytes() - checks that drbg_bytes() never hands out the same block twice
+ * 작은 요청으로 버퍼를 일부 쓴 뒤 버퍼보다 큰 요청 (바로 만드는 경로)과 작은 요청을 섞어 받고,
+ * 모든 16 바이트 블록을 정렬해 겹치는 것이 없는지 본다.
+ */
+static int check_bytes(void)
+{
+    const size_t sizes[] = {16, 48, DRBG_BUFSIZE, 32, 3*DRBG_BUFSIZE + 16, 16, DRBG_BUFSIZE - 16, 2*DRBG_BUFSIZE};
+    size_t total = 0, off = 0;
+    uint8_t *out;
+    int bad = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        total += sizes[i];
+    if ((out = malloc(total)) == NULL)
+        return 1;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        drbg_bytes(out + off, sizes[i]);
+        off += sizes[i];
+    }
+    qsort(out, total / BLOCKLEN, BLOCKLEN, cmp_block);
+    for (size_t i = 1; i < total / BLOCKLEN; i++)
+        bad |= memcmp(out + BLOCKLEN*(i-1), out + BLOCKLEN*i, BLOCKLEN) == 0;
+    free(out);
+    return bad;
+}
+
+/*
+ * check_fork() - checks that a forked child does not repeat the parent's next output
+ */
+static int check_fork(void)
+{
+    uint8_t mine[64], theirs[64];
+    int fd[2], status;
+    pid_t pid;
+
+    drbg_bytes(mine, 16);
+    if (pipe(fd) != 0 || (pid = fork()) < 0)
+        return 1;
+    if (pid == 0) {
+        close(fd[0]);
+        drbg_bytes(theirs, sizeof(theirs));
+        _exit(write(fd[1], theirs, sizeof(theirs)) != sizeof(theirs));
+    }
+    close(fd[1]);
+    drbg_bytes(mine, sizeof(mine));
+    if (read(fd[0], theirs, sizeof(theirs)) != sizeof(theirs))
+        memcpy(theirs, mine, sizeof(mine));
+    close(fd[0]);
+    waitpid(pid, &status, 0);
+    return memcmp(mine, theirs, sizeof(mine)) == 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+int main(void)
+{
+    const int masks[] = {AES_NI, 0};
+    const char *names[] = {"AES-NI vs reference", "generic vs reference"};
+    int features = aes_accel_features(), bad, fail = 0;
+
+    for (size_t k = 0; k < sizeof(masks) / sizeof(masks[0]); k++) {
+        // CPU가 지원하지 않는 백엔드는 건너뜀
+        if ((masks[k] & features) != masks[k])
+            continue;
+        aes_accel_restrict(masks[k]);
+        bad = 0;
+        for (int i = 0; i < ROUNDS; i++)
+            bad |= check_ref(i & 1);
+        printf("CTR_DRBG %-30s -- %s\n", names[k], bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    aes_accel_restrict(features);
+    bad = check_limits();
+    printf("CTR_DRBG %-30s -- %s\n", "request limit, reseed", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    bad = check_bytes();
+    printf("CTR_DRBG %-30s -- %s\n", "drbg_bytes no repeated block", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    bad = check_fork();
+    printf("CTR_DRBG %-30s -- %s\n", "fork child differs", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    return fail;
+}
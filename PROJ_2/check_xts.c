@@ -0,0 +1,284 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * XTS-AES-128 교차 검증 : IEEE 1619 부록 B의 검증 데이터 (벡터 1-4, 15-18)로 암호화와 복호화를 확인하고,
+ * 여러 섹터를 스레드로 나누는 xts_crypt_sectors()가 섹터마다 xts_crypt()를 부른 결과와 같은지 본다.
+ * 무작위 키와 섹터 번호에서는 트윅을 바이트 단위로 한 블록씩 두 배 하는 참조 구현과 비교하며, 길이는
+ * 짧은 블록 0-15 바이트와 XTS_CHUNK 경계 앞뒤를 모두 지난다. 길이가 범위를 벗어나면 -1을 리턴하는지,
+ * 스레드 수가 섹터를 고르게 나누지 못하거나 섹터보다 많을 때도 결과가 같은지 확인한다.
+ * 벡터 2-4와 15-18은 OpenSSL EVP_aes_128_xts()의 결과와도 같다 (벡터 1은 Key1 = Key2라서 OpenSSL이 거부한다).
+ * make check가 SSE2 트윅 계산으로 한 번 (check_xts), xts.c를 -U__SSE2__로 다시 컴파일한 스칼라 트윅
+ * 계산으로 한 번 (check_xts_scalar) 실행한다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "xts.h"
+
+#include <bsd/stdlib.h>
+
+/*
+ * 평문이 NULL이면 0x00, 0x01, ..., 0xff, 0x00, ... 순서의 바이트이다.
+ */
+static const struct {
+    const char *name, *key1, *key2;
+    uint64_t sector;
+    const char *pt, *ct;
+} kat[] = {
+    {"IEEE 1619 vector 1",
+     "00000000000000000000000000000000", "00000000000000000000000000000000", 0,
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "917cf69ebd68b2ec9b9fe9a3eadda692cd43d2f59598ed858c02c2652fbf922e"},
+    {"IEEE 1619 vector 2",
+     "11111111111111111111111111111111", "22222222222222222222222222222222", 0x3333333333,
+     "4444444444444444444444444444444444444444444444444444444444444444",
+     "c454185e6a16936e39334038acef838bfb186fff7480adc4289382ecd6d394f0"},
+    {"IEEE 1619 vector 3",
+     "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0", "22222222222222222222222222222222", 0x3333333333,
+     "4444444444444444444444444444444444444444444444444444444444444444",
+     "af85336b597afc1a900b2eb21ec949d292df4c047e0b21532186a5971a227a89"},
+    {"IEEE 1619 vector 4",
+     "27182818284590452353602874713526", "31415926535897932384626433832795", 0,
+     NULL,
+     "27a7479befa1d476489f308cd4cfa6e2a96e4bbe3208ff25287dd3819616e89c"
+     "c78cf7f5e543445f8333d8fa7f56000005279fa5d8b5e4ad40e736ddb4d35412"
+     "328063fd2aab53e5ea1e0a9f332500a5df9487d07a5c92cc512c8866c7e860ce"
+     "93fdf166a24912b422976146ae20ce846bb7dc9ba94a767aaef20c0d61ad0265"
+     "5ea92dc4c4e41a8952c651d33174be51a10c421110e6d81588ede82103a252d8"
+     "a750e8768defffed9122810aaeb99f9172af82b604dc4b8e51bcb08235a6f434"
+     "1332e4ca60482a4ba1a03b3e65008fc5da76b70bf1690db4eae29c5f1badd03c"
+     "5ccf2a55d705ddcd86d449511ceb7ec30bf12b1fa35b913f9f747a8afd1b130e"
+     "94bff94effd01a91735ca1726acd0b197c4e5b03393697e126826fb6bbde8ecc"
+     "1e08298516e2c9ed03ff3c1b7860f6de76d4cecd94c8119855ef5297ca67e9f3"
+     "e7ff72b1e99785ca0a7e7720c5b36dc6d72cac9574c8cbbc2f801e23e56fd344"
+     "b07f22154beba0f08ce8891e643ed995c94d9a69c9f1b5f499027a78572aeebd"
+     "74d20cc39881c213ee770b1010e4bea718846977ae119f7a023ab58cca0ad752"
+     "afe656bb3c17256a9f6e9bf19fdd5a38fc82bbe872c5539edb609ef4f79c203e"
+     "bb140f2e583cb2ad15b4aa5b655016a8449277dbd477ef2c8d6c017db738b18d"
+     "eb4a427d1923ce3ff262735779a418f20a282df920147beabe421ee5319d0568"},
+    {"IEEE 1619 vector 15",
+     "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0", "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0", 0x123456789a,
+     NULL, "6c1625db4671522d3d7599601de7ca09ed"},
+    {"IEEE 1619 vector 16",
+     "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0", "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0", 0x123456789a,
+     NULL, "d069444b7a7e0cab09e24447d24deb1fedbf"},
+    {"IEEE 1619 vector 17",
+     "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0", "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0", 0x123456789a,
+     NULL, "e5df1351c0544ba1350b3363cd8ef4beedbf9d"},
+    {"IEEE 1619 vector 18",
+     "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0", "bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0", 0x123456789a,
+     NULL, "9d84c813f719aa2c7be3f66171c7c5c2edbf9dac"},
+};
+
+#define NKAT (sizeof(kat) / sizeof(kat[0]))
+#define MAXLEN 512
+#define SECTOR 520              /* 블록의 배수가 아닌 섹터 크기 (암호문 훔치기 포함) */
+#define NSECTORS 64
+
+/*
+ * unhex() - decodes the hex string s into p and returns the number of bytes
+ */
+static size_t unhex(const char *s, uint8_t *p)
+{
+    size_t n = strlen(s) / 2;
+
+    for (size_t i = 0; i < n; i++)
+        sscanf(s + 2*i, "%2hhx", p + i);
+    return n;
+}
+
+/*
+ * check_kat() - encrypts and decrypts one vector in place
+ */
+static int check_kat(int i)
+{
+    uint8_t k[XTS_KEYLEN], pt[MAXLEN], ct[MAXLEN], buf[MAXLEN];
+    xts_key key;
+    size_t len;
+    int bad = 0;
+
+    unhex(kat[i].key1, k);
+    unhex(kat[i].key2, k + KEYLEN);
+    len = unhex(kat[i].ct, ct);
+    if (kat[i].pt != NULL)
+        unhex(kat[i].pt, pt);
+    else
+        for (size_t j = 0; j < len; j++)
+            pt[j] = (uint8_t)j;
+
+    xts_init(&key, k);
+    memcpy(buf, pt, len);
+    bad |= xts_crypt(&key, buf, len, kat[i].sector, ENCRYPT) != 0;
+    bad |= memcmp(buf, ct, len) != 0;
+    bad |= xts_crypt(&key, buf, len, kat[i].sector, DECRYPT) != 0;
+    bad |= memcmp(buf, pt, len) != 0;
+    xts_clear(&key);
+    return bad;
+}
+
+/*
+ * ref_double() - multiplies the tweak by x in GF(2^128), one byte at a time (IEEE 1619 5.2)
+ */
+static void ref_double(uint8_t *T)
+{
+    uint8_t carry = 0, c;
+
+    for (int i = 0; i < BLOCKLEN; i++) {
+        c = T[i] >> 7;
+        T[i] = (uint8_t)(T[i] << 1) | carry;
+        carry = c;
+    }
+    if (carry)
+        T[0] ^= 0x87;
+}
+
+/*
+ * ref_crypt() - XTS-AES of one sector with Cipher() per block and one tweak at a time
+ */
+static void ref_crypt(const xts_key *key, uint8_t *data, size_t len, uint64_t sector, int mode)
+{
+    uint8_t T[BLOCKLEN], Tn[BLOCKLEN], cc[BLOCKLEN], *last, *tail, *a, *b;
+    size_t m = len / BLOCKLEN, r = len % BLOCKLEN, full = r ? m - 1 : m;
+
+    for (int i = 0; i < BLOCKLEN; i++)
+        T[i] = i < 8 ? (uint8_t)(sector >> 8*i) : 0;
+    Cipher(T, key->rk2, ENCRYPT);
+    for (size_t j = 0; j < full; j++, ref_double(T)) {
+        for (int i = 0; i < BLOCKLEN; i++)
+            data[BLOCKLEN*j + i] ^= T[i];
+        Cipher(data + BLOCKLEN*j, key->rk1, mode);
+        for (int i = 0; i < BLOCKLEN; i++)
+            data[BLOCKLEN*j + i] ^= T[i];
+    }
+    if (r == 0)
+        return;
+
+    // 암호화는 T_(m-1), T_m 순서로, 복호화는 T_m, T_(m-1) 순서로 씀
+    memcpy(Tn, T, BLOCKLEN);
+    ref_double(Tn);
+    a = (mode == ENCRYPT) ? T : Tn;
+    b = (mode == ENCRYPT) ? Tn : T;
+    last = data + BLOCKLEN*(m - 1);
+    tail = data + BLOCKLEN*m;
+    for (int i = 0; i < BLOCKLEN; i++)
+        cc[i] = last[i] ^ a[i];
+    Cipher(cc, key->rk1, mode);
+    for (int i = 0; i < BLOCKLEN; i++)
+        cc[i] ^= a[i];
+    for (int i = 0; i < BLOCKLEN; i++)
+        last[i] = (i < (int)r ? tail[i] : cc[i]) ^ b[i];
+    memcpy(tail, cc, r);
+    Cipher(last, key->rk1, mode);
+    for (int i = 0; i < BLOCKLEN; i++)
+        last[i] ^= b[i];
+}
+
+/*
+ * check_ref() - compares xts_crypt() with ref_crypt() for every tail length around the chunk boundaries
+ */
+static int check_ref(void)
+{
+    static uint8_t p[(2*XTS_CHUNK + 2) * BLOCKLEN], a[sizeof(p)], b[sizeof(p)];
+    const size_t blocks[] = {1, 2, 3, XTS_CHUNK - 1, XTS_CHUNK, XTS_CHUNK + 1, 2*XTS_CHUNK + 1};
+    uint8_t k[XTS_KEYLEN];
+    uint64_t sector;
+    xts_key key;
+    size_t len;
+    int bad = 0;
+
+    arc4random_buf(k, sizeof(k));
+    xts_init(&key, k);
+    for (size_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++)
+        for (size_t r = 0; r < BLOCKLEN; r++) {
+            len = BLOCKLEN*blocks[i] + r;
+            arc4random_buf(p, len);
+            arc4random_buf(&sector, sizeof(sector));
+            memcpy(a, p, len);
+            memcpy(b, p, len);
+            bad |= xts_crypt(&key, a, len, sector, ENCRYPT) != 0;
+            ref_crypt(&key, b, len, sector, ENCRYPT);
+            bad |= memcmp(a, b, len) != 0;
+            bad |= xts_crypt(&key, a, len, sector, DECRYPT) != 0;
+            ref_crypt(&key, b, len, sector, DECRYPT);
+            bad |= memcmp(a, p, len) != 0 || memcmp(b, p, len) != 0;
+        }
+    xts_clear(&key);
+    return bad;
+}
+
+/*
+ * check_limits() - checks that lengths outside BLOCKLEN..XTS_MAX_LEN are rejected
+ */
+static int check_limits(void)
+{
+    uint8_t k[XTS_KEYLEN] = {0}, buf[BLOCKLEN] = {0};
+    xts_key key;
+    int bad = 0;
+
+    xts_init(&key, k);
+    bad |= xts_crypt(&key, buf, BLOCKLEN - 1, 0, ENCRYPT) != -1;
+    bad |= xts_crypt(&key, buf, XTS_MAX_LEN + 1, 0, ENCRYPT) != -1;
+    bad |= xts_crypt_sectors(&key, buf, BLOCKLEN - 1, 1, 0, ENCRYPT, 1) != -1;
+    bad |= xts_crypt_sectors(&key, buf, XTS_MAX_LEN + 1, 1, 0, ENCRYPT, 1) != -1;
+    xts_clear(&key);
+    return bad;
+}
+
+/*
+ * check_sectors() - compares xts_crypt_sectors() on nthreads threads with xts_crypt() per sector
+ * 섹터 수는 nsectors, 0 이하의 nthreads는 온라인 코어 수이다.
+ */
+static int check_sectors(size_t nsectors, int nthreads)
+{
+    static uint8_t a[SECTOR*NSECTORS], b[SECTOR*NSECTORS], p[SECTOR*NSECTORS];
+    uint8_t k[XTS_KEYLEN];
+    uint64_t first = 0xfffffffffffffff0;    /* 섹터 번호가 2^64에서 한 바퀴 돈다 */
+    xts_key key;
+    int bad = 0;
+
+    arc4random_buf(k, sizeof(k));
+    arc4random_buf(p, sizeof(p));
+    xts_init(&key, k);
+    memcpy(a, p, sizeof(p));
+    memcpy(b, p, sizeof(p));
+    bad |= xts_crypt_sectors(&key, a, SECTOR, nsectors, first, ENCRYPT, nthreads) != 0;
+    for (size_t i = 0; i < nsectors; i++)
+        bad |= xts_crypt(&key, b + SECTOR*i, SECTOR, first + i, ENCRYPT) != 0;
+    bad |= memcmp(a, b, sizeof(a)) != 0;
+    bad |= xts_crypt_sectors(&key, a, SECTOR, nsectors, first, DECRYPT, nthreads) != 0;
+    bad |= memcmp(a, p, sizeof(p)) != 0;
+    xts_clear(&key);
+    return bad;
+}
+
+int main(void)
+{
+    // 고르게 나뉘는 경우, 나머지가 있는 경우, 섹터보다 스레드가 많은 경우, 코어 수
+    const struct { size_t nsectors; int nthreads; } split[] = {{NSECTORS, 4}, {NSECTORS - 5, 3}, {20, 64}, {NSECTORS, 0}};
+    char label[64];
+    int bad, fail = 0;
+
+    for (size_t i = 0; i < NKAT; i++) {
+        bad = check_kat(i);
+        printf("XTS %-28s -- %s\n", kat[i].name, bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    bad = check_ref();
+    printf("XTS %-28s -- %s\n", "random vs reference", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    bad = check_limits();
+    printf("XTS %-28s -- %s\n", "length limits", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    for (size_t i = 0; i < sizeof(split) / sizeof(split[0]); i++) {
+        bad = check_sectors(split[i].nsectors, split[i].nthreads);
+        if (split[i].nthreads > 0)
+            snprintf(label, sizeof(label), "%zu sectors on %d threads", split[i].nsectors, split[i].nthreads);
+        else
+            snprintf(label, sizeof(label), "%zu sectors on all cores", split[i].nsectors);
+        printf("XTS %-28s -- %s\n", label, bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    return fail;
+}
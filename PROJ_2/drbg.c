@@ -0,0 +1,263 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "aes.h"
+#include "drbg.h"
+
+#include <bsd/stdlib.h>
+
+#if RNDKEYSIZE != DRBG_RNDKEYSIZE || KEYLEN != DRBG_KEYLEN || BLOCKLEN != DRBG_OUTLEN
+#error "drbg.h does not match the AES parameters in aes.h"
+#endif
+
+/*
+ * increment() - V = (V + 1) mod 2^128, V는 빅 엔디언
+ */
+static void increment(uint8_t *V)
+{
+    for (int i = DRBG_OUTLEN - 1; i >= 0; i--)
+        if (++V[i] != 0)
+            break;
+}
+
+/*
+ * ctr_drbg_update() - CTR_DRBG_Update (10.2.1.2)
+ * temp = E(Key, V+1) || E(Key, V+2)에 provided_data를 XOR한 뒤 앞 16 바이트를 새 Key, 뒤 16 바이트를 새 V로 한다.
+ * provided_data가 NULL이면 0으로 본다.
+ */
+static void ctr_drbg_update(ctr_drbg *d, const uint8_t *provided)
+{
+    uint8_t temp[DRBG_SEEDLEN];
+
+    for (int i = 0; i < DRBG_SEEDLEN; i += DRBG_OUTLEN) {
+        increment(d->V);
+        memcpy(temp + i, d->V, DRBG_OUTLEN);
+    }
+    CipherBlocks(temp, DRBG_SEEDLEN / DRBG_OUTLEN, d->rk);
+    if (provided)
+        for (int i = 0; i < DRBG_SEEDLEN; i++)
+            temp[i] ^= provided[i];
+    KeyExpansion(temp, d->rk);
+    memcpy(d->V, temp + DRBG_KEYLEN, DRBG_OUTLEN);
+    explicit_bzero(temp, sizeof(temp));
+}
+
+/*
+ * ctr_drbg_instantiate() - CTR_DRBG_Instantiate_algorithm without a derivation function (10.2.1.3.1)
+ * entropy는 DRBG_SEEDLEN 바이트, pers는 DRBG_SEEDLEN 바이트의 개인화 문자열이거나 NULL이다.
+ */
+void ctr_drbg_instantiate(ctr_drbg *d, const uint8_t *entropy, const uint8_t *pers)
+{
+    uint8_t seed[DRBG_SEEDLEN], key[DRBG_KEYLEN] = {0};
+
+    for (int i = 0; i < DRBG_SEEDLEN; i++)
+        seed[i] = entropy[i] ^ (pers ? pers[i] : 0);
+    KeyExpansion(key, d->rk);
+    memset(d->V, 0, DRBG_OUTLEN);
+    ctr_drbg_update(d, seed);
+    d->reseed_counter = 1;
+    explicit_bzero(seed, sizeof(seed));
+}
+
+/*
+ * ctr_drbg_reseed() - CTR_DRBG_Reseed_algorithm without a derivation function (10.2.1.4.1)
+ */
+void ctr_drbg_reseed(ctr_drbg *d, const uint8_t *entropy, const uint8_t *add)
+{
+    uint8_t seed[DRBG_SEEDLEN];
+
+    for (int i = 0; i < DRBG_SEEDLEN; i++)
+        seed[i] = entropy[i] ^ (add ? add[i] : 0);
+    ctr_drbg_update(d, seed);
+    d->reseed_counter = 1;
+    explicit_bzero(seed, sizeof(seed));
+}
+
+/*
+ * ctr_drbg_generate() - CTR_DRBG_Generate_algorithm without a derivation function (10.2.1.5.1)
+ * out에 len 바이트를 만들고, 끝에 Update로 Key와 V를 바꾸어 지난 출력을 되짚을 수 없게 한다.
+ * add는 DRBG_SEEDLEN 바이트의 추가 입력이거나 NULL이다.
+ * It returns 1 if a reseed is required, -1 if len > DRBG_MAX_REQUEST, otherwise 0.
+ */
+int ctr_drbg_generate(ctr_drbg *d, void *_out, size_t len, const uint8_t *add)
+{
+    uint8_t *out = _out, block[DRBG_OUTLEN];
+    size_t n;
+
+    if (len > DRBG_MAX_REQUEST)
+        return -1;
+    if (d->reseed_counter > DRBG_RESEED_INTERVAL)
+        return 1;
+    if (add)
+        ctr_drbg_update(d, add);
+
+    // 블록 단위는 카운터를 out에 모두 채운 뒤 CipherBlocks() 한 번으로 암호화하고, 남는 부분만 block을 거침
+    n = len / DRBG_OUTLEN;
+    for (size_t i = 0; i < n; i++) {
+        increment(d->V);
+        memcpy(out + DRBG_OUTLEN*i, d->V, DRBG_OUTLEN);
+    }
+    CipherBlocks(out, n, d->rk);
+    if (len % DRBG_OUTLEN) {
+        increment(d->V);
+        memcpy(block, d->V, DRBG_OUTLEN);
+        CipherBlocks(block, 1, d->rk);
+        memcpy(out + DRBG_OUTLEN*n, block, len % DRBG_OUTLEN);
+        explicit_bzero(block, sizeof(block));
+    }
+    ctr_drbg_update(d, add);
+    d->reseed_counter++;
+    return 0;
+}
+
+void ctr_drbg_uninstantiate(ctr_drbg *d)
+{
+    explicit_bzero(d, sizeof(ctr_drbg));
+}
+
+/*
+ * 스레드별 인스턴스
+ * fork_gen은 fork() 자식에서 하나씩 늘어나며, 인스턴스를 만든 때의 값과 다르면 fork 뒤로 보고 다시 초기화한다.
+ */
+struct drbg_thread {
+    ctr_drbg drbg;
+    unsigned long gen;
+    size_t pos;                         /* buf에서 이미 내준 바이트 수 */
+    unsigned char buf[DRBG_BUFSIZE];
+};
+
+static pthread_key_t drbg_key;
+static pthread_once_t drbg_once = PTHREAD_ONCE_INIT;
+static volatile unsigned long fork_gen;
+
+static void drbg_free(void *p)
+{
+    explicit_bzero(p, sizeof(struct drbg_thread));
+    free(p);
+}
+
+static void drbg_atfork_child(void)
+{
+    fork_gen++;
+}
+
+static void drbg_key_create(void)
+{
+    pthread_key_create(&drbg_key, drbg_free);
+    pthread_atfork(NULL, NULL, drbg_atfork_child);
+}
+
+static void drbg_seed(struct drbg_thread *t)
+{
+    uint8_t entropy[DRBG_SEEDLEN];
+
+    arc4random_buf(entropy, sizeof(entropy));
+    ctr_drbg_instantiate(&t->drbg, entropy, NULL);
+    explicit_bzero(entropy, sizeof(entropy));
+    explicit_bzero(t->buf, sizeof(t->buf));
+    t->pos = DRBG_BUFSIZE;
+    t->gen = fork_gen;
+}
+
+/*
+ * drbg_get() - returns the calling thread's instance, creating or reseeding it as needed
+ * 메모리가 없으면 NULL을 리턴하고, 호출한 쪽은 arc4random_buf()로 대신한다.
+ */
+static struct drbg_thread *drbg_get(void)
+{
+    struct drbg_thread *t;
+
+    pthread_once(&drbg_once, drbg_key_create);
+    if ((t = pthread_getspecific(drbg_key)) != NULL) {
+        if (t->gen != fork_gen)
+            drbg_seed(t);
+        return t;
+    }
+    if ((t = malloc(sizeof(struct drbg_thread))) == NULL)
+        return NULL;
+    drbg_seed(t);
+    if (pthread_setspecific(drbg_key, t) != 0) {
+        drbg_free(t);
+        return NULL;
+    }
+    return t;
+}
+
+/*
+ * generate() - Generate with a reseed from arc4random_buf() whenever the interval has run out
+ */
+static void generate(struct drbg_thread *t, void *out, size_t len)
+{
+    uint8_t entropy[DRBG_SEEDLEN];
+
+    while (ctr_drbg_generate(&t->drbg, out, len, NULL) == 1) {
+        arc4random_buf(entropy, sizeof(entropy));
+        ctr_drbg_reseed(&t->drbg, entropy, NULL);
+        explicit_bzero(entropy, sizeof(entropy));
+    }
+}
+
+/*
+ * drbg_bytes() - fills buf with len random bytes from the calling thread's CTR_DRBG
+ * 버퍼 크기 이상인 요청은 버퍼에 남은 바이트와 관계없이 버퍼를 거치지 않고, Generate가 카운터 블록을
+ * buf에 바로 채워 CipherBlocks()로 암호화하게 한다 (DRBG_MAX_REQUEST 바이트씩). 복사와 지우기가 없고
+ * 남은 버퍼는 다음 작은 요청이 쓴다.
+ */
+void drbg_bytes(void *_buf, size_t len)
+{
+    struct drbg_thread *t;
+    unsigned char *buf = _buf;
+    size_t n;
+
+    if ((t = drbg_get()) == NULL) {
+        arc4random_buf(buf, len);
+        return;
+    }
+    while (len >= DRBG_BUFSIZE) {
+        n = (len < DRBG_MAX_REQUEST) ? len : DRBG_MAX_REQUEST;
+        generate(t, buf, n);
+        buf += n;
+        len -= n;
+    }
+    while (len > 0) {
+        if (t->pos == DRBG_BUFSIZE) {
+            generate(t, t->buf, DRBG_BUFSIZE);
+            t->pos = 0;
+        }
+        n = (len < DRBG_BUFSIZE - t->pos) ? len : DRBG_BUFSIZE - t->pos;
+        memcpy(buf, t->buf + t->pos, n);
+        explicit_bzero(t->buf + t->pos, n);
+        t->pos += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+uint32_t drbg_u32(void)
+{
+    uint32_t r;
+
+    drbg_bytes(&r, sizeof(r));
+    return r;
+}
+
+/*
+ * drbg_uniform() - returns a uniform random number less than upper (0 if upper < 2)
+ * arc4random_uniform()과 같이 2^32 mod upper보다 작은 값을 버려 치우침을 없앤다.
+ */
+uint32_t drbg_uniform(uint32_t upper)
+{
+    uint32_t r, min;
+
+    if (upper < 2)
+        return 0;
+    min = -upper % upper;
+    do {
+        r = drbg_u32();
+    } while (r < min);
+    return r % upper;
+}
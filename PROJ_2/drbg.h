@@ -0,0 +1,50 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef DRBG_H
+#define DRBG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * NIST SP 800-90A CTR_DRBG (AES-128, 유도 함수 없음)
+ * 블록 암호는 aes.c의 CipherBlocks() (여러 카운터 블록을 한 번에 암호화, AES-NI가 있으면 그것으로)이며,
+ * 내부 상태는 키 Key (16 바이트)와 카운터 V (16 바이트)이다.
+ * 엔트로피 입력은 arc4random_buf()에서 seedlen = 32 바이트를 받으므로 완전 엔트로피로 보고
+ * 유도 함수를 쓰지 않는다 (10.2.1). 예측 저항은 제공하지 않는다.
+ *
+ * drbg_bytes(), drbg_u32(), drbg_uniform()은 arc4random_buf(), arc4random(), arc4random_uniform()을
+ * 대신한다. 스레드마다 인스턴스 하나와 DRBG_BUFSIZE 바이트 버퍼를 두어 Generate 한 번으로 버퍼를
+ * 채우고, 작은 요청은 버퍼에서 잘라 준 뒤 그 자리를 지운다. 버퍼 크기 이상인 요청은 호출한 쪽 버퍼에
+ * 바로 만든다. fork() 뒤 자식은 처음 호출할 때 버퍼를 버리고 새 엔트로피로 다시 초기화하므로
+ * 부모와 같은 값을 내지 않는다.
+ */
+#define DRBG_KEYLEN 16                  /* AES-128 키 길이 */
+#define DRBG_OUTLEN 16                  /* 블록 길이 */
+#define DRBG_SEEDLEN 32                 /* keylen + outlen */
+#define DRBG_RNDKEYSIZE 44              /* 라운드 키 워드 수, aes.h의 RNDKEYSIZE */
+#define DRBG_MAX_REQUEST 65536          /* Generate 한 번의 최대 바이트 수 (2^19 비트) */
+#define DRBG_RESEED_INTERVAL 4096       /* 다시 시드를 넣기 전까지의 Generate 횟수 */
+#define DRBG_BUFSIZE 4096               /* 스레드별 출력 버퍼 */
+
+/*
+ * ctr_drbg - CTR_DRBG 인스턴스 하나의 내부 상태
+ */
+typedef struct {
+    uint32_t rk[DRBG_RNDKEYSIZE];       /* Key의 라운드 키 */
+    uint8_t V[DRBG_OUTLEN];
+    uint64_t reseed_counter;
+} ctr_drbg;
+
+void ctr_drbg_instantiate(ctr_drbg *d, const uint8_t *entropy, const uint8_t *pers);
+void ctr_drbg_reseed(ctr_drbg *d, const uint8_t *entropy, const uint8_t *add);
+int ctr_drbg_generate(ctr_drbg *d, void *out, size_t len, const uint8_t *add);
+void ctr_drbg_uninstantiate(ctr_drbg *d);
+
+void drbg_bytes(void *buf, size_t len);
+uint32_t drbg_u32(void);
+uint32_t drbg_uniform(uint32_t upper);
+
+#endif
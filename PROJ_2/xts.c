@@ -0,0 +1,220 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "xts.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * xts_init() - expands both halves of the XTS_KEYLEN-byte key k = Key1 || Key2
+ */
+void xts_init(xts_key *key, const uint8_t *k)
+{
+    KeyExpansion(k, key->rk1);
+    KeyExpansion(k + KEYLEN, key->rk2);
+}
+
+void xts_clear(xts_key *key)
+{
+    explicit_bzero(key, sizeof(xts_key));
+}
+
+/*
+ * tweaks() - writes T, T*x, ..., T*x^(n-1) into t and leaves T*x^n in T
+ * 트윅은 리틀 엔디언 128 비트 수이다. 왼쪽으로 한 비트 밀 때 비트 63은 비트 64로 넘기고,
+ * 비트 127이 켜져 있으면 0x87을 더한다.
+ */
+#ifdef __SSE2__
+static void tweaks(uint8_t *T, uint8_t *t, int n)
+{
+    const __m128i poly = _mm_set_epi32(0, 1, 0, 0x87);
+    __m128i x = _mm_loadu_si128((const __m128i *)T), c;
+
+    for (int j = 0; j < n; j++) {
+        _mm_storeu_si128((__m128i *)(t + BLOCKLEN*j), x);
+        // 32 비트 칸마다 최상위 비트를 퍼뜨린 뒤 칸 3 -> 0 (0x87), 칸 1 -> 2 (1)로 옮김
+        c = _mm_shuffle_epi32(_mm_srai_epi32(x, 31), 0x13);
+        x = _mm_xor_si128(_mm_slli_epi64(x, 1), _mm_and_si128(c, poly));
+    }
+    _mm_storeu_si128((__m128i *)T, x);
+}
+#else
+static uint64_t load_le64(const uint8_t *p)
+{
+    uint64_t x = 0;
+
+    for (int i = 7; i >= 0; i--)
+        x = x << 8 | p[i];
+    return x;
+}
+
+static void store_le64(uint8_t *p, uint64_t x)
+{
+    for (int i = 0; i < 8; i++, x >>= 8)
+        p[i] = (uint8_t)x;
+}
+
+static void tweaks(uint8_t *T, uint8_t *t, int n)
+{
+    uint64_t lo = load_le64(T), hi = load_le64(T + 8), c;
+
+    for (int j = 0; j < n; j++) {
+        store_le64(t + BLOCKLEN*j, lo);
+        store_le64(t + BLOCKLEN*j + 8, hi);
+        c = hi >> 63;
+        hi = hi << 1 | lo >> 63;
+        lo = lo << 1 ^ (0x87 & -c);
+    }
+    store_le64(T, lo);
+    store_le64(T + 8, hi);
+}
+#endif
+
+/*
+ * xor_blocks() - p[j] ^= t[j] for n blocks, eight bytes at a time
+ */
+static void xor_blocks(uint8_t *p, const uint8_t *t, int n)
+{
+    uint64_t a, b;
+
+    for (int i = 0; i < BLOCKLEN*n; i += 8) {
+        memcpy(&a, p + i, 8);
+        memcpy(&b, t + i, 8);
+        a ^= b;
+        memcpy(p + i, &a, 8);
+    }
+}
+
+/*
+ * xts_crypt() - encrypts or decrypts one len-byte sector in place
+ * mode는 ENCRYPT 또는 DECRYPT이다. len이 BLOCKLEN보다 작거나 XTS_MAX_LEN보다 크면 -1, 아니면 0을 리턴한다.
+ * 훔치기가 있으면 복호화는 마지막 완전 블록에 다음 트윅을, 짧은 블록을 채운 블록에 그 앞 트윅을 쓴다.
+ */
+int xts_crypt(const xts_key *key, uint8_t *data, size_t len, uint64_t sector, int mode)
+{
+    uint8_t T[BLOCKLEN], t[XTS_CHUNK*BLOCKLEN], cc[BLOCKLEN], *last, *tail, *ta, *tb;
+    size_t m = len / BLOCKLEN, r = len % BLOCKLEN, full;
+    int n;
+
+    if (len < BLOCKLEN || len > XTS_MAX_LEN)
+        return -1;
+
+    // T = E(Key2, 섹터 번호 (리틀 엔디언))
+    for (int i = 0; i < BLOCKLEN; i++, sector >>= 8)
+        T[i] = i < 8 ? (uint8_t)sector : 0;
+    Cipher(T, key->rk2, ENCRYPT);
+
+    // 훔치기가 있으면 마지막 완전 블록은 따로 처리
+    full = r ? m - 1 : m;
+    for (size_t j = 0; j < full; j += n) {
+        n = (full - j < XTS_CHUNK) ? (int)(full - j) : XTS_CHUNK;
+        tweaks(T, t, n);
+        xor_blocks(data + BLOCKLEN*j, t, n);
+        for (int k = 0; k < n; k++)
+            Cipher(data + BLOCKLEN*(j + k), key->rk1, mode);
+        xor_blocks(data + BLOCKLEN*j, t, n);
+    }
+    if (r == 0) {
+        explicit_bzero(t, sizeof(t));
+        return 0;
+    }
+
+    // t = T_(m-1) || T_m, 암호화는 T_(m-1)을 먼저, 복호화는 T_m을 먼저 씀
+    last = data + BLOCKLEN*(m - 1);
+    tail = data + BLOCKLEN*m;
+    ta = (mode == ENCRYPT) ? t : t + BLOCKLEN;
+    tb = (mode == ENCRYPT) ? t + BLOCKLEN : t;
+    tweaks(T, t, 2);
+    memcpy(cc, last, BLOCKLEN);
+    xor_blocks(cc, ta, 1);
+    Cipher(cc, key->rk1, mode);
+    xor_blocks(cc, ta, 1);
+    // 짧은 블록은 cc의 앞 r 바이트가 되고, 짧은 블록을 cc의 뒷부분으로 채워 마지막 완전 블록을 만듦
+    memcpy(last, tail, r);
+    memcpy(last + r, cc + r, BLOCKLEN - r);
+    memcpy(tail, cc, r);
+    xor_blocks(last, tb, 1);
+    Cipher(last, key->rk1, mode);
+    xor_blocks(last, tb, 1);
+    explicit_bzero(cc, sizeof(cc));
+    explicit_bzero(t, sizeof(t));
+    return 0;
+}
+
+struct xts_job {
+    const xts_key *key;
+    uint8_t *data;
+    size_t sector_size, nsectors;
+    uint64_t first;
+    int mode;
+};
+
+static void *xts_worker(void *arg)
+{
+    struct xts_job *job = arg;
+
+    for (size_t i = 0; i < job->nsectors; i++)
+        xts_crypt(job->key, job->data + job->sector_size * i, job->sector_size, job->first + i, job->mode);
+    return NULL;
+}
+
+/*
+ * xts_crypt_sectors() - processes nsectors consecutive sectors; sector i uses number first + i
+ * nthreads가 0 이하이면 온라인 코어 수를 사용하고, 섹터가 적으면 스레드를 줄인다.
+ * 섹터 크기가 맞지 않으면 -1, 아니면 0을 리턴한다.
+ */
+int xts_crypt_sectors(const xts_key *key, uint8_t *data, size_t sector_size, size_t nsectors,
+                      uint64_t first, int mode, int nthreads)
+{
+    struct xts_job *job;
+    pthread_t *tid;
+    size_t chunk;
+    int t, started;
+
+    if (sector_size < BLOCKLEN || sector_size > XTS_MAX_LEN)
+        return -1;
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)nthreads > nsectors / XTS_MIN_SECTORS)
+        nthreads = (int)(nsectors / XTS_MIN_SECTORS);
+    if (nthreads <= 1) {
+        struct xts_job one = {key, data, sector_size, nsectors, first, mode};
+
+        xts_worker(&one);
+        return 0;
+    }
+
+    job = malloc(nthreads * sizeof(struct xts_job));
+    tid = malloc(nthreads * sizeof(pthread_t));
+    if (job == NULL || tid == NULL) {
+        struct xts_job one = {key, data, sector_size, nsectors, first, mode};
+
+        free(job); free(tid);
+        xts_worker(&one);
+        return 0;
+    }
+    chunk = (nsectors + nthreads - 1) / nthreads;
+    for (t = 0; t < nthreads; t++) {
+        size_t lo = (chunk * t < nsectors) ? chunk * t : nsectors;
+        size_t hi = (chunk * (t+1) < nsectors) ? chunk * (t+1) : nsectors;
+
+        job[t] = (struct xts_job){key, data + sector_size * lo, sector_size, hi - lo, first + lo, mode};
+    }
+
+    // 마지막 구간은 호출한 스레드가 직접 처리, 스레드 생성에 실패한 구간도 직접 처리
+    for (started = 0; started < nthreads-1; started++)
+        if (pthread_create(&tid[started], NULL, xts_worker, &job[started]) != 0)
+            break;
+    for (t = started; t < nthreads; t++)
+        xts_worker(&job[t]);
+    for (t = 0; t < started; t++)
+        pthread_join(tid[t], NULL);
+    free(job); free(tid);
+    return 0;
+}
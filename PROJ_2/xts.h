@@ -0,0 +1,39 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef XTS_H
+#define XTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes.h"
+
+/*
+ * XTS-AES (IEEE 1619, NIST SP 800-38E)
+ * 키는 KEYLEN 바이트 두 개 (Key1 || Key2)이며, Key1로 데이터를, Key2로 섹터 번호를 암호화한다.
+ * aes.c가 128 비트 키만 다루므로 XTS-AES-128이다. 섹터 (데이터 단위) 하나는 BLOCKLEN 바이트 이상이고,
+ * 길이가 블록의 배수가 아니면 마지막 두 블록은 암호문 훔치기 (ciphertext stealing)로 처리한다.
+ * 섹터 i의 트윅은 T = E(Key2, i)이고 블록마다 GF(2^128)에서 x를 곱한다 (x^128 + x^7 + x^2 + x + 1).
+ * 트윅은 XTS_CHUNK 블록씩 미리 구해 두고, x86이면 SSE2로 한 번에 두 배를 한다.
+ */
+#define XTS_KEYLEN (2*KEYLEN)
+#define XTS_MAX_LEN (BLOCKLEN << 20)    /* 섹터 하나의 최대 바이트 수 (2^20 블록) */
+#define XTS_CHUNK 32                    /* 트윅을 미리 구해 두는 블록 수 */
+#define XTS_MIN_SECTORS 8               /* 스레드 하나가 맡는 최소 섹터 수 */
+
+/*
+ * xts_key - 두 키의 라운드 키
+ */
+typedef struct {
+    uint32_t rk1[RNDKEYSIZE];       /* 데이터 키 Key1 */
+    uint32_t rk2[RNDKEYSIZE];       /* 트윅 키 Key2 */
+} xts_key;
+
+void xts_init(xts_key *key, const uint8_t *k);
+void xts_clear(xts_key *key);
+int xts_crypt(const xts_key *key, uint8_t *data, size_t len, uint64_t sector, int mode);
+int xts_crypt_sectors(const xts_key *key, uint8_t *data, size_t sector_size, size_t nsectors,
+                      uint64_t first, int mode, int nthreads);
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "instr.h"
+
+#ifdef INSTRUMENT
+
+__thread struct instr_thread *instr_self;
+
+static const char *const names[INSTR_NIDS] = {
+    "euclid", "aes_key_expansion", "aes_encrypt", "aes_decrypt",
+    "mod_pow", "mod_mul", "miller_rabin", "miller_rabin_composite",
+    "mRSA_generate_key", "mRSA_candidate", "mRSA_cipher", "mRSA_cipher_batch",
+    "mRSA128_private", "mRSA128_public",
+    "rsa_generate_key", "prime_test", "prime_reject",
+    "rsa_cipher_import", "rsa_cipher_powm", "rsa_cipher_export", "rsa_cipher_crt", "rsa_cipher_pub",
+    "rsa_bn_powm", "rsa_pss_hash", "mgf", "pss_sign", "pss_verify"
+};
+
+/*
+ * 스레드마다 처음 기록할 때 카운터 블록을 만들어 목록에 넣고, 스레드가 끝나면
+ * 키 소멸자가 그 값을 retired에 더한 뒤 목록에서 뺀다. 목록과 retired는 lock으로 보호한다.
+ */
+static struct instr_thread *threads;
+static instr_stat retired[INSTR_NIDS];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+static void stat_add(instr_stat *d, const instr_stat *s)
+{
+    d->count += s->count;
+    d->cycles += s->cycles;
+    for (int b = 0; b < INSTR_BUCKETS; b++)
+        d->hist[b] += s->hist[b];
+}
+
+static void detach(void *p)
+{
+    struct instr_thread *t = p;
+
+    pthread_mutex_lock(&lock);
+    for (int i = 0; i < INSTR_NIDS; i++)
+        stat_add(&retired[i], &t->stat[i]);
+    if (t->prev)
+        t->prev->next = t->next;
+    else
+        threads = t->next;
+    if (t->next)
+        t->next->prev = t->prev;
+    pthread_mutex_unlock(&lock);
+    free(t);
+}
+
+static void key_create(void)
+{
+    pthread_key_create(&key, detach);
+}
+
+/*
+ * instr_attach() - creates and registers the calling thread's counter block
+ * 메모리가 없으면 NULL을 리턴하고 그 기록은 버린다.
+ */
+struct instr_thread *instr_attach(void)
+{
+    struct instr_thread *t;
+
+    pthread_once(&key_once, key_create);
+    if ((t = calloc(1, sizeof(*t))) == NULL)
+        return NULL;
+    pthread_mutex_lock(&lock);
+    t->next = threads;
+    if (threads)
+        threads->prev = t;
+    threads = t;
+    pthread_mutex_unlock(&lock);
+    pthread_setspecific(key, t);
+    instr_self = t;
+    return t;
+}
+
+const char *instr_name(int id)
+{
+    return (id >= 0 && id < INSTR_NIDS) ? names[id] : "";
+}
+
+/*
+ * instr_snapshot() - stores the sum over all threads into stat[0..INSTR_NIDS-1]
+ */
+void instr_snapshot(instr_stat *stat)
+{
+    pthread_mutex_lock(&lock);
+    memcpy(stat, retired, sizeof(retired));
+    for (struct instr_thread *t = threads; t; t = t->next)
+        for (int i = 0; i < INSTR_NIDS; i++)
+            stat_add(&stat[i], &t->stat[i]);
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * instr_reset() - clears every counter
+ * 다른 스레드가 기록하는 중이면 그 한 건은 남을 수 있다.
+ */
+void instr_reset(void)
+{
+    pthread_mutex_lock(&lock);
+    memset(retired, 0, sizeof(retired));
+    for (struct instr_thread *t = threads; t; t = t->next)
+        memset(t->stat, 0, sizeof(t->stat));
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * clocks_per_us() - measures the instr_clock() rate once against CLOCK_MONOTONIC
+ */
+static double clocks_per_us(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static double rate;
+    struct timespec t0, t1, d = {0, 10000000};
+    uint64_t c0, c1;
+
+    if (rate == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        c0 = instr_clock();
+        nanosleep(&d, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        c1 = instr_clock();
+        rate = (c1 - c0) / ((t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) * 1e-3);
+    }
+    return rate;
+#else
+    return 1000.0;
+#endif
+}
+
+/*
+ * percentile() - upper bound of the histogram bucket holding the q-quantile
+ */
+static uint64_t percentile(const instr_stat *s, double q)
+{
+    uint64_t want = (uint64_t)(q * s->count + 0.999999), sum = 0;
+    int b;
+
+    for (b = 0; b < INSTR_BUCKETS - 1; b++)
+        if ((sum += s->hist[b]) >= want)
+            break;
+    return b < 63 ? (uint64_t)2 << b : UINT64_MAX;
+}
+
+/*
+ * instr_dump() - prints every non-zero counter with mean, p50, p99 and the log2 histogram
+ * 이벤트 카운터 (INSTR_ADD)는 개수만 출력한다. p50, p99는 해당 구간의 상한이다.
+ */
+void instr_dump(FILE *f)
+{
+    instr_stat stat[INSTR_NIDS];
+    double rate = clocks_per_us();
+
+    instr_snapshot(stat);
+    fprintf(f, "%-24s %12s %12s %10s %10s %10s %12s\n", "instr", "count", "clk/op", "us/op", "p50 clk", "p99 clk", "total ms");
+    for (int i = 0; i < INSTR_NIDS; i++) {
+        const instr_stat *s = &stat[i];
+
+        if (s->count == 0)
+            continue;
+        if (s->cycles == 0) {
+            fprintf(f, "%-24s %12llu\n", names[i], (unsigned long long)s->count);
+            continue;
+        }
+        fprintf(f, "%-24s %12llu %12.0f %10.3f %10llu %10llu %12.3f\n", names[i], (unsigned long long)s->count,
+                (double)s->cycles / s->count, s->cycles / rate / s->count,
+                (unsigned long long)percentile(s, 0.5), (unsigned long long)percentile(s, 0.99), s->cycles / rate / 1e3);
+        fprintf(f, "%24s", "");
+        for (int b = 0; b < INSTR_BUCKETS; b++)
+            if (s->hist[b])
+                fprintf(f, " 2^%d:%llu", b, (unsigned long long)s->hist[b]);
+        fprintf(f, "\n");
+    }
+}
+
+#endif
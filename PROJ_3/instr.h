@@ -0,0 +1,139 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef INSTR_H
+#define INSTR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * 핫 경로 계측
+ * -DINSTRUMENT로 빌드하면 각 모듈의 핫 함수가 스레드별 카운터에 호출 수, 누적 시간, 그리고
+ * 시간의 log2 구간 히스토그램 (구간 b는 [2^b, 2^(b+1)) 클록)을 남긴다. 시간은 x86이면 rdtsc,
+ * 그 밖에는 clock_gettime()의 나노초이다. 스레드는 자기 카운터에만 쓰므로 락이 없고,
+ * instr_snapshot()은 살아 있는 스레드와 끝난 스레드의 카운터를 합친다 (실행 중에는 근사값).
+ * 정의하지 않으면 INSTR_BEGIN/END/ADD는 아무 코드도 만들지 않고, API는 빈 인라인 함수가 된다.
+ * 이때는 instr.c를 링크하지 않아도 된다.
+ */
+enum {
+    INSTR_EUCLID,               /* PROJ_1 xgcd(), mul_inv(), PROJ_3 umul_inv() */
+    INSTR_AES_KEY,              /* PROJ_2 KeyExpansion() */
+    INSTR_AES_ENCRYPT,          /* PROJ_2 Cipher(ENCRYPT) */
+    INSTR_AES_DECRYPT,          /* PROJ_2 Cipher(DECRYPT) */
+    INSTR_MOD_POW,              /* PROJ_3 mod_pow() */
+    INSTR_MOD_MUL,              /* PROJ_3 mod_mul() 호출 수 */
+    INSTR_MILLER_RABIN,         /* PROJ_3 miller_rabin() */
+    INSTR_MR_COMPOSITE,         /* miller_rabin()이 합성수로 판정한 수 */
+    INSTR_MRSA_KEYGEN,          /* PROJ_4 mRSA_generate_key() */
+    INSTR_MRSA_CANDIDATE,       /* mRSA_generate_key()가 검사한 소수 후보 수 */
+    INSTR_MRSA_CIPHER,          /* PROJ_4 mRSA_cipher() */
+    INSTR_MRSA_BATCH,           /* PROJ_4 mRSA_cipher_batch() */
+    INSTR_MRSA128_PRIVATE,      /* PROJ_4 mRSA128_private() */
+    INSTR_MRSA128_PUBLIC,       /* PROJ_4 mRSA128_public() */
+    INSTR_RSA_KEYGEN,           /* PROJ_5 키 생성 전체 */
+    INSTR_PRIME_TEST,           /* 체를 통과해 bpsw()로 검사한 후보 */
+    INSTR_PRIME_REJECT,         /* bpsw()가 거부한 후보 수 */
+    INSTR_RSA_IMPORT,           /* rsa_cipher()의 mpz_import() */
+    INSTR_RSA_POWM,             /* rsa_cipher()의 mpz_powm() */
+    INSTR_RSA_EXPORT,           /* rsa_cipher()의 mpz_export() */
+    INSTR_RSA_CRT,              /* rsa_cipher_crt() */
+    INSTR_RSA_PUBLIC,           /* rsa_cipher_pub() */
+    INSTR_BN_POWM,              /* rsa_bn_powm() */
+    INSTR_HASH,                 /* rsa_pss_hash() */
+    INSTR_MGF,                  /* mgf_xor() */
+    INSTR_PSS_SIGN,             /* rsassa_pss_sign(), rsassa_pss_sign_hash() */
+    INSTR_PSS_VERIFY,           /* rsassa_pss_verify_hash()의 복원과 디코딩 */
+    INSTR_NIDS
+};
+
+#define INSTR_BUCKETS 64
+
+/*
+ * instr_stat - 계측 지점 하나의 누적값
+ */
+typedef struct {
+    uint64_t count;             /* 호출 수 (INSTR_ADD는 더한 값) */
+    uint64_t cycles;            /* 누적 시간 (클록) */
+    uint64_t hist[INSTR_BUCKETS];
+} instr_stat;
+
+#ifdef INSTRUMENT
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+struct instr_thread {
+    instr_stat stat[INSTR_NIDS];
+    struct instr_thread *prev, *next;
+};
+
+extern __thread struct instr_thread *instr_self;
+struct instr_thread *instr_attach(void);
+
+static inline uint64_t instr_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*
+ * instr_record() - adds one call of c clocks to the calling thread's counter id
+ */
+static inline void instr_record(int id, uint64_t c)
+{
+    struct instr_thread *t = instr_self ? instr_self : instr_attach();
+    instr_stat *s;
+
+    if (t == NULL)
+        return;
+    s = &t->stat[id];
+    s->count++;
+    s->cycles += c;
+    s->hist[c ? 63 - __builtin_clzll(c) : 0]++;
+}
+
+/*
+ * instr_add() - adds n to the calling thread's event counter id
+ */
+static inline void instr_add(int id, uint64_t n)
+{
+    struct instr_thread *t = instr_self ? instr_self : instr_attach();
+
+    if (t)
+        t->stat[id].count += n;
+}
+
+#define INSTR_BEGIN(id) uint64_t instr_t_##id = instr_clock()
+#define INSTR_END(id) instr_record(id, instr_clock() - instr_t_##id)
+#define INSTR_ADD(id, n) instr_add(id, n)
+
+const char *instr_name(int id);
+void instr_snapshot(instr_stat *stat);
+void instr_reset(void);
+void instr_dump(FILE *f);
+
+#else
+
+#define INSTR_BEGIN(id) ((void)0)
+#define INSTR_END(id) ((void)0)
+#define INSTR_ADD(id, n) ((void)0)
+
+static inline const char *instr_name(int id) { (void)id; return ""; }
+static inline void instr_snapshot(instr_stat *stat) { memset(stat, 0, INSTR_NIDS * sizeof(instr_stat)); }
+static inline void instr_reset(void) { }
+static inline void instr_dump(FILE *f) { (void)f; }
+
+#endif
+
+#endif
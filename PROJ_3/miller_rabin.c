@@ -3,6 +3,7 @@
  * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
  */
 #include "miller_rabin.h"
+#include "instr.h"
 
 /*
  * Miller-Rabin Primality Testing against small sets of bases
@@ -13,7 +14,7 @@
  * if n < 3,317,044,064,679,887,385,961,981,
  * it is enough to test a = 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, and 41.
  */
-const uint64_t a[ALEN] = {2,3,5,7,11,13,17,19,23,29,31,37};
+const uint64_t mr_bases[ALEN] = {2,3,5,7,11,13,17,19,23,29,31,37};
 
 /*
  * miller_rabin() - Miller-Rabin Primality Test (deterministic version)
@@ -25,6 +26,7 @@ int miller_rabin(uint64_t n)
 {
     if (n % 2 == 0 && n != 2) return COMPOSITE;
 
+    INSTR_BEGIN(INSTR_MILLER_RABIN);
     int k = 0;
     uint64_t q = n-1;
 
@@ -33,8 +35,8 @@ int miller_rabin(uint64_t n)
         k++;
     }
 
-    for (int i=0; i<ALEN && a[i] < n-1; i++){
-        uint64_t x = mod_pow(a[i], q, n);
+    for (int i=0; i<ALEN && mr_bases[i] < n-1; i++){
+        uint64_t x = mod_pow(mr_bases[i], q, n);
         int count = 0;
 
         if (x == 1) continue;
@@ -46,7 +48,12 @@ int miller_rabin(uint64_t n)
             }
         }
 
-        if (count == 0) return COMPOSITE;
+        if (count == 0){
+            INSTR_END(INSTR_MILLER_RABIN);
+            INSTR_ADD(INSTR_MR_COMPOSITE, 1);
+            return COMPOSITE;
+        }
     }
+    INSTR_END(INSTR_MILLER_RABIN);
     return PRIME;
 }
@@ -11,6 +11,15 @@
 #define PRIME 1
 #define COMPOSITE 0
 
+/*
+ * 64 비트 정수 연산의 유일한 구현
+ * mod.c (모듈러 연산, gcd, 역원)와 miller_rabin.c를 PROJ_4 mRSA와 다른 모듈이 함께 쓴다.
+ * mr_bases[]는 miller_rabin()과 miller_rabin_mont()가 공유하는 결정적 검사의 밑이다.
+ */
+extern const uint64_t mr_bases[ALEN];
+
+uint64_t gcd(uint64_t a, uint64_t b);
+uint64_t umul_inv(uint64_t a, uint64_t m);
 uint64_t mod_add(uint64_t a, uint64_t b, uint64_t m);
 uint64_t mod_sub(uint64_t a, uint64_t b, uint64_t m);
 uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t m);
@@ -4,6 +4,9 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include "miller_rabin.h"
+#include "instr.h"
+
 /*
  * mod_add() - computes a+b mod m
  * a와 b가 m보다 작다는 가정하에서 a+b >= m이면 결과에서 m을 빼줘야 하므로
@@ -46,6 +49,7 @@ uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t m)
 {
     uint64_t r = 0;
 
+    INSTR_ADD(INSTR_MOD_MUL, 1);
     while (b > 0){
         if (b & 1) r = mod_add(r, a, m);
         b = b >> 1;
@@ -70,6 +74,7 @@ uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t m)
 uint64_t mod_pow(uint64_t a, uint64_t b, uint64_t m)
 {
     uint64_t r = 1;
+    INSTR_BEGIN(INSTR_MOD_POW);
 
     while (b > 0){
         if (b & 1) r = mod_mul(r, a, m);
@@ -77,5 +82,57 @@ uint64_t mod_pow(uint64_t a, uint64_t b, uint64_t m)
         a = mod_mul(a, a, m);
     }
 
+    INSTR_END(INSTR_MOD_POW);
     return r;
-}
\ No newline at end of file
+}
+
+/*
+ * gcd() - Euclidean algorithm for unsigned 64-bit integers
+ * gcd(a,b) = gcd(b,a mod b)를 a, b 중 하나가 0이 될 때까지 반복한다.
+ */
+uint64_t gcd(uint64_t a, uint64_t b)
+{
+    uint64_t temp;
+
+    while (a != 0 && b != 0){
+        temp = a;
+        a = b;
+        b = temp % b;
+    }
+
+    return (a == 0) ? b : a;
+}
+
+/*
+ * umul_inv() - computes multiplicative inverse a^-1 mod m for unsigned 64-bit integers
+ * 확장 유클리드 알고리즘이다. 부호 없는 정수에서 음수인 계수는 2^64 근처의 큰 값으로 나타나므로
+ * x2 > 2^63이면 m을 더해 양수로 돌린다. 역이 존재하지 않으면 0을 리턴한다.
+ * PROJ_1의 euclid_gf8과 PROJ_4의 mRSA가 함께 쓰는 유일한 구현이다.
+ */
+uint64_t umul_inv(uint64_t a, uint64_t m)
+{
+    uint64_t d0 = a, d1 = m;
+    uint64_t x0 = 1, x1 = 0;
+
+    uint64_t q = d0 / d1;
+    uint64_t d2 = d0 - q * d1;
+    uint64_t x2 = x0 - q * x1;
+    INSTR_BEGIN(INSTR_EUCLID);
+
+    while (d2 > 1){
+        q = d0 / d1;
+        d2 = d0 - q * d1;
+        x2 = x0 - q * x1;
+
+        d0 = d1;
+        d1 = d2;
+        x0 = x1;
+        x1 = x2;
+    }
+    INSTR_END(INSTR_EUCLID);
+
+    if (d2 == 1)
+        return (x2 > (uint64_t)1<<63 ? x2+m : x2);
+    else
+        return 0;
+}
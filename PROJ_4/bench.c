@@ -0,0 +1,918 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 모듈 전체 성능 측정 프로그램
+ * PROJ_3의 mod_pow(), miller_rabin(), 64 비트와 128 비트 mRSA, PROJ_5의 2048 비트 RSA 지수승,
+ * 키 생성, PSS 서명과 검증, PROJ_2의 AES와 CTR_DRBG (arc4random 호출과 비교)를 초당 연산 수로 비교한다.
+ * AES는 펼친 키 스케줄과 라운드 키를 그때그때 만드는 압축 문맥 (KeyCompact)을 키가 많을 때도 비교한다.
+ * XTS 항목의 ops/s는 초당 섹터 수이고, HMAC과 EtM 항목은 메시지 하나를 연산 하나로 센다.
+ * async 항목은 같은 연산을 PROJ_5의 비동기 작업 풀 (rsa_async.h)에 ASYNC_WINDOW개씩 넣고 기다린다.
+ * 2048 비트 지수승은 GMP (mpz_powm)와 고정 크기 백엔드 (rsa_bn, 이식용 C / ADX)를 함께 잰다.
+ * -t로 스레드 수를 주면 항목마다 모든 스레드가 같은 연산을 -n회씩 동시에 실행하고 합계를 보고하며,
+ * -j이면 회귀 추적용으로 결과를 JSON으로 출력한다.
+ * -DINSTRUMENT로 빌드하면 (make clean && make CPPFLAGS=-DINSTRUMENT) 끝에 함수별 계측 결과 (instr.h)를 표준 오류로 출력한다.
+ *
+ * 기본 연산은 모듈마다 한 벌만 있다 (64 비트 정수 연산은 PROJ_3의 mod.c와 miller_rabin.c).
+ * 저장소 최상위의 Makefile이 모든 모듈을 libcrypto_proj.a와 libcrypto_proj.so로 묶고 이 프로그램을 링크한다.
+ *   make PROJ_4/bench
+ * (또는 gcc -O2 -pthread -I../PROJ_2 -I../PROJ_3 -I../PROJ_5 -o bench bench.c ../libcrypto_proj.a -lgmp -lbsd -lm)
+ * ./bench [-n 반복 횟수] [-t 스레드 수] [-j]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <gmp.h>
+#include "aes.h"
+#include "drbg.h"
+#include "xts.h"
+#include "mRSA128.h"
+#include "rsa_pss.h"
+#include "rsa_bn.h"
+#include "rsa_async.h"
+#include "hmac.h"
+#include "sha2_accel.h"
+#include "etm.h"
+#include "instr.h"
+
+#include <bsd/stdlib.h>
+
+#define BATCH 4096
+#define BENCH_MAX_THREADS 64
+#define XTS_SECTORS 256            /* XTS 항목에서 한 번에 처리하는 섹터 수 */
+#define ASYNC_WINDOW 256            /* async 항목에서 한 번에 넣고 기다리는 작업 수 */
+#define AES_CONTEXTS (1 << 18)      /* 키 문맥이 많을 때의 AES 항목에서 쓰는 문맥 수 */
+#define HMAC_MSG 64                 /* HMAC 항목의 메시지 길이 */
+#define ETM_MSG (1 << 20)           /* EtM 항목의 메시지 길이 */
+
+static int json, nthreads = 1, nreport;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, long count, double sec)
+{
+    if (json)
+        printf("%s\n    {\"name\": \"%s\", \"ops\": %ld, \"seconds\": %.6f, \"ops_per_sec\": %.1f, \"us_per_op\": %.4f}",
+               nreport++ ? "," : "", name, count, sec, count / sec, sec * 1e6 / count);
+    else
+        printf("%-28s %12.0f ops/s %10.3f us/op\n", name, count / sec, sec * 1e6 / count);
+}
+
+/*
+ * 측정에 쓰는 키와 입력
+ * 스레드들은 여기서 읽기만 하고, 연산마다 바뀌는 값은 각자 지역 변수에 복사해서 쓴다.
+ */
+static struct {
+    uint64_t e, d, n;
+    mRSA_ctx ctx;
+    mRSA128_key key;
+    unsigned char e2[RSAKEYSIZE/8], d2[RSAKEYSIZE/8], n2[RSAKEYSIZE/8], m2[RSAKEYSIZE/8], s2[RSAKEYSIZE/8];
+    rsa_private_key pk;
+    rsa_public_key pub;
+    rsa_bn_ctx bn;
+    int sec;                        /* crt_unblinded()에서 mpz_powm_sec() 사용 */
+    uint8_t aeskey[KEYLEN];
+    uint32_t rk[RNDKEYSIZE];
+    aes_compact_key ck[2];          /* ENCRYPT, DECRYPT용 */
+    uint32_t (*rks)[RNDKEYSIZE];    /* AES_CONTEXTS개의 펼친 키 */
+    aes_compact_key *cks;           /* 같은 키들의 압축 문맥 */
+    xts_key xts;
+    uint8_t mackey[ETM_MACKEYLEN];
+    hmac_sha256_key hmac;
+    hmac_sha512_key hmac512;
+    etm_key etm;
+    async_pool *pool;
+} fx;
+
+static const char msg[] = "cross-module benchmark message";
+
+
+/*
+ * rsa2048_cipher() - PROJ_5의 rsa_cipher()와 같은 과정 (import, powm, export)
+ */
+static void rsa2048_cipher(void *_m, const void *_k, const void *_n)
+{
+    mpz_t m, k, n;
+
+    mpz_inits(m, k, n, NULL);
+    mpz_import(m, RSAKEYSIZE/8, 1, 1, 1, 0, _m);
+    mpz_import(k, RSAKEYSIZE/8, 1, 1, 1, 0, _k);
+    mpz_import(n, RSAKEYSIZE/8, 1, 1, 1, 0, _n);
+    mpz_powm(m, m, k, n);
+    mpz_export(_m, NULL, 1, RSAKEYSIZE/8, 1, 0, m);
+    mpz_clears(m, k, n, NULL);
+}
+
+/*
+ * crt_unblinded() - rsa_cipher_crt()에서 블라인딩을 뺀 CRT 지수승, sec이면 mpz_powm_sec() 사용
+ */
+static void crt_unblinded(void *_m, const rsa_private_key *key, int sec)
+{
+    mpz_t m, m1, m2;
+
+    mpz_inits(m, m1, m2, NULL);
+    mpz_import(m, RSAKEYSIZE/8, 1, 1, 1, 0, _m);
+    mpz_mod(m1, m, key->p);
+    mpz_mod(m2, m, key->q);
+    if (sec) {
+        mpz_powm_sec(m1, m1, key->dP, key->p);
+        mpz_powm_sec(m2, m2, key->dQ, key->q);
+    } else {
+        mpz_powm(m1, m1, key->dP, key->p);
+        mpz_powm(m2, m2, key->dQ, key->q);
+    }
+    mpz_sub(m1, m1, m2);
+    mpz_mul(m1, m1, key->qInv);
+    mpz_mod(m1, m1, key->p);
+    mpz_mul(m, m1, key->q);
+    mpz_add(m, m, m2);
+    mpz_export(_m, NULL, 1, RSAKEYSIZE/8, 1, 0, m);
+    mpz_clears(m, m1, m2, NULL);
+}
+
+/*
+ * rsa2048_keygen_serial() - 이전 rsa_generate_key()의 소수 탐색 (매번 새 난수, 50회 검사, p와 q를 차례로)
+ */
+static void rsa2048_keygen_serial(void)
+{
+    mpz_t p, q, n;
+    gmp_randstate_t state;
+
+    mpz_inits(p, q, n, NULL);
+    gmp_randinit_default(state);
+    gmp_randseed_ui(state, arc4random());
+    do {
+        do {
+            mpz_urandomb(p, state, RSAKEYSIZE/2);
+            mpz_setbit(p, 0);
+            mpz_setbit(p, RSAKEYSIZE/2-1);
+        } while (mpz_probab_prime_p(p, 50) == 0);
+        do {
+            mpz_urandomb(q, state, RSAKEYSIZE/2);
+            mpz_setbit(q, 0);
+            mpz_setbit(q, RSAKEYSIZE/2-1);
+        } while (mpz_probab_prime_p(q, 50) == 0);
+        mpz_mul(n, p, q);
+    } while (!mpz_tstbit(n, RSAKEYSIZE-1));
+    mpz_clears(p, q, n, NULL);
+    gmp_randclear(state);
+}
+
+/*
+ * async_window - 측정 스레드 하나가 풀에 넣고 기다리는 작업 묶음
+ */
+struct async_window {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int left;
+    async_job job[ASYNC_WINDOW];
+};
+
+static void async_done(async_job *job)
+{
+    struct async_window *aw = job->arg;
+
+    pthread_mutex_lock(&aw->lock);
+    if (--aw->left == 0)
+        pthread_cond_signal(&aw->cond);
+    pthread_mutex_unlock(&aw->lock);
+}
+
+/*
+ * async_run() - submits count jobs made by prep() in windows of ASYNC_WINDOW and waits for each window
+ */
+static void async_run(long count, void (*prep)(async_job *job, int i, void *buf), void *buf)
+{
+    struct async_window *aw = malloc(sizeof(struct async_window));
+    int n;
+
+    if (aw == NULL)
+        return;
+    pthread_mutex_init(&aw->lock, NULL);
+    pthread_cond_init(&aw->cond, NULL);
+    for (long i = 0; i < count; i += n) {
+        n = (count - i < ASYNC_WINDOW) ? (int)(count - i) : ASYNC_WINDOW;
+        aw->left = n;
+        for (int j = 0; j < n; j++) {
+            prep(&aw->job[j], j, buf);
+            if (async_submit(fx.pool, &aw->job[j], async_done, aw) != 0)
+                async_done(&aw->job[j]);
+        }
+        pthread_mutex_lock(&aw->lock);
+        while (aw->left > 0)
+            pthread_cond_wait(&aw->cond, &aw->lock);
+        pthread_mutex_unlock(&aw->lock);
+    }
+    pthread_mutex_destroy(&aw->lock);
+    pthread_cond_destroy(&aw->cond);
+    free(aw);
+}
+
+static void prep_mrsa(async_job *job, int i, void *buf)
+{
+    uint64_t *m = (uint64_t *)buf + i;
+
+    *m = fx.n / 3 + i;
+    async_prep_mrsa(job, m, fx.d, fx.n);
+}
+
+static void prep_pss_sign(async_job *job, int i, void *buf)
+{
+    async_prep_sign_key(job, msg, sizeof(msg), &fx.pk, (unsigned char *)buf + i * (RSAKEYSIZE/8));
+}
+
+static void prep_pss_verify(async_job *job, int i, void *buf)
+{
+    (void)i; (void)buf;
+    async_prep_verify_key(job, msg, sizeof(msg), &fx.pub, fx.s2);
+}
+
+static void b_mod_pow(long count)
+{
+    uint64_t x = fx.n / 3;
+
+    for (long i = 0; i < count; ++i)
+        x = mod_pow(x, fx.d, fx.n);
+}
+
+static void b_miller_rabin(long count)
+{
+    uint64_t x = fx.n / 3 | 1;
+
+    // 연속한 홀수를 검사하므로 대부분 합성수이고, 소수는 밑 12개를 모두 거친다
+    for (long i = 0; i < count; ++i, x += 2)
+        miller_rabin(x);
+}
+
+static void b_miller_rabin_mont(long count)
+{
+    uint64_t x = fx.n / 3 | 1;
+
+    for (long i = 0; i < count; ++i, x += 2)
+        miller_rabin_mont(x);
+}
+
+static void b_mrsa_keygen(long count)
+{
+    uint64_t e, d, n;
+
+    for (long i = 0; i < count; ++i)
+        mRSA_generate_key(&e, &d, &n);
+}
+
+static void b_mrsa_cipher(long count)
+{
+    uint64_t m = 0x0123456789abcdef;
+
+    for (long i = 0; i < count; ++i)
+        mRSA_cipher(&m, fx.d, fx.n);
+}
+
+static void b_mrsa_batch(long count)
+{
+    uint64_t buf[BATCH];
+
+    arc4random_buf(buf, sizeof(buf));
+    for (long i = 0; i < BATCH; ++i)
+        buf[i] %= fx.n;
+    for (long i = 0; i < count; i += BATCH)
+        mRSA_cipher_batch(&fx.ctx, buf, BATCH, NULL, 1);
+}
+
+static void b_mrsa128_cipher(long count)
+{
+    uint128_t m = fx.key.n / 3;
+
+    for (long i = 0; i < count; ++i)
+        mRSA128_cipher(&m, fx.key.d, fx.key.n);
+}
+
+static void b_mrsa128_private(long count)
+{
+    uint128_t m = fx.key.n / 3;
+
+    for (long i = 0; i < count; ++i)
+        mRSA128_private(&m, &fx.key);
+}
+
+static void b_mrsa128_public(long count)
+{
+    uint128_t m = fx.key.n / 3;
+
+    for (long i = 0; i < count; ++i)
+        mRSA128_public(&m, &fx.key);
+}
+
+static void b_rsa2048_d(long count)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    memcpy(m, fx.m2, sizeof(m));
+    for (long i = 0; i < count; ++i)
+        rsa2048_cipher(m, fx.d2, fx.n2);
+}
+
+static void b_rsa2048_e(long count)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    memcpy(m, fx.m2, sizeof(m));
+    for (long i = 0; i < count; ++i)
+        rsa2048_cipher(m, fx.e2, fx.n2);
+}
+
+static void b_rsa_bn_d(long count)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    memcpy(m, fx.m2, sizeof(m));
+    for (long i = 0; i < count; ++i)
+        rsa_bn_powm(m, m, fx.d2, RSAKEYSIZE/8, &fx.bn);
+}
+
+static void b_rsa_bn_e(long count)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    memcpy(m, fx.m2, sizeof(m));
+    for (long i = 0; i < count; ++i)
+        rsa_bn_powm(m, m, fx.e2, RSAKEYSIZE/8, &fx.bn);
+}
+
+static void b_crt_unblinded(long count)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    memcpy(m, fx.m2, sizeof(m));
+    for (long i = 0; i < count; ++i)
+        crt_unblinded(m, &fx.pk, fx.sec);
+}
+
+static void b_crt_blinded(long count)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    memcpy(m, fx.m2, sizeof(m));
+    for (long i = 0; i < count; ++i)
+        rsa_cipher_crt(m, RSAKEYSIZE/8, &fx.pk);
+}
+
+static void b_keygen_serial(long count)
+{
+    for (long i = 0; i < count; ++i)
+        rsa2048_keygen_serial();
+}
+
+static void b_rsa_keygen(long count)
+{
+    unsigned char e[RSAKEYSIZE/8], d[RSAKEYSIZE/8], n[RSAKEYSIZE/8];
+
+    for (long i = 0; i < count; ++i)
+        rsa_generate_key(e, d, n, 0);
+}
+
+static void b_async_mrsa(long count)
+{
+    uint64_t m[ASYNC_WINDOW];
+
+    async_run(count, prep_mrsa, m);
+}
+
+static void b_async_pss_sign(long count)
+{
+    unsigned char *s = malloc(ASYNC_WINDOW * (RSAKEYSIZE/8));
+
+    if (s)
+        async_run(count, prep_pss_sign, s);
+    free(s);
+}
+
+static void b_async_pss_verify(long count)
+{
+    async_run(count, prep_pss_verify, NULL);
+}
+
+static void b_pss_sign(long count)
+{
+    unsigned char s[RSAKEYSIZE/8];
+
+    for (long i = 0; i < count; ++i)
+        rsassa_pss_sign_key(msg, sizeof(msg), &fx.pk, s);
+}
+
+static void b_pss_verify(long count)
+{
+    for (long i = 0; i < count; ++i)
+        rsassa_pss_verify_key(msg, sizeof(msg), &fx.pub, fx.s2);
+}
+
+static void b_aes_key(long count)
+{
+    uint32_t rk[RNDKEYSIZE];
+
+    for (long i = 0; i < count; ++i)
+        KeyExpansion(fx.aeskey, rk);
+}
+
+static void b_aes_encrypt(long count)
+{
+    uint8_t state[BLOCKLEN] = {0};
+
+    for (long i = 0; i < count; ++i)
+        Cipher(state, fx.rk, ENCRYPT);
+}
+
+static void b_aes_encrypt_blocks(long count)
+{
+    uint8_t state[BLOCKLEN] = {0};
+
+    // 한 번에 한 블록씩 넣어 Cipher (encrypt)와 블록당 시간을 비교
+    for (long i = 0; i < count; ++i)
+        CipherBlocks(state, 1, fx.rk);
+}
+
+static void b_aes_decrypt(long count)
+{
+    uint8_t state[BLOCKLEN] = {0};
+
+    for (long i = 0; i < count; ++i)
+        Cipher(state, fx.rk, DECRYPT);
+}
+
+static void b_aes_key_compact(long count)
+{
+    aes_compact_key ck;
+
+    for (long i = 0; i < count; ++i)
+        KeyCompact(fx.aeskey, &ck, DECRYPT);
+}
+
+static void b_aes_encrypt_compact(long count)
+{
+    uint8_t state[BLOCKLEN] = {0};
+
+    for (long i = 0; i < count; ++i)
+        CipherCompact(state, &fx.ck[ENCRYPT], ENCRYPT);
+}
+
+static void b_aes_decrypt_compact(long count)
+{
+    uint8_t state[BLOCKLEN] = {0};
+
+    for (long i = 0; i < count; ++i)
+        CipherCompact(state, &fx.ck[DECRYPT], DECRYPT);
+}
+
+/*
+ * aes_contexts() - encrypts one block per op under a pseudo-random one of AES_CONTEXTS keys
+ * 연결이 많은 서버처럼 키 문맥이 캐시에 없는 경우를 흉내 낸다.
+ */
+static void aes_contexts(long count, int compact)
+{
+    uint8_t state[BLOCKLEN] = {0};
+    uint64_t x = 1;
+    size_t j;
+
+    for (long i = 0; i < count; ++i) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        j = (size_t)(x >> 40) % AES_CONTEXTS;
+        if (compact)
+            CipherCompact(state, &fx.cks[j], ENCRYPT);
+        else
+            Cipher(state, fx.rks[j], ENCRYPT);
+    }
+}
+
+static void b_aes_contexts(long count)
+{
+    aes_contexts(count, 0);
+}
+
+static void b_aes_contexts_compact(long count)
+{
+    aes_contexts(count, 1);
+}
+
+/*
+ * xts_sectors() - encrypts count sectors of size bytes, XTS_SECTORS per call of xts_crypt_sectors()
+ */
+static void xts_sectors(long count, size_t size, int threads)
+{
+    uint8_t *buf = calloc(XTS_SECTORS, size);
+    long n;
+
+    if (buf == NULL)
+        return;
+    for (long i = 0; i < count; i += n) {
+        n = (count - i < XTS_SECTORS) ? count - i : XTS_SECTORS;
+        xts_crypt_sectors(&fx.xts, buf, size, n, i, ENCRYPT, threads);
+    }
+    free(buf);
+}
+
+static void b_xts_512(long count)
+{
+    xts_sectors(count, 512, 1);
+}
+
+static void b_xts_4096(long count)
+{
+    xts_sectors(count, 4096, 1);
+}
+
+static void b_xts_4096_mt(long count)
+{
+    xts_sectors(count, 4096, 0);
+}
+
+/*
+ * hmac_naive() - HMAC-SHA256 on sha256_ctx without cached states, K ^ ipad and K ^ opad every message
+ */
+static void hmac_naive(const uint8_t *k, size_t kLen, const uint8_t *m, size_t mLen, unsigned char *mac)
+{
+    unsigned char pad[SHA256_BLOCK_SIZE], inner[SHA256_DIGEST_SIZE];
+    sha256_ctx c;
+
+    memset(pad, 0x36, sizeof(pad));
+    for (size_t i = 0; i < kLen; i++)
+        pad[i] ^= k[i];
+    sha256_init(&c);
+    sha256_update(&c, pad, sizeof(pad));
+    sha256_update(&c, m, mLen);
+    sha256_final(&c, inner);
+    memset(pad, 0x5c, sizeof(pad));
+    for (size_t i = 0; i < kLen; i++)
+        pad[i] ^= k[i];
+    sha256_init(&c);
+    sha256_update(&c, pad, sizeof(pad));
+    sha256_update(&c, inner, sizeof(inner));
+    sha256_final(&c, mac);
+}
+
+static void b_hmac_naive(long count)
+{
+    uint8_t m[HMAC_MSG] = {0};
+    unsigned char mac[HMAC_SHA256_LEN];
+
+    for (long i = 0; i < count; ++i) {
+        hmac_naive(fx.mackey, sizeof(fx.mackey), m, sizeof(m), mac);
+        m[0] = mac[0];
+    }
+}
+
+static void b_hmac_cached(long count)
+{
+    uint8_t m[HMAC_MSG] = {0};
+    unsigned char mac[HMAC_SHA256_LEN];
+
+    for (long i = 0; i < count; ++i) {
+        hmac_sha256(&fx.hmac, m, sizeof(m), mac);
+        m[0] = mac[0];
+    }
+}
+
+static void b_hmac512_cached(long count)
+{
+    uint8_t m[HMAC_MSG] = {0};
+    unsigned char mac[HMAC_SHA512_LEN];
+
+    for (long i = 0; i < count; ++i) {
+        hmac_sha512(&fx.hmac512, m, sizeof(m), mac);
+        m[0] = mac[0];
+    }
+}
+
+/*
+ * etm_msgs() - seals (mode 0) or opens (1) count ETM_MSG-byte messages
+ */
+static void etm_msgs(long count, int mode)
+{
+    uint8_t *in = calloc(1, ETM_MSG), *out = malloc(ETM_MSG), iv[ETM_IVLEN] = {0}, tag[ETM_TAGLEN];
+
+    if (in == NULL || out == NULL) {
+        free(in); free(out);
+        return;
+    }
+    // 여는 경우 in은 암호문
+    if (mode == 1)
+        etm_seal(&fx.etm, iv, NULL, 0, in, ETM_MSG, in, tag);
+    for (long i = 0; i < count; ++i) {
+        if (mode == 0)
+            etm_seal(&fx.etm, iv, NULL, 0, in, ETM_MSG, out, tag);
+        else
+            etm_open(&fx.etm, iv, NULL, 0, in, ETM_MSG, out, tag);
+    }
+    free(in); free(out);
+}
+
+static void b_etm_seal(long count)
+{
+    etm_msgs(count, 0);
+}
+
+static void b_etm_open(long count)
+{
+    etm_msgs(count, 1);
+}
+
+static void b_salt_arc4random(long count)
+{
+    volatile unsigned char salt[SHASIZE/8];
+
+    // 이전 pss_encode()의 salt 채우기 (바이트마다 arc4random() 한 번)
+    for (long i = 0; i < count; ++i)
+        for (int j = 0; j < SHASIZE/8; j++)
+            salt[j] = arc4random() & 255;
+    (void)salt[0];
+}
+
+static void b_salt_arc4random_buf(long count)
+{
+    unsigned char salt[SHASIZE/8];
+
+    for (long i = 0; i < count; ++i)
+        arc4random_buf(salt, sizeof(salt));
+}
+
+static void b_salt_drbg(long count)
+{
+    unsigned char salt[SHASIZE/8];
+
+    for (long i = 0; i < count; ++i)
+        drbg_bytes(salt, sizeof(salt));
+}
+
+static void b_uniform_arc4random(long count)
+{
+    for (long i = 0; i < count; ++i)
+        arc4random_uniform(0x7fffffff);
+}
+
+static void b_uniform_drbg(long count)
+{
+    for (long i = 0; i < count; ++i)
+        drbg_uniform(0x7fffffff);
+}
+
+static void b_bulk_arc4random(long count)
+{
+    unsigned char buf[DRBG_BUFSIZE];
+
+    for (long i = 0; i < count; ++i)
+        arc4random_buf(buf, sizeof(buf));
+}
+
+static void b_bulk_drbg(long count)
+{
+    unsigned char buf[DRBG_BUFSIZE];
+
+    for (long i = 0; i < count; ++i)
+        drbg_bytes(buf, sizeof(buf));
+}
+
+struct bench_job {
+    void (*fn)(long);
+    long count;
+};
+
+static void *bench_worker(void *arg)
+{
+    struct bench_job *job = arg;
+
+    job->fn(job->count);
+    return NULL;
+}
+
+/*
+ * run() - runs fn(count) on nthreads threads at once and reports the total
+ * 마지막 몫은 호출한 스레드가 직접 실행하고, 만들지 못한 스레드의 몫은 합계에서 뺀다.
+ */
+static void run(const char *name, void (*fn)(long), long count)
+{
+    pthread_t tid[BENCH_MAX_THREADS];
+    struct bench_job job = {fn, count};
+    int started;
+    double t;
+
+    t = now();
+    for (started = 0; started < nthreads - 1; started++)
+        if (pthread_create(&tid[started], NULL, bench_worker, &job) != 0)
+            break;
+    bench_worker(&job);
+    for (int i = 0; i < started; i++)
+        pthread_join(tid[i], NULL);
+    report(name, count * (started + 1), now() - t);
+}
+
+int main(int argc, char *argv[])
+{
+    long iter = 20000;
+    unsigned char p2[RSAKEYSIZE/16], q2[RSAKEYSIZE/16], pr2[RSA_MAX_PRIMES * RSA_PRIME_LEN(RSAKEYSIZE, 3)];
+    uint8_t xk[XTS_KEYLEN], ek[ETM_KEYLEN];
+    int c, code;
+
+    while ((c = getopt(argc, argv, "n:t:j")) != -1) {
+        switch (c) {
+        case 'n': iter = atol(optarg); break;
+        case 't': nthreads = atoi(optarg); break;
+        case 'j': json = 1; break;
+        default: goto usage;
+        }
+    }
+    // 이전 사용법 (./bench 반복 횟수)
+    if (optind + 1 == argc)
+        iter = atol(argv[optind]);
+    else if (optind != argc)
+        goto usage;
+    if (iter < 1 || nthreads < 1 || nthreads > BENCH_MAX_THREADS)
+        goto usage;
+    if (json)
+        printf("{\n  \"iterations\": %ld,\n  \"threads\": %d,\n  \"results\": [", iter, nthreads);
+    if ((fx.pool = async_pool_create(0)) == NULL) {
+        fprintf(stderr, "async_pool_create failed\n");
+        return 1;
+    }
+
+    /*
+     * PROJ_3 64 비트 정수 연산
+     */
+    mRSA_generate_key(&fx.e, &fx.d, &fx.n);
+    run("mod_pow (64-bit)", b_mod_pow, iter);
+    run("miller_rabin", b_miller_rabin, iter);
+    run("miller_rabin_mont", b_miller_rabin_mont, iter);
+
+    /*
+     * 64 비트 mRSA
+     */
+    run("mRSA_generate_key", b_mrsa_keygen, iter / 1000 + 1);
+    run("mRSA_cipher (d)", b_mrsa_cipher, iter);
+    mRSA_ctx_init(&fx.ctx, fx.d, fx.n);
+    run("mRSA_cipher_batch (d, 1T)", b_mrsa_batch, (iter + BATCH - 1) / BATCH * BATCH);
+    run("async mRSA_cipher (d)", b_async_mrsa, iter);
+
+    /*
+     * 128 비트 mRSA
+     */
+    mRSA128_generate_key(&fx.key);
+    run("mRSA128_cipher (d)", b_mrsa128_cipher, iter);
+    run("mRSA128_private (CRT)", b_mrsa128_private, iter);
+    run("mRSA128_public (e)", b_mrsa128_public, iter);
+
+    /*
+     * PROJ_5 2048 비트 RSA
+     */
+    rsa_generate_key(fx.e2, fx.d2, fx.n2, 0);
+    memcpy(fx.m2, fx.n2, sizeof(fx.m2));
+    fx.m2[0] >>= 1;
+    run("rsa_cipher 2048 (d)", b_rsa2048_d, iter / 100 + 1);
+    run("rsa_cipher 2048 (e)", b_rsa2048_e, iter / 10 + 1);
+
+    /*
+     * 고정 크기 백엔드 : 128 비트 정수 C 코드, mulx/adcx/adox
+     */
+    if ((code = rsa_bn_init(&fx.bn, fx.n2, RSAKEYSIZE/8)) != 0) {
+        fprintf(stderr, "rsa_bn_init failed (%d)\n", code);
+        return 1;
+    }
+    for (int adx = 0, f = rsa_bn_features(); adx <= (f & RSA_BN_ADX); ++adx) {
+        rsa_bn_restrict(adx ? RSA_BN_ADX : 0);
+        run(adx ? "rsa_bn 2048 (d, adx)" : "rsa_bn 2048 (d, c)", b_rsa_bn_d, iter / 100 + 1);
+        run(adx ? "rsa_bn 2048 (e, adx)" : "rsa_bn 2048 (e, c)", b_rsa_bn_e, iter / 10 + 1);
+    }
+    rsa_bn_restrict(RSA_BN_ADX);
+
+    /*
+     * 2048 비트 CRT 서명 지수승 : 보호 없음, mpz_powm_sec만, mpz_powm_sec + 블라인딩 (rsa_cipher_crt)
+     */
+    rsa_generate_key_crt(fx.e2, fx.d2, fx.n2, p2, q2, 0);
+    if ((code = rsa_private_key_import(&fx.pk, fx.d2, fx.n2, p2, q2)) != 0 ||
+        (code = rsa_public_key_import(&fx.pub, fx.e2, fx.n2)) != 0) {
+        fprintf(stderr, "2048-bit key import failed (%d)\n", code);
+        return 1;
+    }
+    memcpy(fx.m2, fx.n2, sizeof(fx.m2));
+    fx.m2[0] >>= 1;
+    fx.sec = 0;
+    run("CRT 2048 (powm)", b_crt_unblinded, iter / 20 + 1);
+    fx.sec = 1;
+    run("CRT 2048 (powm_sec)", b_crt_unblinded, iter / 20 + 1);
+    run("CRT 2048 (powm_sec, blinded)", b_crt_blinded, iter / 20 + 1);
+
+    /*
+     * 2048 비트 RSASSA-PSS 서명과 검증
+     */
+    rsassa_pss_sign_key(msg, sizeof(msg), &fx.pk, fx.s2);
+    run("rsassa_pss_sign 2048", b_pss_sign, iter / 20 + 1);
+    run("rsassa_pss_verify 2048", b_pss_verify, iter / 10 + 1);
+    run("async rsassa_pss_sign 2048", b_async_pss_sign, iter / 20 + 1);
+    run("async rsassa_pss_verify 2048", b_async_pss_verify, iter / 10 + 1);
+    rsa_private_key_clear(&fx.pk);
+    rsa_public_key_clear(&fx.pub);
+
+    /*
+     * 2048 비트 다중 소수 CRT : 소수 3개, 4개
+     */
+    for (int k = 3; k <= RSA_MAX_PRIMES; ++k) {
+        char name[32];
+
+        rsa_generate_key_mp(RSAKEYSIZE, k, fx.e2, fx.d2, fx.n2, pr2, 0);
+        if ((code = rsa_private_key_import_mp(&fx.pk, RSAKEYSIZE, k, fx.d2, fx.n2, pr2)) != 0) {
+            fprintf(stderr, "%d-prime key import failed (%d)\n", k, code);
+            return 1;
+        }
+        memcpy(fx.m2, fx.n2, sizeof(fx.m2));
+        fx.m2[0] >>= 1;
+        snprintf(name, sizeof(name), "CRT 2048 (%d primes)", k);
+        run(name, b_crt_blinded, iter / 20 + 1);
+        rsa_private_key_clear(&fx.pk);
+    }
+
+    /*
+     * 2048 비트 키 생성 (소수 탐색이 대부분)
+     */
+    run("keygen 2048 (serial, 50 MR)", b_keygen_serial, iter / 2000 + 1);
+    run("rsa_generate_key 2048", b_rsa_keygen, iter / 2000 + 1);
+
+    /*
+     * PROJ_2 AES-128 (블록 하나 단위)와 XTS-AES-128 섹터 암호화
+     */
+    arc4random_buf(fx.aeskey, sizeof(fx.aeskey));
+    KeyExpansion(fx.aeskey, fx.rk);
+    run("AES KeyExpansion", b_aes_key, iter);
+    run("AES Cipher (encrypt)", b_aes_encrypt, iter);
+    run("AES Cipher (decrypt)", b_aes_decrypt, iter);
+    run("AES CipherBlocks (encrypt)", b_aes_encrypt_blocks, iter);
+    KeyCompact(fx.aeskey, &fx.ck[ENCRYPT], ENCRYPT);
+    KeyCompact(fx.aeskey, &fx.ck[DECRYPT], DECRYPT);
+    run("AES KeyCompact (decrypt)", b_aes_key_compact, iter);
+    run("AES CipherCompact (encrypt)", b_aes_encrypt_compact, iter);
+    run("AES CipherCompact (decrypt)", b_aes_decrypt_compact, iter);
+    fx.rks = malloc(AES_CONTEXTS * sizeof(*fx.rks));
+    fx.cks = malloc(AES_CONTEXTS * sizeof(*fx.cks));
+    if (fx.rks != NULL && fx.cks != NULL) {
+        for (size_t j = 0; j < AES_CONTEXTS; j++) {
+            uint8_t k[KEYLEN];
+
+            drbg_bytes(k, sizeof(k));
+            KeyExpansion(k, fx.rks[j]);
+            KeyCompact(k, &fx.cks[j], ENCRYPT);
+        }
+        run("AES 2^18 keys (schedule)", b_aes_contexts, iter);
+        run("AES 2^18 keys (compact)", b_aes_contexts_compact, iter);
+    }
+    free(fx.rks);
+    free(fx.cks);
+    arc4random_buf(xk, sizeof(xk));
+    xts_init(&fx.xts, xk);
+    run("XTS-AES 512 B sectors", b_xts_512, iter / 4 + 1);
+    run("XTS-AES 4096 B sectors", b_xts_4096, iter / 32 + 1);
+    run("XTS-AES 4096 B (all cores)", b_xts_4096_mt, iter / 32 + 1);
+
+    /*
+     * HMAC : 메시지마다 키 블록을 해시하는 방식과 캐시된 상태, EtM : 한 번에 / 두 번에 나누어
+     */
+    arc4random_buf(fx.mackey, sizeof(fx.mackey));
+    hmac_sha256_key_init(&fx.hmac, fx.mackey, sizeof(fx.mackey));
+    hmac_sha512_key_init(&fx.hmac512, fx.mackey, sizeof(fx.mackey));
+    run("HMAC-SHA256 64 B (naive)", b_hmac_naive, iter * 10);
+    sha2_accel_restrict(0);
+    run("HMAC-SHA256 64 B (cached, C)", b_hmac_cached, iter * 10);
+    sha2_accel_restrict(SHA2_SHANI | SHA2_AVX2);
+    run("HMAC-SHA256 64 B (cached)", b_hmac_cached, iter * 10);
+    run("HMAC-SHA512 64 B (cached)", b_hmac512_cached, iter * 10);
+    arc4random_buf(ek, sizeof(ek));
+    etm_init(&fx.etm, ek);
+    run("EtM seal 1 MiB", b_etm_seal, iter / 2000 + 1);
+    run("EtM open 1 MiB", b_etm_open, iter / 2000 + 1);
+
+    /*
+     * 난수 : 기존 arc4random 호출과 스레드별 CTR_DRBG
+     */
+    run("salt 32 B (arc4random x 32)", b_salt_arc4random, iter * 10);
+    run("salt 32 B (arc4random_buf)", b_salt_arc4random_buf, iter * 10);
+    run("salt 32 B (drbg_bytes)", b_salt_drbg, iter * 10);
+    run("arc4random_uniform", b_uniform_arc4random, iter * 10);
+    run("drbg_uniform", b_uniform_drbg, iter * 10);
+    run("4096 B (arc4random_buf)", b_bulk_arc4random, iter / 10 + 1);
+    run("4096 B (drbg_bytes)", b_bulk_drbg, iter / 10 + 1);
+
+    if (json)
+        printf("\n  ]\n}\n");
+    async_pool_destroy(fx.pool);
+    instr_dump(stderr);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-n iterations] [-t threads] [-j]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 배열 단위 mRSA 검증 : mRSA_cipher_batch()의 결과를 원소마다 mRSA_cipher()를 부른 결과와 비교한다.
+ * 길이는 스레드 하나가 맡는 최소 원소 수 (MRSA_BATCH_MIN) 앞뒤와 MRSA_LANES의 배수가 아닌 값을 쓰고,
+ * 스레드 수는 자동 (0), 1, 3, 8로 바꾼다. 일부 원소는 n 이상으로 두어 err[]와 리턴값도 확인한다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mRSA.h"
+
+#include <bsd/stdlib.h>
+
+#define MAXLEN (3*MRSA_BATCH_MIN + 5)
+
+static uint64_t in[MAXLEN], want[MAXLEN];
+
+/*
+ * prepare() - draws the inputs and computes the expected values with mRSA_cipher()
+ * 대부분은 n보다 작게 하고 일부만 범위를 벗어나게 둔다. mRSA_cipher()는 입력이 n 이상인지 검사하지
+ * 않으므로 범위 안의 원소만 계산한다.
+ */
+static void prepare(uint64_t k, uint64_t n)
+{
+    arc4random_buf(in, sizeof(in));
+    for (size_t i = 0; i < MAXLEN; i++) {
+        if (in[i] % 7 != 0)
+            in[i] %= n;
+        want[i] = in[i];
+        if (in[i] < n)
+            mRSA_cipher(&want[i], k, n);
+    }
+}
+
+/*
+ * check_batch() - runs mRSA_cipher_batch() on the first len inputs
+ */
+static int check_batch(uint64_t k, uint64_t n, size_t len, int nthreads)
+{
+    static uint64_t m[MAXLEN];
+    static uint8_t err[MAXLEN];
+    mRSA_ctx ctx;
+    size_t nbad = 0;
+    int bad = 0;
+
+    memcpy(m, in, len * sizeof(uint64_t));
+    for (size_t i = 0; i < len; i++)
+        nbad += in[i] >= n;
+    mRSA_ctx_init(&ctx, k, n);
+    memset(err, 0xff, len);
+    bad |= mRSA_cipher_batch(&ctx, m, len, err, nthreads) != nbad;
+    for (size_t i = 0; i < len; i++)
+        bad |= err[i] != (in[i] >= n) || m[i] != want[i];
+    return bad;
+}
+
+int main(void)
+{
+    const size_t lens[] = {0, 1, MRSA_LANES - 1, MRSA_LANES + 1, MRSA_BATCH_MIN - 1, MRSA_BATCH_MIN + 3, MAXLEN};
+    const int threads[] = {0, 1, 3, 8};
+    uint64_t e, d, n, key[2];
+    int bad, fail = 0;
+
+    mRSA_generate_key(&e, &d, &n);
+    key[0] = e;
+    key[1] = d;
+    for (int k = 0; k < 2; k++) {
+        prepare(key[k], n);
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            bad = 0;
+            for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+                bad |= check_batch(key[k], n, lens[l], threads[t]);
+            printf("mRSA_cipher_batch %c, %d threads vs mRSA_cipher -- %s\n", k ? 'd' : 'e', threads[t],
+                   bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+    }
+    return fail;
+}
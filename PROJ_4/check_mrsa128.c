@@ -0,0 +1,140 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 128 비트 mini RSA 교차 검증 : mont128_mul(), mod_mul128(), mod_pow128()의 결과를 GMP와 비교한다.
+ * 법은 2^128 - 1, 2^128 - 3처럼 2^128에 가까운 값, 2^127 +- 1, 무작위 홀수를 쓰고,
+ * 입력은 무작위 값과 법 바로 아래의 값을 섞는다. 만든 키로는 mRSA128_public(), mRSA128_private()가
+ * 서로 역연산인지, CRT 결과가 m^d mod n과 같은지 확인한다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <gmp.h>
+#include "mRSA128.h"
+
+#include <bsd/stdlib.h>
+
+#define ROUNDS 4000
+#define POW_ROUNDS 300
+#define KEYS 20
+
+static void mpz_set_u128(mpz_t z, uint128_t x)
+{
+    mpz_set_ui(z, (uint64_t)(x >> 64));
+    mpz_mul_2exp(z, z, 64);
+    mpz_add_ui(z, z, (uint64_t)x);
+}
+
+static uint128_t random128(void)
+{
+    uint128_t x;
+
+    arc4random_buf(&x, sizeof(x));
+    return x;
+}
+
+/*
+ * check_modulus() - compares the three operations with GMP for one odd modulus m
+ * 입력의 절반은 법 바로 아래의 값으로 해서 중간 결과가 가장 커지는 경우를 시험한다.
+ */
+static int check_modulus(uint128_t m)
+{
+    mpz_t a, b, n, r, x, rinv;
+    mont128_ctx ctx;
+    uint128_t u, v;
+    int bad = 0;
+
+    mpz_inits(a, b, n, r, x, rinv, NULL);
+    mpz_set_u128(n, m);
+    mpz_setbit(rinv, 128);
+    mpz_invert(rinv, rinv, n);
+    mont128_init(&ctx, m);
+    for (int i = 0; i < ROUNDS && !bad; i++) {
+        u = (i % 2) ? m - 1 - (random128() & 0xffff) : random128() % m;
+        v = (i % 4 < 2) ? m - 1 - (random128() & 0xffff) : random128() % m;
+        mpz_set_u128(a, u);
+        mpz_set_u128(b, v);
+
+        // a*b*R^-1 mod n
+        mpz_mul(r, a, b);
+        mpz_mul(r, r, rinv);
+        mpz_mod(r, r, n);
+        mpz_set_u128(x, mont128_mul(u, v, &ctx));
+        bad |= mpz_cmp(r, x) != 0;
+
+        mpz_mul(r, a, b);
+        mpz_mod(r, r, n);
+        mpz_set_u128(x, mod_mul128(u, v, m));
+        bad |= mpz_cmp(r, x) != 0;
+
+        if (i < POW_ROUNDS) {
+            mpz_powm(r, a, b, n);
+            mpz_set_u128(x, mod_pow128(u, v, m));
+            bad |= mpz_cmp(r, x) != 0;
+        }
+    }
+    mpz_clears(a, b, n, r, x, rinv, NULL);
+    return bad;
+}
+
+/*
+ * check_keys() - encrypts and decrypts random messages with generated keys
+ */
+static int check_keys(void)
+{
+    mRSA128_key key;
+    mpz_t d, n, r, x;
+    uint128_t m, c;
+    int bad = 0;
+
+    mpz_inits(d, n, r, x, NULL);
+    for (int k = 0; k < KEYS && !bad; k++) {
+        mRSA128_generate_key(&key);
+        bad |= key.n < MINIMUM_N128;
+        mpz_set_u128(d, key.d);
+        mpz_set_u128(n, key.n);
+        for (int i = 0; i < 100; i++) {
+            m = random128() % key.n;
+            c = m;
+            bad |= mRSA128_public(&c, &key) != 0;
+            mpz_set_u128(r, c);
+            mpz_powm(r, r, d, n);
+            bad |= mRSA128_private(&c, &key) != 0;
+            mpz_set_u128(x, c);
+            bad |= c != m || mpz_cmp(r, x) != 0;
+        }
+        m = key.n;
+        bad |= mRSA128_public(&m, &key) != 1 || mRSA128_private(&m, &key) != 1;
+    }
+    mpz_clears(d, n, r, x, NULL);
+    return bad;
+}
+
+int main(void)
+{
+    const uint128_t one = 1;
+    const struct {
+        const char *name;
+        uint128_t m;
+    } mods[] = {
+        {"2^128 - 1", ~(uint128_t)0},
+        {"2^128 - 3", ~(uint128_t)0 - 2},
+        {"2^128 - 2^70 - 1", ~(uint128_t)0 - (one << 70)},
+        {"2^127 + 1", (one << 127) + 1},
+        {"2^127 - 1", (one << 127) - 1},
+        {"random odd", random128() | 1},
+        {"random odd < 2^96", (random128() >> 32) | 1},
+    };
+    int bad, fail = 0;
+
+    for (size_t i = 0; i < sizeof(mods) / sizeof(mods[0]); i++) {
+        bad = check_modulus(mods[i].m);
+        printf("mRSA128 m = %-18s vs GMP -- %s\n", mods[i].name, bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    bad = check_keys();
+    printf("mRSA128 %-25s -- %s\n", "public/private keys", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    return fail;
+}
@@ -0,0 +1,476 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 시간 누출 측정 프로그램 (dudect 방식)
+ * 기본 연산마다 비밀 입력을 고정 클래스와 무작위 클래스로 나누어 무작위 순서로 수백만 번 실행하고,
+ * 직렬화한 rdtsc로 잰 클록 수의 두 클래스 분포를 Welch의 t-검정으로 비교한다.
+ * 긴 꼬리 (인터럽트, 캐시 미스)를 덜어 내기 위해 첫 배치의 측정값으로 백분위 경계 DUDECT_NPERC개를 정해
+ * 경계 아래의 값만 쓰는 검정을 함께 하고, 평균 차이가 없어도 분산이 다른 경우를 잡기 위해
+ * 클래스 평균과의 차의 제곱에 대한 2차 검정도 한다. 모든 검정 중 |t|의 최댓값으로 판정한다.
+ *   |t| < 4.5   누출이 보이지 않음 (그 측정 수에서)
+ *   |t| < 10    누출 가능성 (측정 수를 늘려 다시 확인)
+ *   |t| >= 10   누출
+ *
+ * 비밀 정수 (지수, 곱하는 수)의 고정 클래스는 최상위와 최하위 비트만 켠 값이고 무작위 클래스도
+ * 최상위 비트를 켜므로, 두 클래스는 길이가 같고 해밍 무게만 다르다. 블록과 메시지의 고정 클래스는
+ * 0 블록 (AES)이거나 시작할 때 한 번 고른 값이다. 입력은 배치마다 미리 만들어 두고 측정 구간에는
+ * 연산 호출만 넣는다. 이름을 주면 그 연산만 잰다.
+ *
+ * 과제 코드의 mod_mul(), mod_pow(), mRSA_ctx_pow()는 원래 비밀에 따라 시간이 달라지므로 누출이
+ * 예상된 연산으로 표시하고, 판정 옆에 (expected)를 붙인다. 종료 상태는 예상하지 않은 연산에서 누출이 나오면 1,
+ * 키 준비가 실패하면 1, 사용법이 틀리면 2, 그 밖에는 0이다.
+ *
+ * gcc -O2 -pthread -I../PROJ_2 -I../PROJ_3 -I../PROJ_5 -o dudect dudect.c mRSA.c ../PROJ_2/aes.c ../PROJ_2/drbg.c ../PROJ_3/mod.c ../PROJ_3/miller_rabin.c ../PROJ_5/rsa_pss.c ../PROJ_5/rsa_prime.c ../PROJ_5/rsa_bn.c ../PROJ_5/sha2_accel.c ../PROJ_5/sha2.c -lgmp -lbsd -lm
+ * ./dudect [-s 측정 수 배율] [연산 이름 ...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "aes.h"
+#include "drbg.h"
+#include "mRSA.h"
+#include "rsa_pss.h"
+#include "rsa_bn.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define DUDECT_NPERC 100            /* 자르기 검정의 수 */
+#define DUDECT_TESTS (DUDECT_NPERC + 2)     /* 자르지 않은 검정, 자르기 검정, 2차 검정 */
+#define DUDECT_MIN 10000            /* 2차 검정을 시작하는 측정 수 */
+#define DUDECT_BATCH 10000          /* 배치 하나의 최대 측정 수 */
+#define T_MAYBE 4.5
+#define T_LEAK 10.0
+
+/*
+ * ttest - Welford 방식으로 클래스별 평균과 제곱 편차 합을 누적하는 Welch t-검정
+ */
+typedef struct {
+    double mean[2], m2[2], n[2];
+} ttest;
+
+static void t_push(ttest *t, double x, int cls)
+{
+    double d;
+
+    t->n[cls]++;
+    d = x - t->mean[cls];
+    t->mean[cls] += d / t->n[cls];
+    t->m2[cls] += d * (x - t->mean[cls]);
+}
+
+static double t_value(const ttest *t)
+{
+    double v0, v1;
+
+    if (t->n[0] < 2 || t->n[1] < 2)
+        return 0;
+    v0 = t->m2[0] / (t->n[0] - 1);
+    v1 = t->m2[1] / (t->n[1] - 1);
+    if (v0 + v1 == 0)
+        return 0;
+    return (t->mean[0] - t->mean[1]) / sqrt(v0 / t->n[0] + v1 / t->n[1]);
+}
+
+/*
+ * cycles() - serialized cycle counter: lfence keeps the measured call from moving across it
+ */
+static inline uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t c;
+
+    _mm_lfence();
+    c = __rdtsc();
+    _mm_lfence();
+    return c;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*
+ * 측정에 쓰는 키와 고정 입력
+ */
+static struct {
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t block[BLOCKLEN];
+    uint64_t a, m;                  /* mod_mul(), mod_pow()의 밑과 법 */
+    uint64_t e, d, n;               /* mRSA 키 */
+    unsigned char e2[RSAKEYSIZE/8], d2[RSAKEYSIZE/8], n2[RSAKEYSIZE/8], m2[RSAKEYSIZE/8];
+    rsa_private_key pk;
+    rsa_bn_ctx bn;
+    rsa_scratch *w;                 /* 이 스레드의 rsa_cipher_blind() 작업 공간 */
+} fx;
+
+static volatile uint64_t sink;
+
+/*
+ * scalar() - 64-bit secret of class cls: top and bottom bit only, or random with the top bit set
+ */
+static uint64_t scalar(int cls)
+{
+    uint64_t x;
+
+    if (cls == 0)
+        return 0x8000000000000001ULL;
+    drbg_bytes(&x, sizeof(x));
+    return x | 0x8000000000000000ULL;
+}
+
+/*
+ * big_scalar() - RSAKEYSIZE-bit secret of class cls below n, in the same two forms as scalar()
+ */
+static void big_scalar(unsigned char *x, int cls)
+{
+    if (cls == 0) {
+        memset(x, 0, RSAKEYSIZE/8);
+        x[RSAKEYSIZE/8 - 1] = 1;
+    } else
+        drbg_bytes(x, RSAKEYSIZE/8);
+    // n보다 작도록 최상위 비트를 지우고 그다음 비트를 켬
+    x[0] = (x[0] & 0x3f) | 0x40;
+}
+
+/*
+ * 연산마다 prep()이 클래스에 맞는 입력을 만들고, op()이 측정 구간 안에서 연산 하나를 실행한다
+ */
+static void prep_aes_block(void *in, int cls)
+{
+    if (cls == 0)
+        memset(in, 0, BLOCKLEN);
+    else
+        drbg_bytes(in, BLOCKLEN);
+}
+
+static void op_aes_encrypt(void *in)
+{
+    Cipher(in, fx.rk, ENCRYPT);
+}
+
+static void op_aes_decrypt(void *in)
+{
+    Cipher(in, fx.rk, DECRYPT);
+}
+
+static void prep_aes_key(void *in, int cls)
+{
+    uint8_t key[KEYLEN];
+
+    if (cls == 0)
+        memset(key, 0, KEYLEN);
+    else
+        drbg_bytes(key, KEYLEN);
+    KeyExpansion(key, in);
+}
+
+static void op_aes_key(void *in)
+{
+    uint8_t state[BLOCKLEN];
+
+    memcpy(state, fx.block, BLOCKLEN);
+    Cipher(state, in, ENCRYPT);
+    sink = state[0];
+}
+
+static void prep_scalar(void *in, int cls)
+{
+    *(uint64_t *)in = scalar(cls);
+}
+
+static void op_mod_mul(void *in)
+{
+    sink = mod_mul(fx.a, *(uint64_t *)in, fx.m);
+}
+
+static void op_mod_pow(void *in)
+{
+    sink = mod_pow(fx.a, *(uint64_t *)in, fx.m);
+}
+
+static void prep_mrsa_ctx(void *in, int cls)
+{
+    int shift = __builtin_clzll(fx.n) + 1;
+
+    // n보다 한 비트 짧게 잘라 두 클래스의 길이를 맞춤
+    mRSA_ctx_init(in, scalar(cls) >> shift | 1, fx.n);
+}
+
+static void op_mrsa_ctx_pow(void *in)
+{
+    sink = mRSA_ctx_pow(in, fx.a % fx.n);
+}
+
+static void prep_big_scalar(void *in, int cls)
+{
+    big_scalar(in, cls);
+}
+
+/*
+ * op_rsa_cipher_blind() - the octet-key private operation m^d mod n alone, without PSS encoding
+ * 고정 클래스는 같은 d가 반복되어 블라인딩 쌍을 제곱해 쓰고 무작위 클래스는 쌍을 새로 만들게 되므로,
+ * 쌍을 버려 두 클래스 모두 쌍을 만드는 지수승까지 거치게 한다.
+ */
+static void op_rsa_cipher_blind(void *in)
+{
+    unsigned char m[RSAKEYSIZE/8];
+
+    fx.w->bvalid = 0;
+    memcpy(m, fx.m2, sizeof(m));
+    rsa_cipher_blind(m, sizeof(m), in, fx.n2);
+    sink = m[0];
+}
+
+static void op_rsa_bn_powm(void *in)
+{
+    unsigned char r[RSAKEYSIZE/8];
+
+    rsa_bn_powm(r, fx.m2, in, RSAKEYSIZE/8, &fx.bn);
+    sink = r[0];
+}
+
+static void prep_message(void *in, int cls)
+{
+    if (cls == 0)
+        memcpy(in, fx.m2, RSAKEYSIZE/8);
+    else {
+        drbg_bytes(in, RSAKEYSIZE/8);
+        ((unsigned char *)in)[0] &= 0x7f;
+    }
+}
+
+static void op_rsa_cipher_crt(void *in)
+{
+    rsa_cipher_crt(in, RSAKEYSIZE/8, &fx.pk);
+}
+
+/*
+ * primitive - 측정할 연산 하나, count는 배율 1에서의 측정 수
+ */
+struct primitive {
+    const char *name;
+    const char *secret;
+    size_t insize;
+    long count;
+    void (*prep)(void *in, int cls);
+    void (*op)(void *in);
+    int expected;                   /* 누출이 예상된 연산이면 1 */
+};
+
+static const struct primitive prims[] = {
+    {"aes_encrypt", "plaintext", BLOCKLEN, 2000000, prep_aes_block, op_aes_encrypt, 0},
+    {"aes_decrypt", "ciphertext", BLOCKLEN, 2000000, prep_aes_block, op_aes_decrypt, 0},
+    {"aes_key", "key", RNDKEYSIZE * sizeof(uint32_t), 2000000, prep_aes_key, op_aes_key, 0},
+    {"mod_mul", "multiplier", sizeof(uint64_t), 1000000, prep_scalar, op_mod_mul, 1},
+    {"mod_pow", "exponent", sizeof(uint64_t), 200000, prep_scalar, op_mod_pow, 1},
+    {"mRSA_ctx_pow", "exponent", sizeof(mRSA_ctx), 1000000, prep_mrsa_ctx, op_mrsa_ctx_pow, 1},
+    {"rsa_cipher_blind", "exponent", RSAKEYSIZE/8, 10000, prep_big_scalar, op_rsa_cipher_blind, 0},
+    {"rsa_bn_powm", "exponent", RSAKEYSIZE/8, 10000, prep_big_scalar, op_rsa_bn_powm, 0},
+    {"rsa_cipher_crt", "message", RSAKEYSIZE/8, 20000, prep_message, op_rsa_cipher_crt, 0},
+};
+
+#define NPRIMS (sizeof(prims) / sizeof(prims[0]))
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * measure() - runs one batch: random classes, prepared inputs, then a tight timed loop
+ */
+static void measure(const struct primitive *p, size_t n, unsigned char *in, uint8_t *cls, uint64_t *t)
+{
+    uint64_t t0, t1;
+
+    drbg_bytes(cls, n);
+    for (size_t i = 0; i < n; i++) {
+        cls[i] &= 1;
+        p->prep(in + i * p->insize, cls[i]);
+    }
+    for (size_t i = 0; i < n; i++) {
+        t0 = cycles();
+        p->op(in + i * p->insize);
+        t1 = cycles();
+        t[i] = t1 - t0;
+    }
+}
+
+/*
+ * test() - measures p count times and returns the largest |t| over every test
+ * 첫 배치는 백분위 경계를 정하는 데만 쓴다. *which에는 최댓값을 낸 검정 (0 자르지 않음,
+ * 1..DUDECT_NPERC 자르기, DUDECT_NPERC+1 2차)을, *used에는 그 검정의 측정 수를 넣는다.
+ */
+static double test(const struct primitive *p, long count, int *which, double *used)
+{
+    static ttest tt[DUDECT_TESTS];
+    uint64_t perc[DUDECT_NPERC], *t, *sorted;
+    size_t batch = count / 20, n;
+    unsigned char *in;
+    uint8_t *cls;
+    double x, c, tmax = 0, v;
+
+    if (batch > DUDECT_BATCH)
+        batch = DUDECT_BATCH;
+    if (batch < 100)
+        batch = 100;
+    in = malloc(batch * p->insize);
+    cls = malloc(batch);
+    t = malloc(batch * sizeof(uint64_t));
+    sorted = malloc(batch * sizeof(uint64_t));
+    if (in == NULL || cls == NULL || t == NULL || sorted == NULL) {
+        free(in); free(cls); free(t); free(sorted);
+        return -1;
+    }
+    memset(tt, 0, sizeof(tt));
+
+    // 백분위 경계 1 - 0.5^(10(k+1)/NPERC) : 아래쪽은 촘촘하고 꼬리로 갈수록 성김
+    measure(p, batch, in, cls, t);
+    memcpy(sorted, t, batch * sizeof(uint64_t));
+    qsort(sorted, batch, sizeof(uint64_t), cmp_u64);
+    for (int k = 0; k < DUDECT_NPERC; k++)
+        perc[k] = sorted[(size_t)((1 - pow(0.5, 10.0 * (k + 1) / DUDECT_NPERC)) * batch)];
+
+    for (long done = 0; done < count; done += n) {
+        n = (count - done < (long)batch) ? (size_t)(count - done) : batch;
+        measure(p, n, in, cls, t);
+        for (size_t i = 0; i < n; i++) {
+            x = (double)t[i];
+            t_push(&tt[0], x, cls[i]);
+            for (int k = 0; k < DUDECT_NPERC; k++)
+                if (t[i] < perc[k])
+                    t_push(&tt[k + 1], x, cls[i]);
+            if (tt[0].n[0] + tt[0].n[1] > DUDECT_MIN) {
+                c = x - tt[0].mean[cls[i]];
+                t_push(&tt[DUDECT_NPERC + 1], c * c, cls[i]);
+            }
+        }
+    }
+
+    *which = 0;
+    *used = 0;
+    for (int k = 0; k < DUDECT_TESTS; k++) {
+        // 측정이 너무 적은 검정은 판정에 넣지 않음
+        if (tt[k].n[0] + tt[k].n[1] < (count < DUDECT_MIN ? count / 2 : DUDECT_MIN))
+            continue;
+        if ((v = fabs(t_value(&tt[k]))) > tmax) {
+            tmax = v;
+            *which = k;
+            *used = tt[k].n[0] + tt[k].n[1];
+        }
+    }
+    free(in); free(cls); free(t); free(sorted);
+    return tmax;
+}
+
+/*
+ * setup() - makes the keys and fixed inputs, returning the key import or rsa_bn_init() error if any
+ */
+static int setup(void)
+{
+    int code;
+    uint8_t key[KEYLEN];
+    unsigned char p2[RSAKEYSIZE/16], q2[RSAKEYSIZE/16];
+
+    drbg_bytes(key, sizeof(key));
+    KeyExpansion(key, fx.rk);
+    drbg_bytes(fx.block, sizeof(fx.block));
+    mRSA_generate_key(&fx.e, &fx.d, &fx.n);
+    fx.m = fx.n;
+    fx.a = fx.n / 3;
+    rsa_generate_key_crt(fx.e2, fx.d2, fx.n2, p2, q2, 0);
+    if ((code = rsa_private_key_import(&fx.pk, fx.d2, fx.n2, p2, q2)) != 0)
+        return code;
+    if ((code = rsa_bn_init(&fx.bn, fx.n2, RSAKEYSIZE/8)) != 0)
+        return code;
+    if ((fx.w = rsa_scratch_get()) == NULL)
+        return EM_NO_MEMORY;
+    memcpy(fx.m2, fx.n2, sizeof(fx.m2));
+    fx.m2[0] >>= 1;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    double scale = 1, t, used, start;
+    long count;
+    int c, which, selected, code, fail = 0;
+    struct timespec ts;
+
+    while ((c = getopt(argc, argv, "s:")) != -1) {
+        switch (c) {
+        case 's': scale = atof(optarg); break;
+        default: goto usage;
+        }
+    }
+    if (scale <= 0)
+        goto usage;
+    for (int i = optind; i < argc; i++) {
+        for (selected = 0; selected < (int)NPRIMS; selected++)
+            if (strcmp(argv[i], prims[selected].name) == 0)
+                break;
+        if (selected == (int)NPRIMS)
+            goto usage;
+    }
+
+    if ((code = setup()) != 0) {
+        fprintf(stderr, "setup: key preparation failed (%d)\n", code);
+        return 1;
+    }
+    printf("%-16s %-11s %10s %9s %8s %10s  %s\n", "primitive", "secret", "measured", "max |t|", "test", "seconds", "verdict");
+    for (size_t k = 0; k < NPRIMS; k++) {
+        const struct primitive *p = &prims[k];
+        char name[16];
+        const char *verdict;
+
+        selected = optind == argc;
+        for (int i = optind; i < argc; i++)
+            if (strcmp(argv[i], p->name) == 0)
+                selected = 1;
+        if (!selected)
+            continue;
+        count = (long)(p->count * scale);
+        if (count < 1000)
+            count = 1000;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        start = ts.tv_sec + ts.tv_nsec * 1e-9;
+        if ((t = test(p, count, &which, &used)) < 0) {
+            fprintf(stderr, "%s: out of memory\n", p->name);
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        if (which == 0)
+            snprintf(name, sizeof(name), "raw");
+        else if (which <= DUDECT_NPERC)
+            snprintf(name, sizeof(name), "crop%d", which);
+        else
+            snprintf(name, sizeof(name), "2nd");
+        verdict = t >= T_LEAK ? "LEAK" : t >= T_MAYBE ? "maybe leaks" : "no leak detected";
+        printf("%-16s %-11s %10.0f %9.2f %8s %10.1f  %s%s\n", p->name, p->secret, used, t, name,
+               ts.tv_sec + ts.tv_nsec * 1e-9 - start, verdict,
+               (p->expected && t >= T_MAYBE) ? " (expected)" : "");
+        fflush(stdout);
+        // 누출이 예상된 연산은 종료 상태에 넣지 않음
+        if (!p->expected)
+            fail |= t >= T_LEAK;
+    }
+    rsa_private_key_clear(&fx.pk);
+    return fail;
+
+usage:
+    fprintf(stderr, "usage: %s [-s scale] [primitive ...]\n  primitives:", argv[0]);
+    for (size_t k = 0; k < NPRIMS; k++)
+        fprintf(stderr, " %s", prims[k].name);
+    fprintf(stderr, "\n");
+    return 2;
+}
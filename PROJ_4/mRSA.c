@@ -3,11 +3,11 @@
  * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
  */
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "mRSA.h"
-
-#include <bsd/stdlib.h>
-
-const uint64_t a[ALEN] = {2,3,5,7,11,13,17,19,23,29,31,37};
+#include "instr.h"
+#include "drbg.h"
 
 /*
  * mRSA_generate_key() - generates mini RSA keys e, d and n
@@ -17,17 +17,19 @@ void mRSA_generate_key(uint64_t *e, uint64_t *d, uint64_t *n)
 {
     uint64_t p, q;
     uint64_t lambda_n;
+    INSTR_BEGIN(INSTR_MRSA_KEYGEN);
 
     // randomly 32bit integer x
-    uint64_t x = arc4random_uniform(0x7fffffff) + 0x80000000;
+    uint64_t x = drbg_uniform(0x7fffffff) + 0x80000000;
     int num = 0;
 
     // first while loop for p, q
     while(1){
+        INSTR_ADD(INSTR_MRSA_CANDIDATE, 1);
         // if find first prime, p
         if (miller_rabin(x) && !num){
             p = x;
-            x = arc4random_uniform(0x7fffffff) + 0x80000000;
+            x = drbg_uniform(0x7fffffff) + 0x80000000;
             num++;
         }
 
@@ -40,7 +42,7 @@ void mRSA_generate_key(uint64_t *e, uint64_t *d, uint64_t *n)
             }
             else {
                 num = 0;
-                x = arc4random_uniform(0x7fffffff) + 0x80000000;
+                x = drbg_uniform(0x7fffffff) + 0x80000000;
             }
         }
         x++;
@@ -55,15 +57,15 @@ void mRSA_generate_key(uint64_t *e, uint64_t *d, uint64_t *n)
 
     // second while loop for e, d
     while (1){
-        random1 = arc4random_uniform(p-1);
-        random2 = arc4random_uniform(q-1);
+        random1 = drbg_uniform(p-1);
+        random2 = drbg_uniform(q-1);
 
         i = random1 * random2 / gcd(p-1, q-1);
         
         // if i and lambda_n is relatively prime and i has its inverse d,
         // e = i and can get d
         if (gcd(i, lambda_n) == 1){
-            *d = mul_inv(i, lambda_n);
+            *d = umul_inv(i, lambda_n);
             if (*d == 0) continue;
             else {
                 *e = i;
@@ -71,6 +73,7 @@ void mRSA_generate_key(uint64_t *e, uint64_t *d, uint64_t *n)
             }
         }
     }
+    INSTR_END(INSTR_MRSA_KEYGEN);
 }
 
 /*
@@ -79,115 +82,257 @@ void mRSA_generate_key(uint64_t *e, uint64_t *d, uint64_t *n)
  */
 int mRSA_cipher(uint64_t *m, uint64_t k, uint64_t n)
 {
+    INSTR_BEGIN(INSTR_MRSA_CIPHER);
     *m = mod_pow(*m, k, n);
+    INSTR_END(INSTR_MRSA_CIPHER);
 
     // over range
     if (*m >= n) return 1;
     else return 0;
 }
 
-uint64_t gcd(uint64_t a, uint64_t b){
-    uint64_t temp = 0, result = 0;
-
-    while (a != 0 && b != 0){
-        temp = a;
-        a = b;
-        b = temp % b;
-    }
-
-    if (a == 0)
-        result = b;
-    else
-        result = a;
+/*
+ * mont_mul() - computes a*b*R^-1 mod n (R = 2^64)
+ * a, b < n이라고 가정한다. q = lo * n^-1 mod R로 잡으면 q*n의 하위 64비트가 lo와 같아지므로
+ * (a*b - q*n) / R은 상위 64비트의 차로 바로 구할 수 있고, 그 값은 (-n, n) 범위에 있다.
+ */
+static inline uint64_t mont_mul(uint64_t a, uint64_t b, uint64_t n, uint64_t ninv)
+{
+    __uint128_t t = (__uint128_t)a * b;
+    uint64_t lo = (uint64_t)t, hi = (uint64_t)(t >> 64);
+    uint64_t h = (uint64_t)(((__uint128_t)(lo * ninv) * n) >> 64);
 
-    return result; 
+    return (hi >= h) ? hi - h : hi - h + n;
 }
 
-uint64_t mul_inv(uint64_t a, uint64_t m){
-    uint64_t d0 = a, d1 = m;
-    uint64_t x0 = 1, x1 = 0;
-
-    uint64_t q = d0 / d1;
-    uint64_t d2 = d0 - q * d1;
-    uint64_t x2 = x0 - q * x1;
-
-    while (d2 > 1){
-        q = d0 / d1;
-        d2 = d0 - q * d1;
-        x2 = x0 - q * x1;
+/*
+ * mRSA_ctx_init() - precomputes the Montgomery context of n and recodes k
+ * n은 홀수여야 한다. mRSA_generate_key()가 만든 n은 두 홀수 소수의 곱이므로 항상 만족한다.
+ */
+void mRSA_ctx_init(mRSA_ctx *ctx, uint64_t k, uint64_t n)
+{
+    uint64_t x = n;
+    int bits = 0;
+
+    // Newton 반복으로 n^-1 mod 2^64 계산, 반복마다 맞는 비트 수가 두 배가 된다.
+    for (int i=0; i<5; i++)
+        x *= 2 - n * x;
+
+    ctx->n = n;
+    ctx->ninv = x;
+    ctx->r1 = (0 - n) % n;
+    ctx->r2 = (uint64_t)(((__uint128_t)ctx->r1 * ctx->r1) % n);
+
+    // k를 MRSA_WINDOW 비트씩 잘라 상위 자리부터 저장
+    while (bits < 64 && (k >> bits) != 0)
+        bits++;
+    ctx->ndigit = (bits + MRSA_WINDOW - 1) / MRSA_WINDOW;
+    for (int i=0; i<ctx->ndigit; i++)
+        ctx->digit[i] = (k >> (MRSA_WINDOW * (ctx->ndigit - 1 - i))) & ((1 << MRSA_WINDOW) - 1);
+}
 
-        d0 = d1;
-        d1 = d2;
-        x0 = x1;
-        x1 = x2;
+/*
+ * mont_pow_lanes() - computes x[l]^k mod n for MRSA_LANES values at once
+ * 모든 원소가 같은 지수를 쓰므로 레인마다 똑같은 곱셈 순서를 밟는다.
+ * 레인을 안쪽 루프에 두면 서로 의존성이 없는 곱셈이 연달아 나와 파이프라인이 채워진다.
+ * 자리 값이 0이어도 tab[0] = R을 곱해 곱셈 순서가 데이터에 따라 바뀌지 않도록 한다.
+ */
+static void mont_pow_lanes(const mRSA_ctx *ctx, uint64_t *x)
+{
+    uint64_t tab[1 << MRSA_WINDOW][MRSA_LANES];
+    uint64_t r[MRSA_LANES];
+    uint64_t n = ctx->n, ninv = ctx->ninv;
+    int l;
+
+    for (l=0; l<MRSA_LANES; l++){
+        tab[0][l] = ctx->r1;
+        tab[1][l] = mont_mul(x[l], ctx->r2, n, ninv);
+    }
+    for (int j=2; j<(1 << MRSA_WINDOW); j++)
+        for (l=0; l<MRSA_LANES; l++)
+            tab[j][l] = mont_mul(tab[j-1][l], tab[1][l], n, ninv);
+
+    for (l=0; l<MRSA_LANES; l++)
+        r[l] = ctx->ndigit ? tab[ctx->digit[0]][l] : ctx->r1;
+
+    for (int i=1; i<ctx->ndigit; i++){
+        for (int j=0; j<MRSA_WINDOW; j++)
+            for (l=0; l<MRSA_LANES; l++)
+                r[l] = mont_mul(r[l], r[l], n, ninv);
+        for (l=0; l<MRSA_LANES; l++)
+            r[l] = mont_mul(r[l], tab[ctx->digit[i]][l], n, ninv);
     }
 
-    if (d2 == 1)
-        return (x2 > (uint64_t)1<<63 ? x2+m : x2);
-    else
-        return 0;
+    // Montgomery 표현에서 일반 표현으로 복귀
+    for (l=0; l<MRSA_LANES; l++)
+        x[l] = mont_mul(r[l], 1, n, ninv);
 }
 
-uint64_t mod_add(uint64_t a, uint64_t b, uint64_t m)
+/*
+ * mRSA_ctx_pow() - computes x^k mod n for a single x < n
+ * mont_pow_lanes()와 같은 순서를 한 레인에 대해서만 수행한다.
+ */
+uint64_t mRSA_ctx_pow(const mRSA_ctx *ctx, uint64_t x)
 {
-    a = a - (a / m) * m;
-    b = b - (b / m) * m;
+    uint64_t tab[1 << MRSA_WINDOW];
+    uint64_t r, n = ctx->n, ninv = ctx->ninv;
+
+    tab[0] = ctx->r1;
+    tab[1] = mont_mul(x, ctx->r2, n, ninv);
+    for (int j=2; j<(1 << MRSA_WINDOW); j++)
+        tab[j] = mont_mul(tab[j-1], tab[1], n, ninv);
+
+    r = ctx->ndigit ? tab[ctx->digit[0]] : ctx->r1;
+    for (int i=1; i<ctx->ndigit; i++){
+        for (int j=0; j<MRSA_WINDOW; j++)
+            r = mont_mul(r, r, n, ninv);
+        r = mont_mul(r, tab[ctx->digit[i]], n, ninv);
+    }
 
-    return ((a >= m - b) ? a - (m - b) : a + b);
+    return mont_mul(r, 1, n, ninv);
 }
 
-uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t m)
+/*
+ * batch_range() - processes m[0..len-1] with a single thread
+ * n 이상인 원소는 0으로 대신 계산하고 결과를 쓰지 않으며, err[i]에 1을 기록한다.
+ */
+static size_t batch_range(const mRSA_ctx *ctx, uint64_t *m, size_t len, uint8_t *err)
 {
-    uint64_t r=0;
+    uint64_t x[MRSA_LANES];
+    size_t count = 0;
+
+    for (size_t i=0; i<len; i+=MRSA_LANES){
+        size_t w = (len - i < MRSA_LANES) ? len - i : MRSA_LANES;
 
-    while (b > 0){
-        if (b & 1) r = mod_add(r, a, m);
-        b = b >> 1;
-        a = mod_add(a, a, m);
+        for (size_t l=0; l<MRSA_LANES; l++)
+            x[l] = (l < w && m[i+l] < ctx->n) ? m[i+l] : 0;
+        mont_pow_lanes(ctx, x);
+        for (size_t l=0; l<w; l++){
+            int bad = m[i+l] >= ctx->n;
+
+            if (!bad) m[i+l] = x[l];
+            if (err) err[i+l] = bad;
+            count += bad;
+        }
     }
+    return count;
+}
 
-    return r;
+struct batch_job {
+    const mRSA_ctx *ctx;
+    uint64_t *m;
+    uint8_t *err;
+    size_t len;
+    size_t count;
+};
+
+static void *batch_worker(void *arg)
+{
+    struct batch_job *job = arg;
+
+    job->count = batch_range(job->ctx, job->m, job->len, job->err);
+    return NULL;
 }
 
-uint64_t mod_pow(uint64_t a, uint64_t b, uint64_t m)
+/*
+ * mRSA_cipher_batch() - computes m[i]^k mod n for every element of m
+ * ctx는 mRSA_ctx_init()으로 미리 준비한다. err가 NULL이 아니면 m[i] >= n인 원소에 대해
+ * err[i] = 1, 정상 처리된 원소에 대해 err[i] = 0을 기록한다.
+ * nthreads가 0 이하이면 온라인 코어 수를 사용하고, 원소가 적으면 스레드를 줄인다.
+ * 범위를 벗어난 원소의 수를 리턴한다.
+ */
+size_t mRSA_cipher_batch(const mRSA_ctx *ctx, uint64_t *m, size_t len, uint8_t *err, int nthreads)
 {
-    uint64_t r=1;
+    struct batch_job *job;
+    pthread_t *tid;
+    size_t chunk, count = 0;
+    int t, started;
+    INSTR_BEGIN(INSTR_MRSA_BATCH);
+
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)nthreads > len / MRSA_BATCH_MIN)
+        nthreads = (int)(len / MRSA_BATCH_MIN);
+    if (nthreads <= 1){
+        count = batch_range(ctx, m, len, err);
+        INSTR_END(INSTR_MRSA_BATCH);
+        return count;
+    }
+
+    job = malloc(nthreads * sizeof(struct batch_job));
+    tid = malloc(nthreads * sizeof(pthread_t));
+    if (job == NULL || tid == NULL){
+        free(job); free(tid);
+        count = batch_range(ctx, m, len, err);
+        INSTR_END(INSTR_MRSA_BATCH);
+        return count;
+    }
 
-    while (b > 0){
-        if (b & 1) r = mod_mul(r, a, m);
-        b = b >> 1;
-        a = mod_mul(a, a, m);
+    // 레인 경계에 맞춰 구간을 나눔, 올림 때문에 뒤쪽 구간은 비거나 짧을 수 있으므로 len으로 자름
+    chunk = ((len + nthreads - 1) / nthreads + MRSA_LANES - 1) / MRSA_LANES * MRSA_LANES;
+    for (t=0; t<nthreads; t++){
+        size_t lo = (chunk * t < len) ? chunk * t : len;
+        size_t hi = (chunk * (t+1) < len) ? chunk * (t+1) : len;
+
+        job[t].ctx = ctx;
+        job[t].m = m + lo;
+        job[t].err = err ? err + lo : NULL;
+        job[t].len = hi - lo;
+        job[t].count = 0;
     }
 
-    return r;
+    // 마지막 구간은 호출한 스레드가 직접 처리, 스레드 생성에 실패한 구간도 직접 처리
+    for (started=0; started<nthreads-1; started++)
+        if (pthread_create(&tid[started], NULL, batch_worker, &job[started]) != 0)
+            break;
+    for (t=started; t<nthreads; t++)
+        batch_worker(&job[t]);
+    for (t=0; t<started; t++)
+        pthread_join(tid[t], NULL);
+
+    for (t=0; t<nthreads; t++)
+        count += job[t].count;
+    free(job); free(tid);
+    INSTR_END(INSTR_MRSA_BATCH);
+    return count;
 }
 
-int miller_rabin(uint64_t n)
+/*
+ * miller_rabin_mont() - Miller-Rabin test for 64-bit odd n using Montgomery arithmetic
+ * miller_rabin()과 같은 밑 mr_bases[]를 사용하지만, a^q는 mRSA_ctx_pow()로 한 번 구하고
+ * 이후 제곱은 Montgomery 표현 그대로 이어서 계산한다.
+ */
+int miller_rabin_mont(uint64_t n)
 {
-    if (n % 2 == 0 && n != 2) return COMPOSITE;
-
+    mRSA_ctx ctx;
+    uint64_t q = n-1, one, minus_one;
     int k = 0;
-    uint64_t q = n-1;
+
+    if (n < 4) return (n == 2 || n == 3) ? PRIME : COMPOSITE;
+    if (n % 2 == 0) return COMPOSITE;
 
     while ((q % 2) == 0){
         q /= 2;
         k++;
     }
 
-    for (int i=0; i<ALEN && a[i] < n-1; i++){
-        uint64_t x = mod_pow(a[i], q, n);
-        int count = 0;
+    mRSA_ctx_init(&ctx, q, n);
+    one = ctx.r1;
+    minus_one = n - ctx.r1;
 
-        if (x == 1) continue;
+    for (int i=0; i<ALEN && mr_bases[i] < n-1; i++){
+        // x = a^q * R mod n
+        uint64_t x = mont_mul(mRSA_ctx_pow(&ctx, mr_bases[i]), ctx.r2, n, ctx.ninv);
+        int j;
 
-        for (int j = 0; j < k; j++){
-            if (mod_pow(x, 1 << j, n) == n-1){
-                count++;
-                break;
-            }
+        if (x == one || x == minus_one) continue;
+
+        for (j = 1; j < k; j++){
+            x = mont_mul(x, x, n, ctx.ninv);
+            if (x == minus_one) break;
         }
 
-        if (count == 0) return COMPOSITE;
+        if (j == k) return COMPOSITE;
     }
     return PRIME;
 }
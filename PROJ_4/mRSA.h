@@ -5,22 +5,41 @@
 #ifndef mRSA_H
 #define mRSA_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include "miller_rabin.h"
 
-#define PRIME 1
-#define COMPOSITE 0
 #define MINIMUM_N 0x8000000000000000
-#define ALEN 12
+
+/*
+ * 배열 단위 mRSA 연산을 위한 상수
+ * MRSA_WINDOW : 지수 재부호화에 사용하는 고정 윈도 크기 (비트)
+ * MRSA_LANES : 한 번에 나란히 처리하는 원소 수
+ * MRSA_BATCH_MIN : 스레드 하나가 맡는 최소 원소 수
+ */
+#define MRSA_WINDOW 4
+#define MRSA_LANES 4
+#define MRSA_BATCH_MIN 4096
+
+/*
+ * mRSA_ctx - 하나의 (k, n)에 대해 미리 계산해 둔 Montgomery 문맥
+ * R = 2^64이며, digit[]에는 k를 MRSA_WINDOW 비트씩 자른 값이 상위 자리부터 들어 있다.
+ */
+typedef struct {
+    uint64_t n;
+    uint64_t ninv;      /* n^-1 mod R */
+    uint64_t r1;        /* R mod n */
+    uint64_t r2;        /* R^2 mod n */
+    int ndigit;
+    uint8_t digit[64/MRSA_WINDOW];
+} mRSA_ctx;
 
 void mRSA_generate_key(uint64_t *e, uint64_t *d, uint64_t *n);
 int mRSA_cipher(uint64_t *m, uint64_t k, uint64_t n);
+void mRSA_ctx_init(mRSA_ctx *ctx, uint64_t k, uint64_t n);
+size_t mRSA_cipher_batch(const mRSA_ctx *ctx, uint64_t *m, size_t len, uint8_t *err, int nthreads);
+uint64_t mRSA_ctx_pow(const mRSA_ctx *ctx, uint64_t x);
 
-uint64_t gcd(uint64_t a, uint64_t b);
-uint64_t mul_inv(uint64_t a, uint64_t m);
-uint64_t mod_add(uint64_t a, uint64_t b, uint64_t m);
-uint64_t mod_sub(uint64_t a, uint64_t b, uint64_t m);
-uint64_t mod_mul(uint64_t a, uint64_t b, uint64_t m);
-uint64_t mod_pow(uint64_t a, uint64_t b, uint64_t m);
-int miller_rabin(uint64_t n);
+int miller_rabin_mont(uint64_t n);
 
 #endif
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include "mRSA128.h"
+#include "instr.h"
+#include "drbg.h"
+
+/*
+ * mont128_init() - precomputes the Montgomery context of an odd n < 2^128
+ * R mod n = 2^128 - n mod n이고, R^2 mod n은 R mod n을 128번 두 배 하여 구한다.
+ * 두 배 하는 과정은 mod_add()와 같이 오버플로가 나지 않도록 r >= n-r을 검사한다.
+ */
+void mont128_init(mont128_ctx *ctx, uint128_t n)
+{
+    uint64_t n0 = (uint64_t)n, x = n0;
+    uint128_t r;
+
+    // Newton 반복으로 n^-1 mod 2^64 계산
+    for (int i=0; i<5; i++)
+        x *= 2 - n0 * x;
+
+    ctx->n = n;
+    ctx->ninv = 0 - x;
+    ctx->r1 = (0 - n) % n;
+
+    r = ctx->r1;
+    for (int i=0; i<128; i++)
+        r = (r >= n - r) ? r - (n - r) : r + r;
+    ctx->r2 = r;
+}
+
+/*
+ * mont128_mul() - computes a*b*R^-1 mod n (R = 2^128)
+ * 64 비트 워드 두 개로 나누어 64x64->128 곱셈만 사용하는 CIOS 방식으로 계산한다.
+ * a, b < n이라고 가정하며, 중간 결과는 2n보다 작으므로 마지막에 한 번만 n을 뺀다.
+ * n이 2^128에 가까우면 두 번째 워드를 더한 t는 2^192를 넘을 수 있으므로 그 올림을 t3에 받는다.
+ */
+uint128_t mont128_mul(uint128_t a, uint128_t b, const mont128_ctx *ctx)
+{
+    uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+    uint64_t b0 = (uint64_t)b, b1 = (uint64_t)(b >> 64);
+    uint64_t n0 = (uint64_t)ctx->n, n1 = (uint64_t)(ctx->n >> 64);
+    uint64_t t0, t1, t2, t3, m;
+    uint128_t c, r;
+
+    // i = 0 : t = a*b0, 이후 m*n을 더해 하위 워드를 없앰
+    c = (uint128_t)a0 * b0;
+    t0 = (uint64_t)c;
+    c = (uint128_t)a1 * b0 + (c >> 64);
+    t1 = (uint64_t)c;
+    t2 = (uint64_t)(c >> 64);
+
+    m = t0 * ctx->ninv;
+    c = ((uint128_t)m * n0 + t0) >> 64;
+    c += (uint128_t)m * n1 + t1;
+    t0 = (uint64_t)c;
+    c = (c >> 64) + t2;
+    t1 = (uint64_t)c;
+    t2 = (uint64_t)(c >> 64);
+
+    // i = 1 : t += a*b1, 다시 m*n을 더해 하위 워드를 없앰
+    c = (uint128_t)a0 * b1 + t0;
+    t0 = (uint64_t)c;
+    c = (uint128_t)a1 * b1 + t1 + (c >> 64);
+    t1 = (uint64_t)c;
+    c = (c >> 64) + t2;
+    t2 = (uint64_t)c;
+    t3 = (uint64_t)(c >> 64);
+
+    m = t0 * ctx->ninv;
+    c = ((uint128_t)m * n0 + t0) >> 64;
+    c += (uint128_t)m * n1 + t1;
+    t0 = (uint64_t)c;
+    c = (c >> 64) + t2;
+    t1 = (uint64_t)c;
+    t2 = (uint64_t)(c >> 64) + t3;
+
+    r = ((uint128_t)t1 << 64) | t0;
+    if (t2 || r >= ctx->n)
+        r -= ctx->n;
+    return r;
+}
+
+/*
+ * mont128_pow() - computes a^b mod n for a < n
+ * mRSA_ctx_pow()와 같은 4 비트 고정 윈도 방식을 사용한다.
+ */
+uint128_t mont128_pow(uint128_t a, uint128_t b, const mont128_ctx *ctx)
+{
+    uint128_t tab[1 << MRSA_WINDOW];
+    uint128_t r;
+    int i = 128 / MRSA_WINDOW - 1;
+
+    tab[0] = ctx->r1;
+    tab[1] = mont128_mul(a, ctx->r2, ctx);
+    for (int j=2; j<(1 << MRSA_WINDOW); j++)
+        tab[j] = mont128_mul(tab[j-1], tab[1], ctx);
+
+    // 상위의 0인 자리는 건너뜀
+    while (i > 0 && ((b >> (MRSA_WINDOW * i)) & ((1 << MRSA_WINDOW) - 1)) == 0)
+        i--;
+
+    r = tab[(b >> (MRSA_WINDOW * i)) & ((1 << MRSA_WINDOW) - 1)];
+    for (i--; i>=0; i--){
+        for (int j=0; j<MRSA_WINDOW; j++)
+            r = mont128_mul(r, r, ctx);
+        r = mont128_mul(r, tab[(b >> (MRSA_WINDOW * i)) & ((1 << MRSA_WINDOW) - 1)], ctx);
+    }
+
+    return mont128_mul(r, 1, ctx);
+}
+
+/*
+ * mod_mul128() - computes a*b mod m for odd m
+ * Montgomery 곱을 두 번 하면 (a*b*R^-1)*R^2*R^-1 = a*b가 된다.
+ * 문맥을 매번 만들기 때문에 반복 계산에는 mont128_mul()을 직접 쓰는 것이 좋다.
+ */
+uint128_t mod_mul128(uint128_t a, uint128_t b, uint128_t m)
+{
+    mont128_ctx ctx;
+
+    mont128_init(&ctx, m);
+    return mont128_mul(mont128_mul(a % m, b % m, &ctx), ctx.r2, &ctx);
+}
+
+/*
+ * mod_pow128() - computes a^b mod m for odd m
+ */
+uint128_t mod_pow128(uint128_t a, uint128_t b, uint128_t m)
+{
+    mont128_ctx ctx;
+
+    mont128_init(&ctx, m);
+    return mont128_pow(a % m, b, &ctx);
+}
+
+/*
+ * inv128() - computes a^-1 mod m, or 0 if the inverse does not exist
+ * m < 2^127이면 확장유클리드 알고리즘의 계수 x의 절댓값이 m보다 작으므로
+ * 부호 없는 정수로 계산한 뒤 최상위 비트로 음수 여부를 판단할 수 있다.
+ */
+static uint128_t inv128(uint128_t a, uint128_t m)
+{
+    uint128_t d0 = m, d1 = a % m, x0 = 0, x1 = 1, q, t;
+
+    while (d1 > 1){
+        q = d0 / d1;
+        t = d0 - q * d1; d0 = d1; d1 = t;
+        t = x0 - q * x1; x0 = x1; x1 = t;
+    }
+
+    if (d1 != 1)
+        return 0;
+    return (x1 >> 127) ? x1 + m : x1;
+}
+
+/*
+ * random_prime64() - returns a random 64-bit prime whose top two bits are set
+ * 상위 두 비트를 세우면 두 소수의 곱은 항상 2^127 이상이 된다.
+ */
+static uint64_t random_prime64(void)
+{
+    uint64_t x;
+
+    while (1){
+        drbg_bytes(&x, sizeof(uint64_t));
+        x |= 0xc000000000000001;
+
+        // 홀수만 차례로 검사하되 2^64를 넘어가면 처음부터 다시 뽑음
+        for (; x >= 0xc000000000000001; x += 2)
+            if (miller_rabin_mont(x))
+                return x;
+    }
+}
+
+/*
+ * mRSA128_generate_key() - generates a 128-bit mini RSA key with CRT parameters
+ * Carmichael's totient function Lambda(n) is used.
+ * p-1과 q-1이 모두 짝수이므로 Lambda(n) <= (p-1)(q-1)/2 < 2^127이 되어 inv128()의 조건을 만족한다.
+ */
+void mRSA128_generate_key(mRSA128_key *key)
+{
+    uint64_t p, q;
+    uint128_t lambda;
+
+    do {
+        p = random_prime64();
+        do {
+            q = random_prime64();
+        } while (q == p);
+        lambda = (uint128_t)(p-1) * (q-1) / gcd(p-1, q-1);
+    } while (lambda % MRSA128_E == 0);
+
+    key->p = p;
+    key->q = q;
+    key->n = (uint128_t)p * q;
+    key->e = MRSA128_E;
+    key->d = inv128(key->e, lambda);
+    key->dp = (uint64_t)(key->d % (p-1));
+    key->dq = (uint64_t)(key->d % (q-1));
+    key->qinv = (uint64_t)inv128(q, p);
+
+    mont128_init(&key->cn, key->n);
+    mRSA_ctx_init(&key->cp, key->dp, p);
+    mRSA_ctx_init(&key->cq, key->dq, q);
+}
+
+/*
+ * mRSA128_cipher() - compute m^k mod n
+ * If m >= n then returns 1 (error), otherwise 0 (success).
+ */
+int mRSA128_cipher(uint128_t *m, uint128_t k, uint128_t n)
+{
+    if (*m >= n) return 1;
+
+    *m = mod_pow128(*m, k, n);
+    return 0;
+}
+
+/*
+ * mRSA128_public() - compute m^e mod n with the precomputed context of n
+ */
+int mRSA128_public(uint128_t *m, const mRSA128_key *key)
+{
+    if (*m >= key->n) return 1;
+
+    INSTR_BEGIN(INSTR_MRSA128_PUBLIC);
+    *m = mont128_pow(*m, key->e, &key->cn);
+    INSTR_END(INSTR_MRSA128_PUBLIC);
+    return 0;
+}
+
+/*
+ * mRSA128_private() - compute m^d mod n with the CRT
+ * m1 = m^dp mod p, m2 = m^dq mod q, h = qinv*(m1-m2) mod p이면 결과는 m2 + h*q이다.
+ * 두 번의 지수승이 64 비트 Montgomery 연산으로 끝나므로 d로 직접 계산하는 것보다 빠르다.
+ */
+int mRSA128_private(uint128_t *m, const mRSA128_key *key)
+{
+    uint64_t m1, m2, h;
+
+    if (*m >= key->n) return 1;
+
+    INSTR_BEGIN(INSTR_MRSA128_PRIVATE);
+    m1 = mRSA_ctx_pow(&key->cp, (uint64_t)(*m % key->p));
+    m2 = mRSA_ctx_pow(&key->cq, (uint64_t)(*m % key->q));
+    h = (uint64_t)(((uint128_t)m1 + key->p - m2 % key->p) % key->p * key->qinv % key->p);
+
+    *m = m2 + (uint128_t)h * key->q;
+    INSTR_END(INSTR_MRSA128_PRIVATE);
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef mRSA128_H
+#define mRSA128_H
+
+#include "mRSA.h"
+
+/*
+ * 128 비트 mini RSA
+ * p, q는 64 비트 소수이며 n = p*q는 2^127 이상이다. e는 65537로 고정한다.
+ */
+typedef unsigned __int128 uint128_t;
+
+#define MINIMUM_N128 ((uint128_t)1 << 127)
+#define MRSA128_E 65537
+
+/*
+ * mont128_ctx - 홀수 n < 2^128에 대한 Montgomery 문맥 (R = 2^128)
+ */
+typedef struct {
+    uint128_t n;
+    uint128_t r1;       /* R mod n */
+    uint128_t r2;       /* R^2 mod n */
+    uint64_t ninv;      /* -n^-1 mod 2^64 */
+} mont128_ctx;
+
+/*
+ * mRSA128_key - 공개키 (e, n), 개인키 d와 CRT 계수
+ * cp, cq는 각각 (dp, p), (dq, q)에 대해 미리 계산한 64 비트 Montgomery 문맥이다.
+ */
+typedef struct {
+    uint128_t e, d, n;
+    uint64_t p, q, dp, dq, qinv;
+    mont128_ctx cn;
+    mRSA_ctx cp, cq;
+} mRSA128_key;
+
+void mont128_init(mont128_ctx *ctx, uint128_t n);
+uint128_t mont128_mul(uint128_t a, uint128_t b, const mont128_ctx *ctx);
+uint128_t mont128_pow(uint128_t a, uint128_t b, const mont128_ctx *ctx);
+uint128_t mod_mul128(uint128_t a, uint128_t b, uint128_t m);
+uint128_t mod_pow128(uint128_t a, uint128_t b, uint128_t m);
+
+void mRSA128_generate_key(mRSA128_key *key);
+int mRSA128_cipher(uint128_t *m, uint128_t k, uint128_t n);
+int mRSA128_public(uint128_t *m, const mRSA128_key *key);
+int mRSA128_private(uint128_t *m, const mRSA128_key *key);
+
+#endif
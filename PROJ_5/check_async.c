@@ -0,0 +1,229 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 비동기 작업 검증 : 연산마다 같은 키의 작업을 여러 개 async_submit()으로 넣어 배치로 묶이게 하고,
+ * 절반은 콜백으로, 절반은 async_fd()와 async_poll()로 받아 같은 입력을 직접 호출한 결과와 비교한다.
+ * AES 암호화/복호화는 Cipher()를 블록마다 부른 값, mRSA는 mRSA_cipher()의 값과 리턴값 (m >= n 포함),
+ * PSS 서명은 직접 검증이 받는지, 검증은 바뀐 메시지를 섞어 직접 검증과 리턴값이 같은지를 본다.
+ * 키 생성은 리턴값이 0이고 만든 키로 서명과 검증이 되는지, ASYNC_CALL은 함수의 리턴값을 돌려주는지 본다.
+ * 작업 스레드 1개와 여러 개로 반복한다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include "aes.h"
+#include "mRSA.h"
+#include "rsa_async.h"
+
+#include <bsd/stdlib.h>
+
+#define NJOB 48
+#define MAXBLOCKS 20
+#define MSGLEN 100
+#define NB (RSAKEYSIZE/8)
+
+static int ncb;                     /* 콜백으로 끝난 작업 수 */
+
+static void count_cb(async_job *job)
+{
+    (void)job;
+    __atomic_add_fetch(&ncb, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * run_jobs() - submits n prepared jobs, every other one with a callback, and waits for all of them
+ * 콜백이 없는 작업은 eventfd가 읽을 수 있을 때 async_poll()로 꺼낸다. 모두 끝나면 0을 리턴한다.
+ */
+static int run_jobs(async_pool *pool, async_job *jobs, int n)
+{
+    async_job *done[NJOB];
+    struct pollfd pfd = {async_fd(pool), POLLIN, 0};
+    int npoll = 0, want = n / 2;
+
+    __atomic_store_n(&ncb, 0, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < n; i++)
+        if (async_submit(pool, &jobs[i], (i & 1) ? count_cb : NULL, NULL) != 0)
+            return 1;
+    while (npoll < n - want || __atomic_load_n(&ncb, __ATOMIC_SEQ_CST) < want) {
+        npoll += async_poll(pool, done, NJOB);
+        if (npoll < n - want && poll(&pfd, 1, 10) < 0)
+            return 1;
+    }
+    return npoll != n - want;
+}
+
+/*
+ * check_aes() - compares encryption and decryption jobs of 0..MAXBLOCKS-1 blocks with Cipher()
+ */
+static int check_aes(async_pool *pool)
+{
+    static uint8_t got[NJOB][MAXBLOCKS * BLOCKLEN], want[NJOB][MAXBLOCKS * BLOCKLEN];
+    static async_job jobs[NJOB];
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t key[KEYLEN];
+    int bad = 0;
+
+    arc4random_buf(key, sizeof(key));
+    KeyExpansion(key, rk);
+    for (int mode = 0; mode < 2; mode++) {
+        for (int i = 0; i < NJOB; i++) {
+            arc4random_buf(got[i], sizeof(got[i]));
+            memcpy(want[i], got[i], sizeof(got[i]));
+            for (int k = 0; k < i % MAXBLOCKS; k++)
+                Cipher(want[i] + BLOCKLEN*k, rk, mode == 0 ? ENCRYPT : DECRYPT);
+            async_prep_aes(&jobs[i], mode == 0 ? ASYNC_AES_ENCRYPT : ASYNC_AES_DECRYPT, got[i], i % MAXBLOCKS, rk);
+        }
+        bad |= run_jobs(pool, jobs, NJOB);
+        for (int i = 0; i < NJOB; i++)
+            bad |= jobs[i].result != 0 || memcmp(got[i], want[i], sizeof(got[i])) != 0;
+    }
+    return bad;
+}
+
+/*
+ * check_mrsa() - compares mRSA jobs with mRSA_cipher(), a few inputs at or above n included
+ */
+static int check_mrsa(async_pool *pool)
+{
+    static async_job jobs[NJOB];
+    uint64_t e, d, n, got[NJOB], want[NJOB];
+    int result[NJOB], bad = 0;
+
+    mRSA_generate_key(&e, &d, &n);
+    for (int i = 0; i < NJOB; i++) {
+        arc4random_buf(&got[i], sizeof(got[i]));
+        got[i] = (i % 8 == 7) ? n + (got[i] % 16) : got[i] % n;
+        want[i] = got[i];
+        result[i] = mRSA_cipher(&want[i], d, n);
+        async_prep_mrsa(&jobs[i], &got[i], d, n);
+    }
+    bad |= run_jobs(pool, jobs, NJOB);
+    for (int i = 0; i < NJOB; i++)
+        bad |= jobs[i].result != result[i] || (result[i] == 0 && got[i] != want[i]);
+    return bad;
+}
+
+/*
+ * check_pss() - signs with the octet and imported-key jobs, then verifies with jobs and directly
+ * 검증 작업의 셋 중 하나는 메시지 한 비트를 바꿔 직접 검증의 리턴값과 비교한다.
+ */
+static int check_pss(async_pool *pool, const unsigned char *e, const unsigned char *d, const unsigned char *n,
+                     const rsa_private_key *sk, const rsa_public_key *pk)
+{
+    static unsigned char m[NJOB][MSGLEN], s[NJOB][NB];
+    static async_job jobs[NJOB];
+    int want[NJOB], bad = 0;
+
+    for (int i = 0; i < NJOB; i++) {
+        arc4random_buf(m[i], MSGLEN);
+        if (i < NJOB / 2)
+            async_prep_sign(&jobs[i], m[i], MSGLEN, d, n, s[i]);
+        else
+            async_prep_sign_key(&jobs[i], m[i], MSGLEN, sk, s[i]);
+    }
+    bad |= run_jobs(pool, jobs, NJOB);
+    for (int i = 0; i < NJOB; i++) {
+        bad |= jobs[i].result != 0;
+        bad |= rsassa_pss_verify(m[i], MSGLEN, e, n, s[i]) != 0;
+    }
+
+    for (int i = 0; i < NJOB; i++) {
+        if (i % 3 == 2)
+            m[i][i % MSGLEN] ^= 0x01;
+        want[i] = rsassa_pss_verify(m[i], MSGLEN, e, n, s[i]);
+        if (i < NJOB / 2)
+            async_prep_verify(&jobs[i], m[i], MSGLEN, e, n, s[i]);
+        else
+            async_prep_verify_key(&jobs[i], m[i], MSGLEN, pk, s[i]);
+    }
+    bad |= run_jobs(pool, jobs, NJOB);
+    for (int i = 0; i < NJOB; i++)
+        bad |= jobs[i].result != want[i] || (want[i] == 0) != (i % 3 != 2);
+    return bad;
+}
+
+/*
+ * check_keygen() - generates keys with jobs and checks the result code and a sign/verify round trip
+ */
+static int check_keygen(async_pool *pool)
+{
+    static unsigned char e[2][NB], d[2][NB], n[2][NB], s[NB];
+    async_job jobs[2];
+    unsigned char m[MSGLEN];
+    int bad = 0;
+
+    for (int mode = 0; mode < 2; mode++)
+        async_prep_keygen(&jobs[mode], e[mode], d[mode], n[mode], mode);
+    bad |= run_jobs(pool, jobs, 2);
+    for (int mode = 0; mode < 2; mode++) {
+        bad |= jobs[mode].result != 0;
+        arc4random_buf(m, sizeof(m));
+        bad |= rsassa_pss_sign(m, MSGLEN, d[mode], n[mode], s) != 0;
+        bad |= rsassa_pss_verify(m, MSGLEN, e[mode], n[mode], s) != 0;
+    }
+    return bad;
+}
+
+static int triple(void *arg)
+{
+    return 3 * *(int *)arg;
+}
+
+/*
+ * check_call() - checks that ASYNC_CALL jobs return fn(arg)
+ */
+static int check_call(async_pool *pool)
+{
+    static async_job jobs[NJOB];
+    int arg[NJOB], bad = 0;
+
+    for (int i = 0; i < NJOB; i++) {
+        arg[i] = i - NJOB / 2;
+        async_prep_call(&jobs[i], triple, &arg[i]);
+    }
+    bad |= run_jobs(pool, jobs, NJOB);
+    for (int i = 0; i < NJOB; i++)
+        bad |= jobs[i].result != 3 * arg[i];
+    return bad;
+}
+
+int main(void)
+{
+    static unsigned char e[NB], d[NB], n[NB], p[NB/2], q[NB/2];
+    const int threads[] = {1, 4};
+    const char *names[] = {"AES encrypt/decrypt", "mRSA_cipher", "PSS sign/verify", "rsa_generate_key", "ASYNC_CALL"};
+    rsa_private_key sk;
+    rsa_public_key pk;
+    async_pool *pool;
+    int bad, fail = 0;
+
+    rsa_generate_key_crt(e, d, n, p, q, 0);
+    if (rsa_private_key_import(&sk, d, n, p, q) != 0 || rsa_public_key_import(&pk, e, n) != 0) {
+        printf("key import failed\n");
+        return 1;
+    }
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        if ((pool = async_pool_create(threads[t])) == NULL) {
+            printf("async_pool_create(%d) failed\n", threads[t]);
+            return 1;
+        }
+        for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+            switch (k) {
+            case 0: bad = check_aes(pool); break;
+            case 1: bad = check_mrsa(pool); break;
+            case 2: bad = check_pss(pool, e, d, n, &sk, &pk); break;
+            case 3: bad = check_keygen(pool); break;
+            default: bad = check_call(pool); break;
+            }
+            printf("async %-20s %d threads -- %s\n", names[k], threads[t], bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+        async_pool_destroy(pool);
+    }
+    rsa_private_key_clear(&sk);
+    rsa_public_key_clear(&pk);
+    return fail;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 일괄 검증 교차 검증 : rsassa_pss_verify_batch()의 항목별 결과를 하나씩 부른 rsassa_pss_verify_key()와
+ * 비교한다. 항목은 두 키로 만든 올바른 서명, 서명이나 메시지를 바꾼 서명, s >= n,
+ * 다른 키의 서명을 섞고, 길이가 같은 메시지 (다중 버퍼 해시)와 다른 메시지를 함께 쓴다.
+ * 스레드 수를 바꿔 가며 캐시 없이, 작은 캐시 (교체가 일어남), 큰 캐시로 두 번씩 돌리고, 두 번째에는
+ * 캐시에서 얻은 결과도 같은지와 다른 키로 바꾼 같은 (m, s)가 캐시에 걸리지 않는지 확인한다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rsa_batch.h"
+
+#include <bsd/stdlib.h>
+
+#define NITEM 300
+#define MSGLEN 64
+
+static unsigned char msg[NITEM][2*MSGLEN], sig[NITEM][RSAKEYSIZE/8];
+static rsa_verify_item item[NITEM];
+static int want[NITEM];
+
+/*
+ * make_items() - builds the items and their expected results
+ * 항목 i의 종류는 i % 6으로 정한다 : 0, 1은 올바른 서명, 2는 서명 변조, 3은 메시지 변조,
+ * 4는 s >= n, 5는 다른 키로 검증. 셋째 항목마다 메시지 길이를 바꾼다.
+ */
+static void make_items(rsa_private_key *sk, rsa_public_key *pk, const unsigned char (*n)[RSAKEYSIZE/8])
+{
+    int k;
+
+    for (int i = 0; i < NITEM; i++) {
+        k = i % 2;
+        item[i].m = msg[i];
+        item[i].mLen = (i % 3 == 0) ? MSGLEN + i % 50 : MSGLEN;
+        item[i].s = sig[i];
+        item[i].key = &pk[k];
+        arc4random_buf(msg[i], item[i].mLen);
+        rsassa_pss_sign_key(msg[i], item[i].mLen, &sk[k], sig[i]);
+        switch (i % 6) {
+        case 2: sig[i][arc4random_uniform(RSAKEYSIZE/8)] ^= 0x40; break;
+        case 3: msg[i][arc4random_uniform(item[i].mLen)] ^= 0x01; break;
+        case 4: memcpy(sig[i], n[k], RSAKEYSIZE/8); break;
+        case 5: item[i].key = &pk[1-k]; break;
+        }
+        want[i] = rsassa_pss_verify_key(item[i].m, item[i].mLen, item[i].key, item[i].s);
+    }
+}
+
+/*
+ * check_batch() - runs one batch and compares every result and the failure count
+ */
+static int check_batch(int nthreads, rsa_verify_cache *cache, rsa_batch_stats *stats)
+{
+    static int result[NITEM];
+    size_t nbad = 0;
+    int bad = 0;
+
+    for (int i = 0; i < NITEM; i++)
+        nbad += want[i] != 0;
+    memset(result, 0xff, sizeof(result));
+    bad |= rsassa_pss_verify_batch(item, NITEM, result, nthreads, cache, stats) != nbad;
+    for (int i = 0; i < NITEM; i++)
+        bad |= result[i] != want[i];
+    bad |= stats->count != NITEM || stats->valid != NITEM - nbad;
+    return bad;
+}
+
+/*
+ * check_cache() - runs the batch twice with a cache of capacity entries
+ * 용량이 항목 수보다 충분히 크면 두 번째에는 거의 모두 (집합 하나에 몰린 항목은 밀려날 수 있으므로
+ * 90% 이상) 캐시에서 나와야 한다. 작은 캐시는 같은 순서로 다시 돌리면 집합마다 돌아가며 교체하느라
+ * 하나도 남지 않을 수 있으므로, 결과가 맞는지와 캐시에서 나온 수가 용량 (집합 수를 2의 거듭제곱으로
+ * 올리므로 2*capacity 미만)을 넘지 않는지만 본다.
+ * 마지막으로 올바른 서명 (m, s)의 키만 바꾸어 캐시의 결과가 다른 키에 쓰이지 않는지 본다.
+ */
+static int check_cache(int nthreads, size_t capacity, rsa_public_key *pk)
+{
+    rsa_verify_cache cache;
+    rsa_batch_stats stats;
+    int bad = 0;
+
+    if (rsa_verify_cache_init(&cache, capacity) != 0)
+        return 1;
+    bad |= check_batch(nthreads, &cache, &stats);
+    bad |= stats.cached != 0;
+    bad |= check_batch(nthreads, &cache, &stats);
+    if (capacity >= 2*NITEM)
+        bad |= stats.cached < NITEM * 9 / 10;
+    else
+        bad |= stats.cached >= 2*capacity;
+
+    for (int i = 0; i < NITEM; i += 6) {
+        item[i].key = &pk[1 - i % 2];
+        want[i] = rsassa_pss_verify_key(item[i].m, item[i].mLen, item[i].key, item[i].s);
+        bad |= want[i] == 0;
+    }
+    bad |= check_batch(nthreads, &cache, &stats);
+    for (int i = 0; i < NITEM; i += 6) {
+        item[i].key = &pk[i % 2];
+        want[i] = 0;
+    }
+    rsa_verify_cache_clear(&cache);
+    return bad;
+}
+
+int main(void)
+{
+    unsigned char e[2][RSAKEYSIZE/8], d[RSAKEYSIZE/8], n[2][RSAKEYSIZE/8], p[RSAKEYSIZE/16], q[RSAKEYSIZE/16];
+    const int threads[] = {1, 3, 8};
+    rsa_private_key sk[2];
+    rsa_public_key pk[2];
+    rsa_batch_stats stats;
+    int bad, fail = 0;
+
+    for (int k = 0; k < 2; k++) {
+        rsa_generate_key_crt(e[k], d, n[k], p, q, 0);
+        if (rsa_private_key_import(&sk[k], d, n[k], p, q) != 0 || rsa_public_key_import(&pk[k], e[k], n[k]) != 0) {
+            printf("key import failed\n");
+            return 1;
+        }
+    }
+    make_items(sk, pk, n);
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        bad = check_batch(threads[t], NULL, &stats);
+        printf("verify_batch %d threads, %-10s vs single -- %s\n", threads[t], "no cache", bad ? "FAILED" : "PASSED");
+        fail |= bad;
+        bad = check_cache(threads[t], NITEM / 4, pk);
+        printf("verify_batch %d threads, %-10s vs single -- %s\n", threads[t], "small cache", bad ? "FAILED" : "PASSED");
+        fail |= bad;
+        bad = check_cache(threads[t], 4*NITEM, pk);
+        printf("verify_batch %d threads, %-10s vs single -- %s\n", threads[t], "large cache", bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    for (int k = 0; k < 2; k++) {
+        rsa_private_key_clear(&sk[k]);
+        rsa_public_key_clear(&pk[k]);
+    }
+    return fail;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 고정 크기 지수승 백엔드 교차 검증 : rsa_bn_powm()의 결과를 GMP mpz_powm()과 비교한다.
+ * 2048, 3072, 4096 비트 법마다 무작위 법, 밑, 지수 (비트 길이를 여러 가지로 바꿈)로 계산하고,
+ * BMI2/ADX가 있으면 그 경로와 128 비트 정수 경로를 둘 다 시험한다. 밑이 법 이상이거나 법이 짝수,
+ * 지원하지 않는 길이인 경우의 오류 코드도 확인한다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include "rsa_bn.h"
+
+#include <bsd/stdlib.h>
+
+#define ROUNDS 40               /* 처음 20번은 지수 비트 길이 표를 차례로 씀 */
+
+/*
+ * random_below() - writes a random len-byte octet string that is smaller than m
+ */
+static void random_below(unsigned char *x, const unsigned char *m, size_t len)
+{
+    do
+        arc4random_buf(x, len);
+    while (memcmp(x, m, len) >= 0);
+}
+
+/*
+ * random_exponent() - writes a len-byte exponent with at most bits significant bits
+ */
+static void random_exponent(unsigned char *e, size_t len, size_t bits)
+{
+    memset(e, 0, len);
+    if (bits == 0)
+        return;
+    arc4random_buf(e + len - (bits + 7) / 8, (bits + 7) / 8);
+    if (bits % 8 != 0)
+        e[len - (bits + 7) / 8] &= (1 << (bits % 8)) - 1;
+    e[len - (bits + 7) / 8] |= 1 << ((bits - 1) % 8);
+}
+
+/*
+ * check_size() - compares rsa_bn_powm() with mpz_powm() on len-byte moduli
+ */
+static int check_size(size_t len)
+{
+    unsigned char m[RSA_MAX_KEYSIZE/8], a[RSA_MAX_KEYSIZE/8], e[RSA_MAX_KEYSIZE/8];
+    unsigned char r[RSA_MAX_KEYSIZE/8], x[RSA_MAX_KEYSIZE/8];
+    const size_t ebits[] = {0, 1, 2, 17, 32, 33, 64, 65, 100, 1000};
+    rsa_bn_ctx ctx;
+    mpz_t zm, za, ze, zr;
+    int bad = 0;
+
+    mpz_inits(zm, za, ze, zr, NULL);
+    for (int it = 0; it < ROUNDS && !bad; it++) {
+        arc4random_buf(m, len);
+        m[0] |= 0x80;
+        m[len-1] |= 1;
+        if (rsa_bn_init(&ctx, m, len) != 0) {
+            bad = 1;
+            break;
+        }
+        // 밑은 0, 1, m-1과 무작위 값을, 지수는 여러 비트 길이와 법과 같은 길이를 씀
+        switch (it) {
+        case 0: memset(a, 0, len); break;
+        case 1: memset(a, 0, len); a[len-1] = 1; break;
+        case 2: memcpy(a, m, len); a[len-1] ^= 1; break;
+        default: random_below(a, m, len);
+        }
+        if (it % 2 == 0 && (size_t)it / 2 < sizeof(ebits) / sizeof(ebits[0]))
+            random_exponent(e, len, ebits[it / 2]);
+        else
+            random_exponent(e, len, 8*len - it % 3);
+
+        mpz_import(zm, len, 1, 1, 1, 0, m);
+        mpz_import(za, len, 1, 1, 1, 0, a);
+        mpz_import(ze, len, 1, 1, 1, 0, e);
+        mpz_powm(zr, za, ze, zm);
+        memset(x, 0, len);
+        mpz_export(x + len - (mpz_sizeinbase(zr, 2) + 7) / 8, NULL, 1, 1, 1, 0, zr);
+
+        bad |= rsa_bn_powm(r, a, e, len, &ctx) != 0;
+        bad |= memcmp(r, x, len) != 0;
+        // r이 a와 같은 배열이어도 됨
+        memcpy(r, a, len);
+        bad |= rsa_bn_powm(r, r, e, len, &ctx) != 0;
+        bad |= memcmp(r, x, len) != 0;
+    }
+    // 밑이 법과 같으면 범위 밖
+    bad |= rsa_bn_powm(r, m, e, len, &ctx) != EM_MSG_OUT_OF_RANGE;
+    // 짝수 법과 지원하지 않는 길이는 거부
+    m[len-1] &= 0xfe;
+    bad |= rsa_bn_init(&ctx, m, len) != EM_INVALID_PARAMS;
+    m[len-1] |= 1;
+    bad |= rsa_bn_init(&ctx, m, len - 8) != EM_INVALID_PARAMS;
+    mpz_clears(zm, za, ze, zr, NULL);
+    return bad;
+}
+
+int main(void)
+{
+    const size_t lens[] = {2048/8, 3072/8, 4096/8};
+    int features = rsa_bn_features(), bad, fail = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        // 두 번째는 BMI2/ADX를 끄고 128 비트 정수 경로로 계산함
+        if (pass == 1) {
+            if (!(features & RSA_BN_ADX)) {
+                printf("rsa_bn mulx/adcx/adox not available, skipped\n");
+                break;
+            }
+            rsa_bn_restrict(0);
+        }
+        for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+            bad = check_size(lens[i]);
+            printf("rsa_bn_powm %4zu bits, %-8s vs mpz_powm -- %s\n", 8*lens[i],
+                   (rsa_bn_features() & RSA_BN_ADX) ? "ADX" : "generic", bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+    }
+    rsa_bn_restrict(features);
+    return fail;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 개인키 연산 검증 : rsa_cipher_crt()와 octet 키의 rsa_cipher_blind()의 결과를 GMP의 m^d mod n과 비교한다.
+ * 소수 2, 3, 4개인 2048 비트 키를 e = 65537과 무작위 e로 만들어 시험하고, dQ를 바꿔 한쪽 CRT 결과만
+ * 틀리게 했을 때 EM_FAULT를 리턴하며 출력을 지우는지, m >= n을 거부하는지도 확인한다.
+ * rsa_cipher_blind()는 키마다 여러 번 불러 블라인딩 쌍을 다시 쓰는 경우와 키가 바뀌는 경우를 모두 거친다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include "rsa_pss.h"
+
+#include <bsd/stdlib.h>
+
+#define BITS 2048
+#define ROUNDS 20
+
+/*
+ * check_key() - compares rsa_cipher_crt() and rsa_cipher_blind() with mpz_powm() for one generated key
+ */
+static int check_key(int nprimes, int mode)
+{
+    unsigned char e[BITS/8], d[BITS/8], n[BITS/8], primes[RSA_MAX_PRIMES * BITS/8];
+    unsigned char m[BITS/8], x[BITS/8], y[BITS/8], zero[BITS/8] = {0};
+    rsa_private_key key;
+    mpz_t zd, zn, zm;
+    int bad = 0;
+
+    if (rsa_generate_key_mp(BITS, nprimes, e, d, n, primes, mode) != 0)
+        return 1;
+    if (rsa_private_key_import_mp(&key, BITS, nprimes, d, n, primes) != 0) {
+        rsa_private_key_clear(&key);
+        return 1;
+    }
+    mpz_inits(zd, zn, zm, NULL);
+    mpz_import(zd, BITS/8, 1, 1, 1, 0, d);
+    mpz_import(zn, BITS/8, 1, 1, 1, 0, n);
+    for (int i = 0; i < ROUNDS && !bad; i++) {
+        arc4random_buf(m, sizeof(m));
+        m[0] &= 0x7f;
+        mpz_import(zm, BITS/8, 1, 1, 1, 0, m);
+        mpz_powm(zm, zm, zd, zn);
+        memset(x, 0, sizeof(x));
+        mpz_export(x + BITS/8 - (mpz_sizeinbase(zm, 2) + 7) / 8, NULL, 1, 1, 1, 0, zm);
+        memcpy(y, m, BITS/8);
+        bad |= rsa_cipher_blind(y, BITS/8, d, n) != 0;
+        bad |= memcmp(y, x, BITS/8) != 0;
+        bad |= rsa_cipher_crt(m, BITS/8, &key) != 0;
+        bad |= memcmp(m, x, BITS/8) != 0;
+    }
+    memcpy(m, n, BITS/8);
+    bad |= rsa_cipher_crt(m, BITS/8, &key) != EM_MSG_OUT_OF_RANGE;
+    bad |= rsa_cipher_blind(m, BITS/8, d, n) != EM_MSG_OUT_OF_RANGE;
+    n[BITS/8 - 1] ^= 1;
+    m[0] = 0;
+    bad |= rsa_cipher_blind(m, BITS/8, d, n) != EM_INVALID_KEY;
+
+    // q 쪽 결과만 틀리게 하면 검사에 걸려야 함
+    mpz_add_ui(key.dQ, key.dQ, 1);
+    arc4random_buf(m, sizeof(m));
+    m[0] &= 0x7f;
+    bad |= rsa_cipher_crt(m, BITS/8, &key) != EM_FAULT;
+    bad |= memcmp(m, zero, BITS/8) != 0;
+
+    mpz_clears(zd, zn, zm, NULL);
+    rsa_private_key_clear(&key);
+    return bad;
+}
+
+int main(void)
+{
+    int bad, fail = 0;
+
+    for (int mode = 0; mode < 2; mode++)
+        for (int k = 2; k <= RSA_MAX_PRIMES; k++) {
+            bad = check_key(k, mode);
+            printf("rsa_cipher_crt/blind %d primes, %-10s vs mpz_powm -- %s\n", k, mode ? "random e" : "e = 65537",
+                   bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+    return fail;
+}
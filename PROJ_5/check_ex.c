@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 실행 중 키 크기/해시 선택 검증 : {2048, 3072, 4096} x {SHA-224, 256, 384, 512}의 모든 쌍에서
+ * octet 키 API (rsassa_pss_sign_ex, rsassa_pss_verify_ex)와 가져온 키 API (rsassa_pss_sign_key_ex,
+ * rsassa_pss_verify_key_ex)로 만든 서명이 서로 검증되는지, 다른 해시나 바뀐 메시지로는 거부되는지 확인한다.
+ * 2048 비트와 SHA-256 (rsa_pss.h의 기본값)에서는 기존 API와도 교차 검증하고, 지원하지 않는 쌍은
+ * EM_INVALID_PARAMS로 거부하는지 본다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "rsa_pss_ex.h"
+
+#include <bsd/stdlib.h>
+
+#define MSGLEN 200
+#define NB (RSA_MAX_KEYSIZE/8)
+
+static const int sizes[] = {2048, 3072, 4096};
+static const int hashes[] = {224, 256, 384, 512};
+
+#define NHASH (sizeof(hashes) / sizeof(hashes[0]))
+
+/*
+ * check_pair() - signs and verifies one message both ways with one (key size, hash) pair
+ */
+static int check_pair(int bits, int hash, const unsigned char *e, const unsigned char *d, const unsigned char *n,
+                      const rsa_private_key *sk, const rsa_public_key *pk)
+{
+    rsa_pss_params prm = {bits, hash}, other = {bits, hash == 256 ? 512 : 256};
+    unsigned char m[MSGLEN], s[NB];
+    int bad = 0;
+
+    arc4random_buf(m, sizeof(m));
+    bad |= !rsa_pss_params_supported(&prm);
+    bad |= rsassa_pss_sign_ex(&prm, m, MSGLEN, d, n, s) != 0;
+    bad |= rsassa_pss_verify_ex(&prm, m, MSGLEN, e, n, s) != 0;
+    bad |= rsassa_pss_verify_key_ex(hash, m, MSGLEN, pk, s) != 0;
+    bad |= rsassa_pss_verify_ex(&other, m, MSGLEN, e, n, s) == 0;
+    if (bits == RSAKEYSIZE && hash == SHASIZE)
+        bad |= rsassa_pss_verify(m, MSGLEN, e, n, s) != 0;
+
+    bad |= rsassa_pss_sign_key_ex(hash, m, MSGLEN, sk, s) != 0;
+    bad |= rsassa_pss_verify_key_ex(hash, m, MSGLEN, pk, s) != 0;
+    bad |= rsassa_pss_verify_ex(&prm, m, MSGLEN, e, n, s) != 0;
+    bad |= rsassa_pss_verify_key_ex(other.hash, m, MSGLEN, pk, s) == 0;
+    if (bits == RSAKEYSIZE && hash == SHASIZE) {
+        bad |= rsassa_pss_verify_key(m, MSGLEN, pk, s) != 0;
+        bad |= rsassa_pss_sign_key(m, MSGLEN, sk, s) != 0;
+        bad |= rsassa_pss_verify_ex(&prm, m, MSGLEN, e, n, s) != 0;
+    }
+
+    m[MSGLEN/2] ^= 0x80;
+    bad |= rsassa_pss_verify_ex(&prm, m, MSGLEN, e, n, s) == 0;
+    bad |= rsassa_pss_verify_key_ex(hash, m, MSGLEN, pk, s) == 0;
+    return bad;
+}
+
+/*
+ * check_unsupported() - checks that pairs without an implementation are rejected
+ */
+static int check_unsupported(const unsigned char *e, const unsigned char *d, const unsigned char *n)
+{
+    const rsa_pss_params bad_prm[] = {{1024, 256}, {2048, 160}, {2048, 0}, {8192, 256}, {3000, 256}};
+    unsigned char m[MSGLEN] = {0}, s[NB] = {0};
+    int bad = 0;
+
+    for (size_t i = 0; i < sizeof(bad_prm) / sizeof(bad_prm[0]); i++) {
+        bad |= rsa_pss_params_supported(&bad_prm[i]);
+        bad |= rsassa_pss_sign_ex(&bad_prm[i], m, MSGLEN, d, n, s) != EM_INVALID_PARAMS;
+        bad |= rsassa_pss_verify_ex(&bad_prm[i], m, MSGLEN, e, n, s) != EM_INVALID_PARAMS;
+    }
+    return bad;
+}
+
+int main(void)
+{
+    unsigned char e[NB], d[NB], n[NB], p[NB/2], q[NB/2];
+    rsa_private_key sk;
+    rsa_public_key pk;
+    int bits, bad, fail = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bits = sizes[i];
+        if (rsa_generate_key_ex(bits, e, d, n, p, q, 0) != 0 ||
+            rsa_private_key_import_ex(&sk, bits, d, n, p, q) != 0 || rsa_public_key_import_ex(&pk, bits, e, n) != 0) {
+            printf("%d-bit key generation or import failed\n", bits);
+            return 1;
+        }
+        for (size_t h = 0; h < NHASH; h++) {
+            bad = check_pair(bits, hashes[h], e, d, n, &sk, &pk);
+            printf("PSS_ex %d bits, SHA-%d %-12s -- %s\n", bits, hashes[h], "sign/verify", bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+        if (bits == RSAKEYSIZE) {
+            bad = check_unsupported(e, d, n);
+            printf("PSS_ex %-30s -- %s\n", "unsupported parameters", bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+        rsa_private_key_clear(&sk);
+        rsa_public_key_clear(&pk);
+    }
+    return fail;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 일괄 GCD 검증 : 서로 다른 소수로 만든 모듈러스 사이에 공유 인수를 일부러 심고 rsa_batchgcd를 실행해
+ * 심은 모듈러스만, 맞는 공유 인수와 함께 찾는지 확인한다. 심는 경우는 두 모듈러스가 소수 하나를 공유,
+ * 세 모듈러스가 같은 소수를 공유, 같은 모듈러스가 두 번 (dup), 두 소수를 각각 다른 모듈러스와 공유하는
+ * 모듈러스 (처음 gcd가 N 자신이라 쌍별 gcd로 다시 나누는 경우)이다. 16진수 입력과 -r octet 입력,
+ * 스레드 1개와 여러 개로 돌리고, 공유 인수가 없는 입력에서는 아무것도 찾지 않는지도 본다.
+ * rsa_batchgcd는 이 디렉터리에 만들어져 있어야 한다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <gmp.h>
+
+#include <bsd/stdlib.h>
+
+#define NMOD 200
+#define BITS 1024
+#define TOOL "./rsa_batchgcd"
+
+static mpz_t mod[NMOD];
+static int want[NMOD];              /* 찾아야 하면 1 */
+static mpz_t factor[NMOD];          /* 기대하는 공유 인수, dup이면 모듈러스 자신, 둘 중 하나면 0 */
+
+/*
+ * random_prime() - a BITS/2-bit prime from the next prime after a random odd number
+ */
+static void random_prime(mpz_t p)
+{
+    unsigned char buf[BITS/16];
+
+    arc4random_buf(buf, sizeof(buf));
+    buf[0] |= 0xc0;
+    mpz_import(p, sizeof(buf), 1, 1, 1, 0, buf);
+    mpz_nextprime(p, p);
+}
+
+/*
+ * make_moduli() - builds NMOD moduli from fresh primes, then plants shared factors if plant is 1
+ */
+static void make_moduli(int plant)
+{
+    const int three[] = {77, 120, 199};
+    mpz_t p, q, r;
+
+    mpz_inits(p, q, r, NULL);
+    for (int i = 0; i < NMOD; i++) {
+        random_prime(p);
+        random_prime(q);
+        mpz_mul(mod[i], p, q);
+        want[i] = 0;
+        mpz_set_ui(factor[i], 0);
+    }
+    if (plant) {
+        // 10과 50이 p를 공유
+        random_prime(p);
+        random_prime(q);
+        mpz_mul(mod[10], p, q);
+        random_prime(q);
+        mpz_mul(mod[50], p, q);
+        mpz_set(factor[10], p);
+        mpz_set(factor[50], p);
+        want[10] = want[50] = 1;
+        // 77, 120, 199가 p를 공유
+        random_prime(p);
+        for (int k = 0; k < 3; k++) {
+            random_prime(q);
+            mpz_mul(mod[three[k]], p, q);
+            mpz_set(factor[three[k]], p);
+            want[three[k]] = 1;
+        }
+        // 150은 30과 같음
+        mpz_set(mod[150], mod[30]);
+        mpz_set(factor[30], mod[30]);
+        mpz_set(factor[150], mod[30]);
+        want[30] = want[150] = 1;
+        // 90 = p * q이고 91이 p, 92가 q를 공유하므로 90의 공유 인수는 둘 중 하나
+        random_prime(p);
+        random_prime(q);
+        mpz_mul(mod[90], p, q);
+        random_prime(r);
+        mpz_mul(mod[91], r, p);
+        random_prime(r);
+        mpz_mul(mod[92], r, q);
+        mpz_set(factor[91], p);
+        mpz_set(factor[92], q);
+        want[90] = want[91] = want[92] = 1;
+    }
+    mpz_clears(p, q, r, NULL);
+}
+
+/*
+ * write_input() - writes the moduli to a temporary file as hex lines or BITS/8-byte octet strings
+ */
+static int write_input(char *path, int raw)
+{
+    unsigned char buf[BITS/8];
+    FILE *fp;
+    int fd;
+
+    if ((fd = mkstemp(path)) < 0 || (fp = fdopen(fd, "w")) == NULL)
+        return -1;
+    for (int i = 0; i < NMOD; i++) {
+        if (raw) {
+            memset(buf, 0, sizeof(buf));
+            mpz_export(buf + sizeof(buf) - (mpz_sizeinbase(mod[i], 2) + 7) / 8, NULL, 1, 1, 1, 0, mod[i]);
+            fwrite(buf, 1, sizeof(buf), fp);
+        } else {
+            gmp_fprintf(fp, "%Zx\n", mod[i]);
+        }
+    }
+    return fclose(fp);
+}
+
+/*
+ * check_factor() - checks one reported line "index modulus factor" against the planted factors
+ */
+static int check_factor(size_t i, const char *hex, const char *fac)
+{
+    mpz_t x, g;
+    int bad = 0;
+
+    if (i >= NMOD || !want[i])
+        return 1;
+    mpz_inits(x, g, NULL);
+    bad |= mpz_set_str(x, hex, 16) != 0 || mpz_cmp(x, mod[i]) != 0;
+    if (strcmp(fac, "dup") == 0) {
+        bad |= mpz_cmp(factor[i], mod[i]) != 0;
+    } else {
+        bad |= mpz_set_str(g, fac, 16) != 0;
+        if (mpz_sgn(factor[i]) != 0)
+            bad |= mpz_cmp(g, factor[i]) != 0;
+        else
+            bad |= !mpz_divisible_p(mod[i], g) || mpz_cmp_ui(g, 1) <= 0 || mpz_cmp(g, mod[i]) >= 0;
+    }
+    mpz_clears(x, g, NULL);
+    return bad;
+}
+
+/*
+ * run_tool() - runs rsa_batchgcd on the moduli and compares its output with want[] and factor[]
+ */
+static int run_tool(int raw, int nthreads)
+{
+    char path[] = "/tmp/check_gcdXXXXXX", cmd[256], line[1024], hex[512], fac[512];
+    int seen[NMOD] = {0}, bad = 0, status, nfound = 0, nwant = 0;
+    size_t i;
+    FILE *fp;
+
+    if (write_input(path, raw) < 0)
+        return 1;
+    if (raw)
+        snprintf(cmd, sizeof(cmd), "%s -r %d -t %d %s 2>/dev/null", TOOL, BITS, nthreads, path);
+    else
+        snprintf(cmd, sizeof(cmd), "%s -t %d %s 2>/dev/null", TOOL, nthreads, path);
+    if ((fp = popen(cmd, "r")) == NULL) {
+        unlink(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "%zu %511s %511s", &i, hex, fac) != 3 || i >= NMOD || seen[i]) {
+            bad = 1;
+            continue;
+        }
+        seen[i] = 1;
+        nfound++;
+        bad |= check_factor(i, hex, fac);
+    }
+    status = pclose(fp);
+    unlink(path);
+    for (int k = 0; k < NMOD; k++)
+        nwant += want[k];
+    bad |= nfound != nwant;
+    // 약한 모듈러스가 있으면 2, 없으면 0으로 끝남
+    bad |= !WIFEXITED(status) || WEXITSTATUS(status) != (nwant ? 2 : 0);
+    return bad;
+}
+
+int main(void)
+{
+    const int threads[] = {1, 4};
+    int bad, fail = 0;
+
+    if (access(TOOL, X_OK) != 0) {
+        printf("%s not found\n", TOOL);
+        return 1;
+    }
+    for (int i = 0; i < NMOD; i++)
+        mpz_inits(mod[i], factor[i], NULL);
+    for (int plant = 1; plant >= 0; plant--) {
+        make_moduli(plant);
+        for (int raw = 0; raw < 2; raw++)
+            for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+                bad = run_tool(raw, threads[t]);
+                printf("batchgcd %-14s %-5s input, %d threads -- %s\n", plant ? "planted" : "no shared",
+                       raw ? "octet" : "hex", threads[t], bad ? "FAILED" : "PASSED");
+                fail |= bad;
+            }
+    }
+    for (int i = 0; i < NMOD; i++)
+        mpz_clears(mod[i], factor[i], NULL);
+    return fail;
+}
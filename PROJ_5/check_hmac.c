@@ -0,0 +1,326 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * HMAC과 Encrypt-then-MAC 검증 : RFC 4231의 검증 데이터 (경우 1-7)로 HMAC-SHA256/512를 한 번에, 그리고
+ * 여러 조각으로 나누어 넣어 확인하고, SHA extensions이 있으면 끈 상태에서도 다시 확인한다.
+ * EtM은 OpenSSL AES-128-CTR과 Python hmac으로 만든 검증 데이터로 etm_seal()을 확인하고,
+ * 태그, 암호문, A, IV 중 하나라도 바뀌면 etm_open()이 -1을 리턴하며 출력을 건드리지 않는지 본다.
+ * 무작위 키에서는 블록마다 Cipher()를 부르는 CTR과 A || IV || C || AL을 한 번에 넣은 hmac_sha256()으로
+ * 만든 참조 값과 비교하며, 길이는 0부터 블록과 ETM_CHUNK 경계 앞뒤를 지나고 카운터는 여러 바이트에
+ * 걸쳐 올림이 생기게 한다. CPU가 지원하는 CipherBlocks() 백엔드 (AES-NI, 열 단위 구현)마다 반복한다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다. make check가 실행한다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hmac.h"
+#include "etm.h"
+#include "sha2_accel.h"
+#include "aes.h"
+
+#include <bsd/stdlib.h>
+
+/*
+ * RFC 4231 경우 1-7, hex가 1이면 data는 16진수 문자열이다. 경우 5는 앞 128 비트만 비교한다.
+ */
+static const struct {
+    const char *key;
+    const char *data;
+    int hex;
+    const char *mac256, *mac512;
+} kat[] = {
+    {"0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b", "Hi There", 0,
+     "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+     "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cde"
+     "daa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854"},
+    {"4a656665", "what do ya want for nothing?", 0,
+     "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+     "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+     "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+     "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd"
+     "dddddddddddddddddddddddddddddddddddd", 1,
+     "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe",
+     "fa73b0089d56a284efb0f0756c890be9b1b5dbdd8ee81a3655f83e33b2279d39"
+     "bf3e848279a722c806b485a47e67c807b946a337bee8942674278859e13292fb"},
+    {"0102030405060708090a0b0c0d0e0f10111213141516171819",
+     "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd"
+     "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd", 1,
+     "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b",
+     "b0ba465637458c6990e5a8c5f61d4af7e576d97ff94b872de76f8050361ee3db"
+     "a91ca5c11aa25eb4d679275cc5788063a5f19741120c4f2de2adebeb10a298dd"},
+    {"0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c", "Test With Truncation", 0,
+     "a3b6167473100ee06e0c796c2955552b",
+     "415fad6271580a531d4179bc891d87a6"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaa", "Test Using Larger Than Block-Size Key - Hash Key First", 0,
+     "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+     "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+     "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+     "aaaaaa",
+     "This is a test using a larger than block-size key and a larger than block-size data. "
+     "The key needs to be hashed before being used by the HMAC algorithm.", 0,
+     "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2",
+     "e37b6a775dc87dbaa4dfa9f96e5e3ffddebd71f8867289865df5a32d20cdc944"
+     "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58"},
+};
+
+#define NKAT (sizeof(kat) / sizeof(kat[0]))
+#define MAXLEN 256
+
+/*
+ * EtM 검증 데이터 : 키는 0x00..0x2f, IV는 0xf0..0xff, A는 "header", 평문은 (7i mod 256) 100 바이트
+ */
+static const char etm_ct[] =
+    "66a0c9fd28711b79af6e984a674dcfc4c2f6a9853b0da60c0c02c506aa57cd33"
+    "32967ca38058e18ce39ead747ba91738208f383f50cc22c6dfe29585ebcb8523"
+    "abc66cfdf175b9937c7ddf1febe5a314d9031fb52987633fc0e25303c4c4aa1a"
+    "44a1f480";
+static const char etm_tag[] = "aee308ec022de28d5d1db3e7816f82b9c9052b6e6084c5c19f6fc4c35aef88c1";
+#define ETM_MLEN 100
+#define ETM_BIG (3*ETM_CHUNK + 17)
+
+/*
+ * unhex() - decodes the hex string s into p and returns the number of bytes
+ */
+static size_t unhex(const char *s, uint8_t *p)
+{
+    size_t n = strlen(s) / 2;
+
+    for (size_t i = 0; i < n; i++)
+        sscanf(s + 2*i, "%2hhx", p + i);
+    return n;
+}
+
+/*
+ * check_hmac() - checks case i in one call and fed in step-byte pieces
+ */
+static int check_hmac(int i, size_t step)
+{
+    uint8_t k[MAXLEN], m[MAXLEN], mac[HMAC_SHA512_LEN], want[HMAC_SHA512_LEN];
+    size_t kLen, mLen, wLen, n;
+    hmac_sha256_key k256;
+    hmac_sha512_key k512;
+    hmac_sha256_ctx c256;
+    hmac_sha512_ctx c512;
+    int bad = 0;
+
+    kLen = unhex(kat[i].key, k);
+    if (kat[i].hex)
+        mLen = unhex(kat[i].data, m);
+    else {
+        mLen = strlen(kat[i].data);
+        memcpy(m, kat[i].data, mLen);
+    }
+    hmac_sha256_key_init(&k256, k, kLen);
+    hmac_sha512_key_init(&k512, k, kLen);
+
+    wLen = unhex(kat[i].mac256, want);
+    hmac_sha256(&k256, m, mLen, mac);
+    bad |= memcmp(mac, want, wLen) != 0;
+    hmac_sha256_init(&c256, &k256);
+    for (size_t off = 0; off < mLen; off += n) {
+        n = (mLen - off < step) ? mLen - off : step;
+        hmac_sha256_update(&c256, m + off, n);
+    }
+    hmac_sha256_final(&c256, mac);
+    bad |= memcmp(mac, want, wLen) != 0;
+
+    wLen = unhex(kat[i].mac512, want);
+    hmac_sha512(&k512, m, mLen, mac);
+    bad |= memcmp(mac, want, wLen) != 0;
+    hmac_sha512_init(&c512, &k512);
+    for (size_t off = 0; off < mLen; off += n) {
+        n = (mLen - off < step) ? mLen - off : step;
+        hmac_sha512_update(&c512, m + off, n);
+    }
+    hmac_sha512_final(&c512, mac);
+    bad |= memcmp(mac, want, wLen) != 0;
+
+    hmac_sha256_key_clear(&k256);
+    hmac_sha512_key_clear(&k512);
+    return bad;
+}
+
+/*
+ * open_rejects() - etm_open() must fail and leave out untouched
+ */
+static int open_rejects(const etm_key *key, const uint8_t *iv, const void *aad, size_t aadLen,
+                        const uint8_t *c, size_t len, const uint8_t *tag)
+{
+    static uint8_t out[ETM_BIG];
+    int bad = 0;
+
+    memset(out, 0xaa, len);
+    bad |= etm_open(key, iv, aad, aadLen, c, len, out, tag) != -1;
+    for (size_t i = 0; i < len; i++)
+        bad |= out[i] != 0xaa;
+    return bad;
+}
+
+/*
+ * check_etm() - known answer, round trip across chunks and tamper rejection
+ */
+static int check_etm(void)
+{
+    static uint8_t p[ETM_BIG], c[ETM_BIG], q[ETM_BIG];
+    uint8_t k[ETM_KEYLEN], iv[ETM_IVLEN], tag[ETM_TAGLEN], want[ETM_TAGLEN];
+    const char aad[] = "header";
+    etm_key key;
+    int bad = 0;
+
+    for (int i = 0; i < ETM_KEYLEN; i++)
+        k[i] = (uint8_t)i;
+    for (int i = 0; i < ETM_IVLEN; i++)
+        iv[i] = (uint8_t)(0xf0 + i);
+    for (int i = 0; i < ETM_MLEN; i++)
+        p[i] = (uint8_t)(7*i);
+    etm_init(&key, k);
+
+    // 검증 데이터
+    etm_seal(&key, iv, aad, 6, p, ETM_MLEN, c, tag);
+    unhex(etm_ct, q);
+    unhex(etm_tag, want);
+    bad |= memcmp(c, q, ETM_MLEN) != 0 || memcmp(tag, want, ETM_TAGLEN) != 0;
+    bad |= etm_open(&key, iv, aad, 6, c, ETM_MLEN, q, tag) != 0 || memcmp(q, p, ETM_MLEN) != 0;
+
+    // 조각 경계를 넘는 길이를 제자리에서 암호화하고 복호화
+    arc4random_buf(p, ETM_BIG);
+    memcpy(q, p, ETM_BIG);
+    etm_seal(&key, iv, NULL, 0, q, ETM_BIG, q, tag);
+    memcpy(c, q, ETM_BIG);
+    bad |= etm_open(&key, iv, NULL, 0, q, ETM_BIG, q, tag) != 0 || memcmp(q, p, ETM_BIG) != 0;
+
+    // 태그, 암호문, A, IV를 하나씩 바꿈
+    tag[ETM_TAGLEN-1] ^= 1;
+    bad |= open_rejects(&key, iv, NULL, 0, c, ETM_BIG, tag);
+    tag[ETM_TAGLEN-1] ^= 1;
+    c[ETM_BIG-1] ^= 0x80;
+    bad |= open_rejects(&key, iv, NULL, 0, c, ETM_BIG, tag);
+    c[ETM_BIG-1] ^= 0x80;
+    bad |= open_rejects(&key, iv, aad, 6, c, ETM_BIG, tag);
+    iv[0] ^= 1;
+    bad |= open_rejects(&key, iv, NULL, 0, c, ETM_BIG, tag);
+    iv[0] ^= 1;
+    bad |= etm_open(&key, iv, NULL, 0, c, ETM_BIG, q, tag) != 0 || memcmp(q, p, ETM_BIG) != 0;
+    etm_clear(&key);
+    return bad;
+}
+
+/*
+ * ref_seal() - EtM with Cipher() per counter block and the MAC input built in one buffer
+ */
+static void ref_seal(const uint8_t *k, const uint8_t *iv, const uint8_t *aad, size_t aadLen,
+                     const uint8_t *p, size_t len, uint8_t *c, uint8_t *tag)
+{
+    static uint8_t buf[16 + ETM_IVLEN + ETM_BIG + 8];
+    uint32_t rk[RNDKEYSIZE];
+    uint8_t ctr[BLOCKLEN], ks[BLOCKLEN];
+    hmac_sha256_key mk;
+    size_t n = 0;
+
+    KeyExpansion(k, rk);
+    memcpy(ctr, iv, BLOCKLEN);
+    for (size_t off = 0; off < len; off += BLOCKLEN) {
+        memcpy(ks, ctr, BLOCKLEN);
+        Cipher(ks, rk, ENCRYPT);
+        for (int i = BLOCKLEN - 1; i >= 0 && ++ctr[i] == 0; i--)
+            ;
+        for (size_t i = 0; i < BLOCKLEN && off + i < len; i++)
+            c[off + i] = p[off + i] ^ ks[i];
+    }
+    memcpy(buf, aad, aadLen);
+    n += aadLen;
+    memcpy(buf + n, iv, ETM_IVLEN);
+    n += ETM_IVLEN;
+    memcpy(buf + n, c, len);
+    n += len;
+    for (int i = 0; i < 8; i++)
+        buf[n++] = ((uint64_t)aadLen << 3 >> (56 - 8*i)) & 0xff;
+    hmac_sha256_key_init(&mk, k + KEYLEN, ETM_MACKEYLEN);
+    hmac_sha256(&mk, buf, n, tag);
+    hmac_sha256_key_clear(&mk);
+}
+
+/*
+ * check_etm_ref() - compares etm_seal() and etm_open() with ref_seal() on random keys and lengths
+ */
+static int check_etm_ref(void)
+{
+    static uint8_t p[ETM_BIG], c[ETM_BIG], q[ETM_BIG];
+    const size_t lens[] = {0, 1, 15, 16, 17, ETM_MLEN, ETM_CHUNK - 1, ETM_CHUNK, ETM_CHUNK + 1, ETM_BIG};
+    uint8_t k[ETM_KEYLEN], iv[ETM_IVLEN], aad[16], tag[ETM_TAGLEN], want[ETM_TAGLEN];
+    etm_key key;
+    size_t aadLen;
+    int bad = 0;
+
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        arc4random_buf(k, sizeof(k));
+        arc4random_buf(iv, sizeof(iv));
+        arc4random_buf(aad, sizeof(aad));
+        arc4random_buf(p, lens[i]);
+        // 카운터의 아래 세 바이트를 올림 직전으로 두어 메시지 안에서 올림이 생기게 함
+        memset(iv + ETM_IVLEN - 3, 0xff, 3);
+        iv[ETM_IVLEN - 1] = 0xf0;
+        aadLen = i % (sizeof(aad) + 1);
+        etm_init(&key, k);
+        etm_seal(&key, iv, aad, aadLen, p, lens[i], c, tag);
+        ref_seal(k, iv, aad, aadLen, p, lens[i], q, want);
+        bad |= memcmp(c, q, lens[i]) != 0 || memcmp(tag, want, ETM_TAGLEN) != 0;
+        bad |= etm_open(&key, iv, aad, aadLen, c, lens[i], q, tag) != 0 || memcmp(q, p, lens[i]) != 0;
+        etm_clear(&key);
+    }
+    return bad;
+}
+
+int main(void)
+{
+    const int masks[] = {AES_NI, 0};
+    const char *names[] = {"AES-NI", "generic"};
+    int aes = aes_accel_features();
+    const size_t steps[] = {1, 3, 63, 64, 65, 1000};
+    int features = sha2_accel_features(), bad, fail = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        // 두 번째는 SHA extensions을 끄고 sha2.c로 계산함
+        if (pass == 1) {
+            if (!(features & SHA2_SHANI)) {
+                printf("HMAC SHA extensions not available, skipped\n");
+                break;
+            }
+            sha2_accel_restrict(features & ~SHA2_SHANI);
+        }
+        for (size_t i = 0; i < NKAT; i++) {
+            bad = 0;
+            for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+                bad |= check_hmac(i, steps[s]);
+            printf("HMAC RFC 4231 case %zu, %-8s -- %s\n", i + 1,
+                   (sha2_accel_features() & SHA2_SHANI) ? "SHA-NI" : "generic", bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+    }
+    sha2_accel_restrict(features);
+    bad = check_etm();
+    printf("EtM AES-128-CTR + HMAC-SHA256       -- %s\n", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    for (size_t k = 0; k < sizeof(masks) / sizeof(masks[0]); k++) {
+        // CPU가 지원하지 않는 백엔드는 건너뜀
+        if ((masks[k] & aes) != masks[k])
+            continue;
+        aes_accel_restrict(masks[k]);
+        bad = check_etm_ref();
+        printf("EtM random vs reference, %-10s -- %s\n", names[k], bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    aes_accel_restrict(aes);
+    return fail;
+}
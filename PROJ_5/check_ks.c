@@ -0,0 +1,209 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 키 저장소 왕복 검증 : 크기와 소수 개수가 다른 키, 무작위 e 키, 공개키만 있는 키, rsa_bn이 받지 않는
+ * 크기의 키를 rsa_keystore_write()로 쓰고 다시 열어, 지문으로 찾은 키의 모든 값 (n, e, CRT 값, 셋째
+ * 소수부터의 r_i, d_i, t_i, Montgomery 상수)이 octet string에서 직접 가져온 키와 같은지 비교한다.
+ * 저장소 키로 만든 서명은 octet 키로, octet 키로 만든 서명은 저장소 키로 검증해 본다.
+ * 한 바이트를 바꾸거나 잘라 낸 파일은 EM_CORRUPT, 없는 파일은 EM_FILE_ERROR로 거부하는지도 본다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rsa_pss_ex.h"
+#include "rsa_keystore.h"
+
+#include <bsd/stdlib.h>
+
+#define NB (RSA_MAX_KEYSIZE/8)
+#define MSGLEN 100
+
+/*
+ * spec - 저장소에 넣을 키 하나, priv가 0이면 공개키만 넣는다
+ */
+static const struct {
+    int bits, nprimes, mode, priv;
+} spec[] = {
+    {2048, 2, 0, 1}, {2048, 3, 0, 1}, {2048, 2, 1, 1}, {3072, 2, 0, 1},
+    {4096, 4, 0, 1}, {1536, 2, 0, 1}, {2048, 2, 0, 0},
+};
+
+#define NKEY (sizeof(spec) / sizeof(spec[0]))
+
+static unsigned char e[NKEY][NB], d[NKEY][NB], n[NKEY][NB], primes[NKEY][RSA_MAX_PRIMES * NB/2];
+static rsa_ks_input in[NKEY];
+
+/*
+ * same_private() - compares every CRT value of two private keys
+ */
+static int same_private(const rsa_private_key *a, const rsa_private_key *b)
+{
+    int bad = 0;
+
+    bad |= a->bits != b->bits || a->nprimes != b->nprimes;
+    bad |= mpz_cmp(a->n, b->n) != 0 || mpz_cmp(a->e, b->e) != 0;
+    bad |= mpz_cmp(a->p, b->p) != 0 || mpz_cmp(a->q, b->q) != 0;
+    bad |= mpz_cmp(a->dP, b->dP) != 0 || mpz_cmp(a->dQ, b->dQ) != 0 || mpz_cmp(a->qInv, b->qInv) != 0;
+    for (int i = 0; i < a->nprimes - 2; i++)
+        bad |= mpz_cmp(a->r[i], b->r[i]) != 0 || mpz_cmp(a->d[i], b->d[i]) != 0 || mpz_cmp(a->t[i], b->t[i]) != 0;
+    return bad;
+}
+
+/*
+ * check_key() - finds key k in the keystore by fingerprint and compares it with the octet-string key
+ */
+static int check_key(const rsa_keystore *ks, int k)
+{
+    int bits = spec[k].bits, supported = bits == 2048 || bits == 3072 || bits == 4096;
+    rsa_public_key pk, kpk;
+    rsa_private_key sk, ksk;
+    rsa_bn_ctx ctx, kctx;
+    unsigned char m[MSGLEN], s[NB];
+    int i, bad = 0;
+
+    if (rsa_public_key_import_ex(&pk, bits, e[k], n[k]) != 0)
+        return 1;
+    if ((i = rsa_keystore_find(ks, pk.fp)) < 0) {
+        rsa_public_key_clear(&pk);
+        return 1;
+    }
+    bad |= rsa_keystore_public(ks, i, &kpk) != 0;
+    bad |= kpk.bits != bits || kpk.f4 != pk.f4 || memcmp(kpk.fp, pk.fp, SHASIZE/8) != 0;
+    bad |= mpz_cmp(kpk.n, pk.n) != 0 || mpz_cmp(kpk.e, pk.e) != 0;
+
+    // Montgomery 상수는 rsa_bn이 받는 크기에만 있음
+    if (supported) {
+        bad |= rsa_bn_init(&ctx, n[k], bits/8) != 0 || rsa_keystore_mont(ks, i, &kctx) != 0;
+        bad |= kctx.n != ctx.n || kctx.minv != ctx.minv;
+        bad |= memcmp(kctx.m, ctx.m, ctx.n * sizeof(rsa_bn_limb)) != 0;
+        bad |= memcmp(kctx.rr, ctx.rr, ctx.n * sizeof(rsa_bn_limb)) != 0;
+    } else {
+        bad |= rsa_keystore_mont(ks, i, &kctx) != EM_INVALID_PARAMS;
+    }
+
+    if (!spec[k].priv) {
+        bad |= rsa_keystore_private(ks, i, &ksk) != EM_INVALID_KEY;
+        rsa_public_key_clear(&pk);
+        return bad;
+    }
+    if (rsa_private_key_import_mp(&sk, bits, spec[k].nprimes, d[k], n[k], primes[k]) != 0 ||
+        rsa_keystore_private(ks, i, &ksk) != 0) {
+        rsa_private_key_clear(&sk);
+        rsa_public_key_clear(&pk);
+        return 1;
+    }
+    bad |= same_private(&ksk, &sk);
+    if (supported) {
+        arc4random_buf(m, sizeof(m));
+        bad |= rsassa_pss_sign_key_ex(SHASIZE, m, MSGLEN, &ksk, s) != 0;
+        bad |= rsassa_pss_verify_key_ex(SHASIZE, m, MSGLEN, &pk, s) != 0;
+        bad |= rsassa_pss_sign_key_ex(SHASIZE, m, MSGLEN, &sk, s) != 0;
+        bad |= rsassa_pss_verify_key_ex(SHASIZE, m, MSGLEN, &kpk, s) != 0;
+        m[0] ^= 1;
+        bad |= rsassa_pss_verify_key_ex(SHASIZE, m, MSGLEN, &kpk, s) == 0;
+    }
+    rsa_private_key_clear(&sk);
+    rsa_private_key_clear(&ksk);
+    rsa_public_key_clear(&pk);
+    return bad;
+}
+
+/*
+ * check_corrupt() - checks that a changed, truncated or missing file is rejected
+ */
+static int check_corrupt(const char *path)
+{
+    unsigned char *buf;
+    rsa_keystore ks;
+    char copy[] = "/tmp/check_ksXXXXXX";
+    long size;
+    FILE *fp;
+    int fd, bad = 0;
+
+    if ((fp = fopen(path, "rb")) == NULL)
+        return 1;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    if ((buf = malloc(size)) == NULL || fread(buf, 1, size, fp) != (size_t)size) {
+        fclose(fp);
+        free(buf);
+        return 1;
+    }
+    fclose(fp);
+    if ((fd = mkstemp(copy)) < 0) {
+        free(buf);
+        return 1;
+    }
+    close(fd);
+
+    // 헤더 뒤 아무 바이트나 바꿈
+    buf[sizeof(struct rsa_ks_header) + arc4random_uniform(size - sizeof(struct rsa_ks_header))] ^= 0x10;
+    fp = fopen(copy, "wb");
+    bad |= fp == NULL || fwrite(buf, 1, size, fp) != (size_t)size;
+    if (fp)
+        fclose(fp);
+    bad |= rsa_keystore_open(&ks, copy) != EM_CORRUPT;
+    bad |= truncate(copy, size / 2) != 0;
+    bad |= rsa_keystore_open(&ks, copy) != EM_CORRUPT;
+    unlink(copy);
+    bad |= rsa_keystore_open(&ks, copy) != EM_FILE_ERROR;
+    free(buf);
+    return bad;
+}
+
+int main(void)
+{
+    char path[] = "/tmp/check_ksXXXXXX";
+    unsigned char fp[SHASIZE/8];
+    rsa_public_key pk;
+    rsa_keystore ks;
+    int fd, bad, fail = 0;
+
+    for (size_t k = 0; k < NKEY; k++) {
+        if (rsa_generate_key_mp(spec[k].bits, spec[k].nprimes, e[k], d[k], n[k], primes[k], spec[k].mode) != 0) {
+            printf("%d-bit key generation failed\n", spec[k].bits);
+            return 1;
+        }
+        in[k].bits = spec[k].bits;
+        in[k].nprimes = spec[k].nprimes;
+        in[k].e = e[k];
+        in[k].n = n[k];
+        in[k].d = spec[k].priv ? d[k] : NULL;
+        in[k].primes = spec[k].priv ? primes[k] : NULL;
+    }
+    if ((fd = mkstemp(path)) < 0)
+        return 1;
+    close(fd);
+    if (rsa_keystore_write(path, in, NKEY) != 0 || rsa_keystore_open(&ks, path) != 0) {
+        printf("keystore write or open failed\n");
+        unlink(path);
+        return 1;
+    }
+
+    for (size_t k = 0; k < NKEY; k++) {
+        bad = check_key(&ks, k);
+        printf("keystore %d bits, %d primes, %-14s -- %s\n", spec[k].bits, spec[k].nprimes,
+               !spec[k].priv ? "public only" : spec[k].mode ? "random e" : "e = 65537", bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+
+    bad = ks.count != (int)NKEY;
+    arc4random_buf(fp, sizeof(fp));
+    bad |= rsa_keystore_find(&ks, fp) != -1;
+    bad |= rsa_keystore_public(&ks, NKEY, &pk) != EM_INVALID_PARAMS;
+    bad |= rsa_keystore_public(&ks, -1, &pk) != EM_INVALID_PARAMS;
+    printf("keystore %-35s -- %s\n", "count, lookup misses", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    rsa_keystore_close(&ks);
+
+    bad = check_corrupt(path);
+    printf("keystore %-35s -- %s\n", "corrupt, truncated, missing", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    unlink(path);
+    return fail;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * Merkle 트리 서명 검증 : 잎 수가 1, 2, 홀수, 2의 거듭제곱보다 하나 많은 메시지와 빈 메시지, 짧은 마지막 잎이
+ * 있는 메시지에서 rsa_merkle_hash()가 접두어를 붙여 복사한 버퍼를 rsa_pss_hash()로 한 층씩 계산한 값과 같은지,
+ * 스레드 수와 관계없이 같은지 확인한다. rsa_merkle_tree_build()로 한 번 만든 트리로 서명하고 모든 조각의
+ * 증명을 내어 rsassa_pss_verify_chunk()로 검증하며, 바뀐 조각이나 다른 조각 번호는 거부하는지 본다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rsa_merkle.h"
+
+#include <bsd/stdlib.h>
+
+#define HLEN (SHASIZE/8)
+
+static const size_t lens[] = {0, 1, MERKLE_CHUNK - 1, MERKLE_CHUNK, MERKLE_CHUNK + 1, 2*MERKLE_CHUNK,
+                              5*MERKLE_CHUNK + 3, 9*MERKLE_CHUNK};
+
+/*
+ * ref_hash() - the tree-mode mHash computed level by level from copied buffers
+ * 잎은 0x00 || 조각, 내부 노드는 0x01 || 왼쪽 || 오른쪽을 버퍼에 만들어 rsa_pss_hash()로 해시한다.
+ */
+static int ref_hash(const unsigned char *m, size_t len, unsigned char *mHash)
+{
+    size_t w = len == 0 ? 1 : (len + MERKLE_CHUNK - 1) / MERKLE_CHUNK, clen;
+    unsigned char *node, *buf, top[1 + 8 + 4 + HLEN];
+
+    if ((node = malloc(w * HLEN)) == NULL || (buf = malloc(1 + MERKLE_CHUNK)) == NULL) {
+        free(node);
+        return -1;
+    }
+    for (size_t i = 0; i < w; i++) {
+        clen = (i < w - 1) ? MERKLE_CHUNK : len - i * MERKLE_CHUNK;
+        buf[0] = 0x00;
+        memcpy(buf + 1, m + i * MERKLE_CHUNK, clen);
+        rsa_pss_hash(buf, 1 + clen, node + i * HLEN);
+    }
+    for (; w > 1; w = (w + 1) / 2) {
+        for (size_t i = 0; i < w / 2; i++) {
+            buf[0] = 0x01;
+            memcpy(buf + 1, node + 2 * i * HLEN, 2*HLEN);
+            rsa_pss_hash(buf, 1 + 2*HLEN, node + i * HLEN);
+        }
+        if (w % 2)
+            memmove(node + (w / 2) * HLEN, node + (w - 1) * HLEN, HLEN);
+    }
+    top[0] = 0x02;
+    for (int i = 0; i < 8; i++)
+        top[1 + i] = ((uint64_t)len >> (56 - 8*i)) & 0xff;
+    for (int i = 0; i < 4; i++)
+        top[9 + i] = ((uint32_t)MERKLE_CHUNK >> (24 - 8*i)) & 0xff;
+    memcpy(top + 13, node, HLEN);
+    rsa_pss_hash(top, sizeof(top), mHash);
+    free(buf);
+    free(node);
+    return 0;
+}
+
+/*
+ * check_len() - runs every check on one random message of len bytes
+ */
+static int check_len(const unsigned char *m, size_t len, const rsa_private_key *sk, const rsa_public_key *pk)
+{
+    unsigned char want[HLEN], got[HLEN], s[RSAKEYSIZE/8];
+    rsa_merkle_proof proof, one;
+    rsa_merkle_tree t;
+    uint64_t n, clen;
+    int bad = 0;
+
+    if (ref_hash(m, len, want) != 0)
+        return 1;
+    for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+        bad |= rsa_merkle_hash(m, len, nthreads, got) != 0;
+        bad |= memcmp(got, want, HLEN) != 0;
+    }
+    if (rsa_merkle_tree_build(m, len, 0, &t) != 0)
+        return 1;
+    rsa_merkle_tree_hash(&t, got);
+    bad |= memcmp(got, want, HLEN) != 0;
+    bad |= rsassa_pss_sign_merkle_tree(&t, sk, s) != 0;
+    bad |= rsassa_pss_verify_merkle(m, len, pk, 0, s) != 0;
+    bad |= rsassa_pss_verify_key(m, len, pk, s) == 0;
+
+    n = t.width[0];
+    for (uint64_t i = 0; i < n; i++) {
+        clen = (i < n - 1) ? MERKLE_CHUNK : len - i * MERKLE_CHUNK;
+        bad |= rsa_merkle_tree_proof(&t, i, &proof) != 0;
+        bad |= rsassa_pss_verify_chunk(m + i * MERKLE_CHUNK, clen, &proof, pk, s) != 0;
+        if (i == n - 1) {
+            bad |= rsa_merkle_proof_make(m, len, i, 1, &one) != 0;
+            bad |= one.depth != proof.depth || memcmp(one.path, proof.path, proof.depth * HLEN) != 0;
+        }
+        // 다른 조각 번호를 주장하면 뿌리가 달라짐
+        if (n > 1) {
+            proof.index = (i + 1) % n;
+            bad |= rsassa_pss_verify_chunk(m + i * MERKLE_CHUNK, clen, &proof, pk, s) == 0;
+        }
+    }
+    bad |= rsa_merkle_tree_proof(&t, n, &proof) != EM_INVALID_PARAMS;
+    rsa_merkle_tree_free(&t);
+
+    // 조각을 한 바이트 바꾸면 그 조각의 증명이 맞지 않음
+    if (len > 0) {
+        unsigned char *c = malloc(len < MERKLE_CHUNK ? len : MERKLE_CHUNK);
+
+        clen = (n > 1) ? MERKLE_CHUNK : len;
+        if (c == NULL || rsa_merkle_proof_make(m, len, 0, 0, &proof) != 0) {
+            free(c);
+            return 1;
+        }
+        memcpy(c, m, clen);
+        c[arc4random_uniform(clen)] ^= 0x40;
+        bad |= rsassa_pss_verify_chunk(c, clen, &proof, pk, s) == 0;
+        free(c);
+    }
+    return bad;
+}
+
+int main(void)
+{
+    unsigned char e[RSAKEYSIZE/8], d[RSAKEYSIZE/8], n[RSAKEYSIZE/8], p[RSAKEYSIZE/16], q[RSAKEYSIZE/16];
+    size_t maxlen = lens[sizeof(lens) / sizeof(lens[0]) - 1];
+    rsa_private_key sk;
+    rsa_public_key pk;
+    unsigned char *m;
+    int bad, fail = 0;
+
+    rsa_generate_key_crt(e, d, n, p, q, 0);
+    if (rsa_private_key_import(&sk, d, n, p, q) != 0 || rsa_public_key_import(&pk, e, n) != 0) {
+        printf("key import failed\n");
+        return 1;
+    }
+    if ((m = malloc(maxlen)) == NULL)
+        return 1;
+    arc4random_buf(m, maxlen);
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        bad = check_len(m, lens[i], &sk, &pk);
+        printf("merkle %8zu bytes, %2zu leaves -- %s\n", lens[i],
+               lens[i] == 0 ? (size_t)1 : (lens[i] + MERKLE_CHUNK - 1) / MERKLE_CHUNK, bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    free(m);
+    rsa_private_key_clear(&sk);
+    rsa_public_key_clear(&pk);
+    return fail;
+}
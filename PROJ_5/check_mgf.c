@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * MGF1 검증 : OpenSSL로 만든 RSASSA-PSS 서명 (MGF1은 서명과 같은 해시, salt 길이는 해시 길이)을 검증한다.
+ * 검증은 maskedDB에 MGF1(H) 마스크를 XOR한 DB의 패딩과 salt를 확인하므로, 마스크가 한 바이트라도 틀리면
+ * 실패한다. 기본 API (rsassa_pss_verify, mgf_xor)와 실행 중에 고르는 API (rsassa_pss_verify_ex,
+ * rsassa_pss_verify_key_ex)를 모두 시험하고, 가속 해시가 있으면 끈 상태로 한 번 더 돌린다.
+ * 서명을 한 비트 바꾸면 거부하는지도 본다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "rsa_pss_ex.h"
+#include "sha2_accel.h"
+
+/*
+ * 공개키는 e = 65537, 메시지는 "MGF1 known answer test"이다.
+ */
+static const char n2048[] =
+    "8861a035c1b43a1cadd1c66e908f2a2726a1d06a3c13d9dddc241f1843ac20b1"
+    "be811a66777d2eb67c55a54d265ffa66157d3ca1b13bf651c5152a7a5c5568f3"
+    "04c161ea172ee0aaba2d8a3530f3f5fd10a0b00a43493629e091135c2738adf6"
+    "6ffc9859ae5fd78d7b39dbe4487910ec49eae517fabac3375c236b583e829f7f"
+    "531a0d4dce73140afa92993823f6c26d1864665467c41d9931823c740b05075e"
+    "fc9cb29511df404f8c00d32b4b3ef30b95c01d9eb9a7241b140117b7e0a36f84"
+    "4010a6345665a8b123d4b721a593991efd1e3ff02893ba65e4cc4ddc287c42cc"
+    "8c9092838d4a9c8edf0eb4264bf58be67b8f3d4bcbdc4851b841be61732ed38b";
+
+static const char n3072[] =
+    "af34dfd803bd3093ec552b9acc5a7ed275af357a5b607f8850fc1d376de390f6"
+    "3f46f9d72594dae05ecac425e5eebfc74f9902aa709a44c50751d1ed1daeee06"
+    "91d7bf19c0e7c2d70dc5032883f9b7efaa76d3a4066a006ec7ffea4343c88136"
+    "719994387582066e41043d7fdfdcecd5d80aaebfe997a0fa423d35bf45b3e377"
+    "281d1106a046ee2d875b51b059836468629494b2835483c08a9cb3dbaaa13a07"
+    "b44d653df73c719099326ff27494de8f1953c8f5835be5986d84d2eb84bb6feb"
+    "5bcf02d44567f5fd82c0c5f25a0693f8041e89ae440b5d3935a90936f22150ed"
+    "8dc90149f653f517899d7df694db2b926ad80fad7755a5645d3c3710c60e9452"
+    "f693f7f8994c3f432c9934ad44470a24736674c91e4b9a403e7001363b803e62"
+    "1ceb783abe4a1c6a3a36df3794f43771cf711c95ba150e0468124e2693a936ad"
+    "69dcb33fae7c712145493e93f371176855b34b00f4b373d370899f46a2a9690b"
+    "9f8a4763826fa6b23d4317046a55f10a305a5181a72e2d4fed8af2b86c03a807";
+
+static const char n4096[] =
+    "c47434c08049fa60b19c030ae90bf62d85830e189e754685e6a3c02555bc4a86"
+    "625d5c58074bc0c13e0e2ec6777ca71d04d4b3a61c30af14c098d1653e72f444"
+    "1c210e9f7399662969474035f02b99c46dd21de1f7e95266325a4730b9f41f0e"
+    "ba37da985bba1add5eb569563a24109bc94bed680ed7b6269f7e9a645304779c"
+    "672f3070814f7e12beae067c0fc5d5c46754533ae9c0ef9191ebbade0137a85e"
+    "a3db8c389aabca3acb241be834710fd71fa6592c969f8a6cf0b0a956f424c82d"
+    "199b69bdc0b1139c88a57cd2cfc174e1ac6fb04a9082ff9a49340babcde479da"
+    "e89d075ad8897f0646726bdced88994f87dfb4bab3203aaed6cbac631bb48f42"
+    "7fe22e5628193480dc15eb7d420cb520eb39004d25ebc863bf870db0b8f4182d"
+    "46d44b23798d568a5296049d4dbe864fa2780aed839a5d03f3c1e7f0b7d05aaa"
+    "3eee3e5ee5e139271f9a9e42a4b93fdc8e7d0c23d62dbb61c2bd6e181c2eaccc"
+    "e5291f88b6321ba4354bfbd0971739d6fb9eed968d6caf6475faf115d10a5e1c"
+    "6524ad88e358867e414c75d9ca389f544e995f0256187fa9a2b0e992c2e80212"
+    "f56517e3e979326a717f197985350ab5aad02ca6d6c9fcd3ad5d47fed43c30d7"
+    "6b41f57bfda02f214245389e69a0748f511ce2cfab5e3c967b17cd8c487b88b4"
+    "485189259950c0f40ac42a4c4b08bc1dbd6956318b074431ee5f0166c572334f";
+
+static const char s2048_256[] =
+    "4ebdb55ba00134bdf6f73811b0c9e844518bf9e23105c511dcc4c10b5a3e4a9d"
+    "39dcc4017efd98f776274033e51a59c49cc63c9788c603ae5e1f1a125ff9b537"
+    "ead8d898d722d7f9d1a733c00effe2c437c0debd0c375fb561c38e7df028c98d"
+    "c21cdb8e078e97297430199cd85134700cea5991b06a7e0d7875f9c9f6f24a8a"
+    "b95d97d47eb3b0061cd53af9a61b7a116937917200a8de00bdc81803e6c50a74"
+    "16a41baffb547460c5503b4820ea377ee52475e88b7acd65ded0e58bd0c1af2f"
+    "5d7dc0a87fab1242ff824a1fe4fd1745b311c04eb4ec66f1c4045bfcf1ac640d"
+    "0f6d4301b497d908b2c1fde86c25721c5db2348d401d9d1dc5dcc9fc2f25815e";
+
+static const char s2048_224[] =
+    "6163f31a28c7e9d36b89deb17581d248ec35ab33db41149a403935dca76cfce5"
+    "66e4d4023fc1eb6471cdd71b5db6d2cc276686a56d2db9889d5c8ca107e1913f"
+    "433ef39294276f0e81f5c5ebccf7d1dc9c49d9ce1e1519101f9ce0f2932b389e"
+    "81a1a8719b4b9072008adc9de8f10f988c7666e2ae9ecb6a3ab7a241e2336509"
+    "9a7857afd37b15a17b09b90e610f17727345ac8cc89949325ff0637c729c1dc3"
+    "0bdea0155c0f69c3af51b3773f490632a5f57c5f31694efdbcbd47796f498eca"
+    "aaf0638dd388cf43880b1b17d6c543902ccaf9915494b351c6b7301571504b96"
+    "3a130b215e8f606e8ac84e239a9251aee63a27ebc4b6713d57f71c087de0d227";
+
+static const char s2048_384[] =
+    "3baace9d4c62e69d2f76b260d38e2b6378000531aac5447caa1390a0c959baa8"
+    "b30ade9cf327e16e9b617a68542f60b0e61ae8ba33706a96d672eba171c49d66"
+    "a972f5b0ccb9edc6fa6a57234183ba9f82d6b7e39bb55dcebce8a823df52abad"
+    "85ec6ff3694df0075c56d4043a30fd47db246ed1c5e7b93e197d33ea08aab6fd"
+    "2fca59d824eaf2643bed946adeb9e270f443884826888ff4def4f91e4bebdcd2"
+    "0b1164cc09c4893cf0041df6fb795303fbae3bf60a73c6f8ff32530a467cdebc"
+    "f06fb9ee7500a3502cb300cf4967f9c57a35dbbd1da53a854f499936e23e5b8d"
+    "aac6ae7f1a82c038cebcd57162fee2b764de36df3c722244881340a05a25d25d";
+
+static const char s2048_512[] =
+    "6a7db8308b1337b10707180bd50e2f3d731fc5cb5c78aaa56a76235670ccb228"
+    "06ef0f0ecf972ad1edc2aa97843d0fdbfe3854cf34c7f50cbf54cf15185a58af"
+    "4b2f0f029f341d951ea955e2f821cc2d13ad438fb7598c48d7dfa82329865755"
+    "45c27a6e33d4f40623f24424bbe07936245294691e81c8d5e636551e9d3322cf"
+    "04224049062ccf7916020272bc1b4d49bbee7e6ab9848c84bf3293903245981d"
+    "7e5e228b6a9bc8077b88005c313bda6a8023eb2fecea30420fd970126f5c5bcd"
+    "552da3c07a6a110ab5afcd8b62b239c31dd1db8fac02dd4543635b262afc0742"
+    "833f8f6b036a4d639cd28d2f03766dda2a73aee7c1d48eeae78fd67c939abc87";
+
+static const char s3072_256[] =
+    "5d10c15b3631ebadf13be0678734ea2c0e4cb025f0cc4329f7ec3c5c9afc3b5a"
+    "e2522bbe8f86be197b886a0e2c1d29c8c6b339cb3a5a5a653fdd745a7a278425"
+    "8d44005d902a6e3cefc2e2e7ad49355383c731a5cf9f77a6219977af20ae3079"
+    "e7a0e1bb0c4763b627b38f4791d5a6c4ed9e0b52f573452005fc345c3cd75bcc"
+    "2bbd160519c1a771e58db03b8ae085cebe85da2c018486a432499763999b7b8c"
+    "43b3be085eefd9fd3e88f8e589f9413ad719e3b5be1e479ba818ea92b7dd42f4"
+    "b3ddafcd38325222562f79d7e95945225a997ac9092e0594dbb265cb2f9717e6"
+    "53acb88a6be486bb3d481e66a4c6851f773de0adc083941551dc43a69a41bd56"
+    "c22c68c8a5dc86f625cd5680df694ec81fcc1e9fe820af26a53f9f1abd191645"
+    "fa5d0ada7bffb4a4fedd7c606fc4f380241d65d50eb1b16deb9b32ee4b1ab2a4"
+    "3e94bf8a448c903f4b7540931b8588c3856b82d739a030841e886c08c51cedc2"
+    "8ddc3d2327fd55d566a404ccc6976e6c068d70d1aa9dbe8c7857f293d8650a95";
+
+static const char s4096_512[] =
+    "10f141f3fe3807adb1171d504cfa838aca79807746a71ef0fb2025e821cb7894"
+    "b6439030af3c80071be6c6fcaf1326ce948bb305012e3bd8fcdaa7f47379222e"
+    "30b3af85da35d7effddd72e4f6b3df09b1c2ca3fdb43e171fc6a761bd6121b5e"
+    "1bb620f5eadc1cf9378f753b55100f0e69d161243e9b5be39737a3bc437fa417"
+    "f9ef50cb6a0eccf169976a710be7590954a71e055e95cab4c3ae77678b8276f2"
+    "07ee085bdc5c71f15c23507b933546646052b9cebf01d0f2947495edf37220ad"
+    "410aa7ebe72570c1787d7bd55b1013e7cdfa0b205dcdeede722ab04e68aee1f0"
+    "b4db6fae452c5f2c4675aabe98779f465d64cc35b163bc8fcdcbf59a466fb63a"
+    "ba6d8767f32166062058404b0d3a13e26ffc9db43a1da8a6bf2b2b5a2c8174af"
+    "877e39f3f85bf6fac1a2540c28c63dab07a5f08f79987cf19a6a236aeeb21e89"
+    "6a060049693366811d0bdc4a7b69563c3c38518bca0376fa035a42f19353cf93"
+    "1801f5b657e259bec40611df72a34538d2684e589eb9ea1bb710b7a7669ac539"
+    "b6b1e3e12201a851d1f5e6df03492e642144b15c9b20d5bc0619ba3e602bc9a2"
+    "8aaf440180ae65c7169e40b1bb7fff8a3c17ab701715f6f43800232f0ef3c5da"
+    "ebf2d287bc3f3632dfe91bb2d34ca230781908ecc52fc4933393d59293c589b9"
+    "6a90f1958e283095e9645258b3fac3531768ede05cfe7fdcb0920d32b83794d4";
+static const struct {
+    const char *name;
+    int bits, hash;
+    const char *n, *s;
+} kat[] = {
+    {"2048 bits, SHA-256", 2048, 256, n2048, s2048_256},
+    {"2048 bits, SHA-224", 2048, 224, n2048, s2048_224},
+    {"2048 bits, SHA-384", 2048, 384, n2048, s2048_384},
+    {"2048 bits, SHA-512", 2048, 512, n2048, s2048_512},
+    {"3072 bits, SHA-256", 3072, 256, n3072, s3072_256},
+    {"4096 bits, SHA-512", 4096, 512, n4096, s4096_512},
+};
+
+#define NKAT (sizeof(kat) / sizeof(kat[0]))
+
+static const char msg[] = "MGF1 known answer test";
+
+/*
+ * unhex() - decodes the hex string s into p and returns the number of bytes
+ */
+static size_t unhex(const char *s, unsigned char *p)
+{
+    size_t n = strlen(s) / 2;
+
+    for (size_t i = 0; i < n; i++)
+        sscanf(s + 2*i, "%2hhx", p + i);
+    return n;
+}
+
+/*
+ * check_kat() - verifies one vector with every API that accepts its key size and hash
+ */
+static int check_kat(int i)
+{
+    unsigned char e[RSA_MAX_KEYSIZE/8] = {0}, n[RSA_MAX_KEYSIZE/8], s[RSA_MAX_KEYSIZE/8];
+    rsa_pss_params prm = {kat[i].bits, kat[i].hash};
+    size_t len = kat[i].bits / 8, mLen = strlen(msg);
+    rsa_public_key key;
+    int bad = 0;
+
+    unhex(kat[i].n, n);
+    unhex(kat[i].s, s);
+    e[len-3] = 0x01;
+    e[len-1] = 0x01;
+
+    if (kat[i].bits == RSAKEYSIZE && kat[i].hash == SHASIZE)
+        bad |= rsassa_pss_verify(msg, mLen, e, n, s) != 0;
+    bad |= rsassa_pss_verify_ex(&prm, msg, mLen, e, n, s) != 0;
+    bad |= rsa_public_key_import_ex(&key, kat[i].bits, e, n) != 0;
+    bad |= rsassa_pss_verify_key_ex(kat[i].hash, msg, mLen, &key, s) != 0;
+
+    s[len/2] ^= 0x10;
+    bad |= rsassa_pss_verify_ex(&prm, msg, mLen, e, n, s) == 0;
+    bad |= rsassa_pss_verify_key_ex(kat[i].hash, msg, mLen, &key, s) == 0;
+    rsa_public_key_clear(&key);
+    return bad;
+}
+
+int main(void)
+{
+    int features = sha2_accel_features(), bad, fail = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        // 두 번째는 SHA-NI와 AVX2 다중 버퍼를 끄고 sha2.c로만 계산함
+        if (pass == 1) {
+            if (features == 0)
+                break;
+            sha2_accel_restrict(0);
+        }
+        for (size_t i = 0; i < NKAT; i++) {
+            bad = check_kat(i);
+            printf("PSS %-18s %-9s vs OpenSSL -- %s\n", kat[i].name, pass ? "generic" : "default",
+                   bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+    }
+    sha2_accel_restrict(features);
+    return fail;
+}
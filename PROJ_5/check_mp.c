@@ -0,0 +1,155 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 다중 소수 RSA 검증 : rsa_generate_key_mp()가 만든 소수 2, 3, 4개 키에서 n이 정확히 bits 비트이고
+ * 서로 다른 소수들의 곱인지, e*d = 1 (mod lcm(r_i - 1))인지 GMP로 확인한다. rsa_private_key_import_mp()가
+ * 구한 d_i, t_i가 RFC 8017 3.2의 정의와 같은지 보고, 그 키로 만든 서명을 바뀌지 않은 공개키 검증
+ * (rsassa_pss_verify_ex)으로 검증한다. 소수 하나가 틀리거나 소수 개수가 범위를 벗어나면 거부하는지도 본다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <gmp.h>
+#include "rsa_pss_ex.h"
+
+#include <bsd/stdlib.h>
+
+#define NB (RSA_MAX_KEYSIZE/8)
+#define MSGLEN 100
+
+/*
+ * check_numbers() - checks n, the primes and e*d mod lcm(r_i - 1) of a generated key
+ */
+static int check_numbers(int bits, int nprimes, const unsigned char *e, const unsigned char *d,
+                         const unsigned char *n, const unsigned char *primes)
+{
+    size_t plen = RSA_PRIME_LEN(bits, nprimes);
+    mpz_t r[RSA_MAX_PRIMES], zn, ze, zd, prod, lambda, t;
+    int bad = 0;
+
+    mpz_inits(zn, ze, zd, prod, lambda, t, NULL);
+    mpz_import(zn, bits/8, 1, 1, 1, 0, n);
+    mpz_import(ze, bits/8, 1, 1, 1, 0, e);
+    mpz_import(zd, bits/8, 1, 1, 1, 0, d);
+    mpz_set_ui(prod, 1);
+    mpz_set_ui(lambda, 1);
+    for (int i = 0; i < nprimes; i++) {
+        mpz_init(r[i]);
+        mpz_import(r[i], plen, 1, 1, 1, 0, primes + i * plen);
+        bad |= mpz_probab_prime_p(r[i], 25) == 0;
+        for (int j = 0; j < i; j++)
+            bad |= mpz_cmp(r[i], r[j]) == 0;
+        mpz_mul(prod, prod, r[i]);
+        mpz_sub_ui(t, r[i], 1);
+        mpz_lcm(lambda, lambda, t);
+    }
+    bad |= mpz_sizeinbase(zn, 2) != (size_t)bits;
+    bad |= mpz_cmp(prod, zn) != 0;
+    mpz_mul(t, ze, zd);
+    mpz_mod(t, t, lambda);
+    bad |= mpz_cmp_ui(t, 1) != 0;
+
+    for (int i = 0; i < nprimes; i++)
+        mpz_clear(r[i]);
+    mpz_clears(zn, ze, zd, prod, lambda, t, NULL);
+    return bad;
+}
+
+/*
+ * check_coeffs() - compares the imported d_i and t_i (i >= 3) with their RFC 8017 definitions
+ */
+static int check_coeffs(const rsa_private_key *key, const unsigned char *d)
+{
+    mpz_t zd, R, t;
+    int bad = 0;
+
+    mpz_inits(zd, R, t, NULL);
+    mpz_import(zd, key->bits/8, 1, 1, 1, 0, d);
+    mpz_mul(R, key->p, key->q);
+    for (int i = 0; i < key->nprimes - 2; i++) {
+        mpz_sub_ui(t, key->r[i], 1);
+        mpz_mod(t, zd, t);
+        bad |= mpz_cmp(t, key->d[i]) != 0;
+        mpz_mul(t, key->t[i], R);
+        mpz_mod(t, t, key->r[i]);
+        bad |= mpz_cmp_ui(t, 1) != 0;
+        mpz_mul(R, R, key->r[i]);
+    }
+    mpz_clears(zd, R, t, NULL);
+    return bad;
+}
+
+/*
+ * check_key() - generates one multi-prime key and runs every check on it
+ */
+static int check_key(int bits, int nprimes, int mode)
+{
+    unsigned char e[NB], d[NB], n[NB], primes[RSA_MAX_PRIMES * NB/2], m[MSGLEN], s[NB];
+    rsa_pss_params prm = {bits, SHASIZE};
+    rsa_private_key key;
+    int bad = 0;
+
+    if (rsa_generate_key_mp(bits, nprimes, e, d, n, primes, mode) != 0)
+        return 1;
+    bad |= check_numbers(bits, nprimes, e, d, n, primes);
+    if (rsa_private_key_import_mp(&key, bits, nprimes, d, n, primes) != 0) {
+        rsa_private_key_clear(&key);
+        return 1;
+    }
+    bad |= key.nprimes != nprimes;
+    bad |= check_coeffs(&key, d);
+    for (int i = 0; i < 4; i++) {
+        arc4random_buf(m, sizeof(m));
+        bad |= rsassa_pss_sign_key_ex(SHASIZE, m, MSGLEN, &key, s) != 0;
+        bad |= rsassa_pss_verify_ex(&prm, m, MSGLEN, e, n, s) != 0;
+        m[0] ^= 1;
+        bad |= rsassa_pss_verify_ex(&prm, m, MSGLEN, e, n, s) == 0;
+    }
+    rsa_private_key_clear(&key);
+
+    // 마지막 소수의 한 비트를 바꾸면 곱이 n과 달라짐
+    primes[nprimes * RSA_PRIME_LEN(bits, nprimes) - 1] ^= 2;
+    bad |= rsa_private_key_import_mp(&key, bits, nprimes, d, n, primes) != EM_INVALID_KEY;
+    rsa_private_key_clear(&key);
+    return bad;
+}
+
+/*
+ * check_params() - checks that prime counts outside 2..RSA_MAX_PRIMES are rejected
+ */
+static int check_params(void)
+{
+    unsigned char e[NB], d[NB], n[NB], primes[RSA_MAX_PRIMES * NB/2] = {0};
+    rsa_private_key key;
+    int bad = 0;
+
+    bad |= rsa_generate_key_mp(2048, 1, e, d, n, primes, 0) != EM_INVALID_PARAMS;
+    bad |= rsa_generate_key_mp(2048, RSA_MAX_PRIMES + 1, e, d, n, primes, 0) != EM_INVALID_PARAMS;
+    bad |= rsa_private_key_import_mp(&key, 2048, RSA_MAX_PRIMES + 1, d, n, primes) != EM_INVALID_PARAMS;
+    rsa_private_key_clear(&key);
+    return bad;
+}
+
+int main(void)
+{
+    const int sizes[] = {2048, 3072};
+    int bad, fail = 0;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        for (int mode = 0; mode < 2; mode++)
+            for (int k = 2; k <= RSA_MAX_PRIMES; k++) {
+                // 무작위 e는 2048 비트에서만 (검증이 느림)
+                if (mode == 1 && sizes[i] != 2048)
+                    continue;
+                bad = check_key(sizes[i], k, mode);
+                printf("multi-prime %d bits, %d primes, %-10s -- %s\n", sizes[i], k, mode ? "random e" : "e = 65537",
+                       bad ? "FAILED" : "PASSED");
+                fail |= bad;
+            }
+    bad = check_params();
+    printf("multi-prime %-31s -- %s\n", "invalid prime counts", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    return fail;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 가속 SHA-2 교차 검증 : sha2_accel.c의 SHA-NI 함수 (sha224_ni, sha256_ni)와 다중 버퍼 함수
+ * (sha224_mb ~ sha512_mb)의 결과를 sha2.c의 sha224() ~ sha512()와 비교한다.
+ * 길이는 패딩이 한 블록과 두 블록으로 갈리는 경계 앞뒤를, 메시지 수는 레인 수 (8, 4)보다 적거나 많거나
+ * 나머지가 남는 경우를 쓰며, CPU가 지원하는 백엔드 조합 (SHA-NI와 AVX2, 하나씩, 둘 다 끔)마다 반복한다.
+ * 접두어 함수 (sha224_mb_prefix ~ sha512_mb_prefix)는 접두어를 붙여 복사한 메시지의 sha2.c 해시와 비교한다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "sha2_accel.h"
+
+#include <bsd/stdlib.h>
+
+#define MAXLEN 4099
+#define MAXCOUNT 13
+#define MAXPREFIX 63
+
+static const unsigned int lens[] = {0, 1, 55, 56, 63, 64, 65, 111, 112, 119, 127, 128, 129, 1000, MAXLEN};
+
+static const struct {
+    const char *name;
+    int dLen;
+    void (*one)(const unsigned char *, unsigned int, unsigned char *);
+    void (*mb)(const unsigned char *const *, unsigned int, unsigned char *const *, int);
+    void (*mbp)(const unsigned char *, unsigned int, const unsigned char *const *, unsigned int,
+                unsigned char *const *, int);
+} hashes[] = {
+    {"SHA-224", SHA224_DIGEST_SIZE, sha224, sha224_mb, sha224_mb_prefix},
+    {"SHA-256", SHA256_DIGEST_SIZE, sha256, sha256_mb, sha256_mb_prefix},
+    {"SHA-384", SHA384_DIGEST_SIZE, sha384, sha384_mb, sha384_mb_prefix},
+    {"SHA-512", SHA512_DIGEST_SIZE, sha512, sha512_mb, sha512_mb_prefix},
+};
+
+#define NHASH (sizeof(hashes) / sizeof(hashes[0]))
+
+static unsigned char msg[MAXCOUNT][MAXLEN];
+static unsigned char buf[MAXPREFIX + MAXLEN];
+
+/*
+ * check_mb() - compares the multi-buffer function h with sha2.c for every length and count
+ * 틀린 레인이 다른 레인의 결과를 덮어쓰는지도 보이도록 메시지마다 내용을 다르게 한다.
+ */
+static int check_mb(size_t h)
+{
+    unsigned char want[MAXCOUNT][SHA512_DIGEST_SIZE], got[MAXCOUNT][SHA512_DIGEST_SIZE];
+    const unsigned char *pm[MAXCOUNT];
+    unsigned char *pd[MAXCOUNT];
+    int bad = 0;
+
+    for (int i = 0; i < MAXCOUNT; i++) {
+        pm[i] = msg[i];
+        pd[i] = got[i];
+    }
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        for (int i = 0; i < MAXCOUNT; i++)
+            hashes[h].one(msg[i], lens[l], want[i]);
+        for (int count = 1; count <= MAXCOUNT; count++) {
+            memset(got, 0, sizeof(got));
+            hashes[h].mb(pm, lens[l], pd, count);
+            for (int i = 0; i < count; i++)
+                bad |= memcmp(got[i], want[i], hashes[h].dLen) != 0;
+        }
+    }
+    return bad;
+}
+
+/*
+ * check_prefix() - compares the prefix multi-buffer function h with sha2.c on prefix || message
+ * 접두어 길이 1, 9, 63은 첫 블록이 접두어와 메시지로 나뉘는 경계와 메시지 전체가 첫 블록에 들어가는 경우를 거친다.
+ */
+static int check_prefix(size_t h)
+{
+    const unsigned int plens[] = {1, 9, MAXPREFIX};
+    unsigned char want[MAXCOUNT][SHA512_DIGEST_SIZE], got[MAXCOUNT][SHA512_DIGEST_SIZE], pfx[MAXPREFIX];
+    const unsigned char *pm[MAXCOUNT];
+    unsigned char *pd[MAXCOUNT];
+    int bad = 0;
+
+    arc4random_buf(pfx, sizeof(pfx));
+    for (int i = 0; i < MAXCOUNT; i++) {
+        pm[i] = msg[i];
+        pd[i] = got[i];
+    }
+    for (size_t p = 0; p < sizeof(plens) / sizeof(plens[0]); p++)
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            for (int i = 0; i < MAXCOUNT; i++) {
+                memcpy(buf, pfx, plens[p]);
+                memcpy(buf + plens[p], msg[i], lens[l]);
+                hashes[h].one(buf, plens[p] + lens[l], want[i]);
+            }
+            for (int count = 1; count <= MAXCOUNT; count += 4) {
+                memset(got, 0, sizeof(got));
+                hashes[h].mbp(pfx, plens[p], pm, lens[l], pd, count);
+                for (int i = 0; i < count; i++)
+                    bad |= memcmp(got[i], want[i], hashes[h].dLen) != 0;
+            }
+        }
+    return bad;
+}
+
+/*
+ * check_ni() - compares sha224_ni() and sha256_ni() with sha2.c for every length
+ */
+static int check_ni(void)
+{
+    unsigned char want[SHA256_DIGEST_SIZE], got[SHA256_DIGEST_SIZE];
+    int bad = 0;
+
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        sha224(msg[l % MAXCOUNT], lens[l], want);
+        sha224_ni(msg[l % MAXCOUNT], lens[l], got);
+        bad |= memcmp(got, want, SHA224_DIGEST_SIZE) != 0;
+        sha256(msg[l % MAXCOUNT], lens[l], want);
+        sha256_ni(msg[l % MAXCOUNT], lens[l], got);
+        bad |= memcmp(got, want, SHA256_DIGEST_SIZE) != 0;
+    }
+    return bad;
+}
+
+int main(void)
+{
+    const int masks[] = {SHA2_SHANI | SHA2_AVX2, SHA2_SHANI, SHA2_AVX2, 0};
+    const char *names[] = {"SHA-NI + AVX2", "SHA-NI", "AVX2", "generic"};
+    int features = sha2_accel_features(), bad, fail = 0;
+
+    arc4random_buf(msg, sizeof(msg));
+    for (size_t k = 0; k < sizeof(masks) / sizeof(masks[0]); k++) {
+        // CPU가 지원하지 않는 조합은 건너뜀
+        if ((masks[k] & features) != masks[k])
+            continue;
+        sha2_accel_restrict(masks[k]);
+        bad = check_ni();
+        printf("sha224/256_ni %-18s vs sha2.c -- %s\n", names[k], bad ? "FAILED" : "PASSED");
+        fail |= bad;
+        for (size_t h = 0; h < NHASH; h++) {
+            bad = check_mb(h);
+            printf("%s_mb %-21s vs sha2.c -- %s\n", hashes[h].name, names[k], bad ? "FAILED" : "PASSED");
+            fail |= bad;
+            bad = check_prefix(h);
+            printf("%s_mb_prefix %-14s vs sha2.c -- %s\n", hashes[h].name, names[k], bad ? "FAILED" : "PASSED");
+            fail |= bad;
+        }
+    }
+    sha2_accel_restrict(features);
+    return fail;
+}
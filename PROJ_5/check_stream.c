@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 스트림 서명/검증 검증 : 메시지를 무작위 크기 조각 (0 바이트와 블록 경계 앞뒤 포함)으로 나누어 넣은
+ * rsassa_pss_sign_final(), rsassa_pss_verify_final()이 한 번에 처리하는 rsassa_pss_sign_key(),
+ * rsassa_pss_verify_key()와 서로 검증되는지 확인한다. 파일 서명/검증은 PSS_FILE_CHUNK보다 큰 임시 파일로
+ * 시험하고, 없는 파일이면 EM_FILE_ERROR인지도 본다. 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rsa_pss.h"
+
+#include <bsd/stdlib.h>
+
+#define ROUNDS 10
+#define MAXLEN 20000
+#define FILELEN (3*PSS_FILE_CHUNK + 1000)
+
+/*
+ * stream() - feeds m into ctx in pieces of random size
+ * 조각 크기는 0, 1, 블록 크기 앞뒤, 무작위 값을 섞는다.
+ */
+static void stream(rsa_pss_stream *ctx, const unsigned char *m, size_t len)
+{
+    const size_t sizes[] = {0, 1, SHA_BLOCKSIZE - 1, SHA_BLOCKSIZE, SHA_BLOCKSIZE + 1, 3*SHA_BLOCKSIZE};
+    size_t off = 0, n;
+
+    rsa_pss_stream_init(ctx);
+    while (off < len) {
+        n = arc4random_uniform(2) ? sizes[arc4random_uniform(sizeof(sizes) / sizeof(sizes[0]))] :
+            arc4random_uniform(1000);
+        if (n > len - off)
+            n = len - off;
+        rsa_pss_stream_update(ctx, m + off, n);
+        off += n;
+    }
+}
+
+/*
+ * check_stream() - signs and verifies random messages in pieces and in one call
+ */
+static int check_stream(const rsa_private_key *sk, const rsa_public_key *pk)
+{
+    static unsigned char m[MAXLEN];
+    unsigned char s[RSAKEYSIZE/8];
+    const size_t lens[] = {0, 1, 55, 56, 64, 119, 120, 128, 1000, MAXLEN};
+    rsa_pss_stream ctx;
+    size_t len;
+    int bad = 0;
+
+    for (int i = 0; i < ROUNDS && !bad; i++)
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            len = lens[l];
+            arc4random_buf(m, len);
+            stream(&ctx, m, len);
+            bad |= rsassa_pss_sign_final(&ctx, sk, s) != 0;
+            bad |= rsassa_pss_verify_key(m, len, pk, s) != 0;
+
+            bad |= rsassa_pss_sign_key(m, len, sk, s) != 0;
+            stream(&ctx, m, len);
+            bad |= rsassa_pss_verify_final(&ctx, pk, s) != 0;
+            // 마지막 바이트를 빼고 넣으면 틀려야 함
+            if (len > 0) {
+                stream(&ctx, m, len - 1);
+                bad |= rsassa_pss_verify_final(&ctx, pk, s) == 0;
+            }
+        }
+    return bad;
+}
+
+/*
+ * check_file() - signs and verifies a temporary file larger than PSS_FILE_CHUNK
+ */
+static int check_file(const rsa_private_key *sk, const rsa_public_key *pk)
+{
+    char path[] = "/tmp/check_streamXXXXXX";
+    unsigned char s[RSAKEYSIZE/8];
+    unsigned char *m;
+    int fd, bad = 0;
+
+    if ((m = malloc(FILELEN)) == NULL)
+        return 1;
+    arc4random_buf(m, FILELEN);
+    if ((fd = mkstemp(path)) < 0) {
+        free(m);
+        return 1;
+    }
+    bad |= write(fd, m, FILELEN) != FILELEN;
+    close(fd);
+
+    bad |= rsassa_pss_sign_file(path, sk, s) != 0;
+    bad |= rsassa_pss_verify_key(m, FILELEN, pk, s) != 0;
+    bad |= rsassa_pss_sign_key(m, FILELEN, sk, s) != 0;
+    bad |= rsassa_pss_verify_file(path, pk, s) != 0;
+    m[FILELEN - 1] ^= 1;
+    bad |= rsassa_pss_verify_key(m, FILELEN, pk, s) == 0;
+
+    unlink(path);
+    bad |= rsassa_pss_verify_file(path, pk, s) != EM_FILE_ERROR;
+    bad |= rsassa_pss_sign_file(path, sk, s) != EM_FILE_ERROR;
+    free(m);
+    return bad;
+}
+
+int main(void)
+{
+    unsigned char e[RSAKEYSIZE/8], d[RSAKEYSIZE/8], n[RSAKEYSIZE/8], p[RSAKEYSIZE/16], q[RSAKEYSIZE/16];
+    rsa_private_key sk;
+    rsa_public_key pk;
+    int bad, fail = 0;
+
+    rsa_generate_key_crt(e, d, n, p, q, 0);
+    if (rsa_private_key_import(&sk, d, n, p, q) != 0 || rsa_public_key_import(&pk, e, n) != 0) {
+        printf("key import failed\n");
+        return 1;
+    }
+    bad = check_stream(&sk, &pk);
+    printf("PSS %-28s -- %s\n", "stream vs one-shot", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    bad = check_file(&sk, &pk);
+    printf("PSS %-28s -- %s\n", "file vs one-shot", bad ? "FAILED" : "PASSED");
+    fail |= bad;
+    rsa_private_key_clear(&sk);
+    rsa_public_key_clear(&pk);
+    return fail;
+}
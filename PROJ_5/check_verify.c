@@ -0,0 +1,85 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 공개키 검증 경로 검증 : 가져온 공개키로 검증하는 rsassa_pss_verify_key()의 결과를 octet 키로 검증하는
+ * rsassa_pss_verify()와 비교한다. e = 65537 키와 무작위 e 키에서 올바른 서명, 서명이나 메시지를 한 비트
+ * 바꾼 경우, s >= n인 경우를 시험하고, e = 65537이면 제곱 16번 경로 (f4)와 mpz_powm 경로의 결과도 비교한다.
+ * 모두 맞으면 0, 하나라도 틀리면 1로 끝난다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rsa_pss.h"
+
+#include <bsd/stdlib.h>
+
+#define ROUNDS 20
+#define MSGLEN 100
+
+/*
+ * verify_both() - runs the octet and key verifiers and returns 1 if they disagree or ret is not want
+ * 공개키가 e = 65537이면 f4 경로를 끈 상태로도 한 번 더 검증한다.
+ */
+static int verify_both(const void *m, const void *e, const void *n, rsa_public_key *key, const void *s, int want)
+{
+    int r1, r2, bad;
+
+    r1 = rsassa_pss_verify(m, MSGLEN, e, n, s);
+    r2 = rsassa_pss_verify_key(m, MSGLEN, key, s);
+    bad = r1 != r2 || (want == 0 ? r1 != 0 : r1 == 0);
+    if (key->f4) {
+        key->f4 = 0;
+        bad |= rsassa_pss_verify_key(m, MSGLEN, key, s) != r2;
+        key->f4 = 1;
+    }
+    return bad;
+}
+
+/*
+ * check_key() - signs random messages with a fresh key and verifies them both ways
+ */
+static int check_key(int mode)
+{
+    unsigned char e[RSAKEYSIZE/8], d[RSAKEYSIZE/8], n[RSAKEYSIZE/8], s[RSAKEYSIZE/8];
+    unsigned char m[MSGLEN];
+    rsa_public_key key;
+    int bad = 0;
+
+    rsa_generate_key(e, d, n, mode);
+    if (rsa_public_key_import(&key, e, n) != 0 || key.f4 != (mode == 0)) {
+        rsa_public_key_clear(&key);
+        return 1;
+    }
+    for (int i = 0; i < ROUNDS && !bad; i++) {
+        arc4random_buf(m, sizeof(m));
+        bad |= rsassa_pss_sign(m, MSGLEN, d, n, s) != 0;
+        bad |= verify_both(m, e, n, &key, s, 0);
+
+        // 서명과 메시지를 한 비트씩 바꾸면 둘 다 같은 오류여야 함
+        s[arc4random_uniform(sizeof(s))] ^= 1 << arc4random_uniform(8);
+        bad |= verify_both(m, e, n, &key, s, -1);
+        bad |= rsassa_pss_sign(m, MSGLEN, d, n, s) != 0;
+        m[arc4random_uniform(sizeof(m))] ^= 1 << arc4random_uniform(8);
+        bad |= verify_both(m, e, n, &key, s, -1);
+    }
+    memcpy(s, n, sizeof(s));
+    bad |= rsassa_pss_verify_key(m, MSGLEN, &key, s) != EM_MSG_OUT_OF_RANGE;
+    bad |= rsassa_pss_verify(m, MSGLEN, e, n, s) != EM_MSG_OUT_OF_RANGE;
+    rsa_public_key_clear(&key);
+    return bad;
+}
+
+int main(void)
+{
+    int bad, fail = 0;
+
+    for (int mode = 0; mode < 2; mode++) {
+        bad = check_key(mode);
+        printf("rsassa_pss_verify_key %-10s vs octet key -- %s\n", mode ? "random e" : "e = 65537",
+               bad ? "FAILED" : "PASSED");
+        fail |= bad;
+    }
+    return fail;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * AES-128-CTR + HMAC-SHA256 Encrypt-then-MAC, 인터페이스는 etm.h 참고.
+ * ../PROJ_2/aes.c, hmac.c와 그 의존 파일을 같이 링크한다.
+ *
+ * gcc -O2 -I../PROJ_2 -c etm.c
+ */
+#include <string.h>
+#include "etm.h"
+
+/*
+ * etm_init() - expands the AES key and caches the HMAC pad states of k = Ke || Km
+ */
+void etm_init(etm_key *key, const uint8_t *k)
+{
+    KeyExpansion(k, key->rk);
+    hmac_sha256_key_init(&key->mac, k + KEYLEN, ETM_MACKEYLEN);
+}
+
+void etm_clear(etm_key *key)
+{
+    explicit_bzero(key, sizeof(etm_key));
+}
+
+/*
+ * ctr_xor() - out = in ^ E(K, IV), E(K, IV+1), ... for len bytes
+ * ETM_CHUNK 바이트마다 카운터 블록을 모두 만든 뒤 CipherBlocks()로 한꺼번에 암호화한다.
+ */
+static void ctr_xor(const uint32_t *rk, const uint8_t *iv, const uint8_t *in, uint8_t *out, size_t len)
+{
+    uint8_t ctr[BLOCKLEN], ks[ETM_CHUNK];
+    size_t n, nblocks;
+
+    memcpy(ctr, iv, BLOCKLEN);
+    for (size_t off = 0; off < len; off += n) {
+        n = (len - off < ETM_CHUNK) ? len - off : ETM_CHUNK;
+        nblocks = (n + BLOCKLEN - 1) / BLOCKLEN;
+        for (size_t j = 0; j < nblocks; j++) {
+            memcpy(ks + BLOCKLEN*j, ctr, BLOCKLEN);
+            // 카운터 = (카운터 + 1) mod 2^128, 빅 엔디언
+            for (int i = BLOCKLEN - 1; i >= 0; i--)
+                if (++ctr[i] != 0)
+                    break;
+        }
+        CipherBlocks(ks, nblocks, rk);
+        for (size_t i = 0; i < n; i++)
+            out[off + i] = in[off + i] ^ ks[i];
+    }
+    explicit_bzero(ks, sizeof(ks));
+    explicit_bzero(ctr, sizeof(ctr));
+}
+
+/*
+ * mac_start() - starts the tag over A || IV
+ */
+static void mac_start(hmac_sha256_ctx *mac, const etm_key *key, const uint8_t *iv, const void *aad, size_t aadLen)
+{
+    hmac_sha256_init(mac, &key->mac);
+    if (aadLen > 0)
+        hmac_sha256_update(mac, aad, aadLen);
+    hmac_sha256_update(mac, iv, ETM_IVLEN);
+}
+
+/*
+ * mac_finish() - appends AL and outputs the tag
+ */
+static void mac_finish(hmac_sha256_ctx *mac, size_t aadLen, uint8_t *tag)
+{
+    uint8_t al[8];
+    uint64_t bits = (uint64_t)aadLen << 3;
+
+    for (int i = 0; i < 8; i++)
+        al[i] = (bits >> (56 - 8*i)) & 0xff;
+    hmac_sha256_update(mac, al, 8);
+    hmac_sha256_final(mac, tag);
+}
+
+/*
+ * etm_seal() - encrypts len bytes of in into out and outputs the ETM_TAGLEN-byte tag
+ */
+void etm_seal(const etm_key *key, const uint8_t *iv, const void *aad, size_t aadLen,
+              const void *in, size_t len, void *out, uint8_t *tag)
+{
+    hmac_sha256_ctx mac;
+
+    ctr_xor(key->rk, iv, in, out, len);
+    mac_start(&mac, key, iv, aad, aadLen);
+    hmac_sha256_update(&mac, out, len);
+    mac_finish(&mac, aadLen, tag);
+}
+
+/*
+ * etm_open() - checks the tag over in and only then decrypts len bytes of in into out
+ * 태그가 맞으면 0, 틀리면 out을 건드리지 않고 -1을 리턴한다. 태그 비교는 hmac_equal()로 한다.
+ */
+int etm_open(const etm_key *key, const uint8_t *iv, const void *aad, size_t aadLen,
+             const void *in, size_t len, void *out, const uint8_t *tag)
+{
+    uint8_t t[ETM_TAGLEN];
+    hmac_sha256_ctx mac;
+    int ok;
+
+    // 암호문 전체를 MAC에 넣어 태그를 먼저 확인함
+    mac_start(&mac, key, iv, aad, aadLen);
+    hmac_sha256_update(&mac, in, len);
+    mac_finish(&mac, aadLen, t);
+    ok = hmac_equal(t, tag, ETM_TAGLEN);
+    explicit_bzero(t, sizeof(t));
+    if (!ok)
+        return -1;
+    // 태그가 맞을 때만 복호화함
+    ctr_xor(key->rk, iv, in, out, len);
+    return 0;
+}
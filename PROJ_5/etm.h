@@ -0,0 +1,45 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef ETM_H
+#define ETM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aes.h"
+#include "hmac.h"
+
+/*
+ * Encrypt-then-MAC : AES-128-CTR로 암호화하고 HMAC-SHA256으로 인증한다.
+ * 키는 AES 키 KEYLEN 바이트와 HMAC 키 ETM_MACKEYLEN 바이트를 이은 것이다.
+ * 카운터 블록은 IV (BLOCKLEN 바이트)에서 시작해 블록마다 빅 엔디언으로 1씩 늘린다.
+ * 태그는 HMAC(Km, A || IV || C || AL)이고, AL은 A의 비트 길이 (64 비트 빅 엔디언)이다.
+ *
+ * 암호화는 평문 전체를 CTR로 암호화한 뒤 암호문 전체를 MAC에 넣는다. 복호화는 암호문 전체의 태그를
+ * 먼저 확인하고 맞을 때만 복호화하므로, 태그가 틀리면 출력을 건드리지 않는다.
+ * 키 스트림은 ETM_CHUNK 바이트씩 스택에 만들어 CipherBlocks()로 한꺼번에 암호화한다.
+ * in과 out은 같아도 된다. IV는 같은 키로 두 번 쓰면 안 된다.
+ */
+#define ETM_MACKEYLEN 32
+#define ETM_KEYLEN (KEYLEN + ETM_MACKEYLEN)
+#define ETM_IVLEN BLOCKLEN
+#define ETM_TAGLEN HMAC_SHA256_LEN
+#define ETM_CHUNK 4096                  /* 키 스트림을 한 번에 만드는 바이트 수 */
+
+/*
+ * etm_key - AES 라운드 키와 HMAC의 캐시된 해시 상태
+ */
+typedef struct {
+    uint32_t rk[RNDKEYSIZE];
+    hmac_sha256_key mac;
+} etm_key;
+
+void etm_init(etm_key *key, const uint8_t *k);
+void etm_clear(etm_key *key);
+void etm_seal(const etm_key *key, const uint8_t *iv, const void *aad, size_t aadLen,
+              const void *in, size_t len, void *out, uint8_t *tag);
+int etm_open(const etm_key *key, const uint8_t *iv, const void *aad, size_t aadLen,
+             const void *in, size_t len, void *out, const uint8_t *tag);
+
+#endif
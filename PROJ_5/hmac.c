@@ -0,0 +1,39 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * HMAC-SHA256/512, 인터페이스는 hmac.h 참고. sha2_accel.c와 sha2.c를 같이 링크한다.
+ *
+ * gcc -O2 -c hmac.c
+ */
+#include <string.h>
+#include "hmac.h"
+#include "sha2_accel.h"
+
+#define HMAC_XCAT(a, b, c) HMAC_CAT(a, b, c)
+#define HMAC_CAT(a, b, c) a##b##c
+
+/*
+ * 해시마다 hmac_impl.h를 한 번씩 포함하여 특화된 함수를 만든다.
+ */
+#define HMAC_HASH 256
+#include "hmac_impl.h"
+#undef HMAC_HASH
+#define HMAC_HASH 512
+#include "hmac_impl.h"
+#undef HMAC_HASH
+
+/*
+ * hmac_equal() - compares two MACs in time independent of where they differ
+ * 같으면 1, 다르면 0을 리턴한다.
+ */
+int hmac_equal(const void *_a, const void *_b, size_t len)
+{
+    const volatile unsigned char *a = _a, *b = _b;
+    unsigned char d = 0;
+
+    for (size_t i = 0; i < len; i++)
+        d |= a[i] ^ b[i];
+    return d == 0;
+}
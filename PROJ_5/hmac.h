@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef HMAC_H
+#define HMAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sha2.h"
+
+/*
+ * HMAC-SHA256, HMAC-SHA512 (RFC 2104, FIPS 198-1)
+ * HMAC(K, m) = H((K ^ opad) || H((K ^ ipad) || m))에서 K ^ ipad, K ^ opad는 각각 한 블록이므로
+ * 키를 넣을 때 두 블록을 압축한 뒤의 해시 상태 h[]만 hmac_*_key에 저장해 둔다.
+ * 메시지 하나는 이 상태에서 시작하므로 메시지 블록과 패딩 외에 바깥 해시 압축 한 번만 더 든다.
+ * sha2.c는 길이를 32 비트로 세므로 rsa_pss_stream처럼 해시 문맥에는 블록 단위로만 넣고
+ * 길이와 패딩은 여기서 64 비트로 관리한다. SHA extensions이 있으면 SHA-256 압축 함수를 직접 부른다.
+ */
+#define HMAC_SHA256_LEN SHA256_DIGEST_SIZE
+#define HMAC_SHA512_LEN SHA512_DIGEST_SIZE
+
+/*
+ * hmac_sha256_key, hmac_sha512_key - K ^ ipad, K ^ opad 블록을 압축한 뒤의 해시 상태
+ */
+typedef struct {
+    uint32 ih[8];                           /* 안쪽 해시 상태 */
+    uint32 oh[8];                           /* 바깥 해시 상태 */
+} hmac_sha256_key;
+
+typedef struct {
+    uint64 ih[8];
+    uint64 oh[8];
+} hmac_sha512_key;
+
+/*
+ * hmac_sha256_ctx, hmac_sha512_ctx - 메시지를 나누어 넣는 문맥, h.len은 항상 0이다
+ */
+typedef struct {
+    sha256_ctx h;
+    const hmac_sha256_key *key;
+    uint64_t len;                           /* 키 블록을 포함해 지금까지 넣은 전체 바이트 수 */
+    size_t used;                            /* buf에 남아 있는 바이트 수 */
+    unsigned char buf[SHA256_BLOCK_SIZE];
+} hmac_sha256_ctx;
+
+typedef struct {
+    sha512_ctx h;
+    const hmac_sha512_key *key;
+    uint64_t len;
+    size_t used;
+    unsigned char buf[SHA512_BLOCK_SIZE];
+} hmac_sha512_ctx;
+
+void hmac_sha256_key_init(hmac_sha256_key *key, const void *k, size_t kLen);
+void hmac_sha256_key_clear(hmac_sha256_key *key);
+void hmac_sha256_init(hmac_sha256_ctx *ctx, const hmac_sha256_key *key);
+void hmac_sha256_update(hmac_sha256_ctx *ctx, const void *m, size_t mLen);
+void hmac_sha256_final(hmac_sha256_ctx *ctx, unsigned char *mac);
+void hmac_sha256(const hmac_sha256_key *key, const void *m, size_t mLen, unsigned char *mac);
+
+void hmac_sha512_key_init(hmac_sha512_key *key, const void *k, size_t kLen);
+void hmac_sha512_key_clear(hmac_sha512_key *key);
+void hmac_sha512_init(hmac_sha512_ctx *ctx, const hmac_sha512_key *key);
+void hmac_sha512_update(hmac_sha512_ctx *ctx, const void *m, size_t mLen);
+void hmac_sha512_final(hmac_sha512_ctx *ctx, unsigned char *mac);
+void hmac_sha512(const hmac_sha512_key *key, const void *m, size_t mLen, unsigned char *mac);
+
+int hmac_equal(const void *a, const void *b, size_t len);
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 해시 하나에 특화된 HMAC 구현
+ * 포함 가드가 없으며, hmac.c가 HMAC_HASH를 정의한 뒤 해시마다 한 번씩 포함한다.
+ * 만들어지는 함수는 hmac_<hash>_key_init, ..._init, ..._update, ..._final, hmac_<hash>이다.
+ */
+#if HMAC_HASH == 256
+#define HMAC_HCTX sha256_ctx
+#define HMAC_HINIT sha256_init
+#define HMAC_HUPDATE sha256_update
+#define HMAC_BLOCK SHA256_BLOCK_SIZE
+#define HMAC_LEN SHA256_DIGEST_SIZE
+#define HMAC_WORD 4
+#define HMAC_KEY hmac_sha256_key
+#define HMAC_CTX hmac_sha256_ctx
+#else
+#define HMAC_HCTX sha512_ctx
+#define HMAC_HINIT sha512_init
+#define HMAC_HUPDATE sha512_update
+#define HMAC_BLOCK SHA512_BLOCK_SIZE
+#define HMAC_LEN SHA512_DIGEST_SIZE
+#define HMAC_WORD 8
+#define HMAC_KEY hmac_sha512_key
+#define HMAC_CTX hmac_sha512_ctx
+#endif
+#define HMAC_FN(name) HMAC_XCAT(hmac_sha, HMAC_HASH, _##name)
+
+/*
+ * blocks() - feeds whole blocks into the hash context
+ * sha*_update()의 길이는 unsigned int이므로 2^30 바이트씩 나누어 넣는다.
+ */
+static void HMAC_FN(blocks)(HMAC_HCTX *h, const unsigned char *m, size_t len)
+{
+    size_t chunk;
+
+#if HMAC_HASH == 256
+    // SHA extensions이 있으면 압축 함수를 직접 호출함
+    if (sha2_accel_features() & SHA2_SHANI) {
+        sha256_ni_transform(h->h, m, len / HMAC_BLOCK);
+        return;
+    }
+#endif
+    while (len > 0) {
+        chunk = (len < ((size_t)1 << 30)) ? len : ((size_t)1 << 30);
+        HMAC_HUPDATE(h, m, (unsigned int)chunk);
+        m += chunk;
+        len -= chunk;
+    }
+}
+
+/*
+ * absorb() - adds mLen bytes, keeping the partial block in ctx->buf
+ */
+static void HMAC_FN(absorb)(HMAC_CTX *ctx, const unsigned char *m, size_t mLen)
+{
+    size_t n;
+
+    ctx->len += mLen;
+
+    // 남아 있던 조각을 한 블록으로 채움
+    if (ctx->used > 0) {
+        n = HMAC_BLOCK - ctx->used;
+        if (mLen < n) {
+            memcpy(ctx->buf + ctx->used, m, mLen);
+            ctx->used += mLen;
+            return;
+        }
+        memcpy(ctx->buf + ctx->used, m, n);
+        HMAC_FN(blocks)(&ctx->h, ctx->buf, HMAC_BLOCK);
+        m += n; mLen -= n;
+        ctx->used = 0;
+    }
+
+    // 나머지 중 블록 단위는 바로 넣고 남는 조각만 보관
+    n = mLen - mLen % HMAC_BLOCK;
+    HMAC_FN(blocks)(&ctx->h, m, n);
+    memcpy(ctx->buf, m + n, mLen - n);
+    ctx->used = mLen - n;
+}
+
+/*
+ * digest() - pads with the 64-bit bit length and unpacks h[] big-endian into out
+ * SHA-512의 길이 필드는 128 비트이지만 상위 64 비트는 항상 0이다.
+ */
+static void HMAC_FN(digest)(HMAC_CTX *ctx, unsigned char *out)
+{
+    unsigned char pad[2*HMAC_BLOCK];
+    size_t padLen;
+    uint64_t bits = ctx->len << 3;
+
+    padLen = (ctx->used + 1 + HMAC_BLOCK/8 <= HMAC_BLOCK) ? HMAC_BLOCK : 2*HMAC_BLOCK;
+    memset(pad, 0, padLen);
+    memcpy(pad, ctx->buf, ctx->used);
+    pad[ctx->used] = 0x80;
+    for (int i=0; i<8; i++)
+        pad[padLen-1-i] = (bits >> (8*i)) & 0xff;
+    HMAC_FN(blocks)(&ctx->h, pad, padLen);
+
+    for (int i=0; i<HMAC_LEN/HMAC_WORD; i++)
+        for (int j=0; j<HMAC_WORD; j++)
+            out[HMAC_WORD*i+j] = (ctx->h.h[i] >> (8*(HMAC_WORD-1-j))) & 0xff;
+    explicit_bzero(pad, sizeof(pad));
+}
+
+/*
+ * start() - resumes hashing from the cached state h after one absorbed block
+ */
+static void HMAC_FN(start)(HMAC_CTX *ctx, const void *h)
+{
+    ctx->h.tot_len = 0;
+    ctx->h.len = 0;
+    memcpy(ctx->h.h, h, sizeof(ctx->h.h));
+    ctx->len = HMAC_BLOCK;
+    ctx->used = 0;
+}
+
+/*
+ * key_init() - absorbs K ^ ipad and K ^ opad and caches the two hash states
+ * 키가 블록보다 길면 해시 값을 키로 쓴다 (RFC 2104).
+ */
+void HMAC_FN(key_init)(HMAC_KEY *key, const void *k, size_t kLen)
+{
+    unsigned char kb[HMAC_BLOCK], pad[HMAC_BLOCK];
+    HMAC_CTX ctx;
+
+    memset(kb, 0, HMAC_BLOCK);
+    if (kLen > HMAC_BLOCK) {
+        HMAC_HINIT(&ctx.h);
+        ctx.len = 0;
+        ctx.used = 0;
+        HMAC_FN(absorb)(&ctx, k, kLen);
+        HMAC_FN(digest)(&ctx, kb);
+    }
+    else
+        memcpy(kb, k, kLen);
+
+    for (int i = 0; i < HMAC_BLOCK; i++)
+        pad[i] = kb[i] ^ 0x36;
+    HMAC_HINIT(&ctx.h);
+    HMAC_FN(blocks)(&ctx.h, pad, HMAC_BLOCK);
+    memcpy(key->ih, ctx.h.h, sizeof(key->ih));
+
+    for (int i = 0; i < HMAC_BLOCK; i++)
+        pad[i] = kb[i] ^ 0x5c;
+    HMAC_HINIT(&ctx.h);
+    HMAC_FN(blocks)(&ctx.h, pad, HMAC_BLOCK);
+    memcpy(key->oh, ctx.h.h, sizeof(key->oh));
+
+    explicit_bzero(kb, sizeof(kb));
+    explicit_bzero(pad, sizeof(pad));
+    explicit_bzero(&ctx, sizeof(ctx));
+}
+
+void HMAC_FN(key_clear)(HMAC_KEY *key)
+{
+    explicit_bzero(key, sizeof(HMAC_KEY));
+}
+
+/*
+ * init() - starts a message under key, which must outlive the context
+ */
+void HMAC_FN(init)(HMAC_CTX *ctx, const HMAC_KEY *key)
+{
+    HMAC_FN(start)(ctx, key->ih);
+    ctx->key = key;
+}
+
+void HMAC_FN(update)(HMAC_CTX *ctx, const void *m, size_t mLen)
+{
+    HMAC_FN(absorb)(ctx, m, mLen);
+}
+
+/*
+ * final() - finishes the inner hash and runs the outer hash over it
+ * 바깥 해시의 입력은 해시 값 하나이므로 패딩까지 한 블록에 들어간다.
+ */
+void HMAC_FN(final)(HMAC_CTX *ctx, unsigned char *mac)
+{
+    unsigned char inner[HMAC_LEN];
+
+    HMAC_FN(digest)(ctx, inner);
+    HMAC_FN(start)(ctx, ctx->key->oh);
+    HMAC_FN(absorb)(ctx, inner, HMAC_LEN);
+    HMAC_FN(digest)(ctx, mac);
+    explicit_bzero(inner, sizeof(inner));
+    explicit_bzero(ctx, sizeof(HMAC_CTX));
+}
+
+/*
+ * hmac_<hash>() - computes the MAC of m in one call
+ */
+void HMAC_XCAT(hmac_sha, HMAC_HASH, )(const HMAC_KEY *key, const void *m, size_t mLen, unsigned char *mac)
+{
+    HMAC_CTX ctx;
+
+    HMAC_FN(init)(&ctx, key);
+    HMAC_FN(absorb)(&ctx, m, mLen);
+    HMAC_FN(final)(&ctx, mac);
+}
+
+#undef HMAC_HCTX
+#undef HMAC_HINIT
+#undef HMAC_HUPDATE
+#undef HMAC_BLOCK
+#undef HMAC_LEN
+#undef HMAC_WORD
+#undef HMAC_KEY
+#undef HMAC_CTX
+#undef HMAC_FN
@@ -0,0 +1,517 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 공유 작업 스레드 풀과 비동기 작업 API, 인터페이스는 rsa_async.h 참고.
+ * AES와 mRSA를 함께 쓰므로 ../PROJ_2/aes.c, ../PROJ_4/mRSA.c와 그 의존 파일을 같이 링크한다.
+ *
+ * gcc -O2 -pthread -I../PROJ_2 -I../PROJ_3 -I../PROJ_4 -c rsa_async.c
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "aes.h"
+#include "mRSA.h"
+#include "rsa_batch.h"
+#include "rsa_async.h"
+
+/*
+ * deque - 배치 (첫 작업)의 고리 버퍼, 주인은 bottom 쪽에서 넣고 꺼내며 다른 스레드는 top 쪽에서 훔친다
+ * top, bottom은 계속 늘어나기만 하고 cap (2의 거듭제곱)으로 나눈 나머지 자리를 쓴다.
+ */
+struct deque {
+    pthread_mutex_t lock;
+    async_job **ring;
+    size_t cap, top, bottom;
+};
+
+struct worker {
+    pthread_t tid;
+    async_pool *pool;
+    int id;
+    struct deque dq;
+    uint64_t jobs, batches, steals;     /* 주인 스레드만 씀 */
+};
+
+/*
+ * pending은 덱에 들어 있는 배치 수, nidle은 잠든 작업 스레드 수이다.
+ * 넣는 쪽은 pending을 올린 뒤 nidle을 보고, 작업 스레드는 nidle을 올린 뒤 pending을 보므로
+ * (둘 다 seq_cst) 적어도 한쪽은 상대의 쓰기를 보게 되어 깨우기를 놓치지 않는다.
+ */
+struct async_pool {
+    struct worker *w;
+    int nworkers;
+    int efd;
+    unsigned rr;                        /* 키가 없는 작업을 돌아가며 보낼 덱 */
+    long pending;
+    int nidle;
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_mutex_t dlock;              /* 완료 큐 */
+    async_job *dhead, *dtail;
+};
+
+static __thread struct worker *self;
+
+/*
+ * same_key() - true if b can join the batch headed by a
+ */
+static int same_key(const async_job *a, const async_job *b)
+{
+    if (a->op != b->op)
+        return 0;
+    switch (a->op) {
+    case ASYNC_AES_ENCRYPT:
+    case ASYNC_AES_DECRYPT:
+        return a->u.aes.roundKey == b->u.aes.roundKey;
+    case ASYNC_MRSA_CIPHER:
+        return a->u.mrsa.k == b->u.mrsa.k && a->u.mrsa.n == b->u.mrsa.n;
+    case ASYNC_PSS_SIGN:
+        return a->u.sign.d == b->u.sign.d && a->u.sign.n == b->u.sign.n;
+    case ASYNC_PSS_VERIFY:
+        return a->u.verify.e == b->u.verify.e && a->u.verify.n == b->u.verify.n;
+    case ASYNC_PSS_SIGN_KEY:
+        return a->u.sign_key.key == b->u.sign_key.key;
+    case ASYNC_PSS_VERIFY_KEY:
+        return a->u.verify_key.key == b->u.verify_key.key;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * key_hash() - hash of the batching key, 0 if the job is never batched
+ */
+static uint64_t key_hash(const async_job *job)
+{
+    uint64_t h;
+
+    switch (job->op) {
+    case ASYNC_AES_ENCRYPT:
+    case ASYNC_AES_DECRYPT:
+        h = (uintptr_t)job->u.aes.roundKey;
+        break;
+    case ASYNC_MRSA_CIPHER:
+        h = job->u.mrsa.n ^ job->u.mrsa.k;
+        break;
+    case ASYNC_PSS_SIGN:
+        h = (uintptr_t)job->u.sign.n;
+        break;
+    case ASYNC_PSS_VERIFY:
+        h = (uintptr_t)job->u.verify.n;
+        break;
+    case ASYNC_PSS_SIGN_KEY:
+        h = (uintptr_t)job->u.sign_key.key;
+        break;
+    case ASYNC_PSS_VERIFY_KEY:
+        h = (uintptr_t)job->u.verify_key.key;
+        break;
+    default:
+        return 0;
+    }
+    // 포인터의 하위 비트는 정렬 때문에 거의 같으므로 곱해서 상위 비트를 씀
+    // 0은 "키 없음"이므로 해시가 0일 때만 1로 바꿈 (| 1을 하면 짝수 덱이 키 작업을 받지 못함)
+    h *= 0x9e3779b97f4a7c15ULL;
+    h >>= 32;
+    return h ? h : 1;
+}
+
+/*
+ * push() - appends job to w's deque, merging it into a recent batch with the same key
+ * 새 배치를 만들었으면 1, 기존 배치에 합쳤으면 0, 메모리가 없으면 -1을 리턴한다.
+ */
+static int push(struct worker *w, async_job *job)
+{
+    struct deque *dq = &w->dq;
+    async_job *b, **ring;
+    size_t i, n;
+
+    pthread_mutex_lock(&dq->lock);
+    n = dq->bottom - dq->top;
+    for (i = 1; i <= n && i <= ASYNC_SCAN; i++) {
+        b = dq->ring[(dq->bottom - i) & (dq->cap - 1)];
+        if (b->nbatch < ASYNC_BATCH && same_key(b, job)) {
+            b->last->next = job;
+            b->last = job;
+            b->nbatch++;
+            pthread_mutex_unlock(&dq->lock);
+            return 0;
+        }
+    }
+    if (n == dq->cap) {
+        if ((ring = malloc(2 * dq->cap * sizeof(async_job *))) == NULL) {
+            pthread_mutex_unlock(&dq->lock);
+            return -1;
+        }
+        for (i = 0; i < n; i++)
+            ring[i] = dq->ring[(dq->top + i) & (dq->cap - 1)];
+        free(dq->ring);
+        dq->ring = ring;
+        dq->cap *= 2;
+        dq->top = 0;
+        dq->bottom = n;
+    }
+    dq->ring[dq->bottom++ & (dq->cap - 1)] = job;
+    pthread_mutex_unlock(&dq->lock);
+    return 1;
+}
+
+/*
+ * pop() - takes the newest batch of w's own deque
+ */
+static async_job *pop(struct worker *w)
+{
+    struct deque *dq = &w->dq;
+    async_job *b = NULL;
+
+    pthread_mutex_lock(&dq->lock);
+    if (dq->bottom != dq->top)
+        b = dq->ring[--dq->bottom & (dq->cap - 1)];
+    pthread_mutex_unlock(&dq->lock);
+    return b;
+}
+
+/*
+ * steal() - takes the oldest batch of the first non-empty deque after w
+ */
+static async_job *steal(struct worker *w)
+{
+    async_pool *pool = w->pool;
+    struct deque *dq;
+    async_job *b = NULL;
+
+    for (int i = 1; i < pool->nworkers && b == NULL; i++) {
+        dq = &pool->w[(w->id + i) % pool->nworkers].dq;
+        pthread_mutex_lock(&dq->lock);
+        if (dq->bottom != dq->top)
+            b = dq->ring[dq->top++ & (dq->cap - 1)];
+        pthread_mutex_unlock(&dq->lock);
+    }
+    if (b)
+        w->steals++;
+    return b;
+}
+
+/*
+ * run_batch() - executes every job of batch b with one key context
+ */
+static void run_batch(async_job *b)
+{
+    async_job *job;
+    mRSA_ctx ctx;
+    rsa_verify_item item[ASYNC_BATCH];
+    int result[ASYNC_BATCH], i;
+
+    switch (b->op) {
+    case ASYNC_AES_ENCRYPT:
+        // 암호화는 여러 블록을 함께 돌리는 CipherBlocks() (AES-NI가 있으면 8 블록씩)
+        for (job = b; job; job = job->next) {
+            CipherBlocks(job->u.aes.state, job->u.aes.nblocks, job->u.aes.roundKey);
+            job->result = 0;
+        }
+        break;
+    case ASYNC_AES_DECRYPT:
+        for (job = b; job; job = job->next) {
+            for (size_t k = 0; k < job->u.aes.nblocks; k++)
+                Cipher(job->u.aes.state + BLOCKLEN*k, job->u.aes.roundKey, DECRYPT);
+            job->result = 0;
+        }
+        break;
+    case ASYNC_MRSA_CIPHER:
+        // 홀수 n이면 Montgomery 문맥을 한 번만 만들고, m >= n인 입력은 mRSA_cipher()로 넘김
+        if (b->nbatch > 1 && (b->u.mrsa.n & 1)) {
+            mRSA_ctx_init(&ctx, b->u.mrsa.k, b->u.mrsa.n);
+            for (job = b; job; job = job->next) {
+                if (*job->u.mrsa.m < ctx.n) {
+                    *job->u.mrsa.m = mRSA_ctx_pow(&ctx, *job->u.mrsa.m);
+                    job->result = 0;
+                } else
+                    job->result = mRSA_cipher(job->u.mrsa.m, job->u.mrsa.k, job->u.mrsa.n);
+            }
+        } else
+            for (job = b; job; job = job->next)
+                job->result = mRSA_cipher(job->u.mrsa.m, job->u.mrsa.k, job->u.mrsa.n);
+        break;
+    case ASYNC_PSS_SIGN:
+        for (job = b; job; job = job->next)
+            job->result = rsassa_pss_sign(job->u.sign.m, job->u.sign.mLen, job->u.sign.d, job->u.sign.n, job->u.sign.s);
+        break;
+    case ASYNC_PSS_VERIFY:
+        for (job = b; job; job = job->next)
+            job->result = rsassa_pss_verify(job->u.verify.m, job->u.verify.mLen, job->u.verify.e, job->u.verify.n, job->u.verify.s);
+        break;
+    case ASYNC_PSS_SIGN_KEY:
+        for (job = b; job; job = job->next)
+            job->result = rsassa_pss_sign_key(job->u.sign_key.m, job->u.sign_key.mLen, job->u.sign_key.key, job->u.sign_key.s);
+        break;
+    case ASYNC_PSS_VERIFY_KEY:
+        // 기본 키 크기의 같은 키 검증은 멀티 버퍼 해시를 쓰는 일괄 검증으로 처리
+        if (b->nbatch > 1 && b->u.verify_key.key->bits == RSAKEYSIZE) {
+            for (job = b, i = 0; job; job = job->next, i++) {
+                item[i].m = job->u.verify_key.m;
+                item[i].mLen = job->u.verify_key.mLen;
+                item[i].s = job->u.verify_key.s;
+                item[i].key = job->u.verify_key.key;
+            }
+            rsassa_pss_verify_batch(item, b->nbatch, result, 1, NULL, NULL);
+            for (job = b, i = 0; job; job = job->next, i++)
+                job->result = result[i];
+        } else
+            for (job = b; job; job = job->next)
+                job->result = rsassa_pss_verify_key(job->u.verify_key.m, job->u.verify_key.mLen, job->u.verify_key.key, job->u.verify_key.s);
+        break;
+    case ASYNC_RSA_KEYGEN:
+        // rsa_generate_key()는 리턴값이 없으므로 같은 키를 만드는 _ex의 리턴값을 돌려줌
+        for (job = b; job; job = job->next)
+            job->result = rsa_generate_key_ex(RSAKEYSIZE, job->u.keygen.e, job->u.keygen.d, job->u.keygen.n,
+                                              NULL, NULL, job->u.keygen.mode);
+        break;
+    case ASYNC_CALL:
+        for (job = b; job; job = job->next)
+            job->result = job->u.call.fn(job->u.call.arg);
+        break;
+    }
+}
+
+/*
+ * complete() - runs the callbacks of batch b and queues the rest for async_poll()
+ * 콜백이 작업을 다시 쓸 수 있으므로 next를 먼저 읽어 둔다. 완료 큐에 넣은 작업 수를 eventfd에 더한다.
+ */
+static void complete(async_pool *pool, async_job *b)
+{
+    async_job *job, *next, *head = NULL, *tail = NULL;
+    uint64_t n = 0;
+
+    for (job = b; job; job = next) {
+        next = job->next;
+        if (job->cb) {
+            job->cb(job);
+            continue;
+        }
+        job->next = NULL;
+        if (tail)
+            tail->next = job;
+        else
+            head = job;
+        tail = job;
+        n++;
+    }
+    if (n == 0)
+        return;
+    pthread_mutex_lock(&pool->dlock);
+    if (pool->dtail)
+        pool->dtail->next = head;
+    else
+        pool->dhead = head;
+    pool->dtail = tail;
+    if (write(pool->efd, &n, sizeof(n)) < 0) {
+        // 카운터가 가득 찬 경우뿐이며, 이미 읽을 수 있는 상태이다
+    }
+    pthread_mutex_unlock(&pool->dlock);
+}
+
+static void *worker_run(void *arg)
+{
+    struct worker *w = arg;
+    async_pool *pool = w->pool;
+    async_job *b;
+    int stop;
+
+    self = w;
+    for (;;) {
+        if ((b = pop(w)) != NULL || (b = steal(w)) != NULL) {
+            __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+            w->jobs += b->nbatch;
+            w->batches++;
+            run_batch(b);
+            complete(pool, b);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->nidle, 1, __ATOMIC_SEQ_CST);
+        while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) <= 0 && !pool->stopping)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        __atomic_sub_fetch(&pool->nidle, 1, __ATOMIC_SEQ_CST);
+        stop = pool->stopping && __atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) <= 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop)
+            break;
+    }
+    self = NULL;
+    return NULL;
+}
+
+/*
+ * async_pool_create() - starts a pool of nthreads workers, each with its own deque
+ * nthreads가 0 이하이면 온라인 코어 수를 사용한다. 일부 스레드만 시작되면 그 수로 동작하고,
+ * 하나도 시작하지 못하거나 메모리, eventfd를 만들지 못하면 NULL을 리턴한다.
+ */
+async_pool *async_pool_create(int nthreads)
+{
+    async_pool *pool;
+    int t;
+
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1)
+        nthreads = 1;
+    if ((pool = calloc(1, sizeof(async_pool))) == NULL)
+        return NULL;
+    if ((pool->w = calloc(nthreads, sizeof(struct worker))) == NULL) {
+        free(pool);
+        return NULL;
+    }
+    if ((pool->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        free(pool->w);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pthread_mutex_init(&pool->dlock, NULL);
+    for (t = 0; t < nthreads; t++) {
+        pool->w[t].pool = pool;
+        pool->w[t].id = t;
+        pthread_mutex_init(&pool->w[t].dq.lock, NULL);
+        pool->w[t].dq.cap = ASYNC_DEQUE;
+        if ((pool->w[t].dq.ring = malloc(ASYNC_DEQUE * sizeof(async_job *))) == NULL) {
+            pthread_mutex_destroy(&pool->w[t].dq.lock);
+            break;
+        }
+    }
+    nthreads = t;
+
+    // 덱을 훔칠 범위는 nworkers로 정해지므로 스레드를 시작하기 전에 정함
+    pool->nworkers = nthreads;
+    for (t = 0; t < nthreads; t++)
+        if (pthread_create(&pool->w[t].tid, NULL, worker_run, &pool->w[t]) != 0)
+            break;
+    if (t < nthreads) {
+        // 시작한 스레드만 남김, 아직 작업이 없으므로 나머지 덱은 비어 있음
+        pthread_mutex_lock(&pool->lock);
+        pool->nworkers = t;
+        pthread_mutex_unlock(&pool->lock);
+        for (int i = t; i < nthreads; i++) {
+            pthread_mutex_destroy(&pool->w[i].dq.lock);
+            free(pool->w[i].dq.ring);
+        }
+        nthreads = t;
+    }
+    if (nthreads == 0) {
+        async_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/*
+ * async_pool_destroy() - finishes every submitted job, then stops the workers and frees the pool
+ * 동시에 async_submit()을 부르면 안 된다. async_poll()로 꺼내지 않은 작업은 그대로 둔다.
+ */
+void async_pool_destroy(async_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (int t = 0; t < pool->nworkers; t++)
+        pthread_join(pool->w[t].tid, NULL);
+    for (int t = 0; t < pool->nworkers; t++) {
+        pthread_mutex_destroy(&pool->w[t].dq.lock);
+        free(pool->w[t].dq.ring);
+    }
+    close(pool->efd);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->dlock);
+    free(pool->w);
+    free(pool);
+}
+
+/*
+ * async_submit() - queues job, which must have been prepared with one of the async_prep_*() helpers
+ * cb가 NULL이 아니면 끝난 뒤 작업 스레드에서 cb(job)을 부르고, NULL이면 async_poll()로 돌려준다.
+ * 성공하면 0, 알 수 없는 op이거나 메모리가 없으면 -1을 리턴한다.
+ */
+int async_submit(async_pool *pool, async_job *job, async_cb cb, void *arg)
+{
+    struct worker *w;
+    uint64_t h;
+    int r;
+
+    if (job->op < ASYNC_AES_ENCRYPT || job->op > ASYNC_CALL)
+        return -1;
+    job->cb = cb;
+    job->arg = arg;
+    job->result = 0;
+    job->nbatch = 1;
+    job->next = NULL;
+    job->last = job;
+
+    // 작업 스레드 안에서 넣으면 자기 덱, 키가 있으면 키로 고른 덱, 없으면 돌아가며 고른 덱
+    if (self && self->pool == pool)
+        w = self;
+    else if ((h = key_hash(job)) != 0)
+        w = &pool->w[h % pool->nworkers];
+    else
+        w = &pool->w[__atomic_fetch_add(&pool->rr, 1, __ATOMIC_RELAXED) % pool->nworkers];
+
+    if ((r = push(w, job)) <= 0)
+        return r;
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->nidle, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return 0;
+}
+
+/*
+ * async_fd() - eventfd that is readable while completed jobs wait in the queue
+ */
+int async_fd(const async_pool *pool)
+{
+    return pool->efd;
+}
+
+/*
+ * async_poll() - moves up to max completed jobs into done without blocking
+ * 완료 큐를 모두 비우면 eventfd도 비운다. 꺼낸 작업 수를 리턴한다.
+ */
+size_t async_poll(async_pool *pool, async_job **done, size_t max)
+{
+    uint64_t v;
+    size_t n = 0;
+
+    pthread_mutex_lock(&pool->dlock);
+    while (n < max && pool->dhead) {
+        done[n++] = pool->dhead;
+        pool->dhead = pool->dhead->next;
+    }
+    if (pool->dhead == NULL) {
+        pool->dtail = NULL;
+        if (read(pool->efd, &v, sizeof(v)) < 0) {
+            // EAGAIN, 이미 비어 있음
+        }
+    }
+    pthread_mutex_unlock(&pool->dlock);
+    return n;
+}
+
+/*
+ * async_pool_stats() - sums the worker counters (approximate while jobs are running)
+ */
+void async_pool_stats(async_pool *pool, async_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int t = 0; t < pool->nworkers; t++) {
+        stats->jobs += pool->w[t].jobs;
+        stats->batches += pool->w[t].batches;
+        stats->steals += pool->w[t].steals;
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_ASYNC_H
+#define RSA_ASYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rsa_pss.h"
+
+/*
+ * 비동기 작업 API
+ * 암호 연산 하나를 async_job에 담아 async_submit()으로 넣으면 공유 스레드 풀이 처리한다.
+ * 작업 스레드마다 덱을 하나 두고, 자기 덱은 아래쪽에서 꺼내며 비면 다른 덱의 위쪽에서 훔쳐 온다.
+ * 덱의 항목은 같은 연산, 같은 키의 작업을 최대 ASYNC_BATCH개 묶은 배치이므로 한 스레드가
+ * 키 문맥 (라운드 키, Montgomery 문맥, rsa_private_key)을 캐시에 둔 채 연달아 처리한다.
+ * 같은 키의 작업은 같은 덱으로 보내고, 작업 스레드 안 (콜백)에서 넣은 작업은 자기 덱에 넣는다.
+ *
+ * 끝난 작업은 콜백이 있으면 작업 스레드에서 콜백을 부르고, 없으면 완료 큐에 넣고 eventfd에
+ * 알린다. 이벤트 루프는 async_fd()를 poll/epoll에 등록하고, 읽을 수 있으면 async_poll()로 꺼낸다.
+ * async_job은 호출한 쪽이 가지고 있으며, 끝날 때까지 작업과 인자 버퍼를 유지해야 한다.
+ */
+#define ASYNC_BATCH 16              /* 배치 하나의 최대 작업 수 */
+#define ASYNC_SCAN 4                /* 넣을 때 합칠 배치를 찾아보는 덱 아래쪽 항목 수 */
+#define ASYNC_DEQUE 256             /* 덱의 처음 크기 (2의 거듭제곱, 모자라면 두 배로 늘림) */
+
+#define ASYNC_AES_ENCRYPT 1         /* CipherBlocks()로 nblocks개 블록을 암호화 */
+#define ASYNC_AES_DECRYPT 2         /* Cipher(DECRYPT)를 nblocks개 블록에 */
+#define ASYNC_MRSA_CIPHER 3         /* mRSA_cipher() */
+#define ASYNC_PSS_SIGN 4            /* rsassa_pss_sign() */
+#define ASYNC_PSS_VERIFY 5          /* rsassa_pss_verify() */
+#define ASYNC_PSS_SIGN_KEY 6        /* rsassa_pss_sign_key() */
+#define ASYNC_PSS_VERIFY_KEY 7      /* rsassa_pss_verify_key(), 같은 키끼리는 rsassa_pss_verify_batch() */
+#define ASYNC_RSA_KEYGEN 8          /* rsa_generate_key_ex(RSAKEYSIZE, ...), p와 q는 내보내지 않음 */
+#define ASYNC_CALL 9                /* 임의의 함수 fn(arg) */
+
+typedef struct async_job async_job;
+typedef struct async_pool async_pool;
+typedef void (*async_cb)(async_job *job);
+
+/*
+ * async_job - 작업 하나, 결과는 result에 연산 함수의 리턴값으로 들어간다
+ */
+struct async_job {
+    int op;
+    union {
+        struct { uint8_t *state; size_t nblocks; const uint32_t *roundKey; } aes;
+        struct { uint64_t *m; uint64_t k, n; } mrsa;
+        struct { const void *m; size_t mLen; const void *d, *n; void *s; } sign;
+        struct { const void *m; size_t mLen; const void *e, *n; const void *s; } verify;
+        struct { const void *m; size_t mLen; const rsa_private_key *key; void *s; } sign_key;
+        struct { const void *m; size_t mLen; const rsa_public_key *key; const void *s; } verify_key;
+        struct { void *e, *d, *n; int mode; } keygen;
+        struct { int (*fn)(void *); void *arg; } call;
+    } u;
+    async_cb cb;
+    void *arg;                      /* 호출한 쪽의 값, 풀은 쓰지 않음 */
+    int result;
+    /* 아래는 풀 내부 */
+    int nbatch;                     /* 배치 첫 작업에서만 유효 */
+    async_job *next, *last;
+};
+
+/*
+ * async_stats - 풀이 만들어진 뒤의 누적 통계
+ */
+typedef struct {
+    uint64_t jobs;                  /* 끝난 작업 수 */
+    uint64_t batches;               /* 실행한 배치 수 */
+    uint64_t steals;                /* 다른 덱에서 훔쳐 온 배치 수 */
+} async_stats;
+
+static inline void async_prep_aes(async_job *job, int mode, uint8_t *state, size_t nblocks, const uint32_t *roundKey)
+{
+    job->op = mode;
+    job->u.aes.state = state;
+    job->u.aes.nblocks = nblocks;
+    job->u.aes.roundKey = roundKey;
+}
+
+static inline void async_prep_mrsa(async_job *job, uint64_t *m, uint64_t k, uint64_t n)
+{
+    job->op = ASYNC_MRSA_CIPHER;
+    job->u.mrsa.m = m;
+    job->u.mrsa.k = k;
+    job->u.mrsa.n = n;
+}
+
+static inline void async_prep_sign(async_job *job, const void *m, size_t mLen, const void *d, const void *n, void *s)
+{
+    job->op = ASYNC_PSS_SIGN;
+    job->u.sign.m = m;
+    job->u.sign.mLen = mLen;
+    job->u.sign.d = d;
+    job->u.sign.n = n;
+    job->u.sign.s = s;
+}
+
+static inline void async_prep_verify(async_job *job, const void *m, size_t mLen, const void *e, const void *n, const void *s)
+{
+    job->op = ASYNC_PSS_VERIFY;
+    job->u.verify.m = m;
+    job->u.verify.mLen = mLen;
+    job->u.verify.e = e;
+    job->u.verify.n = n;
+    job->u.verify.s = s;
+}
+
+static inline void async_prep_sign_key(async_job *job, const void *m, size_t mLen, const rsa_private_key *key, void *s)
+{
+    job->op = ASYNC_PSS_SIGN_KEY;
+    job->u.sign_key.m = m;
+    job->u.sign_key.mLen = mLen;
+    job->u.sign_key.key = key;
+    job->u.sign_key.s = s;
+}
+
+static inline void async_prep_verify_key(async_job *job, const void *m, size_t mLen, const rsa_public_key *key, const void *s)
+{
+    job->op = ASYNC_PSS_VERIFY_KEY;
+    job->u.verify_key.m = m;
+    job->u.verify_key.mLen = mLen;
+    job->u.verify_key.key = key;
+    job->u.verify_key.s = s;
+}
+
+static inline void async_prep_keygen(async_job *job, void *e, void *d, void *n, int mode)
+{
+    job->op = ASYNC_RSA_KEYGEN;
+    job->u.keygen.e = e;
+    job->u.keygen.d = d;
+    job->u.keygen.n = n;
+    job->u.keygen.mode = mode;
+}
+
+static inline void async_prep_call(async_job *job, int (*fn)(void *), void *arg)
+{
+    job->op = ASYNC_CALL;
+    job->u.call.fn = fn;
+    job->u.call.arg = arg;
+}
+
+async_pool *async_pool_create(int nthreads);
+void async_pool_destroy(async_pool *pool);
+int async_submit(async_pool *pool, async_job *job, async_cb cb, void *arg);
+int async_fd(const async_pool *pool);
+size_t async_poll(async_pool *pool, async_job **done, size_t max);
+void async_pool_stats(async_pool *pool, async_stats *stats);
+
+#endif
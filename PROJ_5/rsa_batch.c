@@ -0,0 +1,376 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rsa_batch.h"
+
+struct verify_cache_set {
+    unsigned char tag[VERIFY_CACHE_WAYS][SHASIZE/8];
+    signed char code[VERIFY_CACHE_WAYS];    /* -1이면 빈 항목 */
+    unsigned char hand;                     /* 다음에 교체할 항목 */
+};
+
+/*
+ * rsa_verify_cache_init() - allocates a cache that holds about capacity results
+ * 집합 수는 capacity/VERIFY_CACHE_WAYS 이상인 2의 거듭제곱으로 맞춘다.
+ * 메모리 할당에 실패하면 -1, 성공하면 0을 리턴한다.
+ */
+int rsa_verify_cache_init(rsa_verify_cache *cache, size_t capacity)
+{
+    size_t nset = 1;
+
+    while (nset * VERIFY_CACHE_WAYS < capacity)
+        nset <<= 1;
+    cache->set = malloc(nset * sizeof(struct verify_cache_set));
+    if (cache->set == NULL)
+        return -1;
+    for (size_t i = 0; i < nset; i++) {
+        memset(cache->set[i].code, -1, VERIFY_CACHE_WAYS);
+        cache->set[i].hand = 0;
+    }
+    cache->nset = nset;
+    cache->hits = cache->misses = 0;
+    for (int i = 0; i < VERIFY_CACHE_LOCKS; i++)
+        pthread_mutex_init(&cache->lock[i], NULL);
+    return 0;
+}
+
+/*
+ * rsa_verify_cache_clear() - releases the cache
+ */
+void rsa_verify_cache_clear(rsa_verify_cache *cache)
+{
+    for (int i = 0; i < VERIFY_CACHE_LOCKS; i++)
+        pthread_mutex_destroy(&cache->lock[i]);
+    free(cache->set);
+    cache->set = NULL;
+    cache->nset = 0;
+}
+
+/*
+ * cache_index() - picks the set of a tag from its first 8 bytes
+ */
+static size_t cache_index(const rsa_verify_cache *cache, const unsigned char *tag)
+{
+    uint64_t x;
+
+    memcpy(&x, tag, sizeof(x));
+    return (size_t)x & (cache->nset - 1);
+}
+
+/*
+ * cache_lookup() - returns the cached result of tag, or -1 if it is not in the cache
+ */
+static int cache_lookup(rsa_verify_cache *cache, const unsigned char *tag)
+{
+    size_t i = cache_index(cache, tag);
+    struct verify_cache_set *set = &cache->set[i];
+    int code = -1;
+
+    pthread_mutex_lock(&cache->lock[i % VERIFY_CACHE_LOCKS]);
+    for (int w = 0; w < VERIFY_CACHE_WAYS; w++)
+        if (set->code[w] >= 0 && memcmp(set->tag[w], tag, SHASIZE/8) == 0) {
+            code = set->code[w];
+            break;
+        }
+    pthread_mutex_unlock(&cache->lock[i % VERIFY_CACHE_LOCKS]);
+    return code;
+}
+
+/*
+ * cacheable() - tells whether code depends only on the signature, key and mHash
+ * 검증 성공과 서명 자체의 결함만 넣고, 메모리 부족처럼 다시 하면 달라질 수 있는 실패는 넣지 않는다.
+ */
+static int cacheable(int code)
+{
+    switch (code) {
+    case 0:
+    case EM_MSG_OUT_OF_RANGE:
+    case EM_INVALID_LAST:
+    case EM_INVALID_INIT:
+    case EM_INVALID_PD2:
+    case EM_HASH_MISMATCH:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * cache_insert() - stores the result of tag, replacing the ways of the set in turn
+ */
+static void cache_insert(rsa_verify_cache *cache, const unsigned char *tag, int code)
+{
+    size_t i = cache_index(cache, tag);
+    struct verify_cache_set *set = &cache->set[i];
+    int w;
+
+    pthread_mutex_lock(&cache->lock[i % VERIFY_CACHE_LOCKS]);
+    w = set->hand;
+    set->hand = (set->hand + 1) % VERIFY_CACHE_WAYS;
+    memcpy(set->tag[w], tag, SHASIZE/8);
+    set->code[w] = (signed char)code;
+    pthread_mutex_unlock(&cache->lock[i % VERIFY_CACHE_LOCKS]);
+}
+
+/*
+ * 작업 훔치기 : 스레드마다 처리할 구간 [lo, hi)를 가지고 앞에서부터 BATCH_CHUNK개씩 꺼낸다.
+ * 자기 구간이 비면 다른 스레드 구간의 뒤쪽 절반을 가져온다. 구간은 각자의 락으로 보호한다.
+ */
+struct batch_job;
+
+struct batch_worker {
+    pthread_mutex_t lock;
+    size_t lo, hi;
+    struct batch_job *job;
+    int id;
+    size_t valid, hits, misses, stolen;
+};
+
+struct batch_job {
+    const rsa_verify_item *item;
+    int *result;
+    rsa_verify_cache *cache;
+    struct batch_worker *w;
+    int nthreads;
+};
+
+/*
+ * take() - pops up to BATCH_CHUNK items from the front of the worker's own range
+ */
+static int take(struct batch_worker *w, size_t *lo, size_t *hi)
+{
+    int ok = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->lo < w->hi) {
+        *lo = w->lo;
+        w->lo = (w->hi - w->lo > BATCH_CHUNK) ? w->lo + BATCH_CHUNK : w->hi;
+        *hi = w->lo;
+        ok = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+/*
+ * steal() - moves the back half of another worker's range into the worker's own range
+ * 모든 스레드의 구간이 비어 있으면 0을 리턴한다.
+ */
+static int steal(struct batch_worker *w)
+{
+    struct batch_job *job = w->job;
+    struct batch_worker *v;
+    size_t lo, hi;
+
+    for (int k = 1; k < job->nthreads; k++) {
+        v = &job->w[(w->id + k) % job->nthreads];
+        pthread_mutex_lock(&v->lock);
+        if (v->lo < v->hi) {
+            hi = v->hi;
+            lo = hi - (hi - v->lo + 1) / 2;
+            v->hi = lo;
+            pthread_mutex_unlock(&v->lock);
+
+            pthread_mutex_lock(&w->lock);
+            w->lo = lo;
+            w->hi = hi;
+            pthread_mutex_unlock(&w->lock);
+            w->stolen++;
+            return 1;
+        }
+        pthread_mutex_unlock(&v->lock);
+    }
+    return 0;
+}
+
+/*
+ * hash_chunk() - computes the message hashes of item[0..n-1]
+ * 길이가 같은 메시지끼리 모아 멀티 버퍼 해시로 한 번에 계산한다.
+ */
+static void hash_chunk(const rsa_verify_item *item, size_t n, unsigned char (*mHash)[SHASIZE/8])
+{
+    const unsigned char *pm[BATCH_CHUNK];
+    unsigned char *pd[BATCH_CHUNK];
+    unsigned char done[BATCH_CHUNK] = {0};
+    int c;
+
+    for (size_t i = 0; i < n; i++) {
+        if (done[i])
+            continue;
+        // sha2.c의 한계보다 긴 메시지는 하나씩 처리
+        if (item[i].mLen >= ((size_t)1 << 29)) {
+            rsa_pss_hash(item[i].m, item[i].mLen, mHash[i]);
+            continue;
+        }
+        c = 0;
+        for (size_t j = i; j < n; j++)
+            if (!done[j] && item[j].mLen == item[i].mLen) {
+                pm[c] = item[j].m;
+                pd[c] = mHash[j];
+                done[j] = 1;
+                c++;
+            }
+        rsa_pss_hash_mb(pm, (unsigned int)item[i].mLen, pd, c);
+    }
+}
+
+/*
+ * verify_chunk() - verifies item[lo..hi-1] and writes their EM_* codes
+ * 캐시가 있으면 항목마다 태그 Hash(fp || mHash || s)를 구해 먼저 찾아보고, 없을 때만 검증한 뒤 넣는다.
+ * 태그 입력은 길이가 모두 같으므로 역시 멀티 버퍼 해시로 계산한다.
+ */
+static void verify_chunk(struct batch_worker *w, size_t lo, size_t hi)
+{
+    const rsa_verify_item *item = w->job->item + lo;
+    rsa_verify_cache *cache = w->job->cache;
+    int *result = w->job->result + lo;
+    size_t n = hi - lo;
+    unsigned char mHash[BATCH_CHUNK][SHASIZE/8];
+    unsigned char in[BATCH_CHUNK][2*SHASIZE/8 + RSAKEYSIZE/8], tag[BATCH_CHUNK][SHASIZE/8];
+    const unsigned char *pm[BATCH_CHUNK] = {NULL};
+    unsigned char *pd[BATCH_CHUNK] = {NULL};
+    int code;
+
+    hash_chunk(item, n, mHash);
+
+    if (cache) {
+        for (size_t i = 0; i < n; i++) {
+            memcpy(in[i], item[i].key->fp, SHASIZE/8);
+            memcpy(in[i] + SHASIZE/8, mHash[i], SHASIZE/8);
+            memcpy(in[i] + 2*SHASIZE/8, item[i].s, RSAKEYSIZE/8);
+            pm[i] = in[i];
+            pd[i] = tag[i];
+        }
+        rsa_pss_hash_mb(pm, sizeof(in[0]), pd, (int)n);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (cache && (code = cache_lookup(cache, tag[i])) >= 0) {
+            w->hits++;
+        } else {
+            code = rsassa_pss_verify_hash(mHash[i], item[i].key, item[i].s);
+            if (cache) {
+                if (cacheable(code))
+                    cache_insert(cache, tag[i], code);
+                w->misses++;
+            }
+        }
+        result[i] = code;
+        if (code == 0)
+            w->valid++;
+    }
+}
+
+static void *batch_run(void *arg)
+{
+    struct batch_worker *w = arg;
+    size_t lo, hi;
+
+    do {
+        while (take(w, &lo, &hi))
+            verify_chunk(w, lo, hi);
+    } while (steal(w));
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * rsassa_pss_verify_batch() - verifies n (message, signature, key) items in parallel
+ * result[i]에 rsassa_pss_verify_key()와 같은 EM_* 코드(성공하면 0)를 기록한다.
+ * nthreads가 0 이하이면 온라인 코어 수를 사용하고, 항목이 적으면 스레드를 줄인다.
+ * cache가 NULL이 아니면 결과를 캐시에서 찾고 새 결과를 넣는다. stats가 NULL이 아니면 통계를 채운다.
+ * 검증에 실패한 항목의 수를 리턴한다.
+ */
+size_t rsassa_pss_verify_batch(const rsa_verify_item *item, size_t n, int *result, int nthreads,
+                               rsa_verify_cache *cache, rsa_batch_stats *stats)
+{
+    struct batch_job job;
+    struct batch_worker one, *w = &one;
+    pthread_t *tid = NULL;
+    size_t chunk, valid = 0, hits = 0, misses = 0, stolen = 0;
+    double start = now();
+    int t, started;
+
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t)nthreads > (n + BATCH_CHUNK - 1) / BATCH_CHUNK)
+        nthreads = (int)((n + BATCH_CHUNK - 1) / BATCH_CHUNK);
+    if (nthreads < 1)
+        nthreads = 1;
+
+    // 스레드 하나이거나 메모리 할당에 실패하면 호출한 스레드만으로 처리
+    if (nthreads > 1) {
+        w = malloc(nthreads * sizeof(struct batch_worker));
+        tid = malloc(nthreads * sizeof(pthread_t));
+        if (w == NULL || tid == NULL) {
+            free(w); free(tid);
+            w = &one;
+            tid = NULL;
+            nthreads = 1;
+        }
+    }
+
+    job.item = item;
+    job.result = result;
+    job.cache = cache;
+    job.w = w;
+    job.nthreads = nthreads;
+
+    // 처음에는 고르게 나누고, 먼저 끝난 스레드가 남은 구간을 훔쳐 감
+    chunk = (n + nthreads - 1) / nthreads;
+    for (t = 0; t < nthreads; t++) {
+        pthread_mutex_init(&w[t].lock, NULL);
+        w[t].lo = (chunk * t < n) ? chunk * t : n;
+        w[t].hi = (chunk * (t+1) < n) ? chunk * (t+1) : n;
+        w[t].job = &job;
+        w[t].id = t;
+        w[t].valid = w[t].hits = w[t].misses = w[t].stolen = 0;
+    }
+
+    // 마지막 구간은 호출한 스레드가 처리하며, 시작하지 못한 스레드의 구간도 훔쳐서 처리됨
+    for (started = 0; started < nthreads-1; started++)
+        if (pthread_create(&tid[started], NULL, batch_run, &w[started]) != 0)
+            break;
+    batch_run(&w[nthreads-1]);
+    for (t = 0; t < started; t++)
+        pthread_join(tid[t], NULL);
+
+    for (t = 0; t < nthreads; t++) {
+        valid += w[t].valid;
+        hits += w[t].hits;
+        misses += w[t].misses;
+        stolen += w[t].stolen;
+        pthread_mutex_destroy(&w[t].lock);
+    }
+    if (cache) {
+        // 같은 캐시를 여러 스레드의 일괄 검증이 함께 쓸 수 있으므로 원자적으로 더함
+        __atomic_add_fetch(&cache->hits, hits, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&cache->misses, misses, __ATOMIC_RELAXED);
+    }
+    if (stats) {
+        stats->count = n;
+        stats->valid = valid;
+        stats->cached = hits;
+        stats->stolen = stolen;
+        stats->nthreads = nthreads;
+        stats->seconds = now() - start;
+        stats->per_sec = stats->seconds > 0 ? n / stats->seconds : 0;
+    }
+    if (w != &one)
+        free(w);
+    free(tid);
+    return n - valid;
+}
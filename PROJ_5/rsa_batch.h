@@ -0,0 +1,60 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_BATCH_H
+#define RSA_BATCH_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "rsa_pss.h"
+
+#define BATCH_CHUNK 8               /* 스레드가 한 번에 가져가는 항목 수, 멀티 버퍼 해시의 레인 수 */
+#define VERIFY_CACHE_WAYS 4         /* 캐시 집합 하나의 항목 수 */
+#define VERIFY_CACHE_LOCKS 64       /* 캐시 집합을 나누어 보호하는 락의 수 */
+
+/*
+ * rsa_verify_item - 일괄 검증할 (메시지, 서명, 공개키) 하나
+ */
+typedef struct {
+    const void *m;
+    size_t mLen;
+    const void *s;                  /* RSAKEYSIZE/8 바이트 서명 */
+    const rsa_public_key *key;
+} rsa_verify_item;
+
+/*
+ * rsa_verify_cache - 검증 결과를 기억하는 크기 제한 캐시
+ * 태그 Hash(fp || mHash || s)로 찾으며, 같은 결과는 다시 검증하지 않고 바로 돌려준다.
+ * VERIFY_CACHE_WAYS-way 집합 연관 구조이고 집합마다 돌아가며 교체한다.
+ * 검증 성공과 서명 자체의 결함 (EM_MSG_OUT_OF_RANGE, EM_INVALID_*, EM_HASH_MISMATCH)만 기억하고,
+ * EM_NO_MEMORY 같은 일시적인 실패는 넣지 않으므로 다음 호출에서 다시 검증한다.
+ */
+struct verify_cache_set;
+
+typedef struct {
+    struct verify_cache_set *set;
+    size_t nset;                    /* 집합 수 (2의 거듭제곱) */
+    size_t hits, misses;            /* 누적 통계, 원자적으로 갱신되므로 읽을 때도 __atomic_load_n()을 쓴다 */
+    pthread_mutex_t lock[VERIFY_CACHE_LOCKS];
+} rsa_verify_cache;
+
+/*
+ * rsa_batch_stats - 일괄 검증 한 번의 통계
+ */
+typedef struct {
+    size_t count;                   /* 전체 항목 수 */
+    size_t valid;                   /* 검증에 성공한 항목 수 */
+    size_t cached;                  /* 캐시에서 바로 결과를 얻은 항목 수 */
+    size_t stolen;                  /* 다른 스레드에서 가져온 구간 수 */
+    int nthreads;
+    double seconds;
+    double per_sec;                 /* 초당 검증 항목 수 */
+} rsa_batch_stats;
+
+int rsa_verify_cache_init(rsa_verify_cache *cache, size_t capacity);
+void rsa_verify_cache_clear(rsa_verify_cache *cache);
+size_t rsassa_pss_verify_batch(const rsa_verify_item *item, size_t n, int *result, int nthreads,
+                               rsa_verify_cache *cache, rsa_batch_stats *stats);
+
+#endif
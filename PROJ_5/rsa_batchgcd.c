@@ -0,0 +1,483 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * RSA 모듈러스 일괄 GCD 검사 (Bernstein batch GCD)
+ * 엔트로피가 부족한 환경에서 만든 키는 서로 소수를 공유할 수 있다. 모든 쌍의 gcd는 O(n^2)이므로
+ * 곱 트리로 P = N_1 * ... * N_n을 구하고, 나머지 트리로 R_i = P mod N_i^2을 구한 뒤
+ * g_i = gcd(R_i / N_i, N_i)가 1이 아닌 모듈러스를 찾는다. g_i = N_i이면 두 소수 모두 다른
+ * 모듈러스와 공유하거나 같은 모듈러스가 중복된 것이므로, 그런 것끼리만 쌍별로 다시 gcd를 구한다.
+ *
+ * 트리의 각 층은 임시 파일에 limb 배열로 쓰고 mmap으로 읽으므로, 층 전체가 메모리에 올라와
+ * 있을 필요가 없다. 읽을 때는 mpz_roinit_n()으로 매핑된 limb를 복사 없이 mpz로 쓴다.
+ * 한 층의 항목들은 서로 독립이므로 여러 스레드가 나누어 계산한다.
+ *
+ * 입력은 한 줄에 16진수 모듈러스 하나이거나, -r bits이면 rsa_generate_key()가 내보낸 bits/8 바이트
+ * octet string을 이어 붙인 파일이다. 약한 모듈러스마다 "번호 모듈러스 공유인수"를 16진수로 출력한다.
+ *
+ * gcc -O2 -pthread -o rsa_batchgcd rsa_batchgcd.c -lgmp
+ * ./rsa_batchgcd [-r bits] [-t 스레드 수] [-d 임시 디렉터리] moduli-file
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <gmp.h>
+
+/*
+ * level - 트리의 한 층, 파일 구조는 off[count], size[count], limb 영역 순서이다
+ * i번째 수는 limb[off[i]]부터 size[i]개의 limb이며, off는 층을 만들 때 크기의 상한으로 정한다.
+ */
+struct level {
+    size_t count;
+    uint64_t *off, *size;
+    mp_limb_t *limb;
+    void *map;
+    size_t maplen;
+};
+
+/*
+ * weak - 공유 인수가 발견된 모듈러스
+ */
+struct weak {
+    size_t index;
+    mpz_t g;
+};
+
+static const char *tmpdir;
+static int nthreads;
+
+static struct weak *weak;
+static size_t nweak, weak_cap;
+static pthread_mutex_t weak_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * level_create() - maps a new level of count numbers where number i has at most bound[i] limbs
+ * 임시 파일은 만들자마자 지우므로 매핑을 해제하면 디스크에서도 사라진다.
+ */
+static int level_create(struct level *lv, size_t count, const uint64_t *bound)
+{
+    char path[4096];
+    uint64_t total = 0;
+    int fd;
+
+    for (size_t i = 0; i < count; i++)
+        total += bound[i];
+    lv->count = count;
+    lv->maplen = 2 * count * sizeof(uint64_t) + total * sizeof(mp_limb_t);
+    snprintf(path, sizeof(path), "%s/batchgcd.XXXXXX", tmpdir);
+    fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (ftruncate(fd, (off_t)lv->maplen) < 0) {
+        close(fd);
+        return -1;
+    }
+    lv->map = mmap(NULL, lv->maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (lv->map == MAP_FAILED)
+        return -1;
+    lv->off = lv->map;
+    lv->size = lv->off + count;
+    lv->limb = (mp_limb_t *)(lv->size + count);
+    total = 0;
+    for (size_t i = 0; i < count; i++) {
+        lv->off[i] = total;
+        total += bound[i];
+    }
+    return 0;
+}
+
+static void level_free(struct level *lv)
+{
+    if (lv->map && lv->map != MAP_FAILED)
+        munmap(lv->map, lv->maplen);
+    lv->map = NULL;
+}
+
+/*
+ * level_get() - makes x a read-only view of number i without copying its limbs
+ * x는 mpz_clear()하면 안 되며 층이 매핑되어 있는 동안만 쓸 수 있다.
+ */
+static mpz_srcptr level_get(const struct level *lv, size_t i, mpz_t x)
+{
+    return mpz_roinit_n(x, lv->limb + lv->off[i], (mp_size_t)lv->size[i]);
+}
+
+static void level_put(struct level *lv, size_t i, const mpz_t x)
+{
+    size_t n = mpz_size(x);
+
+    memcpy(lv->limb + lv->off[i], mpz_limbs_read(x), n * sizeof(mp_limb_t));
+    lv->size[i] = n;
+}
+
+/*
+ * 층 하나를 여러 스레드가 나누어 계산한다. 스레드는 chunk개씩 다음 번호를 가져간다.
+ */
+struct level_job {
+    void (*fn)(struct level_job *job, size_t i, mpz_t t1, mpz_t t2);
+    struct level *src, *dst, *aux;
+    size_t count, next, chunk;
+    pthread_mutex_t lock;
+};
+
+static void *level_worker(void *arg)
+{
+    struct level_job *job = arg;
+    size_t lo, hi;
+    mpz_t t1, t2;
+
+    mpz_inits(t1, t2, NULL);
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        lo = job->next;
+        hi = (job->count - lo > job->chunk) ? lo + job->chunk : job->count;
+        job->next = hi;
+        pthread_mutex_unlock(&job->lock);
+        if (lo >= hi)
+            break;
+        for (size_t i = lo; i < hi; i++)
+            job->fn(job, i, t1, t2);
+    }
+    mpz_clears(t1, t2, NULL);
+    return NULL;
+}
+
+static void level_run(struct level_job *job, size_t count)
+{
+    pthread_t tid[nthreads];
+    int t, started;
+
+    job->count = count;
+    job->next = 0;
+    job->chunk = count / ((size_t)nthreads * 16) + 1;
+    pthread_mutex_init(&job->lock, NULL);
+    // 위쪽 층은 항목이 적으므로 항목 수보다 많은 스레드는 만들지 않음
+    t = ((size_t)nthreads < count) ? nthreads : (int)count;
+    for (started = 0; started < t - 1; started++)
+        if (pthread_create(&tid[started], NULL, level_worker, job) != 0)
+            break;
+    level_worker(job);
+    for (int i = 0; i < started; i++)
+        pthread_join(tid[i], NULL);
+    pthread_mutex_destroy(&job->lock);
+}
+
+/*
+ * product_node() - dst[i] = src[2i] * src[2i+1], or src[2i] if it has no sibling
+ */
+static void product_node(struct level_job *job, size_t i, mpz_t t1, mpz_t t2)
+{
+    mpz_t a, b;
+
+    (void)t2;
+    if (2*i + 1 < job->src->count) {
+        mpz_mul(t1, level_get(job->src, 2*i, a), level_get(job->src, 2*i + 1, b));
+        level_put(job->dst, i, t1);
+    } else {
+        level_put(job->dst, i, level_get(job->src, 2*i, a));
+    }
+}
+
+/*
+ * remainder_node() - dst[i] = src[i/2] mod aux[i]^2 (src는 위 층의 나머지, aux는 같은 층의 곱)
+ */
+static void remainder_node(struct level_job *job, size_t i, mpz_t t1, mpz_t t2)
+{
+    mpz_t r, p;
+
+    level_get(job->aux, i, p);
+    mpz_mul(t1, p, p);
+    mpz_mod(t2, level_get(job->src, i / 2, r), t1);
+    level_put(job->dst, i, t2);
+}
+
+/*
+ * leaf_node() - g = gcd((R mod N^2) / N, N) for modulus i, recording it when g != 1
+ */
+static void leaf_node(struct level_job *job, size_t i, mpz_t t1, mpz_t t2)
+{
+    mpz_t r, n;
+    struct weak *w;
+
+    level_get(job->aux, i, n);
+    mpz_mul(t1, n, n);
+    mpz_mod(t2, level_get(job->src, i / 2, r), t1);
+    mpz_divexact(t2, t2, n);
+    mpz_gcd(t1, t2, n);
+    if (mpz_cmp_ui(t1, 1) == 0)
+        return;
+
+    pthread_mutex_lock(&weak_lock);
+    if (nweak == weak_cap) {
+        w = realloc(weak, (weak_cap ? 2 * weak_cap : 64) * sizeof(struct weak));
+        if (w == NULL) {
+            pthread_mutex_unlock(&weak_lock);
+            fprintf(stderr, "batchgcd: out of memory, modulus %zu not reported\n", i);
+            return;
+        }
+        weak = w;
+        weak_cap = weak_cap ? 2 * weak_cap : 64;
+    }
+    weak[nweak].index = i;
+    mpz_init_set(weak[nweak].g, t1);
+    nweak++;
+    pthread_mutex_unlock(&weak_lock);
+}
+
+/*
+ * parse_hex() - parses one line of hexadecimal digits, ignoring an optional 0x and surrounding spaces
+ * 빈 줄이거나 16진수가 아니면 -1을 리턴한다.
+ */
+static int parse_hex(mpz_t x, char *line)
+{
+    char *p = line, *q;
+
+    while (isspace((unsigned char)*p))
+        p++;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        p += 2;
+    for (q = p; isxdigit((unsigned char)*q); q++)
+        ;
+    while (isspace((unsigned char)*q))
+        *q++ = '\0';
+    if (*q != '\0' || *p == '\0')
+        return -1;
+    return mpz_set_str(x, p, 16);
+}
+
+/*
+ * load_moduli() - reads the input file twice: once for the count and sizes, once into level 0
+ * 모듈러스 수만큼의 크기 배열 말고는 메모리에 올리지 않는다.
+ */
+static int load_moduli(const char *path, int raw_bits, struct level *lv)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t cap = 0, count = 0, n, reclen = raw_bits / 8;
+    uint64_t *bound = NULL, *b;
+    unsigned char *rec = NULL;
+    mpz_t x;
+    int ret = -1;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+        return -1;
+    mpz_init(x);
+    if (raw_bits && (rec = malloc(reclen)) == NULL)
+        goto out;
+
+    for (int pass = 0; pass < 2; pass++) {
+        rewind(fp);
+        n = 0;
+        while (1) {
+            if (raw_bits) {
+                if (fread(rec, 1, reclen, fp) != reclen)
+                    break;
+                mpz_import(x, reclen, 1, 1, 1, 0, rec);
+            } else {
+                if (getline(&line, &cap, fp) < 0)
+                    break;
+                if (parse_hex(x, line) < 0)
+                    continue;
+            }
+            if (mpz_sgn(x) == 0)
+                continue;
+            if (pass == 0) {
+                if (n == count) {
+                    b = realloc(bound, (count ? 2 * count : 1024) * sizeof(uint64_t));
+                    if (b == NULL)
+                        goto out;
+                    bound = b;
+                    count = count ? 2 * count : 1024;
+                }
+                bound[n] = mpz_size(x);
+            } else {
+                level_put(lv, n, x);
+            }
+            n++;
+        }
+        if (pass == 0 && (n == 0 || level_create(lv, n, bound) < 0))
+            goto out;
+    }
+    ret = 0;
+out:
+    mpz_clear(x);
+    free(line);
+    free(rec);
+    free(bound);
+    fclose(fp);
+    return ret;
+}
+
+static int cmp_weak(const void *a, const void *b)
+{
+    const struct weak *x = a, *y = b;
+
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+/*
+ * resolve_full() - splits g = N results by pairwise gcd among those moduli only
+ * 다른 모듈러스와 소수를 하나만 공유하는 것을 찾으면 그 소수를 g로 바꾸고, 끝까지 g = N이면 중복으로 본다.
+ */
+static void resolve_full(const struct level *leaf)
+{
+    mpz_t a, b, g;
+
+    mpz_init(g);
+    for (size_t i = 0; i < nweak; i++) {
+        level_get(leaf, weak[i].index, a);
+        if (mpz_cmp(weak[i].g, a) != 0)
+            continue;
+        for (size_t j = 0; j < nweak; j++) {
+            if (j == i)
+                continue;
+            mpz_gcd(g, a, level_get(leaf, weak[j].index, b));
+            if (mpz_cmp_ui(g, 1) > 0 && mpz_cmp(g, a) < 0) {
+                mpz_set(weak[i].g, g);
+                break;
+            }
+        }
+    }
+    mpz_clear(g);
+}
+
+int main(int argc, char *argv[])
+{
+    struct level *prod, rem[2];
+    struct level_job job;
+    uint64_t *bound;
+    size_t nlevel = 1, n, cur;
+    int raw_bits = 0, opt, ret = 0;
+    double t0, t1, t2;
+    mpz_t x;
+
+    tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    while ((opt = getopt(argc, argv, "r:t:d:")) != -1) {
+        switch (opt) {
+        case 'r': raw_bits = atoi(optarg); break;
+        case 't': nthreads = atoi(optarg); break;
+        case 'd': tmpdir = optarg; break;
+        default: optind = argc + 1;
+        }
+    }
+    if (optind != argc - 1 || nthreads < 1 || raw_bits < 0 || raw_bits % 8 != 0) {
+        fprintf(stderr, "usage: %s [-r bits] [-t threads] [-d tmpdir] moduli-file\n", argv[0]);
+        return 1;
+    }
+
+    // 층 수는 ceil(log2 n) + 1이며 64를 넘지 않는다
+    prod = calloc(65, sizeof(struct level));
+    if (prod == NULL)
+        return 1;
+    t0 = now();
+    if (load_moduli(argv[optind], raw_bits, &prod[0]) < 0) {
+        fprintf(stderr, "batchgcd: cannot read moduli from %s\n", argv[optind]);
+        return 1;
+    }
+
+    /*
+     * 곱 트리 : prod[l+1][i] = prod[l][2i] * prod[l][2i+1]
+     */
+    job.fn = product_node;
+    while (prod[nlevel-1].count > 1) {
+        struct level *src = &prod[nlevel-1];
+
+        n = (src->count + 1) / 2;
+        bound = malloc(n * sizeof(uint64_t));
+        if (bound == NULL)
+            return 1;
+        for (size_t i = 0; i < n; i++)
+            bound[i] = src->size[2*i] + (2*i + 1 < src->count ? src->size[2*i + 1] : 0);
+        if (level_create(&prod[nlevel], n, bound) < 0) {
+            perror("batchgcd");
+            return 1;
+        }
+        free(bound);
+        job.src = src;
+        job.dst = &prod[nlevel];
+        level_run(&job, n);
+        nlevel++;
+    }
+    t1 = now();
+
+    /*
+     * 나머지 트리 : 위에서부터 rem[l][i] = rem[l+1][i/2] mod prod[l][i]^2
+     * 뿌리의 나머지는 뿌리 자신이고, 바로 위 층의 나머지만 남겨 두면 된다.
+     * 다 쓴 곱 트리 층은 바로 해제하며, 잎 층에서는 나머지를 저장하지 않고 gcd를 바로 구한다.
+     */
+    cur = 0;
+    job.src = &prod[nlevel-1];
+    for (size_t l = nlevel - 1; l-- > 1; ) {
+        n = prod[l].count;
+        bound = malloc(n * sizeof(uint64_t));
+        if (bound == NULL)
+            return 1;
+        for (size_t i = 0; i < n; i++)
+            bound[i] = 2 * prod[l].size[i];
+        if (level_create(&rem[cur], n, bound) < 0) {
+            perror("batchgcd");
+            return 1;
+        }
+        free(bound);
+        job.fn = remainder_node;
+        job.dst = &rem[cur];
+        job.aux = &prod[l];
+        level_run(&job, n);
+        if (job.src != &prod[nlevel-1])
+            level_free(job.src);
+        level_free(&prod[l + 1]);
+        job.src = &rem[cur];
+        cur ^= 1;
+    }
+    if (prod[0].count > 1) {
+        job.fn = leaf_node;
+        job.aux = &prod[0];
+        level_run(&job, prod[0].count);
+        level_free(job.src);
+        level_free(&prod[1]);
+    }
+    t2 = now();
+
+    /*
+     * 결과 출력 : 번호 순서로 "번호 모듈러스 공유인수", 두 소수를 모두 공유하면 공유인수 자리에 dup
+     */
+    resolve_full(&prod[0]);
+    qsort(weak, nweak, sizeof(struct weak), cmp_weak);
+    for (size_t i = 0; i < nweak; i++) {
+        level_get(&prod[0], weak[i].index, x);
+        gmp_printf("%zu %Zx ", weak[i].index, x);
+        if (mpz_cmp(weak[i].g, x) == 0)
+            printf("dup\n");
+        else
+            gmp_printf("%Zx\n", weak[i].g);
+        mpz_clear(weak[i].g);
+    }
+    fprintf(stderr, "batchgcd: %zu moduli, %zu levels, %d threads, product %.2f s, remainder %.2f s, %zu weak\n",
+            prod[0].count, nlevel, nthreads, t1 - t0, t2 - t1, nweak);
+    ret = nweak ? 2 : 0;
+
+    level_free(&prod[0]);
+    free(prod);
+    free(weak);
+    return ret;
+}
@@ -0,0 +1,500 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <string.h>
+#include "rsa_bn.h"
+#include "instr.h"
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#define BN_X86_64
+#endif
+
+#define BN_KARATSUBA_MIN 48         /* limb 수가 이 값 이상이고 짝수이면 Karatsuba로 나눈다 (3072, 4096 비트) */
+#define BN_WINDOW_MAX 5             /* 지수승 창의 최대 비트 수 */
+
+typedef unsigned __int128 uint128_t;
+
+/*
+ * CPU 기능 확인, sha2_accel.c와 같이 처음 한 번만 CPUID를 읽는다
+ */
+static int features = -1;
+static int allowed = RSA_BN_ADX;
+
+int rsa_bn_features(void)
+{
+#ifdef BN_X86_64
+    unsigned int a, b, c, d;
+    int f = 0;
+
+    if (features >= 0)
+        return features & allowed;
+    // CPUID.7.0:EBX의 8번 비트가 BMI2 (mulx), 19번 비트가 ADX (adcx, adox)
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && ((b >> 8) & 1) && ((b >> 19) & 1))
+        f |= RSA_BN_ADX;
+    features = f;
+    return features & allowed;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * addmul_1_c() - r[0..n-1] += a[0..n-1] * w, returns the carry limb
+ */
+static rsa_bn_limb addmul_1_c(rsa_bn_limb *r, const rsa_bn_limb *a, int n, rsa_bn_limb w)
+{
+    rsa_bn_limb c = 0;
+    uint128_t t;
+
+    for (int i = 0; i < n; i++) {
+        t = (uint128_t)a[i] * w + r[i] + c;
+        r[i] = (rsa_bn_limb)t;
+        c = (rsa_bn_limb)(t >> 64);
+    }
+    return c;
+}
+
+#ifdef BN_X86_64
+/*
+ * addmul_1_adx() - addmul_1_c() with mulx and two independent carry chains
+ * lo + 이전 hi는 adcx (CF), 그 결과 + r[i]는 adox (OF)로 더하므로 두 덧셈이 서로 기다리지 않는다.
+ * n % 4개를 먼저 하나씩 처리한 뒤 4개씩 펼쳐서 처리하고, 반복 제어에는 플래그를 바꾸지 않는 lea와 jrcxz만 쓴다.
+ */
+static rsa_bn_limb addmul_1_adx(rsa_bn_limb *r, const rsa_bn_limb *a, int n, rsa_bn_limb w)
+{
+    rsa_bn_limb c, lo, hi;
+    size_t cnt = (size_t)n & 3;
+
+    __asm__ volatile (
+        "xor %k[c], %k[c]\n\t"
+        "jrcxz 2f\n\t"
+        "1:\n\t"
+        "mulx (%[a]), %[lo], %[hi]\n\t"
+        "adcx %[c], %[lo]\n\t"
+        "adox (%[r]), %[lo]\n\t"
+        "mov %[lo], (%[r])\n\t"
+        "mov %[hi], %[c]\n\t"
+        "lea 8(%[a]), %[a]\n\t"
+        "lea 8(%[r]), %[r]\n\t"
+        "lea -1(%[cnt]), %[cnt]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov %[q], %[cnt]\n\t"
+        "jrcxz 4f\n\t"
+        "3:\n\t"
+        "mulx (%[a]), %[lo], %[hi]\n\t"
+        "adcx %[c], %[lo]\n\t"
+        "adox (%[r]), %[lo]\n\t"
+        "mov %[lo], (%[r])\n\t"
+        "mulx 8(%[a]), %[lo], %[c]\n\t"
+        "adcx %[hi], %[lo]\n\t"
+        "adox 8(%[r]), %[lo]\n\t"
+        "mov %[lo], 8(%[r])\n\t"
+        "mulx 16(%[a]), %[lo], %[hi]\n\t"
+        "adcx %[c], %[lo]\n\t"
+        "adox 16(%[r]), %[lo]\n\t"
+        "mov %[lo], 16(%[r])\n\t"
+        "mulx 24(%[a]), %[lo], %[c]\n\t"
+        "adcx %[hi], %[lo]\n\t"
+        "adox 24(%[r]), %[lo]\n\t"
+        "mov %[lo], 24(%[r])\n\t"
+        "lea 32(%[a]), %[a]\n\t"
+        "lea 32(%[r]), %[r]\n\t"
+        "lea -1(%[cnt]), %[cnt]\n\t"
+        "jrcxz 4f\n\t"
+        "jmp 3b\n\t"
+        "4:\n\t"
+        "mov $0, %k[lo]\n\t"
+        "adcx %[lo], %[c]\n\t"
+        "adox %[lo], %[c]\n\t"
+        : [c] "=&r"(c), [lo] "=&r"(lo), [hi] "=&r"(hi), [r] "+r"(r), [a] "+r"(a), [cnt] "+c"(cnt)
+        : "d"(w), [q] "r"((size_t)n >> 2)
+        : "cc", "memory");
+    return c;
+}
+#endif
+
+static rsa_bn_limb (*addmul_1)(rsa_bn_limb *, const rsa_bn_limb *, int, rsa_bn_limb) = addmul_1_c;
+
+static void bn_select(void)
+{
+#ifdef BN_X86_64
+    addmul_1 = (rsa_bn_features() & RSA_BN_ADX) ? addmul_1_adx : addmul_1_c;
+#endif
+}
+
+__attribute__((constructor)) static void bn_select_init(void)
+{
+    bn_select();
+}
+
+/*
+ * rsa_bn_restrict() - limits the instructions in use to mask (for testing and benchmarks)
+ */
+void rsa_bn_restrict(int mask)
+{
+    allowed = mask;
+    bn_select();
+}
+
+static rsa_bn_limb bn_add_n(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, int n)
+{
+    rsa_bn_limb c = 0;
+    uint128_t t;
+
+    for (int i = 0; i < n; i++) {
+        t = (uint128_t)a[i] + b[i] + c;
+        r[i] = (rsa_bn_limb)t;
+        c = (rsa_bn_limb)(t >> 64);
+    }
+    return c;
+}
+
+static rsa_bn_limb bn_sub_n(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, int n)
+{
+    rsa_bn_limb c = 0;
+    uint128_t t;
+
+    for (int i = 0; i < n; i++) {
+        t = (uint128_t)a[i] - b[i] - c;
+        r[i] = (rsa_bn_limb)t;
+        c = (rsa_bn_limb)(t >> 64) & 1;
+    }
+    return c;
+}
+
+/*
+ * bn_cond_neg() - replaces x by its two's complement when mask is all ones
+ */
+static void bn_cond_neg(rsa_bn_limb *x, int n, rsa_bn_limb mask)
+{
+    rsa_bn_limb c = mask & 1, v;
+
+    for (int i = 0; i < n; i++) {
+        v = (x[i] ^ mask) + c;
+        c = v < c;
+        x[i] = v;
+    }
+}
+
+/*
+ * bn_absdiff() - d = |x - y|, returns all ones if x < y and 0 otherwise
+ */
+static rsa_bn_limb bn_absdiff(rsa_bn_limb *d, const rsa_bn_limb *x, const rsa_bn_limb *y, int n)
+{
+    rsa_bn_limb mask = (rsa_bn_limb)0 - bn_sub_n(d, x, y, n);
+
+    bn_cond_neg(d, n, mask);
+    return mask;
+}
+
+/*
+ * bn_mul_basecase() - r[0..2n-1] = a*b by rows of addmul_1
+ */
+static void bn_mul_basecase(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, int n)
+{
+    memset(r, 0, n * sizeof(rsa_bn_limb));
+    for (int i = 0; i < n; i++)
+        r[i + n] = addmul_1(r + i, a, n, b[i]);
+}
+
+/*
+ * bn_sqr_basecase() - r[0..2n-1] = a^2
+ * i < j인 a[i]*a[j]를 한 번씩만 구해 두 배 한 뒤 대각선 a[i]^2을 더하므로 곱셈이 절반 가까이 줄어든다.
+ */
+static void bn_sqr_basecase(rsa_bn_limb *r, const rsa_bn_limb *a, int n)
+{
+    rsa_bn_limb c = 0, hi;
+    uint128_t t;
+
+    memset(r, 0, 2 * n * sizeof(rsa_bn_limb));
+    for (int i = 0; i < n - 1; i++)
+        r[i + n] = addmul_1(r + 2*i + 1, a + i + 1, n - 1 - i, a[i]);
+    for (int i = 0; i < 2*n; i++) {
+        hi = r[i] >> 63;
+        r[i] = (r[i] << 1) | c;
+        c = hi;
+    }
+    c = 0;
+    for (int i = 0; i < n; i++) {
+        t = (uint128_t)a[i] * a[i];
+        t += (uint128_t)r[2*i] + c;
+        r[2*i] = (rsa_bn_limb)t;
+        t = (t >> 64) + r[2*i + 1];
+        r[2*i + 1] = (rsa_bn_limb)t;
+        c = (rsa_bn_limb)(t >> 64);
+    }
+}
+
+static void bn_mul(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, int n);
+static void bn_sqr(rsa_bn_limb *r, const rsa_bn_limb *a, int n);
+
+/*
+ * bn_karatsuba() - r[0..2n-1] = a*b for an even n, or a^2 if b is NULL
+ * a = a1*B^h + a0, b = b1*B^h + b0 (h = n/2)일 때 z0 = a0*b0, z2 = a1*b1이면
+ * a0*b1 + a1*b0 = z0 + z2 + (a0 - a1)(b1 - b0)이므로 h limb 곱셈 세 번으로 계산한다.
+ * 차의 부호로 분기하지 않도록 절댓값의 곱을 부호 마스크에 따라 2의 보수로 바꾸어 더한다.
+ */
+static void bn_karatsuba(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, int n)
+{
+    int h = n / 2;
+    rsa_bn_limb da[h], db[h], p[2*h + 1], mid[2*h + 1], s, c;
+
+    s = bn_absdiff(da, a, a + h, h);
+    if (b) {
+        s ^= bn_absdiff(db, b + h, b, h);
+        bn_mul(r, a, b, h);
+        bn_mul(r + n, a + h, b + h, h);
+        bn_mul(p, da, db, h);
+    } else {
+        // (a0 - a1)(a1 - a0) = -(a0 - a1)^2은 항상 0 이하
+        s = ~(rsa_bn_limb)0;
+        bn_sqr(r, a, h);
+        bn_sqr(r + n, a + h, h);
+        bn_sqr(p, da, h);
+    }
+
+    // mid = z0 + z2 ± |a0 - a1||b1 - b0|, 참값은 음수가 아니고 2h+1 limb에 들어감
+    mid[2*h] = bn_add_n(mid, r, r + n, 2*h);
+    p[2*h] = 0;
+    bn_cond_neg(p, 2*h + 1, s);
+    bn_add_n(mid, mid, p, 2*h + 1);
+
+    // r += mid * B^h, 올림은 r의 맨 위 limb을 넘지 않음
+    c = bn_add_n(r + h, r + h, mid, 2*h + 1);
+    for (int i = 3*h + 1; c && i < 2*n; i++) {
+        r[i] += c;
+        c = (r[i] == 0);
+    }
+}
+
+static void bn_mul(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, int n)
+{
+    if (n >= BN_KARATSUBA_MIN && n % 2 == 0)
+        bn_karatsuba(r, a, b, n);
+    else
+        bn_mul_basecase(r, a, b, n);
+}
+
+static void bn_sqr(rsa_bn_limb *r, const rsa_bn_limb *a, int n)
+{
+    if (n >= BN_KARATSUBA_MIN && n % 2 == 0)
+        bn_karatsuba(r, a, NULL, n);
+    else
+        bn_sqr_basecase(r, a, n);
+}
+
+/*
+ * bn_final_sub() - r = t + top*B^n reduced once by m, without branching on the values
+ * t + top*B^n < 2m이면 결과는 m보다 작다.
+ */
+static void bn_final_sub(rsa_bn_limb *r, const rsa_bn_limb *t, rsa_bn_limb top, const rsa_bn_limb *m, int n)
+{
+    rsa_bn_limb d[RSA_BN_MAX_LIMBS], borrow, mask;
+
+    borrow = bn_sub_n(d, t, m, n);
+    // top = 1이거나 빌림이 없으면 d를, 아니면 t를 고름
+    mask = (rsa_bn_limb)0 - (top | (borrow ^ 1));
+    for (int i = 0; i < n; i++)
+        r[i] = (d[i] & mask) | (t[i] & ~mask);
+}
+
+/*
+ * bn_redc() - r = t * R^-1 mod m for t < m*R (Montgomery reduction), t is destroyed
+ * 낮은 limb부터 u = t[i] * minv를 골라 u*m*B^i를 더하면 t[i]가 0이 되고, n번 뒤 위쪽 n limb이 결과이다.
+ */
+static void bn_redc(rsa_bn_limb *r, rsa_bn_limb *t, const rsa_bn_ctx *ctx)
+{
+    int n = ctx->n;
+    rsa_bn_limb c, x, top = 0;
+
+    for (int i = 0; i < n; i++) {
+        c = addmul_1(t + i, ctx->m, n, t[i] * ctx->minv);
+        x = t[i + n] + c;
+        c = (x < c);
+        t[i + n] = x + top;
+        top = c + (t[i + n] < top);
+    }
+    bn_final_sub(r, t + n, top, ctx->m, n);
+}
+
+/*
+ * rsa_bn_mont_mul() - r = a * b * R^-1 mod m for a, b < m
+ * a와 b가 같은 배열이면 제곱으로 계산한다. r은 a나 b와 같아도 된다.
+ */
+void rsa_bn_mont_mul(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, const rsa_bn_ctx *ctx)
+{
+    rsa_bn_limb t[2*RSA_BN_MAX_LIMBS];
+
+    if (a == b)
+        bn_sqr(t, a, ctx->n);
+    else
+        bn_mul(t, a, b, ctx->n);
+    bn_redc(r, t, ctx);
+}
+
+/*
+ * octet string(big-endian)과 limb 배열(낮은 limb부터) 사이의 변환
+ */
+static void bn_from_octets(rsa_bn_limb *x, const unsigned char *p, int n)
+{
+    for (int i = 0; i < n; i++) {
+        const unsigned char *q = p + 8 * (n - 1 - i);
+
+        x[i] = (rsa_bn_limb)q[0] << 56 | (rsa_bn_limb)q[1] << 48 | (rsa_bn_limb)q[2] << 40 |
+               (rsa_bn_limb)q[3] << 32 | (rsa_bn_limb)q[4] << 24 | (rsa_bn_limb)q[5] << 16 |
+               (rsa_bn_limb)q[6] << 8 | q[7];
+    }
+}
+
+static void bn_to_octets(unsigned char *p, const rsa_bn_limb *x, int n)
+{
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < 8; j++)
+            p[8 * (n - 1 - i) + j] = (unsigned char)(x[i] >> (56 - 8*j));
+}
+
+/*
+ * rsa_bn_init() - prepares the Montgomery context of a len-byte modulus m
+ * len은 256, 384, 512 중 하나이고 m은 홀수이며 맨 위 비트가 1이어야 한다.
+ * 아니면 EM_INVALID_PARAMS를 리턴하므로 호출한 쪽에서 GMP로 계산하면 된다.
+ * R mod m = R - m이고, R^2 mod m은 Montgomery 형식의 2를 64n번 거듭제곱하여 (2^(64n) * R = R^2) 구한다.
+ */
+int rsa_bn_init(rsa_bn_ctx *ctx, const void *m, size_t len)
+{
+    rsa_bn_limb one[RSA_BN_MAX_LIMBS], x[RSA_BN_MAX_LIMBS], inv, top;
+    int n = (int)(len / 8), k;
+
+    if (len != 256 && len != 384 && len != 512)
+        return EM_INVALID_PARAMS;
+    ctx->n = n;
+    bn_from_octets(ctx->m, m, n);
+    if (!(ctx->m[0] & 1) || !(ctx->m[n-1] >> 63))
+        return EM_INVALID_PARAMS;
+
+    // Newton 반복 : inv = m^-1 mod 2^3에서 시작하여 한 번에 맞는 비트 수가 두 배가 됨
+    inv = ctx->m[0];
+    for (int i = 0; i < 5; i++)
+        inv *= 2 - ctx->m[0] * inv;
+    ctx->minv = (rsa_bn_limb)0 - inv;
+
+    // one = R mod m = R - m, x = 2R mod m
+    memset(x, 0, sizeof(x));
+    bn_sub_n(one, x, ctx->m, n);
+    top = bn_add_n(x, one, one, n);
+    bn_final_sub(x, x, top, ctx->m, n);
+
+    // rr = x^(64n) (Montgomery 형식), 64n의 위 비트부터 제곱-곱셈
+    memcpy(ctx->rr, x, n * sizeof(rsa_bn_limb));
+    k = 64 * n;
+    for (int b = 30 - __builtin_clz((unsigned int)k); b >= 0; b--) {
+        rsa_bn_mont_mul(ctx->rr, ctx->rr, ctx->rr, ctx);
+        if ((k >> b) & 1)
+            rsa_bn_mont_mul(ctx->rr, ctx->rr, x, ctx);
+    }
+    return 0;
+}
+
+/*
+ * bn_window() - returns the w bits of e starting at bit position pos
+ */
+static unsigned int bn_window(const rsa_bn_limb *e, int n, int pos, int w)
+{
+    unsigned int v = 0;
+
+    for (int j = w - 1; j >= 0; j--) {
+        int b = pos + j;
+
+        v <<= 1;
+        if (b < 64 * n)
+            v |= (unsigned int)(e[b / 64] >> (b % 64)) & 1;
+    }
+    return v;
+}
+
+/*
+ * bn_lookup() - r = table[idx], reading every entry so the access pattern does not depend on idx
+ */
+static void bn_lookup(rsa_bn_limb *r, rsa_bn_limb (*table)[RSA_BN_MAX_LIMBS], int size, unsigned int idx, int n)
+{
+    rsa_bn_limb mask;
+
+    memset(r, 0, n * sizeof(rsa_bn_limb));
+    for (int i = 0; i < size; i++) {
+        mask = (rsa_bn_limb)0 - (rsa_bn_limb)(((unsigned int)i ^ idx) == 0);
+        for (int j = 0; j < n; j++)
+            r[j] |= table[i][j] & mask;
+    }
+}
+
+/*
+ * rsa_bn_powm() - computes r = a^e mod m for len-byte octet strings (len = 8 * ctx->n)
+ * 지수의 비트 길이에 따라 창 크기를 1~5로 고르고, 창 값이 0이어도 곱셈을 수행한다.
+ * 단, 32 비트 이하의 지수 (e = 65537 등)는 공개 지수로 보고 창 크기 1로 1인 비트에서만 곱한다.
+ * r은 a와 같아도 된다. 오류로 끝나도 스택에 남은 값은 모두 지운다.
+ * If a >= m then returns EM_MSG_OUT_OF_RANGE, otherwise returns 0 for success.
+ */
+int rsa_bn_powm(void *r, const void *_a, const void *_e, size_t len, const rsa_bn_ctx *ctx)
+{
+    rsa_bn_limb table[1 << BN_WINDOW_MAX][RSA_BN_MAX_LIMBS];
+    rsa_bn_limb a[RSA_BN_MAX_LIMBS], e[RSA_BN_MAX_LIMBS], x[RSA_BN_MAX_LIMBS], t[RSA_BN_MAX_LIMBS];
+    int n = ctx->n, ebits, w, size, pos, ret = 0;
+    INSTR_BEGIN(INSTR_BN_POWM);
+
+    if (len != (size_t)n * 8) {
+        ret = EM_INVALID_PARAMS;
+        goto out;
+    }
+    bn_from_octets(a, _a, n);
+    if (bn_sub_n(t, a, ctx->m, n) == 0) {
+        ret = EM_MSG_OUT_OF_RANGE;
+        goto out;
+    }
+    bn_from_octets(e, _e, n);
+    for (ebits = 64 * n; ebits > 0 && !((e[(ebits - 1) / 64] >> ((ebits - 1) % 64)) & 1); ebits--)
+        ;
+    w = (ebits > 512) ? 5 : (ebits > 128) ? 4 : (ebits > 32) ? 3 : 1;
+    size = 1 << w;
+
+    // table[i] = a^i * R mod m, table[0] = R mod m
+    memset(t, 0, sizeof(t));
+    t[0] = 1;
+    rsa_bn_mont_mul(table[0], ctx->rr, t, ctx);
+    rsa_bn_mont_mul(table[1], ctx->rr, a, ctx);
+    for (int i = 2; i < size; i++)
+        rsa_bn_mont_mul(table[i], table[i-1], table[1], ctx);
+
+    // 위쪽 창부터 w번 제곱하고 창 값의 거듭제곱을 곱함
+    pos = (ebits > 0) ? (ebits - 1) / w * w : 0;
+    bn_lookup(x, table, size, bn_window(e, n, pos, w), n);
+    for (pos -= w; pos >= 0; pos -= w) {
+        for (int j = 0; j < w; j++)
+            rsa_bn_mont_mul(x, x, x, ctx);
+        if (w == 1) {
+            // 32 비트 이하의 지수는 공개 지수로 보고 1인 비트에서만 곱함
+            if (bn_window(e, n, pos, 1))
+                rsa_bn_mont_mul(x, x, table[1], ctx);
+            continue;
+        }
+        bn_lookup(t, table, size, bn_window(e, n, pos, w), n);
+        rsa_bn_mont_mul(x, x, t, ctx);
+    }
+
+    // Montgomery 형식에서 되돌림
+    memset(t, 0, sizeof(t));
+    t[0] = 1;
+    rsa_bn_mont_mul(x, x, t, ctx);
+    bn_to_octets(r, x, n);
+
+out:
+    explicit_bzero(a, sizeof(a));
+    explicit_bzero(e, sizeof(e));
+    explicit_bzero(x, sizeof(x));
+    explicit_bzero(t, sizeof(t));
+    explicit_bzero(table, sizeof(table));
+    INSTR_END(INSTR_BN_POWM);
+    return ret;
+}
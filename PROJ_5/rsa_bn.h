@@ -0,0 +1,39 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_BN_H
+#define RSA_BN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rsa_pss.h"
+
+/*
+ * 고정 크기 Montgomery 지수승 백엔드
+ * 2048, 3072, 4096 비트 법만 다루며 모든 수를 64 비트 limb 배열로 스택에 두므로 힙 할당이 없다.
+ * limb 곱셈-덧셈은 BMI2/ADX가 있으면 mulx, adcx, adox로 두 올림 사슬을 함께 진행하고,
+ * 없으면 128 비트 정수로 계산한다. 곱셈과 제곱은 Karatsuba로 나누고, 지수승은 고정 창 방식이다.
+ * 창 표는 모든 항목을 훑어 읽으므로 지수의 비트 길이 외에는 지수에 따라 메모리 접근이 달라지지 않는다.
+ * rsa_pss.c, rsa_pss_ex.c를 -DRSA_BN_FIXED로 컴파일하면 (최상위 Makefile의 기본값) 공개 지수 연산인
+ * rsa_cipher()도 mpz_powm 대신 이 백엔드를 쓴다. rsa_cipher_blind()는 이 정의와 상관없이 이 백엔드를 쓴다.
+ */
+#define RSA_BN_MAX_LIMBS (RSA_MAX_KEYSIZE / 64)
+#define RSA_BN_ADX 0x01
+
+typedef uint64_t rsa_bn_limb;
+
+typedef struct {
+    int n;                                  /* limb 수 (32, 48, 64) */
+    rsa_bn_limb m[RSA_BN_MAX_LIMBS];        /* 법 m, 낮은 limb부터 */
+    rsa_bn_limb rr[RSA_BN_MAX_LIMBS];       /* R^2 mod m (R = 2^(64n)) */
+    rsa_bn_limb minv;                       /* -m^-1 mod 2^64 */
+} rsa_bn_ctx;
+
+int rsa_bn_features(void);
+void rsa_bn_restrict(int mask);
+int rsa_bn_init(rsa_bn_ctx *ctx, const void *m, size_t len);
+void rsa_bn_mont_mul(rsa_bn_limb *r, const rsa_bn_limb *a, const rsa_bn_limb *b, const rsa_bn_ctx *ctx);
+int rsa_bn_powm(void *r, const void *a, const void *e, size_t len, const rsa_bn_ctx *ctx);
+
+#endif
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <gmp.h>
+#include "rsa_keystore.h"
+#include "drbg.h"
+
+#include <bsd/stdlib.h>
+
+#if GMP_LIMB_BITS != 64
+#error "rsa_keystore stores 64-bit limbs"
+#endif
+#if __GNU_MP_RELEASE < 60200
+#error "rsa_keystore needs GMP 6.2 or later (mpz_clear() must skip mpz_roinit_n() values)"
+#endif
+
+/*
+ * 레코드 안의 칸 번호, 셋째 소수부터는 KS_R + 3*i에 r_i, d_i, t_i가 온다
+ */
+enum { KS_N, KS_E, KS_RR, KS_P, KS_Q, KS_DP, KS_DQ, KS_QINV, KS_A, KS_AI, KS_R };
+
+#define KS_PUBLIC_SLOTS 3
+#define KS_ROUND(x) (((x) + RSA_KS_ALIGN - 1) & ~(size_t)(RSA_KS_ALIGN - 1))
+
+static int ks_limbs(int bits)
+{
+    return (bits + 63) / 64;
+}
+
+static size_t ks_record_size(int bits, int nprimes, uint32_t flags)
+{
+    int slots = (flags & RSA_KS_PRIVATE) ? KS_R + 3 * (nprimes - 2) : KS_PUBLIC_SLOTS;
+
+    return KS_ROUND((size_t)slots * ks_limbs(bits) * sizeof(mp_limb_t));
+}
+
+static const mp_limb_t *ks_slot(const rsa_keystore *ks, const struct rsa_ks_entry *en, int slot)
+{
+    return (const mp_limb_t *)(ks->base + en->offset) + (size_t)slot * ks_limbs(en->bits);
+}
+
+/*
+ * ks_put() - stores x as nl little-endian limbs (x < 2^(64 nl))
+ */
+static void ks_put(mp_limb_t *rec, int slot, const mpz_t x, int nl)
+{
+    memset(rec + (size_t)slot * nl, 0, nl * sizeof(mp_limb_t));
+    mpz_export(rec + (size_t)slot * nl, NULL, -1, sizeof(mp_limb_t), 0, 0, x);
+}
+
+/*
+ * ks_build() - fills the index entry and the record of one key
+ * 공개키와 개인키는 rsa_public_key_import_ex(), rsa_private_key_import_mp()로 검사하면서 계산하고,
+ * 블라인딩 쌍은 임의의 r로 (r^e, r^-1)을 새로 만든다.
+ */
+static int ks_build(const rsa_ks_input *in, struct rsa_ks_entry *en, mp_limb_t *rec)
+{
+    unsigned char buf[RSA_MAX_KEYSIZE/8 + 8];
+    rsa_public_key pub;
+    rsa_private_key key;
+    rsa_bn_ctx ctx;
+    mpz_t r, a, ai;
+    int nl = ks_limbs(in->bits), ret;
+
+    if ((ret = rsa_public_key_import_ex(&pub, in->bits, in->e, in->n)) != 0) {
+        rsa_public_key_clear(&pub);
+        return ret;
+    }
+    memcpy(en->fp, pub.fp, SHASIZE/8);
+    ks_put(rec, KS_N, pub.n, nl);
+    ks_put(rec, KS_E, pub.e, nl);
+    if (rsa_bn_init(&ctx, in->n, in->bits/8) == 0) {
+        memcpy(rec + KS_RR * nl, ctx.rr, nl * sizeof(mp_limb_t));
+        en->minv = ctx.minv;
+        en->flags |= RSA_KS_MONT;
+    }
+    if (!(en->flags & RSA_KS_PRIVATE)) {
+        rsa_public_key_clear(&pub);
+        return 0;
+    }
+
+    ret = rsa_private_key_import_mp(&key, in->bits, in->nprimes, in->d, in->n, in->primes);
+    if (ret == 0) {
+        ks_put(rec, KS_P, key.p, nl);
+        ks_put(rec, KS_Q, key.q, nl);
+        ks_put(rec, KS_DP, key.dP, nl);
+        ks_put(rec, KS_DQ, key.dQ, nl);
+        ks_put(rec, KS_QINV, key.qInv, nl);
+        for (int i = 0; i < in->nprimes - 2; i++) {
+            ks_put(rec, KS_R + 3*i, key.r[i], nl);
+            ks_put(rec, KS_R + 3*i + 1, key.d[i], nl);
+            ks_put(rec, KS_R + 3*i + 2, key.t[i], nl);
+        }
+
+        mpz_inits(r, a, ai, NULL);
+        do {
+            drbg_bytes(buf, in->bits/8 + 8);
+            mpz_import(r, in->bits/8 + 8, 1, 1, 1, 0, buf);
+            mpz_mod(r, r, pub.n);
+        } while (mpz_cmp_ui(r, 1) <= 0 || mpz_invert(ai, r, pub.n) == 0);
+        mpz_powm(a, r, pub.e, pub.n);
+        ks_put(rec, KS_A, a, nl);
+        ks_put(rec, KS_AI, ai, nl);
+        mpz_clears(r, a, ai, NULL);
+        explicit_bzero(buf, sizeof(buf));
+    }
+    rsa_private_key_clear(&key);
+    rsa_public_key_clear(&pub);
+    return ret;
+}
+
+static int ks_entry_cmp(const void *x, const void *y)
+{
+    return memcmp(((const struct rsa_ks_entry *)x)->fp, ((const struct rsa_ks_entry *)y)->fp, SHASIZE/8);
+}
+
+/*
+ * rsa_keystore_write() - converts count octet-string keys into a keystore file at path
+ * 전체를 메모리에 만든 뒤 path.tmp에 쓰고 fsync()한 다음 이름을 바꾸므로, 중간에 멈춰도 기존 파일은 그대로이다.
+ * 키 크기나 소수 개수가 범위를 벗어나거나 같은 키가 두 번 있으면 EM_INVALID_PARAMS,
+ * 키가 올바르지 않으면 EM_INVALID_KEY, 파일을 쓰지 못하면 EM_FILE_ERROR를 리턴한다.
+ */
+int rsa_keystore_write(const char *path, const rsa_ks_input *keys, int count)
+{
+    struct rsa_ks_header *h;
+    struct rsa_ks_entry *index;
+    unsigned char *buf;
+    char tmp[4096];
+    size_t size, off;
+    ssize_t w;
+    int fd, ret = 0;
+
+    if (count < 0 || (size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp))
+        return EM_INVALID_PARAMS;
+    off = size = KS_ROUND(sizeof(struct rsa_ks_header) + (size_t)count * sizeof(struct rsa_ks_entry));
+    for (int i = 0; i < count; i++) {
+        const rsa_ks_input *in = keys + i;
+        int priv = (in->d != NULL && in->primes != NULL);
+
+        if (in->bits < 1024 || in->bits > RSA_MAX_KEYSIZE || in->bits % 16 != 0)
+            return EM_INVALID_PARAMS;
+        if (priv && (in->nprimes < 2 || in->nprimes > RSA_MAX_PRIMES))
+            return EM_INVALID_PARAMS;
+        size += ks_record_size(in->bits, in->nprimes, priv ? RSA_KS_PRIVATE : 0);
+    }
+    if ((buf = calloc(1, size)) == NULL)
+        return EM_FILE_ERROR;
+    h = (struct rsa_ks_header *)buf;
+    index = (struct rsa_ks_entry *)(buf + sizeof(struct rsa_ks_header));
+
+    for (int i = 0; ret == 0 && i < count; i++) {
+        const rsa_ks_input *in = keys + i;
+        struct rsa_ks_entry *en = index + i;
+
+        en->bits = in->bits;
+        en->offset = off;
+        if (in->d != NULL && in->primes != NULL) {
+            en->flags = RSA_KS_PRIVATE;
+            en->nprimes = in->nprimes;
+        }
+        ret = ks_build(in, en, (mp_limb_t *)(buf + off));
+        off += ks_record_size(en->bits, en->nprimes, en->flags);
+    }
+
+    // 지문 순으로 정렬, 같은 지문이 이웃하면 중복
+    qsort(index, count, sizeof(struct rsa_ks_entry), ks_entry_cmp);
+    for (int i = 1; ret == 0 && i < count; i++)
+        if (ks_entry_cmp(index + i - 1, index + i) == 0)
+            ret = EM_INVALID_PARAMS;
+
+    if (ret == 0) {
+        memcpy(h->magic, RSA_KS_MAGIC, sizeof(h->magic));
+        h->version = RSA_KS_VERSION;
+        h->order = RSA_KS_ORDER;
+        h->count = count;
+        h->hash = SHASIZE;
+        h->size = size;
+        rsa_pss_hash(buf + sizeof(struct rsa_ks_header), size - sizeof(struct rsa_ks_header), h->digest);
+
+        if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+            ret = EM_FILE_ERROR;
+        else {
+            for (off = 0; off < size; off += w)
+                if ((w = write(fd, buf + off, size - off)) < 0) {
+                    if (errno == EINTR) {
+                        w = 0;
+                        continue;
+                    }
+                    ret = EM_FILE_ERROR;
+                    break;
+                }
+            if (fsync(fd) < 0)
+                ret = EM_FILE_ERROR;
+            close(fd);
+            if (ret == 0 && rename(tmp, path) < 0)
+                ret = EM_FILE_ERROR;
+            if (ret != 0)
+                unlink(tmp);
+        }
+    }
+
+    explicit_bzero(buf, size);
+    free(buf);
+    return ret;
+}
+
+/*
+ * rsa_keystore_open() - maps the keystore at path read-only and checks its integrity
+ * 헤더, 해시 크기, 파일 크기, Hash(헤더 뒤 전체), 색인의 정렬과 레코드 범위를 모두 확인하며,
+ * 하나라도 맞지 않으면 EM_CORRUPT, 파일을 열거나 매핑하지 못하면 EM_FILE_ERROR를 리턴한다.
+ * 개인키가 코어 덤프에 남지 않도록 매핑에 MADV_DONTDUMP를 준다.
+ */
+int rsa_keystore_open(rsa_keystore *ks, const char *path)
+{
+    const struct rsa_ks_header *h;
+    unsigned char digest[SHASIZE/8];
+    struct stat st;
+    size_t start;
+    void *p;
+    int fd, ret = 0;
+
+    memset(ks, 0, sizeof(rsa_keystore));
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return EM_FILE_ERROR;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return EM_FILE_ERROR;
+    }
+    if ((size_t)st.st_size < sizeof(struct rsa_ks_header)) {
+        close(fd);
+        return EM_CORRUPT;
+    }
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return EM_FILE_ERROR;
+    madvise(p, st.st_size, MADV_DONTDUMP);
+    ks->base = p;
+    ks->size = st.st_size;
+
+    h = p;
+    if (memcmp(h->magic, RSA_KS_MAGIC, sizeof(h->magic)) != 0 || h->version != RSA_KS_VERSION ||
+        h->order != RSA_KS_ORDER || h->hash != SHASIZE || h->size != ks->size ||
+        h->count > (ks->size - sizeof(struct rsa_ks_header)) / sizeof(struct rsa_ks_entry))
+        ret = EM_CORRUPT;
+    else {
+        rsa_pss_hash(ks->base + sizeof(struct rsa_ks_header), ks->size - sizeof(struct rsa_ks_header), digest);
+        if (memcmp(digest, h->digest, SHASIZE/8) != 0)
+            ret = EM_CORRUPT;
+    }
+
+    if (ret == 0) {
+        ks->count = h->count;
+        ks->index = (const struct rsa_ks_entry *)(ks->base + sizeof(struct rsa_ks_header));
+        start = KS_ROUND(sizeof(struct rsa_ks_header) + (size_t)ks->count * sizeof(struct rsa_ks_entry));
+        for (int i = 0; ret == 0 && i < ks->count; i++) {
+            const struct rsa_ks_entry *en = ks->index + i;
+            int priv = en->flags & RSA_KS_PRIVATE;
+
+            if (en->bits < 1024 || en->bits > RSA_MAX_KEYSIZE || en->bits % 16 != 0 ||
+                (priv && (en->nprimes < 2 || en->nprimes > RSA_MAX_PRIMES)) ||
+                en->offset % RSA_KS_ALIGN != 0 || en->offset < start || en->offset > ks->size ||
+                ks->size - en->offset < ks_record_size(en->bits, en->nprimes, en->flags) ||
+                (i > 0 && ks_entry_cmp(en - 1, en) >= 0))
+                ret = EM_CORRUPT;
+        }
+    }
+    if (ret != 0)
+        rsa_keystore_close(ks);
+    return ret;
+}
+
+/*
+ * rsa_keystore_close() - unmaps the keystore
+ * 저장소에서 만든 키는 이 뒤로 쓸 수 없다.
+ */
+void rsa_keystore_close(rsa_keystore *ks)
+{
+    if (ks->base)
+        munmap((void *)ks->base, ks->size);
+    memset(ks, 0, sizeof(rsa_keystore));
+}
+
+/*
+ * rsa_keystore_find() - returns the index of the key whose fingerprint Hash(e || n) is fp, or -1
+ */
+int rsa_keystore_find(const rsa_keystore *ks, const unsigned char *fp)
+{
+    int lo = 0, hi = ks->count - 1, mid, c;
+
+    while (lo <= hi) {
+        mid = lo + (hi - lo) / 2;
+        c = memcmp(ks->index[mid].fp, fp, SHASIZE/8);
+        if (c == 0)
+            return mid;
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -1;
+}
+
+/*
+ * rsa_keystore_public() - makes key the i-th public key of the keystore without copying
+ * key의 n, e는 매핑된 limb를 가리키는 읽기 전용 mpz이고 지문은 색인의 것을 쓴다.
+ * rsa_public_key_clear()로 해제해도 되지만 (GMP 6.2부터 mpz_roinit_n() 값은 해제하지 않음),
+ * rsa_keystore_close() 뒤에는 쓸 수 없다. i가 범위를 벗어나면 EM_INVALID_PARAMS를 리턴한다.
+ */
+int rsa_keystore_public(const rsa_keystore *ks, int i, rsa_public_key *key)
+{
+    const struct rsa_ks_entry *en;
+    int nl;
+
+    if (i < 0 || i >= ks->count)
+        return EM_INVALID_PARAMS;
+    en = ks->index + i;
+    nl = ks_limbs(en->bits);
+    mpz_roinit_n(key->n, ks_slot(ks, en, KS_N), nl);
+    mpz_roinit_n(key->e, ks_slot(ks, en, KS_E), nl);
+    key->bits = en->bits;
+    key->f4 = (mpz_cmp_ui(key->e, 65537) == 0);
+    memcpy(key->fp, en->fp, SHASIZE/8);
+    return 0;
+}
+
+/*
+ * rsa_keystore_private() - makes key the i-th private key of the keystore without copying
+ * CRT 값은 매핑된 limb를 그대로 가리키고 블라인딩 쌍만 rsa_private_key_set_blinding()으로 복사하므로
+ * 지수승이나 역원 계산이 없다. 쌍의 무작위화는 그 키로 처음 서명할 때 이루어진다.
+ * 다 쓰면 rsa_private_key_clear()로 블라인딩 쌍을 해제하며, rsa_keystore_close() 뒤에는 쓸 수 없다.
+ * i가 범위를 벗어나면 EM_INVALID_PARAMS, 공개키만 있으면 EM_INVALID_KEY를 리턴한다.
+ */
+int rsa_keystore_private(const rsa_keystore *ks, int i, rsa_private_key *key)
+{
+    const struct rsa_ks_entry *en;
+    mpz_t a, ai;
+    int nl;
+
+    if (i < 0 || i >= ks->count)
+        return EM_INVALID_PARAMS;
+    en = ks->index + i;
+    if (!(en->flags & RSA_KS_PRIVATE))
+        return EM_INVALID_KEY;
+    nl = ks_limbs(en->bits);
+    mpz_roinit_n(key->n, ks_slot(ks, en, KS_N), nl);
+    mpz_roinit_n(key->e, ks_slot(ks, en, KS_E), nl);
+    mpz_roinit_n(key->p, ks_slot(ks, en, KS_P), nl);
+    mpz_roinit_n(key->q, ks_slot(ks, en, KS_Q), nl);
+    mpz_roinit_n(key->dP, ks_slot(ks, en, KS_DP), nl);
+    mpz_roinit_n(key->dQ, ks_slot(ks, en, KS_DQ), nl);
+    mpz_roinit_n(key->qInv, ks_slot(ks, en, KS_QINV), nl);
+    for (int j = 0; j < RSA_MAX_PRIMES - 2; j++) {
+        int sz = (j < (int)en->nprimes - 2) ? nl : 0;
+
+        mpz_roinit_n(key->r[j], ks_slot(ks, en, KS_R + 3*j), sz);
+        mpz_roinit_n(key->d[j], ks_slot(ks, en, KS_R + 3*j + 1), sz);
+        mpz_roinit_n(key->t[j], ks_slot(ks, en, KS_R + 3*j + 2), sz);
+    }
+    key->nprimes = en->nprimes;
+    key->bits = en->bits;
+    key->blind = NULL;
+
+    mpz_roinit_n(a, ks_slot(ks, en, KS_A), nl);
+    mpz_roinit_n(ai, ks_slot(ks, en, KS_AI), nl);
+    return rsa_private_key_set_blinding(key, a, ai);
+}
+
+/*
+ * rsa_keystore_mont() - copies the precomputed Montgomery context of the i-th modulus into ctx
+ * RSA_KS_MONT가 없는 키 (rsa_bn이 받지 않는 크기)이거나 i가 범위를 벗어나면 EM_INVALID_PARAMS를 리턴한다.
+ */
+int rsa_keystore_mont(const rsa_keystore *ks, int i, rsa_bn_ctx *ctx)
+{
+    const struct rsa_ks_entry *en;
+    int nl;
+
+    if (i < 0 || i >= ks->count || !(ks->index[i].flags & RSA_KS_MONT))
+        return EM_INVALID_PARAMS;
+    en = ks->index + i;
+    nl = ks_limbs(en->bits);
+    ctx->n = nl;
+    memcpy(ctx->m, ks_slot(ks, en, KS_N), nl * sizeof(rsa_bn_limb));
+    memcpy(ctx->rr, ks_slot(ks, en, KS_RR), nl * sizeof(rsa_bn_limb));
+    ctx->minv = en->minv;
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_KEYSTORE_H
+#define RSA_KEYSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rsa_pss.h"
+#include "rsa_bn.h"
+
+/*
+ * 미리 계산한 키 저장소 (mmap으로 그대로 쓰는 이진 형식)
+ * 키를 octet string으로 두면 프로세스가 시작할 때마다 CRT 값, 블라인딩 쌍, 지문, Montgomery 상수를
+ * 다시 계산해야 한다. 저장소는 이 값들을 64 비트 limb 배열로 미리 계산해 두고, 파일을 mmap한 뒤
+ * mpz_roinit_n()으로 매핑된 limb를 복사 없이 rsa_private_key, rsa_public_key의 mpz로 쓴다.
+ *
+ * 파일 구성 (호스트 바이트 순서, 모든 위치는 64 바이트 정렬)
+ *   헤더 (128 바이트) : magic, 버전, 바이트 순서 표시, 키 개수, 해시 크기, 파일 크기, 헤더 뒤 전체의 Hash
+ *   색인 (키마다 96 바이트) : 지문 Hash(e || n) 순으로 정렬되어 있어 이진 탐색으로 찾는다
+ *   레코드 (키마다) : 크기가 ceil(bits/64) limb인 칸을 n, e, R^2 mod n, p, q, dP, dQ, qInv,
+ *                     블라인딩 쌍 (r^e, r^-1), 셋째 소수부터 (r_i, d_i, t_i) 순으로 둔다
+ * 열 때 헤더 뒤 전체의 Hash를 확인하므로 잘리거나 바뀐 파일은 EM_CORRUPT로 거부된다.
+ */
+#define RSA_KS_MAGIC "RSAKSTOR"
+#define RSA_KS_VERSION 1
+#define RSA_KS_ORDER 0x01020304         /* 다른 바이트 순서의 호스트에서 만든 파일 구별 */
+#define RSA_KS_ALIGN 64
+
+#define RSA_KS_PRIVATE 0x01             /* 레코드에 개인키 값이 있음 */
+#define RSA_KS_MONT 0x02                /* R^2 mod n, minv가 있음 (rsa_bn이 받는 키 크기) */
+
+struct rsa_ks_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;
+    uint32_t count;             /* 키 개수 */
+    uint32_t hash;              /* 지문과 무결성 확인에 쓴 해시 크기 (SHASIZE) */
+    uint64_t size;              /* 파일 전체 크기 */
+    unsigned char digest[64];   /* Hash(헤더 뒤 전체), 앞 SHASIZE/8 바이트 사용 */
+    unsigned char reserved[32];
+};
+
+struct rsa_ks_entry {
+    unsigned char fp[64];       /* 지문 Hash(e || n), 앞 SHASIZE/8 바이트 사용 */
+    uint64_t offset;            /* 레코드의 파일 내 위치 */
+    uint64_t minv;              /* -n^-1 mod 2^64 (RSA_KS_MONT) */
+    uint32_t bits;
+    uint32_t nprimes;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+/*
+ * rsa_keystore - 읽기 전용으로 매핑한 저장소
+ */
+typedef struct {
+    const unsigned char *base;
+    size_t size;
+    int count;
+    const struct rsa_ks_entry *index;
+} rsa_keystore;
+
+/*
+ * rsa_ks_input - rsa_keystore_write()에 넘기는 octet string 형식의 키 하나
+ * e, d, n은 bits/8 바이트, primes는 RSA_PRIME_LEN(bits, nprimes) 바이트씩 이어 붙인 소수이다.
+ * d나 primes가 NULL이면 공개키만 저장한다.
+ */
+typedef struct {
+    int bits, nprimes;
+    const void *e, *d, *n, *primes;
+} rsa_ks_input;
+
+int rsa_keystore_write(const char *path, const rsa_ks_input *keys, int count);
+int rsa_keystore_open(rsa_keystore *ks, const char *path);
+void rsa_keystore_close(rsa_keystore *ks);
+int rsa_keystore_find(const rsa_keystore *ks, const unsigned char *fp);
+int rsa_keystore_public(const rsa_keystore *ks, int i, rsa_public_key *key);
+int rsa_keystore_private(const rsa_keystore *ks, int i, rsa_private_key *key);
+int rsa_keystore_mont(const rsa_keystore *ks, int i, rsa_bn_ctx *ctx);
+
+#endif
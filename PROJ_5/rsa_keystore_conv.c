@@ -0,0 +1,287 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * 키 저장소 변환기
+ * rsa_generate_key_mp()가 내보낸 octet string 키들을 미리 계산한 저장소 (rsa_keystore.h)로 바꾼다.
+ * 입력 파일은 키마다 e || d || n || r_1 || ... || r_k를 이어 붙인 것이며 (-p이면 e || n),
+ * e, d, n은 bits/8 바이트, 소수는 RSA_PRIME_LEN(bits, k) 바이트이다.
+ *
+ * gcc -O2 -pthread -I../PROJ_2 -I../PROJ_3 -o rsa_keystore_conv rsa_keystore_conv.c rsa_keystore.c rsa_pss.c rsa_pss_ex.c rsa_prime.c rsa_bn.c sha2_accel.c sha2.c ../PROJ_2/drbg.c ../PROJ_2/aes.c -lgmp -lbsd
+ * ./rsa_keystore_conv [-b bits] [-k 소수 개수] [-p] octet-file keystore   : 변환
+ * ./rsa_keystore_conv -g 키 개수 [-b bits] [-k 소수 개수] octet-file      : 시험용 octet 키 생성
+ * ./rsa_keystore_conv -l keystore                                         : 무결성 확인과 키 목록
+ * ./rsa_keystore_conv -t [-b bits] [-k 소수 개수] octet-file keystore     : 시작 시간 비교 (octet 가져오기와 저장소)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "rsa_keystore.h"
+#include "rsa_pss_ex.h"
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * read_file() - reads the whole file at path into a malloc'd buffer
+ */
+static unsigned char *read_file(const char *path, size_t *len)
+{
+    unsigned char *buf = NULL;
+    FILE *f;
+    long sz;
+
+    if ((f = fopen(path, "rb")) == NULL)
+        return NULL;
+    if (fseek(f, 0, SEEK_END) == 0 && (sz = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0 &&
+        (buf = malloc(sz + 1)) != NULL && fread(buf, 1, sz, f) != (size_t)sz) {
+        free(buf);
+        buf = NULL;
+    }
+    if (buf)
+        *len = sz;
+    fclose(f);
+    return buf;
+}
+
+/*
+ * parse_keys() - splits an octet file into count rsa_ks_input records
+ */
+static rsa_ks_input *parse_keys(const unsigned char *buf, size_t len, int bits, int k, int pub, int *count)
+{
+    size_t klen = bits/8, plen = RSA_PRIME_LEN(bits, k);
+    size_t rec = pub ? 2*klen : 3*klen + k*plen;
+    rsa_ks_input *in;
+
+    if (len % rec != 0 || (in = malloc((len / rec + 1) * sizeof(rsa_ks_input))) == NULL)
+        return NULL;
+    *count = len / rec;
+    for (int i = 0; i < *count; i++) {
+        const unsigned char *p = buf + i * rec;
+
+        in[i].bits = bits;
+        in[i].nprimes = k;
+        in[i].e = p;
+        if (pub) {
+            in[i].n = p + klen;
+            in[i].d = in[i].primes = NULL;
+        } else {
+            in[i].d = p + klen;
+            in[i].n = p + 2*klen;
+            in[i].primes = p + 3*klen;
+        }
+    }
+    return in;
+}
+
+static int generate(const char *path, int count, int bits, int k)
+{
+    size_t klen = bits/8, plen = RSA_PRIME_LEN(bits, k);
+    unsigned char *rec;
+    FILE *f;
+
+    if ((f = fopen(path, "wb")) == NULL || (rec = malloc(3*klen + k*plen)) == NULL) {
+        perror(path);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (rsa_generate_key_mp(bits, k, rec, rec + klen, rec + 2*klen, rec + 3*klen, 0) != 0) {
+            fprintf(stderr, "잘못된 키 크기 또는 소수 개수\n");
+            return 1;
+        }
+        fwrite(rec, 1, 3*klen + k*plen, f);
+    }
+    explicit_bzero(rec, 3*klen + k*plen);
+    free(rec);
+    fclose(f);
+    return 0;
+}
+
+static int list(const char *path)
+{
+    rsa_keystore ks;
+    int ret;
+
+    if ((ret = rsa_keystore_open(&ks, path)) != 0) {
+        fprintf(stderr, "%s: 저장소를 열 수 없음 (%d)\n", path, ret);
+        return 1;
+    }
+    printf("%d keys, %zu bytes, integrity OK\n", ks.count, ks.size);
+    for (int i = 0; i < ks.count; i++) {
+        const struct rsa_ks_entry *en = ks.index + i;
+
+        for (int j = 0; j < SHASIZE/8; j++)
+            printf("%02x", en->fp[j]);
+        printf(" %u bits, %u primes%s%s\n", en->bits, en->nprimes,
+               (en->flags & RSA_KS_PRIVATE) ? ", private" : ", public",
+               (en->flags & RSA_KS_MONT) ? ", montgomery" : "");
+    }
+    rsa_keystore_close(&ks);
+    return 0;
+}
+
+/*
+ * first_sign() - signs one message with each of the count keys and returns the elapsed time in *t
+ * 저장소의 키는 블라인딩 쌍을 첫 서명에서 무작위화하므로, 두 경로를 서명할 수 있는 상태까지 같은 기준으로 잰다.
+ * rsassa_pss_sign_key_ex()가 받지 않는 키 크기이면 0이 아닌 값을 리턴한다.
+ */
+static int first_sign(const rsa_private_key *pk, int count, double *t)
+{
+    unsigned char s[RSA_MAX_KEYSIZE/8];
+    int ret = 0;
+
+    *t = now();
+    for (int i = 0; i < count && ret == 0; i++)
+        ret = rsassa_pss_sign_key_ex(SHASIZE, "timing", 6, pk + i, s);
+    *t = now() - *t;
+    return ret;
+}
+
+/*
+ * timing() - compares preparing every key from octet strings with opening the keystore
+ * octet 가져오기는 블라인딩 쌍 (r^e, r^-1)을 그 자리에서 계산하고, 저장소는 저장된 쌍을 복사만 한 뒤
+ * 첫 서명에서 무작위화하므로 가져오기 시간만으로는 공정하지 않다. 그래서 키마다 첫 서명까지 걸린 시간도 함께 출력한다.
+ */
+static int timing(const rsa_ks_input *in, int count, const char *path)
+{
+    rsa_private_key *pk = malloc(count * sizeof(rsa_private_key));
+    rsa_public_key *pub = malloc(count * sizeof(rsa_public_key));
+    rsa_keystore ks;
+    double t, ts;
+    int ret = 0, n, sign;
+
+    if (pk == NULL || pub == NULL) {
+        free(pk);
+        free(pub);
+        return 1;
+    }
+    if ((ret = rsa_keystore_open(&ks, path)) != 0) {
+        fprintf(stderr, "%s: 저장소를 열 수 없음 (%d)\n", path, ret);
+        goto out;
+    }
+    // 배열은 octet 파일의 키 수만큼이므로 저장소가 더 많으면 비교할 수 없음
+    if (ks.count > count) {
+        fprintf(stderr, "%s: 저장소의 키 %d개가 octet 파일의 키 %d개보다 많음\n", path, ks.count, count);
+        rsa_keystore_close(&ks);
+        ret = EM_INVALID_PARAMS;
+        goto out;
+    }
+    rsa_keystore_close(&ks);
+
+    t = now();
+    for (n = 0; n < count && ret == 0; n++) {
+        if ((ret = rsa_private_key_import_mp(pk + n, in[n].bits, in[n].nprimes, in[n].d, in[n].n, in[n].primes)) != 0)
+            break;
+        if ((ret = rsa_public_key_import_ex(pub + n, in[n].bits, in[n].e, in[n].n)) != 0) {
+            rsa_private_key_clear(pk + n);
+            break;
+        }
+    }
+    t = now() - t;
+    if (ret != 0) {
+        fprintf(stderr, "octet 키 %d를 가져올 수 없음 (%d)\n", n, ret);
+        goto out;
+    }
+    sign = first_sign(pk, n, &ts);
+    printf("octet import   %4d keys %10.3f ms  (blinding pair computed at import)\n", n, t * 1e3);
+    if (sign == 0)
+        printf("  + first sign %4d keys %10.3f ms  total %10.3f ms\n", n, ts * 1e3, (t + ts) * 1e3);
+    for (int i = 0; i < n; i++) {
+        rsa_private_key_clear(pk + i);
+        rsa_public_key_clear(pub + i);
+    }
+
+    t = now();
+    if ((ret = rsa_keystore_open(&ks, path)) != 0) {
+        fprintf(stderr, "%s: 저장소를 열 수 없음 (%d)\n", path, ret);
+        goto out;
+    }
+    for (n = 0; n < ks.count; n++) {
+        if ((ret = rsa_keystore_private(&ks, n, pk + n)) != 0)
+            break;
+        if ((ret = rsa_keystore_public(&ks, n, pub + n)) != 0) {
+            rsa_private_key_clear(pk + n);
+            break;
+        }
+    }
+    t = now() - t;
+    if (ret == 0) {
+        sign = first_sign(pk, n, &ts);
+        printf("keystore open  %4d keys %10.3f ms  (stored blinding pair randomized at first sign)\n", n, t * 1e3);
+        if (sign == 0)
+            printf("  + first sign %4d keys %10.3f ms  total %10.3f ms\n", n, ts * 1e3, (t + ts) * 1e3);
+        else
+            printf("first sign not timed: rsassa_pss_sign_key_ex() does not take %d-bit keys\n", in[0].bits);
+    } else
+        fprintf(stderr, "%s: 저장소 키 %d를 가져올 수 없음 (%d)\n", path, n, ret);
+    for (int i = 0; i < n; i++) {
+        rsa_private_key_clear(pk + i);
+        rsa_public_key_clear(pub + i);
+    }
+    rsa_keystore_close(&ks);
+out:
+    free(pk);
+    free(pub);
+    return ret != 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int bits = RSAKEYSIZE, k = 2, pub = 0, gen = 0, lst = 0, tim = 0, count, ret, c;
+    unsigned char *buf;
+    rsa_ks_input *in;
+    size_t len;
+
+    while ((c = getopt(argc, argv, "b:k:pg:lt")) != -1) {
+        switch (c) {
+        case 'b': bits = atoi(optarg); break;
+        case 'k': k = atoi(optarg); break;
+        case 'p': pub = 1; break;
+        case 'g': gen = atoi(optarg); break;
+        case 'l': lst = 1; break;
+        case 't': tim = 1; break;
+        default: goto usage;
+        }
+    }
+    if (lst && optind + 1 == argc)
+        return list(argv[optind]);
+    if (gen > 0 && optind + 1 == argc)
+        return generate(argv[optind], gen, bits, k);
+    if (optind + 2 != argc || k < 2 || k > RSA_MAX_PRIMES || bits < 1024 || bits > RSA_MAX_KEYSIZE || bits % 16)
+        goto usage;
+
+    if ((buf = read_file(argv[optind], &len)) == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if ((in = parse_keys(buf, len, bits, k, pub, &count)) == NULL) {
+        fprintf(stderr, "%s: 키 크기에 맞지 않는 입력\n", argv[optind]);
+        return 1;
+    }
+    if (tim)
+        ret = pub ? 1 : timing(in, count, argv[optind + 1]);
+    else if ((ret = rsa_keystore_write(argv[optind + 1], in, count)) != 0)
+        fprintf(stderr, "%s: 변환 실패 (%d)\n", argv[optind + 1], ret);
+    else
+        printf("%d keys written to %s\n", count, argv[optind + 1]);
+
+    explicit_bzero(buf, len);
+    free(buf);
+    free(in);
+    return ret != 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-b bits] [-k primes] [-p] octet-file keystore\n"
+            "       %s -g count [-b bits] [-k primes] octet-file\n"
+            "       %s -l keystore\n"
+            "       %s -t [-b bits] [-k primes] octet-file keystore\n", argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+}
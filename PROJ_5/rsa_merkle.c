@@ -0,0 +1,353 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rsa_merkle.h"
+
+#define HLEN (SHASIZE/8)
+
+static const unsigned char leaf_prefix = 0x00, node_prefix = 0x01;
+
+/*
+ * leaf_job - 잎 해시를 나누어 계산하는 스레드들이 함께 쓰는 작업
+ * 꽉 찬 잎을 MERKLE_LANES개씩 묶어 다음 묶음 번호를 락으로 나누어 가진다.
+ */
+struct leaf_job {
+    const unsigned char *m;
+    uint64_t nfull;                 /* MERKLE_CHUNK 바이트를 꽉 채운 잎 수 */
+    uint64_t next;                  /* 다음에 가져갈 잎 번호 */
+    pthread_mutex_t lock;
+    unsigned char *out;
+};
+
+static uint64_t leaf_count(uint64_t len)
+{
+    return len == 0 ? 1 : (len + MERKLE_CHUNK - 1) / MERKLE_CHUNK;
+}
+
+static void *leaf_worker(void *arg)
+{
+    struct leaf_job *job = arg;
+    const unsigned char *pm[MERKLE_LANES];
+    unsigned char *pd[MERKLE_LANES];
+    uint64_t start;
+    int cnt;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        start = job->next;
+        job->next += MERKLE_LANES;
+        pthread_mutex_unlock(&job->lock);
+        if (start >= job->nfull)
+            break;
+        cnt = (job->nfull - start < MERKLE_LANES) ? (int)(job->nfull - start) : MERKLE_LANES;
+        for (int l = 0; l < cnt; l++) {
+            pm[l] = job->m + (size_t)(start + l) * MERKLE_CHUNK;
+            pd[l] = job->out + (size_t)(start + l) * HLEN;
+        }
+        rsa_pss_hash_mb_prefix(&leaf_prefix, 1, pm, MERKLE_CHUNK, pd, cnt);
+    }
+    return NULL;
+}
+
+/*
+ * rsa_merkle_tree_free() - frees every level of a tree built by rsa_merkle_tree_build()
+ */
+void rsa_merkle_tree_free(rsa_merkle_tree *tree)
+{
+    for (int l = 0; l < tree->levels; l++)
+        free(tree->node[l]);
+    tree->levels = 0;
+}
+
+/*
+ * rsa_merkle_tree_build() - hashes every leaf of m in parallel and builds all levels of the tree
+ * 잎 해시는 호출한 스레드를 포함한 nthreads개가 나누어 계산한다 (0 이하이면 온라인 코어 수).
+ * 스레드를 만들지 못하면 남은 스레드가 나머지를 계산한다. 내부 노드는 잎의 1/MERKLE_CHUNK 정도의
+ * 데이터이므로 한 스레드가 층마다 MERKLE_LANES개씩 멀티 버퍼 해시로 계산한다.
+ * 잎과 내부 노드의 접두어는 멀티 버퍼 해시가 붙이므로 조각이나 자식 해시를 복사하지 않는다.
+ * 메모리가 부족하면 EM_NO_MEMORY를 리턴하며, 성공하면 다 쓴 뒤 rsa_merkle_tree_free()로 풀어야 한다.
+ */
+int rsa_merkle_tree_build(const void *msg, size_t mLen, int nthreads, rsa_merkle_tree *t)
+{
+    const unsigned char *m = msg;
+    struct leaf_job job;
+    pthread_t *tid;
+    const unsigned char *pm[MERKLE_LANES];
+    unsigned char *pd[MERKLE_LANES];
+    uint64_t len = mLen, w = leaf_count(len), pairs, last;
+    int started = 0;
+
+    // 층마다 노드 공간을 잡음
+    t->len = len;
+    t->levels = 0;
+    for (;;) {
+        t->width[t->levels] = w;
+        if ((t->node[t->levels] = malloc(w * HLEN)) == NULL) {
+            rsa_merkle_tree_free(t);
+            return EM_NO_MEMORY;
+        }
+        t->levels++;
+        if (w == 1)
+            break;
+        w = (w + 1) / 2;
+    }
+
+    // 꽉 찬 잎은 스레드들이 나누어 해시하고, 짧은 마지막 잎 (또는 빈 메시지)은 따로 해시
+    job.m = m;
+    job.nfull = len / MERKLE_CHUNK;
+    job.next = 0;
+    job.out = t->node[0];
+    pthread_mutex_init(&job.lock, NULL);
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if ((uint64_t)nthreads > (job.nfull + MERKLE_LANES - 1) / MERKLE_LANES)
+        nthreads = (int)((job.nfull + MERKLE_LANES - 1) / MERKLE_LANES);
+    if (nthreads > 1 && (tid = malloc((nthreads - 1) * sizeof(pthread_t))) != NULL) {
+        for (; started < nthreads - 1; started++)
+            if (pthread_create(&tid[started], NULL, leaf_worker, &job) != 0)
+                break;
+    } else
+        tid = NULL;
+    leaf_worker(&job);
+    for (int i = 0; i < started; i++)
+        pthread_join(tid[i], NULL);
+    free(tid);
+    pthread_mutex_destroy(&job.lock);
+    if (len % MERKLE_CHUNK != 0 || len == 0) {
+        pm[0] = m + job.nfull * MERKLE_CHUNK;
+        pd[0] = t->node[0] + job.nfull * HLEN;
+        last = len - job.nfull * MERKLE_CHUNK;
+        rsa_pss_hash_mb_prefix(&leaf_prefix, 1, pm, (unsigned int)last, pd, 1);
+    }
+
+    // 내부 노드 = Hash(0x01 || 왼쪽 || 오른쪽), 왼쪽과 오른쪽은 아래 층에 붙어 있으므로 그대로 해시
+    // 짝이 없는 마지막 노드는 그대로 올림
+    for (int l = 1; l < t->levels; l++) {
+        pairs = t->width[l-1] / 2;
+        for (uint64_t i = 0; i < pairs; i += MERKLE_LANES) {
+            int cnt = (pairs - i < MERKLE_LANES) ? (int)(pairs - i) : MERKLE_LANES;
+
+            for (int k = 0; k < cnt; k++) {
+                pm[k] = t->node[l-1] + 2 * (i + k) * HLEN;
+                pd[k] = t->node[l] + (i + k) * HLEN;
+            }
+            rsa_pss_hash_mb_prefix(&node_prefix, 1, pm, 2*HLEN, pd, cnt);
+        }
+        if (t->width[l-1] % 2)
+            memcpy(t->node[l] + pairs * HLEN, t->node[l-1] + 2 * pairs * HLEN, HLEN);
+    }
+    return 0;
+}
+
+/*
+ * merkle_digest() - mHash = Hash(0x02 || len || MERKLE_CHUNK || root)
+ */
+static void merkle_digest(const unsigned char *root, uint64_t len, unsigned char *mHash)
+{
+    unsigned char buf[1 + 8 + 4 + HLEN];
+
+    buf[0] = 0x02;
+    for (int i = 0; i < 8; i++)
+        buf[1 + i] = (len >> (56 - 8*i)) & 0xff;
+    for (int i = 0; i < 4; i++)
+        buf[9 + i] = ((uint32_t)MERKLE_CHUNK >> (24 - 8*i)) & 0xff;
+    memcpy(buf + 13, root, HLEN);
+    rsa_pss_hash(buf, sizeof(buf), mHash);
+}
+
+/*
+ * rsa_merkle_tree_hash() - computes the tree-mode message hash mHash from a built tree
+ */
+void rsa_merkle_tree_hash(const rsa_merkle_tree *tree, unsigned char *mHash)
+{
+    merkle_digest(tree->node[tree->levels - 1], tree->len, mHash);
+}
+
+/*
+ * rsa_merkle_tree_proof() - copies the inclusion proof of chunk index out of a built tree
+ * 각 층에서 형제가 있으면 그 해시를 path에 넣고, 짝이 없이 올라가는 층은 건너뛴다.
+ * 해시를 다시 계산하지 않으므로 조각 수만큼 불러도 트리를 만드는 비용은 한 번이다.
+ * index가 조각 수 이상이면 EM_INVALID_PARAMS를 리턴한다.
+ */
+int rsa_merkle_tree_proof(const rsa_merkle_tree *tree, uint64_t index, rsa_merkle_proof *proof)
+{
+    uint64_t i = index;
+
+    if (index >= tree->width[0])
+        return EM_INVALID_PARAMS;
+    proof->index = index;
+    proof->len = tree->len;
+    proof->depth = 0;
+    for (int l = 0; l < tree->levels - 1; l++, i >>= 1)
+        if ((i ^ 1) < tree->width[l])
+            memcpy(proof->path[proof->depth++], tree->node[l] + (i ^ 1) * HLEN, HLEN);
+    return 0;
+}
+
+/*
+ * rsa_merkle_hash() - computes the tree-mode message hash mHash of m with nthreads threads
+ * 메모리가 부족하면 EM_NO_MEMORY, 아니면 0을 리턴한다.
+ */
+int rsa_merkle_hash(const void *m, size_t mLen, int nthreads, unsigned char *mHash)
+{
+    rsa_merkle_tree t;
+    int ret;
+
+    if ((ret = rsa_merkle_tree_build(m, mLen, nthreads, &t)) != 0)
+        return ret;
+    rsa_merkle_tree_hash(&t, mHash);
+    rsa_merkle_tree_free(&t);
+    return 0;
+}
+
+/*
+ * rsa_merkle_proof_make() - builds the inclusion proof of a single chunk index of m
+ * 트리 전체를 만들므로 증명 하나만 필요할 때 쓰고, 여럿이면 rsa_merkle_tree_proof()를 쓴다.
+ * index가 조각 수 이상이면 EM_INVALID_PARAMS, 메모리가 부족하면 EM_NO_MEMORY를 리턴한다.
+ */
+int rsa_merkle_proof_make(const void *m, size_t mLen, uint64_t index, int nthreads, rsa_merkle_proof *proof)
+{
+    rsa_merkle_tree t;
+    int ret;
+
+    if (index >= leaf_count(mLen))
+        return EM_INVALID_PARAMS;
+    if ((ret = rsa_merkle_tree_build(m, mLen, nthreads, &t)) != 0)
+        return ret;
+    ret = rsa_merkle_tree_proof(&t, index, proof);
+    rsa_merkle_tree_free(&t);
+    return ret;
+}
+
+/*
+ * rsassa_pss_sign_merkle() - signs m in tree mode with a CRT private key
+ */
+int rsassa_pss_sign_merkle(const void *m, size_t mLen, const rsa_private_key *key, int nthreads, void *s)
+{
+    unsigned char mHash[HLEN];
+    int ret;
+
+    if ((ret = rsa_merkle_hash(m, mLen, nthreads, mHash)) != 0)
+        return ret;
+    return rsassa_pss_sign_hash_domain(mHash, PSS_DOMAIN_MERKLE, key, s);
+}
+
+/*
+ * rsassa_pss_sign_merkle_tree() - signs the message of a built tree in tree mode
+ * 같은 트리로 rsa_merkle_tree_proof()를 불러 조각마다 증명을 낼 수 있다.
+ */
+int rsassa_pss_sign_merkle_tree(const rsa_merkle_tree *tree, const rsa_private_key *key, void *s)
+{
+    unsigned char mHash[HLEN];
+
+    rsa_merkle_tree_hash(tree, mHash);
+    return rsassa_pss_sign_hash_domain(mHash, PSS_DOMAIN_MERKLE, key, s);
+}
+
+/*
+ * rsassa_pss_verify_merkle() - verifies a tree-mode signature s of m, hashing with nthreads threads
+ */
+int rsassa_pss_verify_merkle(const void *m, size_t mLen, const rsa_public_key *key, int nthreads, const void *s)
+{
+    unsigned char mHash[HLEN];
+    int ret;
+
+    if ((ret = rsa_merkle_hash(m, mLen, nthreads, mHash)) != 0)
+        return ret;
+    return rsassa_pss_verify_hash_domain(mHash, PSS_DOMAIN_MERKLE, key, s);
+}
+
+/*
+ * merkle_file() - computes the tree-mode hash of the file at path through a read-only mapping
+ * 스레드들이 서로 다른 구간을 순서대로 읽으므로 MADV_SEQUENTIAL을 준다.
+ * 해시하는 도중에 파일이 줄어들면 SIGBUS가 날 수 있다.
+ */
+static int merkle_file(const char *path, int nthreads, unsigned char *mHash)
+{
+    struct stat st;
+    void *p = NULL;
+    int fd, ret;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return EM_FILE_ERROR;
+    if (fstat(fd, &st) < 0 ||
+        (st.st_size > 0 && (p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)) {
+        close(fd);
+        return EM_FILE_ERROR;
+    }
+    close(fd);
+    if (p)
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+    ret = rsa_merkle_hash(p ? p : (void *)"", st.st_size, nthreads, mHash);
+    if (p)
+        munmap(p, st.st_size);
+    return ret;
+}
+
+/*
+ * rsassa_pss_sign_merkle_file - signs the contents of the file at path in tree mode
+ */
+int rsassa_pss_sign_merkle_file(const char *path, const rsa_private_key *key, int nthreads, void *s)
+{
+    unsigned char mHash[HLEN];
+    int ret;
+
+    if ((ret = merkle_file(path, nthreads, mHash)) != 0)
+        return ret;
+    return rsassa_pss_sign_hash_domain(mHash, PSS_DOMAIN_MERKLE, key, s);
+}
+
+/*
+ * rsassa_pss_verify_merkle_file - verifies a tree-mode signature s of the file at path
+ */
+int rsassa_pss_verify_merkle_file(const char *path, const rsa_public_key *key, int nthreads, const void *s)
+{
+    unsigned char mHash[HLEN];
+    int ret;
+
+    if ((ret = merkle_file(path, nthreads, mHash)) != 0)
+        return ret;
+    return rsassa_pss_verify_hash_domain(mHash, PSS_DOMAIN_MERKLE, key, s);
+}
+
+/*
+ * rsassa_pss_verify_chunk() - verifies that chunk is part of a message signed in tree mode
+ * 잎 해시에서 시작해 proof의 형제 해시로 뿌리까지 올라간 뒤 mHash를 만들어 서명을 확인한다.
+ * 조각 번호가 범위를 벗어나거나 chunkLen이 그 조각의 길이와 다르면 EM_INVALID_PARAMS,
+ * path의 길이가 트리 모양과 맞지 않으면 EM_HASH_MISMATCH를 리턴한다.
+ */
+int rsassa_pss_verify_chunk(const void *chunk, size_t chunkLen, const rsa_merkle_proof *proof,
+                            const rsa_public_key *key, const void *s)
+{
+    unsigned char h[HLEN], msg[1 + 2*HLEN], mHash[HLEN];
+    const unsigned char *pm = chunk;
+    unsigned char *pd = h;
+    uint64_t n = leaf_count(proof->len), w = n, i = proof->index;
+    int d = 0;
+
+    if (i >= n || chunkLen != (i < n - 1 ? MERKLE_CHUNK : proof->len - (n - 1) * MERKLE_CHUNK))
+        return EM_INVALID_PARAMS;
+    rsa_pss_hash_mb_prefix(&leaf_prefix, 1, &pm, (unsigned int)chunkLen, &pd, 1);
+    for (; w > 1; i >>= 1, w = (w + 1) / 2) {
+        if ((i ^ 1) >= w)
+            continue;
+        if (d >= proof->depth)
+            return EM_HASH_MISMATCH;
+        msg[0] = node_prefix;
+        memcpy(msg + 1 + ((i & 1) ? HLEN : 0), h, HLEN);
+        memcpy(msg + 1 + ((i & 1) ? 0 : HLEN), proof->path[d++], HLEN);
+        rsa_pss_hash(msg, sizeof(msg), h);
+    }
+    if (d != proof->depth)
+        return EM_HASH_MISMATCH;
+    merkle_digest(h, proof->len, mHash);
+    return rsassa_pss_verify_hash_domain(mHash, PSS_DOMAIN_MERKLE, key, s);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_MERKLE_H
+#define RSA_MERKLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rsa_pss.h"
+
+/*
+ * Merkle 트리 해시 서명 모드
+ * 메시지 전체를 하나의 해시로 이어서 계산하면 코어 하나의 속도에 묶이므로, 메시지를 MERKLE_CHUNK
+ * 바이트 조각으로 나누어 잎 Hash(0x00 || 조각)을 여러 스레드가 멀티 버퍼 해시로 계산하고,
+ * 내부 노드는 Hash(0x01 || 왼쪽 || 오른쪽)로 한 층씩 올린다. 접두어가 달라 잎과 내부 노드는 서로 바꿔 쓸 수 없다. 짝이 없는 마지막 노드는 그대로 올라간다.
+ * PSS 인코딩에 넣는 mHash는 Hash(0x02 || 길이 (8 바이트) || MERKLE_CHUNK (4 바이트) || 뿌리)이다.
+ * 길이로 트리 모양이 정해지므로 내부 노드를 잎으로 바꿔 끼울 수 없다.
+ * 조각 하나는 형제 해시의 목록 (rsa_merkle_proof)만으로 서명에 포함되었는지 확인할 수 있다.
+ * 서명하면서 여러 조각의 증명을 내려면 rsa_merkle_tree_build()로 트리를 한 번만 만들어 함께 쓴다.
+ * 이 mHash는 45 바이트 메시지의 일반 PSS 해시와 같은 꼴이므로, 서명과 검증은 PSS_DOMAIN_MERKLE 영역
+ * (M'의 padding1 마지막 바이트 0x02)에서 한다. 따라서 같은 키의 일반 서명과 트리 서명은 서로 검증되지 않는다.
+ */
+#define MERKLE_CHUNK (1 << 20)      /* 잎 하나의 바이트 수 */
+#define MERKLE_LANES 8              /* 스레드가 한 번에 가져가는 잎 수, 멀티 버퍼 해시의 레인 수 */
+#define MERKLE_MAX_DEPTH 64         /* 트리 높이의 최댓값 (잎 2^64개) */
+
+/*
+ * rsa_merkle_proof - 조각 하나의 포함 증명
+ */
+typedef struct {
+    uint64_t index;                 /* 조각 번호 */
+    uint64_t len;                   /* 전체 메시지 길이 */
+    int depth;                      /* path의 항목 수 */
+    unsigned char path[MERKLE_MAX_DEPTH][SHASIZE/8];    /* 잎에서 뿌리 쪽으로 형제 노드의 해시 */
+} rsa_merkle_proof;
+
+/*
+ * rsa_merkle_tree - 모든 층의 노드 해시, node[0]이 잎 층이고 node[levels-1]이 뿌리 하나이다
+ */
+typedef struct {
+    uint64_t len;                   /* 전체 메시지 길이 */
+    int levels;                     /* 층 수, 잎 하나이면 1 */
+    uint64_t width[MERKLE_MAX_DEPTH + 1];
+    unsigned char *node[MERKLE_MAX_DEPTH + 1];
+} rsa_merkle_tree;
+
+int rsa_merkle_tree_build(const void *m, size_t mLen, int nthreads, rsa_merkle_tree *tree);
+void rsa_merkle_tree_hash(const rsa_merkle_tree *tree, unsigned char *mHash);
+int rsa_merkle_tree_proof(const rsa_merkle_tree *tree, uint64_t index, rsa_merkle_proof *proof);
+void rsa_merkle_tree_free(rsa_merkle_tree *tree);
+int rsa_merkle_hash(const void *m, size_t mLen, int nthreads, unsigned char *mHash);
+int rsa_merkle_proof_make(const void *m, size_t mLen, uint64_t index, int nthreads, rsa_merkle_proof *proof);
+int rsassa_pss_sign_merkle(const void *m, size_t mLen, const rsa_private_key *key, int nthreads, void *s);
+int rsassa_pss_sign_merkle_tree(const rsa_merkle_tree *tree, const rsa_private_key *key, void *s);
+int rsassa_pss_verify_merkle(const void *m, size_t mLen, const rsa_public_key *key, int nthreads, const void *s);
+int rsassa_pss_sign_merkle_file(const char *path, const rsa_private_key *key, int nthreads, void *s);
+int rsassa_pss_verify_merkle_file(const char *path, const rsa_public_key *key, int nthreads, const void *s);
+int rsassa_pss_verify_chunk(const void *chunk, size_t chunkLen, const rsa_merkle_proof *proof,
+                            const rsa_public_key *key, const void *s);
+
+#endif
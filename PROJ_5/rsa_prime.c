@@ -0,0 +1,305 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "rsa_prime.h"
+#include "instr.h"
+#include "drbg.h"
+
+/*
+ * 작은 홀수 소수 표, 처음 사용할 때 한 번만 에라토스테네스의 체로 만든다.
+ */
+static unsigned int small_prime[PRIME_SIEVE_SIZE];
+static pthread_once_t small_prime_once = PTHREAD_ONCE_INIT;
+
+static void small_prime_init(void)
+{
+    static unsigned char composite[20000];
+    int k = 0;
+
+    for (unsigned int i = 3; k < PRIME_SIEVE_SIZE; i += 2) {
+        if (composite[i])
+            continue;
+        small_prime[k++] = i;
+        for (unsigned int j = i * i; j < sizeof(composite); j += 2 * i)
+            composite[j] = 1;
+    }
+}
+
+/*
+ * random_below() - sets a to a random number in [2, n-2]
+ */
+static void random_below(mpz_t a, const mpz_t n)
+{
+    size_t len = (mpz_sizeinbase(n, 2) + 7) / 8 + 8;
+    unsigned char buf[len];
+    mpz_t m;
+
+    // n보다 64 비트 더 긴 난수를 줄이므로 치우침은 무시할 수 있음
+    drbg_bytes(buf, len);
+    mpz_import(a, len, 1, 1, 1, 0, buf);
+    mpz_init(m);
+    mpz_sub_ui(m, n, 3);
+    mpz_mod(a, a, m);
+    mpz_add_ui(a, a, 2);
+    mpz_clear(m);
+}
+
+/*
+ * miller_rabin_base() - strong probable prime test of an odd n > 3 to base a
+ * n-1 = d*2^s로 두고 a^d = 1 또는 a^(d*2^r) = -1 (0 <= r < s)이면 1을 리턴한다.
+ */
+static int miller_rabin_base(const mpz_t n, const mpz_t a)
+{
+    mpz_t d, x, n1;
+    mp_bitcnt_t s;
+    int ret = 0;
+
+    mpz_inits(d, x, n1, NULL);
+    mpz_sub_ui(n1, n, 1);
+    s = mpz_scan1(n1, 0);
+    mpz_tdiv_q_2exp(d, n1, s);
+
+    mpz_powm(x, a, d, n);
+    if (mpz_cmp_ui(x, 1) == 0 || mpz_cmp(x, n1) == 0)
+        ret = 1;
+    for (mp_bitcnt_t r = 1; !ret && r < s; r++) {
+        mpz_powm_ui(x, x, 2, n);
+        if (mpz_cmp(x, n1) == 0)
+            ret = 1;
+        else if (mpz_cmp_ui(x, 1) == 0)
+            break;
+    }
+
+    mpz_clears(d, x, n1, NULL);
+    return ret;
+}
+
+/*
+ * half_mod() - computes x/2 mod n for an odd n and 0 <= x < n
+ */
+static void half_mod(mpz_t x, const mpz_t n)
+{
+    if (mpz_odd_p(x))
+        mpz_add(x, x, n);
+    mpz_tdiv_q_2exp(x, x, 1);
+}
+
+/*
+ * strong_lucas() - strong Lucas probable prime test of an odd n > 3 (Selfridge method A)
+ * 5, -7, 9, -11, ... 중 Jacobi(D/n) = -1인 첫 D를 고르고 P = 1, Q = (1-D)/4로 둔다.
+ * n+1 = d*2^s일 때 U_d = 0 또는 V_(d*2^r) = 0 (0 <= r < s)이면 1을 리턴한다.
+ * 제곱수에는 그런 D가 없으므로 먼저 걸러낸다.
+ */
+static int strong_lucas(const mpz_t n)
+{
+    mpz_t D, Q, d, U, V, Qk, t;
+    mp_bitcnt_t s;
+    long dd = 5;
+    int j, ret = 0;
+
+    if (mpz_perfect_square_p(n))
+        return 0;
+
+    mpz_inits(D, Q, d, U, V, Qk, t, NULL);
+    while (1) {
+        mpz_set_si(D, dd);
+        j = mpz_jacobi(D, n);
+        if (j == -1)
+            break;
+        // D가 n의 약수이면 합성수 (n이 |D|인 경우는 작은 소수이므로 여기까지 오지 않음)
+        if (j == 0 && mpz_cmpabs_ui(n, labs(dd)) != 0)
+            goto out;
+        dd = (dd > 0) ? -(dd + 2) : -dd + 2;
+    }
+    mpz_set_si(Q, (1 - dd) / 4);
+    mpz_mod(Q, Q, n);
+
+    mpz_add_ui(d, n, 1);
+    s = mpz_scan1(d, 0);
+    mpz_tdiv_q_2exp(d, d, s);
+
+    // U_1 = 1, V_1 = P = 1, Qk = Q^1에서 시작하여 d의 상위 비트부터 두 배 및 하나 더하기
+    mpz_set_ui(U, 1);
+    mpz_set_ui(V, 1);
+    mpz_set(Qk, Q);
+    for (long i = (long)mpz_sizeinbase(d, 2) - 2; i >= 0; i--) {
+        // U_2k = U_k*V_k, V_2k = V_k^2 - 2Q^k
+        mpz_mul(U, U, V);
+        mpz_mod(U, U, n);
+        mpz_mul(V, V, V);
+        mpz_submul_ui(V, Qk, 2);
+        mpz_mod(V, V, n);
+        mpz_mul(Qk, Qk, Qk);
+        mpz_mod(Qk, Qk, n);
+        if (mpz_tstbit(d, i)) {
+            // U_k+1 = (P*U_k + V_k)/2, V_k+1 = (D*U_k + P*V_k)/2
+            mpz_mul(t, D, U);
+            mpz_add(U, U, V);
+            mpz_mod(U, U, n);
+            half_mod(U, n);
+            mpz_add(V, V, t);
+            mpz_mod(V, V, n);
+            half_mod(V, n);
+            mpz_mul(Qk, Qk, Q);
+            mpz_mod(Qk, Qk, n);
+        }
+    }
+
+    if (mpz_sgn(U) == 0 || mpz_sgn(V) == 0)
+        ret = 1;
+    for (mp_bitcnt_t r = 1; !ret && r < s; r++) {
+        mpz_mul(V, V, V);
+        mpz_submul_ui(V, Qk, 2);
+        mpz_mod(V, V, n);
+        if (mpz_sgn(V) == 0)
+            ret = 1;
+        mpz_mul(Qk, Qk, Qk);
+        mpz_mod(Qk, Qk, n);
+    }
+out:
+    mpz_clears(D, Q, d, U, V, Qk, t, NULL);
+    return ret;
+}
+
+/*
+ * bpsw() - Miller-Rabin rounds followed by a strong Lucas test for an odd n with no small factor
+ * 밑 2를 포함한 PRIME_MR_ROUNDS번의 Miller-Rabin과 strong Lucas 검사를 수행한다.
+ * 밑 2 검사와 Lucas 검사를 합친 것이 BPSW이며, 이를 통과하는 합성수는 아직 알려진 것이 없다.
+ */
+static int bpsw(const mpz_t n)
+{
+    mpz_t a;
+    int ret = 1;
+    INSTR_BEGIN(INSTR_PRIME_TEST);
+
+    mpz_init_set_ui(a, 2);
+    for (int i = 0; ret && i < PRIME_MR_ROUNDS; i++) {
+        if (i > 0)
+            random_below(a, n);
+        ret = miller_rabin_base(n, a);
+    }
+    mpz_clear(a);
+
+    ret = ret && strong_lucas(n);
+    INSTR_END(INSTR_PRIME_TEST);
+    if (!ret)
+        INSTR_ADD(INSTR_PRIME_REJECT, 1);
+    return ret;
+}
+
+/*
+ * rsa_probable_prime() - returns 1 if n is a probable prime, 0 otherwise
+ * 작은 소수로 나누어 본 뒤 bpsw()로 검사한다.
+ */
+int rsa_probable_prime(const mpz_t n)
+{
+    pthread_once(&small_prime_once, small_prime_init);
+    if (mpz_cmp_ui(n, 2) < 0)
+        return 0;
+    if (mpz_even_p(n))
+        return mpz_cmp_ui(n, 2) == 0;
+    for (int i = 0; i < PRIME_SIEVE_SIZE; i++) {
+        if (mpz_cmp_ui(n, small_prime[i]) == 0)
+            return 1;
+        if (mpz_divisible_ui_p(n, small_prime[i]))
+            return 0;
+    }
+    return bpsw(n);
+}
+
+/*
+ * rsa_random_prime() - generates a random bits-bit prime whose top two bits are set
+ * 상위 두 비트를 세우면 같은 크기의 두 소수의 곱은 항상 2*bits 비트가 된다.
+ * 임의의 홀수 시작점 x에 대해 r[i] = x mod small_prime[i]를 한 번만 구하고,
+ * 후보 x + 2j가 작은 소수로 나누어지는 j를 체로 지운 뒤 남은 후보만 확률적 검사를 한다.
+ * 창 안에 소수가 없으면 창만큼 건너뛰어 다시 거르고, bits를 넘어가면 새로 뽑는다.
+ */
+void rsa_random_prime(mpz_t p, unsigned int bits)
+{
+    unsigned char buf[(bits + 7) / 8];
+    unsigned char sieve[PRIME_SIEVE_WINDOW];
+    unsigned int r[PRIME_SIEVE_SIZE];
+    mpz_t x, a;
+
+    pthread_once(&small_prime_once, small_prime_init);
+    mpz_inits(x, a, NULL);
+    while (1) {
+        drbg_bytes(buf, sizeof(buf));
+        mpz_import(x, sizeof(buf), 1, 1, 1, 0, buf);
+        mpz_fdiv_r_2exp(x, x, bits);
+        mpz_setbit(x, bits - 1);
+        mpz_setbit(x, bits - 2);
+        mpz_setbit(x, 0);
+
+        for (int i = 0; i < PRIME_SIEVE_SIZE; i++)
+            r[i] = mpz_fdiv_ui(x, small_prime[i]);
+
+        while (mpz_sizeinbase(x, 2) == bits) {
+            memset(sieve, 0, sizeof(sieve));
+            for (int i = 0; i < PRIME_SIEVE_SIZE; i++) {
+                unsigned int pr = small_prime[i];
+                // x + 2j = 0 (mod pr)인 첫 j = -r/2 mod pr
+                unsigned int j = r[i] ? (unsigned int)(((unsigned long)(pr - r[i]) * ((pr + 1) / 2)) % pr) : 0;
+
+                for (; j < PRIME_SIEVE_WINDOW; j += pr)
+                    sieve[j] = 1;
+            }
+            for (int j = 0; j < PRIME_SIEVE_WINDOW; j++) {
+                if (sieve[j])
+                    continue;
+                mpz_add_ui(a, x, 2 * (unsigned long)j);
+                if (mpz_sizeinbase(a, 2) != bits)
+                    break;
+                // 체를 통과한 후보는 작은 소수의 배수가 아니므로 바로 bpsw()로 검사
+                if (bpsw(a)) {
+                    mpz_set(p, a);
+                    mpz_clears(x, a, NULL);
+                    return;
+                }
+            }
+            mpz_add_ui(x, x, 2 * PRIME_SIEVE_WINDOW);
+            for (int i = 0; i < PRIME_SIEVE_SIZE; i++)
+                r[i] = (unsigned int)((r[i] + 2UL * PRIME_SIEVE_WINDOW) % small_prime[i]);
+        }
+    }
+}
+
+struct prime_job {
+    mpz_ptr p;
+    unsigned int bits;
+};
+
+static void *prime_worker(void *arg)
+{
+    struct prime_job *job = arg;
+
+    rsa_random_prime(job->p, job->bits);
+    return NULL;
+}
+
+/*
+ * rsa_random_prime_pair() - generates two distinct bits-bit primes p and q in parallel
+ * p는 새 스레드에서, q는 호출한 스레드에서 찾는다. 온라인 코어가 하나뿐이면 두 스레드가 번갈아 돌 뿐
+ * 스레드 생성과 전환 비용만 늘어나므로, 그때와 스레드를 만들 수 없을 때는 차례로 찾는다.
+ */
+void rsa_random_prime_pair(mpz_t p, mpz_t q, unsigned int bits)
+{
+    struct prime_job job = { p, bits };
+    pthread_t tid;
+    int parallel = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+
+    do {
+        if (parallel && pthread_create(&tid, NULL, prime_worker, &job) == 0) {
+            rsa_random_prime(q, bits);
+            pthread_join(tid, NULL);
+        } else {
+            rsa_random_prime(p, bits);
+            rsa_random_prime(q, bits);
+        }
+    } while (mpz_cmp(p, q) == 0);
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_PRIME_H
+#define RSA_PRIME_H
+
+#include <gmp.h>
+
+#define PRIME_SIEVE_SIZE 2048       /* 체에 쓰는 작은 홀수 소수의 개수 (3 ~ 17863) */
+#define PRIME_SIEVE_WINDOW 4096     /* 한 번에 체로 거르는 홀수 후보의 수 */
+#define PRIME_MR_ROUNDS 2           /* Lucas 검사 전에 수행하는 Miller-Rabin 횟수 (첫 번째는 밑 2) */
+
+int rsa_probable_prime(const mpz_t n);
+void rsa_random_prime(mpz_t p, unsigned int bits);
+void rsa_random_prime_pair(mpz_t p, mpz_t q, unsigned int bits);
+
+#endif
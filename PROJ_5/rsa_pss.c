@@ -4,8 +4,17 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <gmp.h>
+#include <pthread.h>
 #include "rsa_pss.h"
+#include "sha2_accel.h"
+#include "rsa_prime.h"
+#include "rsa_bn.h"
+#include "instr.h"
+#include "drbg.h"
 #include <stdint.h>
 
 #include <bsd/stdlib.h>
@@ -20,6 +29,56 @@ void (*sha)(const unsigned char *, unsigned int, unsigned char *) = sha384;
 void (*sha)(const unsigned char *, unsigned int, unsigned char *) = sha512;
 #endif
 
+/*
+ * 해시 문맥 API, mgf와 스트림 서명에서 해시 상태를 이어서 사용할 때 쓴다.
+ */
+#if defined(SHA224)
+#define hash_init sha224_init
+#define hash_update sha224_update
+#define hash_final sha224_final
+#define hash_mb sha224_mb
+#define hash_mb_prefix sha224_mb_prefix
+#elif defined(SHA256)
+#define hash_init sha256_init
+#define hash_update sha256_update
+#define hash_final sha256_final
+#define hash_mb sha256_mb
+#define hash_mb_prefix sha256_mb_prefix
+#elif defined(SHA384)
+#define hash_init sha384_init
+#define hash_update sha384_update
+#define hash_final sha384_final
+#define hash_mb sha384_mb
+#define hash_mb_prefix sha384_mb_prefix
+#else
+#define hash_init sha512_init
+#define hash_update sha512_update
+#define hash_final sha512_final
+#define hash_mb sha512_mb
+#define hash_mb_prefix sha512_mb_prefix
+#endif
+
+/*
+ * sha_select() - switches sha to the SHA extensions version when the CPU supports it
+ * main() 이전에 한 번 실행되며, SHA-384/512는 SHA extensions이 없으므로 sha2.c를 그대로 쓴다.
+ */
+__attribute__((constructor))
+static void sha_select(void)
+{
+    if (!(sha2_accel_features() & SHA2_SHANI))
+        return;
+#if defined(SHA224)
+    sha = sha224_ni;
+#elif defined(SHA256)
+    sha = sha256_ni;
+#endif
+}
+
+/*
+ * MGF1은 카운터만 다른 같은 길이의 메시지를 여러 개 해시하므로 멀티 버퍼 해시로 묶어서 계산한다.
+ */
+#define MGF_LANES 8
+
 /*
  * Copyright 2020, 2021. Heekuck Oh, all rights reserved
  * rsa_generate_key() - generates RSA keys e, d and n in octet strings.
@@ -28,64 +87,169 @@ void (*sha)(const unsigned char *, unsigned int, unsigned char *) = sha512;
  */
 void rsa_generate_key(void *_e, void *_d, void *_n, int mode)
 {
-    mpz_t p, q, lambda, e, d, n, gcd;
+    rsa_generate_key_crt(_e, _d, _n, NULL, NULL, mode);
+}
+
+/*
+ * rsa_generate_key_crt() - generates RSA keys e, d, n and the primes p, q in octet strings.
+ * p와 q는 각각 RSAKEYSIZE/16 바이트이며, NULL이면 내보내지 않는다.
+ * rsa_private_key_import()에 넘겨 CRT 서명용 개인키를 만들 수 있다.
+ */
+void rsa_generate_key_crt(void *_e, void *_d, void *_n, void *_p, void *_q, int mode)
+{
+    rsa_generate_key_ex(RSAKEYSIZE, _e, _d, _n, _p, _q, mode);
+}
+
+/*
+ * generate_primes() - generates k distinct primes r[0..k-1] whose product n has exactly bits bits
+ * 앞의 bits % k개 소수는 한 비트 더 길게 하고, 크기가 같은 두 소수는 rsa_random_prime_pair()로 함께 찾는다.
+ * e = 65537이면 (mode = 0) r_i - 1이 e의 배수가 아니어야 한다.
+ */
+static void generate_primes(mpz_t *r, int k, int bits, mpz_t n, int mode)
+{
+    unsigned int b[RSA_MAX_PRIMES];
+    int i, j, ok;
+
+    for (i = 0; i < k; i++)
+        b[i] = bits / k + (i < bits % k);
+    do {
+        for (i = 0; i < k; i++) {
+            if (i + 1 < k && b[i] == b[i+1]) {
+                rsa_random_prime_pair(r[i], r[i+1], b[i]);
+                i++;
+            } else {
+                rsa_random_prime(r[i], b[i]);
+            }
+        }
+        mpz_set(n, r[0]);
+        for (i = 1; i < k; i++)
+            mpz_mul(n, n, r[i]);
+        ok = mpz_tstbit(n, bits-1);
+        for (i = 0; ok && i < k; i++) {
+            if (mode == 0 && mpz_fdiv_ui(r[i], 65537) == 1)
+                ok = 0;
+            for (j = 0; ok && j < i; j++)
+                if (mpz_cmp(r[i], r[j]) == 0)
+                    ok = 0;
+        }
+    } while (!ok);
+}
+
+/*
+ * generate_key() - generates a bits-bit key with k primes r[0..k-1] and exports e, d and n
+ */
+static void generate_key(int bits, int k, mpz_t *r, void *_e, void *_d, void *_n, int mode)
+{
+    mpz_t lambda, e, d, n, gcd, t;
     gmp_randstate_t state;
-    
+    unsigned char seed[32];
+    INSTR_BEGIN(INSTR_RSA_KEYGEN);
+
     /*
      * Initialize mpz variables
      */
-    mpz_inits(p, q, lambda, e, d, n, gcd, NULL);
+    mpz_inits(lambda, e, d, n, gcd, t, NULL);
     gmp_randinit_default(state);
-    gmp_randseed_ui(state, arc4random());
+    // 32 비트가 아닌 256 비트 시드로 e 선택용 GMP 난수 생성기를 초기화
+    drbg_bytes(seed, sizeof(seed));
+    mpz_import(t, sizeof(seed), 1, 1, 1, 0, seed);
+    gmp_randseed(state, t);
+    explicit_bzero(seed, sizeof(seed));
     /*
-     * Generate prime p and q such that 2^(RSAKEYSIZE-1) <= p*q < 2^RSAKEYSIZE
+     * Generate primes r_1, ..., r_k such that 2^(bits-1) <= n = r_1*...*r_k < 2^bits
+     * 소수는 체와 BPSW 검사로 찾으며, 두 개씩 두 스레드에서 찾는다.
      */
-    do {
-        do {
-            mpz_urandomb(p, state, RSAKEYSIZE/2);
-            mpz_setbit(p, 0);
-            mpz_setbit(p, RSAKEYSIZE/2-1);
-       } while (mpz_probab_prime_p(p, 50) == 0);
-        do {
-            mpz_urandomb(q, state, RSAKEYSIZE/2);
-            mpz_setbit(q, 0);
-            mpz_setbit(q, RSAKEYSIZE/2-1);
-        } while (mpz_probab_prime_p(q, 50) == 0);
-        mpz_mul(n, p, q);
-    } while (!mpz_tstbit(n, RSAKEYSIZE-1));
+    generate_primes(r, k, bits, n, mode);
     /*
-     * Generate e and d using Lambda(n)
+     * Generate e and d using Lambda(n) = lcm(r_1 - 1, ..., r_k - 1)
      */
-    mpz_sub_ui(p, p, 1);
-    mpz_sub_ui(q, q, 1);
-    mpz_lcm(lambda, p, q);
+    mpz_set_ui(lambda, 1);
+    for (int i = 0; i < k; i++) {
+        mpz_sub_ui(t, r[i], 1);
+        mpz_lcm(lambda, lambda, t);
+    }
     if (mode == 0)
         mpz_set_ui(e, 65537);
     else do {
-        mpz_urandomb(e, state, RSAKEYSIZE);
+        mpz_urandomb(e, state, bits);
         mpz_gcd(gcd, e, lambda);
     } while (mpz_cmp(e, lambda) >= 0 || mpz_cmp_ui(gcd, 1) != 0);
     mpz_invert(d, e, lambda);
     /*
      * Convert mpz_t values into octet strings
      */
-    mpz_export(_e, NULL, 1, RSAKEYSIZE/8, 1, 0, e);
-    mpz_export(_d, NULL, 1, RSAKEYSIZE/8, 1, 0, d);
-    mpz_export(_n, NULL, 1, RSAKEYSIZE/8, 1, 0, n);
+    mpz_export(_e, NULL, 1, bits/8, 1, 0, e);
+    mpz_export(_d, NULL, 1, bits/8, 1, 0, d);
+    mpz_export(_n, NULL, 1, bits/8, 1, 0, n);
     /*
      * Free the space occupied by mpz variables
      */
-    mpz_clears(p, q, lambda, e, d, n, gcd, NULL);
+    mpz_clears(lambda, e, d, n, gcd, t, NULL);
+    gmp_randclear(state);
+    INSTR_END(INSTR_RSA_KEYGEN);
+}
+
+/*
+ * rsa_generate_key_ex() - generates a bits-bit RSA key chosen at run time
+ * e, d, n은 bits/8 바이트, p와 q는 bits/16 바이트이다.
+ * bits는 16의 배수이고 1024 이상 RSA_MAX_KEYSIZE 이하여야 하며, 아니면 EM_INVALID_PARAMS를 리턴한다.
+ */
+int rsa_generate_key_ex(int bits, void *_e, void *_d, void *_n, void *_p, void *_q, int mode)
+{
+    mpz_t r[2];
+
+    if (bits < 1024 || bits > RSA_MAX_KEYSIZE || bits % 16 != 0)
+        return EM_INVALID_PARAMS;
+    mpz_inits(r[0], r[1], NULL);
+    generate_key(bits, 2, r, _e, _d, _n, mode);
+    if (_p != NULL)
+        mpz_export(_p, NULL, 1, bits/16, 1, 0, r[0]);
+    if (_q != NULL)
+        mpz_export(_q, NULL, 1, bits/16, 1, 0, r[1]);
+    mpz_clears(r[0], r[1], NULL);
+    return 0;
+}
+
+/*
+ * rsa_generate_key_mp() - generates a bits-bit multi-prime RSA key with nprimes primes
+ * primes에는 r_1, ..., r_nprimes를 차례로 RSA_PRIME_LEN(bits, nprimes) 바이트씩 내보낸다.
+ * 소수가 3개이면 CRT 지수승 하나가 n의 약 1/3 크기에서 이루어지므로 두 소수보다 서명이 빠르다.
+ * nprimes는 2 이상 RSA_MAX_PRIMES 이하여야 하며, bits 조건은 rsa_generate_key_ex()와 같다.
+ */
+int rsa_generate_key_mp(int bits, int nprimes, void *_e, void *_d, void *_n, void *_primes, int mode)
+{
+    unsigned char *primes = _primes;
+    size_t plen = RSA_PRIME_LEN(bits, nprimes);
+    mpz_t r[RSA_MAX_PRIMES];
+
+    if (bits < 1024 || bits > RSA_MAX_KEYSIZE || bits % 16 != 0 || nprimes < 2 || nprimes > RSA_MAX_PRIMES)
+        return EM_INVALID_PARAMS;
+    for (int i = 0; i < nprimes; i++)
+        mpz_init(r[i]);
+    generate_key(bits, nprimes, r, _e, _d, _n, mode);
+    for (int i = 0; i < nprimes; i++) {
+        mpz_export(primes + i * plen, NULL, 1, plen, 1, 0, r[i]);
+        mpz_clear(r[i]);
+    }
+    return 0;
 }
 
 /*
  * Copyright 2020. Heekuck Oh, all rights reserved
  * rsa_cipher() - compute m^k mod n
+ * 공개 지수로 검증할 때만 쓰며, 개인키 지수 d로 서명할 때는 블라인딩하는 rsa_cipher_blind()를 쓴다.
  * If m >= n then returns EM_MSG_OUT_OF_RANGE, otherwise returns 0 for success.
  */
 static int rsa_cipher(void *_m, const void *_k, const void *_n)
 {
     mpz_t m, k, n;
+#ifdef RSA_BN_FIXED
+    rsa_bn_ctx ctx;
+
+    // 2048, 3072, 4096 비트 법이면 고정 크기 백엔드로 계산하고, 아니면 GMP로 넘어감
+    if (rsa_bn_init(&ctx, _n, RSAKEYSIZE/8) == 0)
+        return rsa_bn_powm(_m, _m, _k, RSAKEYSIZE/8, &ctx);
+#endif
     
     /*
      * Initialize mpz variables
@@ -94,9 +258,11 @@ static int rsa_cipher(void *_m, const void *_k, const void *_n)
     /*
      * Convert big-endian octets into mpz_t values
      */
+    INSTR_BEGIN(INSTR_RSA_IMPORT);
     mpz_import(m, RSAKEYSIZE/8, 1, 1, 1, 0, _m);
     mpz_import(k, RSAKEYSIZE/8, 1, 1, 1, 0, _k);
     mpz_import(n, RSAKEYSIZE/8, 1, 1, 1, 0, _n);
+    INSTR_END(INSTR_RSA_IMPORT);
     /*
      * Compute m^k mod n
      */
@@ -104,11 +270,15 @@ static int rsa_cipher(void *_m, const void *_k, const void *_n)
         mpz_clears(m, k, n, NULL);
         return EM_MSG_OUT_OF_RANGE;
     }
+    INSTR_BEGIN(INSTR_RSA_POWM);
     mpz_powm(m, m, k, n);
+    INSTR_END(INSTR_RSA_POWM);
     /*
      * Convert mpz_t m into the octet string _m
      */
+    INSTR_BEGIN(INSTR_RSA_EXPORT);
     mpz_export(_m, NULL, 1, RSAKEYSIZE/8, 1, 0, m);
+    INSTR_END(INSTR_RSA_EXPORT);
     /*
      * Free the space occupied by mpz variables
      */
@@ -116,79 +286,809 @@ static int rsa_cipher(void *_m, const void *_k, const void *_n)
     return 0;
 }
 
+/*
+ * 서명 입력 블라인딩 : 임의의 r에 대해 A = r^e, Ai = r^-1 (mod n)을 키에 보관한다.
+ * 서명할 때 m 대신 m*A를 지수승하면 (m*A)^d = m^d * r이므로 결과에 Ai를 곱해 되돌린다.
+ * 한 번 쓴 쌍은 두 값을 각각 제곱하여 (r^2)^e, r^-2로 바꾸므로 새 r의 역원을 구할 필요가 없다.
+ */
+struct rsa_blinding {
+    pthread_mutex_t lock;
+    mpz_t a, ai;
+    int stored;     /* 저장해 둔 쌍이라 처음 쓰기 전에 무작위화해야 함 */
+};
+
+/*
+ * blinding_new() - creates the blinding pair of a CRT private key from its public exponent key->e
+ * 만든 쌍은 *out에 넣고 0을 리턴한다. 메모리가 부족하면 EM_NO_MEMORY, n이 너무 크면 EM_INVALID_KEY를 리턴한다.
+ */
+static int blinding_new(const rsa_private_key *key, struct rsa_blinding **out)
+{
+    struct rsa_blinding *b;
+    unsigned char buf[RSA_MAX_KEYSIZE/8 + 8];
+    size_t len = mpz_sizeinbase(key->n, 256) + 8;
+    mpz_t r;
+
+    if (len > sizeof(buf))
+        return EM_INVALID_KEY;
+    if ((b = malloc(sizeof(struct rsa_blinding))) == NULL)
+        return EM_NO_MEMORY;
+    mpz_init(r);
+    mpz_init2(b->a, 2*mpz_sizeinbase(key->n, 2));
+    mpz_init2(b->ai, 2*mpz_sizeinbase(key->n, 2));
+
+    // gcd(r, n) != 1일 확률은 무시할 만하지만 역원이 없으면 다시 뽑음
+    for (;;) {
+        drbg_bytes(buf, len);
+        mpz_import(r, len, 1, 1, 1, 0, buf);
+        mpz_mod(r, r, key->n);
+        if (mpz_cmp_ui(r, 1) > 0 && mpz_invert(b->ai, r, key->n))
+            break;
+    }
+    mpz_powm(b->a, r, key->e, key->n);
+    b->stored = 0;
+    mpz_clear(r);
+    explicit_bzero(buf, sizeof(buf));
+
+    pthread_mutex_init(&b->lock, NULL);
+    *out = b;
+    return 0;
+}
+
+/*
+ * blinding_free() - releases a blinding pair from blinding_new() or rsa_private_key_set_blinding()
+ */
+static void blinding_free(struct rsa_blinding *b)
+{
+    pthread_mutex_destroy(&b->lock);
+    mpz_clears(b->a, b->ai, NULL);
+    free(b);
+}
+
+/*
+ * blinding_refresh() - randomizes a stored pair before its first use, called with the lock held
+ * 최상위 비트가 1인 임의의 64 비트 k에 대해 (a^k, ai^k)로 바꾼다. (r^e)^k = (r^k)^e, (r^-1)^k = (r^k)^-1이므로
+ * e나 역원 계산 없이 새 쌍이 되고, 같은 저장소를 여러 프로세스가 열어도 서로 다른 쌍을 쓴다.
+ */
+static void blinding_refresh(struct rsa_blinding *b, const mpz_t n)
+{
+    unsigned char buf[8];
+    mpz_t k;
+
+    drbg_bytes(buf, sizeof(buf));
+    buf[0] |= 0x80;
+    mpz_init(k);
+    mpz_import(k, sizeof(buf), 1, 1, 1, 0, buf);
+    mpz_powm_sec(b->a, b->a, k, n);
+    mpz_powm_sec(b->ai, b->ai, k, n);
+    mpz_clear(k);
+    explicit_bzero(buf, sizeof(buf));
+    b->stored = 0;
+}
+
+/*
+ * rsa_private_key_set_blinding() - installs a stored blinding pair a = r^e, ai = r^-1 (mod n) into key
+ * 쌍은 복사만 해 두고, 프로세스마다 같은 쌍을 쓰지 않도록 첫 서명에서 blinding_refresh()로 무작위화한다.
+ * 그래서 키를 많이 가져와도 실제로 쓰는 키만 지수승 비용을 치른다. 이미 쌍이 있으면 바꾼다.
+ * a나 ai가 n 이상이면 EM_INVALID_KEY, 메모리가 부족하면 EM_NO_MEMORY를 리턴한다.
+ */
+int rsa_private_key_set_blinding(rsa_private_key *key, const mpz_t a, const mpz_t ai)
+{
+    struct rsa_blinding *b;
+    size_t bits = mpz_sizeinbase(key->n, 2);
+
+    if (mpz_cmp(a, key->n) >= 0 || mpz_cmp(ai, key->n) >= 0 || mpz_cmp_ui(a, 1) <= 0)
+        return EM_INVALID_KEY;
+    if ((b = malloc(sizeof(struct rsa_blinding))) == NULL)
+        return EM_NO_MEMORY;
+    mpz_init2(b->a, 2*bits);
+    mpz_init2(b->ai, 2*bits);
+    mpz_set(b->a, a);
+    mpz_set(b->ai, ai);
+    b->stored = 1;
+    pthread_mutex_init(&b->lock, NULL);
+
+    if (key->blind)
+        blinding_free(key->blind);
+    key->blind = b;
+    return 0;
+}
+
+/*
+ * rsa_private_key_import() - converts octet strings d, n, p and q into a CRT private key
+ * d와 n은 RSAKEYSIZE/8 바이트, p와 q는 RSAKEYSIZE/16 바이트이다.
+ * p*q가 n과 다르거나 q나 d의 역이 존재하지 않으면 EM_INVALID_KEY, 블라인딩 쌍을 할당하지 못하면
+ * EM_NO_MEMORY를 리턴하며, 이 경우에도 key는 초기화된 상태이므로 rsa_private_key_clear()로 해제해야 한다.
+ */
+int rsa_private_key_import(rsa_private_key *key, const void *_d, const void *_n, const void *_p, const void *_q)
+{
+    return rsa_private_key_import_ex(key, RSAKEYSIZE, _d, _n, _p, _q);
+}
+
+/*
+ * private_key_init() - initializes every mpz member of a private key with no primes yet
+ */
+static void private_key_init(rsa_private_key *key, int bits, int nprimes)
+{
+    mpz_inits(key->n, key->e, key->p, key->q, key->dP, key->dQ, key->qInv, NULL);
+    for (int i = 0; i < RSA_MAX_PRIMES - 2; i++)
+        mpz_inits(key->r[i], key->d[i], key->t[i], NULL);
+    key->bits = bits;
+    key->nprimes = nprimes;
+    key->blind = NULL;
+}
+
+/*
+ * private_key_setup() - checks the imported primes against n and precomputes the CRT values from d
+ * dP = d mod (p-1), dQ = d mod (q-1), qInv = q^-1 mod p이고, 셋째 소수부터는
+ * RFC 8017과 같이 d_i = d mod (r_i - 1), t_i = (r_1 * ... * r_(i-1))^-1 mod r_i를 구한다.
+ * 블라인딩과 서명 결과 검사에 쓰는 e는 d^-1 mod lcm(r_1 - 1, ..., r_u - 1)로 다시 구한다.
+ */
+static int private_key_setup(rsa_private_key *key, const mpz_t d)
+{
+    mpz_t R, t;
+    int ret = 0;
+
+    mpz_inits(R, t, NULL);
+
+    // r_1 * ... * r_u = n 확인
+    mpz_mul(R, key->p, key->q);
+    for (int i = 0; i < key->nprimes - 2; i++)
+        mpz_mul(R, R, key->r[i]);
+    if (mpz_cmp(R, key->n) != 0)
+        ret = EM_INVALID_KEY;
+
+    else {
+        mpz_sub_ui(t, key->p, 1);
+        mpz_mod(key->dP, d, t);
+        mpz_sub_ui(t, key->q, 1);
+        mpz_mod(key->dQ, d, t);
+        if (mpz_invert(key->qInv, key->q, key->p) == 0)
+            ret = EM_INVALID_KEY;
+        mpz_mul(R, key->p, key->q);
+        for (int i = 0; ret == 0 && i < key->nprimes - 2; i++) {
+            mpz_sub_ui(t, key->r[i], 1);
+            mpz_mod(key->d[i], d, t);
+            if (mpz_invert(key->t[i], R, key->r[i]) == 0)
+                ret = EM_INVALID_KEY;
+            mpz_mul(R, R, key->r[i]);
+        }
+    }
+    if (ret == 0) {
+        mpz_sub_ui(R, key->p, 1);
+        mpz_sub_ui(t, key->q, 1);
+        mpz_lcm(R, R, t);
+        for (int i = 0; i < key->nprimes - 2; i++) {
+            mpz_sub_ui(t, key->r[i], 1);
+            mpz_lcm(R, R, t);
+        }
+        if (mpz_invert(key->e, d, R) == 0)
+            ret = EM_INVALID_KEY;
+    }
+    // 블라인딩 쌍이 없으면 서명이 가려지지 않으므로 키를 쓸 수 없는 것으로 처리함
+    if (ret == 0)
+        ret = blinding_new(key, &key->blind);
+
+    mpz_clears(R, t, NULL);
+    return ret;
+}
+
+/*
+ * rsa_private_key_import_ex() - same as rsa_private_key_import() for a bits-bit key
+ * d와 n은 bits/8 바이트, p와 q는 bits/16 바이트이며, 키 크기는 key->bits에 기록된다.
+ */
+int rsa_private_key_import_ex(rsa_private_key *key, int bits, const void *_d, const void *_n, const void *_p, const void *_q)
+{
+    mpz_t d;
+    int ret;
+
+    private_key_init(key, bits, 2);
+    mpz_init(d);
+    mpz_import(d, bits/8, 1, 1, 1, 0, _d);
+    mpz_import(key->n, bits/8, 1, 1, 1, 0, _n);
+    mpz_import(key->p, bits/16, 1, 1, 1, 0, _p);
+    mpz_import(key->q, bits/16, 1, 1, 1, 0, _q);
+    ret = private_key_setup(key, d);
+    mpz_clear(d);
+    return ret;
+}
+
+/*
+ * rsa_private_key_import_mp() - converts a multi-prime key from rsa_generate_key_mp() into a CRT private key
+ * primes는 r_1, ..., r_nprimes를 RSA_PRIME_LEN(bits, nprimes) 바이트씩 이어 붙인 것이다.
+ * nprimes가 범위를 벗어나면 EM_INVALID_PARAMS, 소수의 곱이 n이 아니면 EM_INVALID_KEY,
+ * 메모리가 부족하면 EM_NO_MEMORY를 리턴하며, 어느 경우에도 key는 초기화된 상태이므로 rsa_private_key_clear()로 해제해야 한다.
+ */
+int rsa_private_key_import_mp(rsa_private_key *key, int bits, int nprimes, const void *_d, const void *_n, const void *_primes)
+{
+    const unsigned char *primes = _primes;
+    size_t plen;
+    mpz_t d;
+    int ret;
+
+    private_key_init(key, bits, nprimes);
+    if (nprimes < 2 || nprimes > RSA_MAX_PRIMES)
+        return EM_INVALID_PARAMS;
+    plen = RSA_PRIME_LEN(bits, nprimes);
+    mpz_init(d);
+    mpz_import(d, bits/8, 1, 1, 1, 0, _d);
+    mpz_import(key->n, bits/8, 1, 1, 1, 0, _n);
+    mpz_import(key->p, plen, 1, 1, 1, 0, primes);
+    mpz_import(key->q, plen, 1, 1, 1, 0, primes + plen);
+    for (int i = 0; i < nprimes - 2; i++)
+        mpz_import(key->r[i], plen, 1, 1, 1, 0, primes + (i + 2) * plen);
+    ret = private_key_setup(key, d);
+    mpz_clear(d);
+    return ret;
+}
+
+/*
+ * rsa_private_key_clear() - frees the space occupied by a private key
+ */
+void rsa_private_key_clear(rsa_private_key *key)
+{
+    if (key->blind) {
+        blinding_free(key->blind);
+        key->blind = NULL;
+    }
+    mpz_clears(key->n, key->e, key->p, key->q, key->dP, key->dQ, key->qInv, NULL);
+    for (int i = 0; i < RSA_MAX_PRIMES - 2; i++)
+        mpz_clears(key->r[i], key->d[i], key->t[i], NULL);
+}
+
+/*
+ * rsa_cipher_crt() - compute m^d mod n with the CRT for a len-byte m
+ * m1 = m^dP mod p, m2 = m^dQ mod q, h = qInv*(m1 - m2) mod p이면 m^d mod n = m2 + h*q이다.
+ * 지수와 법의 크기가 절반이 되므로 d로 직접 계산하는 rsa_cipher()보다 3~4배 빠르다.
+ * 다중 소수 키이면 RFC 8017 5.1.2의 Garner 방법으로 R = r_1 * ... * r_(i-1)에 대해
+ * h = (m_i - m)*t_i mod r_i, m = m + R*h를 셋째 소수부터 차례로 반복한다.
+ * 지수승은 mpz_powm_sec()으로 하고, 입력은 키의 블라인딩 쌍으로 가린 뒤 결과에서 되돌린다.
+ * 쌍은 락 안에서 복사하고 제곱해 두므로 여러 스레드가 같은 키로 서명해도 된다.
+ * 중간값은 스레드별 작업 공간 (rsa_scratch의 crt[])에 두므로 서명마다 힙 할당이 없다.
+ * 내보내기 전에 결과를 e로 지수승하여 입력과 같은지 확인하고, 다르면 m을 0으로 지운다.
+ * If m >= n then returns EM_MSG_OUT_OF_RANGE, EM_FAULT if the check fails,
+ * EM_NO_MEMORY if the scratch space cannot be allocated, otherwise returns 0 for success.
+ */
+int rsa_cipher_crt(void *_m, size_t len, const rsa_private_key *key)
+{
+    struct rsa_blinding *b = key->blind;
+    rsa_scratch *w;
+    mpz_ptr c, m, m1, m2, a, ai, R;
+    mpz_t *mi;
+    int k = key->nprimes - 2, ret = 0;
+    INSTR_BEGIN(INSTR_RSA_CRT);
+
+    if ((w = rsa_scratch_get()) == NULL) {
+        ret = EM_NO_MEMORY;
+        goto out;
+    }
+    c = w->crt[0];
+    m = w->crt[1];
+    m1 = w->crt[2];
+    m2 = w->crt[3];
+    a = w->crt[4];
+    ai = w->crt[5];
+    R = w->crt[6];
+    mi = w->crt + 7;
+    mpz_import(c, len, 1, 1, 1, 0, _m);
+    if (mpz_cmp(c, key->n) >= 0) {
+        ret = EM_MSG_OUT_OF_RANGE;
+        goto out;
+    }
+    mpz_set(m, c);
+
+    // 이번에 쓸 쌍을 가져오고 다음 서명을 위해 제곱해 둠
+    if (b) {
+        pthread_mutex_lock(&b->lock);
+        if (b->stored)
+            blinding_refresh(b, key->n);
+        mpz_set(a, b->a);
+        mpz_set(ai, b->ai);
+        mpz_mul(m1, b->a, b->a);
+        mpz_mod(b->a, m1, key->n);
+        mpz_mul(m1, b->ai, b->ai);
+        mpz_mod(b->ai, m1, key->n);
+        pthread_mutex_unlock(&b->lock);
+
+        mpz_mul(m, m, a);
+        mpz_mod(m, m, key->n);
+    }
+
+    // m1, m2와 셋째 소수부터의 m_i = m^d_i mod r_i를 모두 구한 뒤 합친다
+    mpz_mod(m1, m, key->p);
+    mpz_powm_sec(m1, m1, key->dP, key->p);
+    mpz_mod(m2, m, key->q);
+    mpz_powm_sec(m2, m2, key->dQ, key->q);
+    for (int i = 0; i < k; i++) {
+        mpz_mod(mi[i], m, key->r[i]);
+        mpz_powm_sec(mi[i], mi[i], key->d[i], key->r[i]);
+    }
+
+    // m = m2 + q * (qInv * (m1 - m2) mod p)
+    mpz_sub(m1, m1, m2);
+    mpz_mul(m1, m1, key->qInv);
+    mpz_mod(m1, m1, key->p);
+    mpz_mul(m, m1, key->q);
+    mpz_add(m, m, m2);
+
+    // R = r_1 * ... * r_(i-1)일 때 m = m + R * ((m_i - m) * t_i mod r_i)
+    if (k > 0)
+        mpz_mul(R, key->p, key->q);
+    for (int i = 0; i < k; i++) {
+        mpz_sub(m1, mi[i], m);
+        mpz_mul(m1, m1, key->t[i]);
+        mpz_mod(m1, m1, key->r[i]);
+        mpz_addmul(m, R, m1);
+        mpz_mul(R, R, key->r[i]);
+    }
+
+    if (b) {
+        mpz_mul(m, m, ai);
+        mpz_mod(m, m, key->n);
+    }
+
+    // 오류 주입 검사 : m^e mod n이 입력과 다르면 틀린 서명을 내보내지 않음
+    mpz_powm(m2, m, key->e, key->n);
+    if (mpz_cmp(m2, c) != 0) {
+        memset(_m, 0, len);
+        ret = EM_FAULT;
+        goto out;
+    }
+    mpz_export(_m, NULL, 1, len, 1, 0, m);
+out:
+    INSTR_END(INSTR_RSA_CRT);
+    return ret;
+}
+
+/*
+ * rsa_public_key_import() - converts octet strings e and n into a public key
+ * e는 1보다 크고 n보다 작아야 하며, 그렇지 않으면 EM_INVALID_KEY를 리턴한다.
+ * 이 경우에도 key는 초기화된 상태이므로 rsa_public_key_clear()로 해제해야 한다.
+ * 키를 구별하는 지문 fp = Hash(e || n)도 함께 계산한다.
+ */
+int rsa_public_key_import(rsa_public_key *key, const void *_e, const void *_n)
+{
+    return rsa_public_key_import_ex(key, RSAKEYSIZE, _e, _n);
+}
+
+/*
+ * rsa_public_key_import_ex() - same as rsa_public_key_import() for a bits-bit key
+ * e와 n은 bits/8 바이트이며, 키 크기는 key->bits에 기록된다.
+ */
+int rsa_public_key_import_ex(rsa_public_key *key, int bits, const void *_e, const void *_n)
+{
+    unsigned char eN[2*RSA_MAX_KEYSIZE/8];
+
+    mpz_inits(key->n, key->e, NULL);
+    key->bits = bits;
+    if (bits <= 0 || bits > RSA_MAX_KEYSIZE || bits % 8 != 0)
+        return EM_INVALID_KEY;
+    mpz_import(key->e, bits/8, 1, 1, 1, 0, _e);
+    mpz_import(key->n, bits/8, 1, 1, 1, 0, _n);
+    key->f4 = (mpz_cmp_ui(key->e, 65537) == 0);
+    memcpy(eN, _e, bits/8);
+    memcpy(eN + bits/8, _n, bits/8);
+    rsa_pss_hash(eN, 2*bits/8, key->fp);
+
+    if (mpz_cmp_ui(key->e, 1) <= 0 || mpz_cmp(key->e, key->n) >= 0)
+        return EM_INVALID_KEY;
+    return 0;
+}
+
+/*
+ * rsa_public_key_clear() - frees the space occupied by a public key
+ */
+void rsa_public_key_clear(rsa_public_key *key)
+{
+    mpz_clears(key->n, key->e, NULL);
+}
+
+/*
+ * 스레드별 작업 공간 (rsa_scratch)
+ * 스레드마다 처음 한 번만 RSA_MAX_KEYSIZE의 두 배 크기로 할당해 두고, 이후 검증과
+ * rsa_pss_ex.c의 지수승에서는 같은 공간을 다시 사용하므로 힙 할당이 일어나지 않는다. 스레드가 끝나면 해제된다.
+ */
+static pthread_key_t scratch_key;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+
+static void scratch_free(void *p)
+{
+    rsa_scratch *w = p;
+
+    mpz_clears(w->m, w->x, w->t, w->ba, w->bb, NULL);
+    for (int i = 0; i < (int)(sizeof(w->crt) / sizeof(w->crt[0])); i++)
+        mpz_clear(w->crt[i]);
+    explicit_bzero(w, sizeof(rsa_scratch));
+    free(w);
+}
+
+static void scratch_key_create(void)
+{
+    pthread_key_create(&scratch_key, scratch_free);
+}
+
+/*
+ * rsa_scratch_get() - returns the calling thread's scratch space, allocating it on first use
+ */
+rsa_scratch *rsa_scratch_get(void)
+{
+    rsa_scratch *w;
+
+    pthread_once(&scratch_once, scratch_key_create);
+    if ((w = pthread_getspecific(scratch_key)) != NULL)
+        return w;
+    if ((w = malloc(sizeof(rsa_scratch))) == NULL)
+        return NULL;
+    mpz_init2(w->m, 2*RSA_MAX_KEYSIZE);
+    mpz_init2(w->x, 2*RSA_MAX_KEYSIZE);
+    mpz_init2(w->t, 2*RSA_MAX_KEYSIZE);
+    for (int i = 0; i < (int)(sizeof(w->crt) / sizeof(w->crt[0])); i++)
+        mpz_init2(w->crt[i], 2*RSA_MAX_KEYSIZE);
+    mpz_init2(w->ba, 2*RSA_MAX_KEYSIZE);
+    mpz_init2(w->bb, 2*RSA_MAX_KEYSIZE);
+    w->bvalid = 0;
+    if (pthread_setspecific(scratch_key, w) != 0) {
+        scratch_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+/*
+ * rsa_cipher_pub() - compute m^e mod n with a public key
+ * e = 65537 = 2^16 + 1이면 m을 16번 제곱한 뒤 m을 한 번 곱한다.
+ * If m >= n then returns EM_MSG_OUT_OF_RANGE, EM_NO_MEMORY if the scratch space cannot be allocated,
+ * otherwise returns 0 for success.
+ */
+static int rsa_cipher_pub(void *_m, const rsa_public_key *key)
+{
+    rsa_scratch *w;
+
+    if ((w = rsa_scratch_get()) == NULL)
+        return EM_NO_MEMORY;
+    mpz_import(w->m, RSAKEYSIZE/8, 1, 1, 1, 0, _m);
+    if (mpz_cmp(w->m, key->n) >= 0)
+        return EM_MSG_OUT_OF_RANGE;
+
+    INSTR_BEGIN(INSTR_RSA_PUBLIC);
+    if (key->f4) {
+        mpz_set(w->x, w->m);
+        for (int i=0; i<16; i++){
+            mpz_mul(w->t, w->x, w->x);
+            mpz_tdiv_r(w->x, w->t, key->n);
+        }
+        mpz_mul(w->t, w->x, w->m);
+        mpz_tdiv_r(w->x, w->t, key->n);
+    }
+    else
+        mpz_powm(w->x, w->m, key->e, key->n);
+
+    mpz_export(_m, NULL, 1, RSAKEYSIZE/8, 1, 0, w->x);
+    INSTR_END(INSTR_RSA_PUBLIC);
+    return 0;
+}
+
+/*
+ * rsa_cipher_blind() - compute m^d mod n for len-byte octet strings d and n with input blinding
+ * octet 키로 서명하는 rsassa_pss_sign(), rsassa_pss_sign_ex()가 쓴다. e를 모르므로 임의의 A와
+ * B = A^-d mod n을 쌍으로 두고 m^d = (m*A)^d * B로 계산한다. 쌍은 스레드별 작업 공간에 키의 Hash(d || n)과
+ * 함께 두었다가 같은 키로 다시 서명하면 A, B를 각각 제곱해 쓰므로, 쌍을 만드는 지수승은 키가 바뀔 때만 든다.
+ * 지수승은 rsa_bn_powm()이 받는 크기이면 그것으로, 아니면 mpz_powm_sec()으로 하고, 끝나면 d를 지운다.
+ * If m >= n then returns EM_MSG_OUT_OF_RANGE, EM_INVALID_KEY if n is even or d is 0,
+ * EM_NO_MEMORY if the scratch space cannot be allocated, otherwise returns 0 for success.
+ */
+int rsa_cipher_blind(void *_m, size_t len, const void *_d, const void *_n)
+{
+    unsigned char buf[2*RSA_MAX_KEYSIZE/8], fp[SHASIZE/8];
+    rsa_scratch *w;
+    rsa_bn_ctx ctx;
+    mpz_ptr m, d, n, t;
+    size_t nl = (len + sizeof(mp_limb_t) - 1) / sizeof(mp_limb_t);
+    int ret = 0;
+
+    if (len > RSA_MAX_KEYSIZE/8)
+        return EM_INVALID_KEY;
+    if ((w = rsa_scratch_get()) == NULL)
+        return EM_NO_MEMORY;
+    m = w->m;
+    d = w->x;
+    n = w->t;
+    t = w->crt[0];
+    mpz_import(m, len, 1, 1, 1, 0, _m);
+    mpz_import(d, len, 1, 1, 1, 0, _d);
+    mpz_import(n, len, 1, 1, 1, 0, _n);
+    if (mpz_cmp(m, n) >= 0) {
+        ret = EM_MSG_OUT_OF_RANGE;
+        goto out;
+    }
+    if (mpz_even_p(n) || mpz_sgn(d) == 0) {
+        ret = EM_INVALID_KEY;
+        goto out;
+    }
+
+    // 같은 키의 쌍이 있으면 제곱해 쓰고, 없으면 A를 뽑아 B = (A^-1)^d를 구함
+    memcpy(buf, _d, len);
+    memcpy(buf + len, _n, len);
+    rsa_pss_hash(buf, 2*len, fp);
+    if (w->bvalid && memcmp(fp, w->bfp, sizeof(fp)) == 0) {
+        mpz_mul(t, w->ba, w->ba);
+        mpz_mod(w->ba, t, n);
+        mpz_mul(t, w->bb, w->bb);
+        mpz_mod(w->bb, t, n);
+    }
+    else {
+        do {
+            drbg_bytes(buf, len + 8);
+            mpz_import(t, len + 8, 1, 1, 1, 0, buf);
+            mpz_mod(w->ba, t, n);
+        } while (mpz_cmp_ui(w->ba, 1) <= 0 || !mpz_invert(w->bb, w->ba, n));
+        mpz_powm_sec(w->bb, w->bb, d, n);
+        memcpy(w->bfp, fp, sizeof(fp));
+        w->bvalid = 1;
+    }
+    explicit_bzero(buf, sizeof(buf));
+
+    mpz_mul(t, m, w->ba);
+    mpz_mod(m, t, n);
+    if (rsa_bn_init(&ctx, _n, len) == 0) {
+        memset(buf, 0, len);
+        mpz_export(buf, NULL, 1, len, 1, 0, m);
+        rsa_bn_powm(buf, buf, _d, len, &ctx);
+        mpz_import(m, len, 1, 1, 1, 0, buf);
+        explicit_bzero(buf, len);
+    }
+    else
+        mpz_powm_sec(m, m, d, n);
+    mpz_mul(t, m, w->bb);
+    mpz_mod(m, t, n);
+    mpz_export(_m, NULL, 1, len, 1, 0, m);
+out:
+    explicit_bzero(mpz_limbs_modify(d, nl), nl * sizeof(mp_limb_t));
+    mpz_limbs_finish(d, 0);
+    return ret;
+}
+
+/*
+ * mgf_xor_mb() - MGF1 for a seed no longer than hLen, MGF_LANES counters at a time
+ * 스택의 msg[l]에 mgfSeed || C를 만들어 hash_mb()로 한꺼번에 해시한 뒤 buf에 XOR한다.
+ */
+static int mgf_xor_mb(const unsigned char *mgfSeed, size_t seedLen, unsigned char *buf, size_t maskLen, uint32_t count)
+{
+    unsigned char msg[MGF_LANES][SHASIZE/8 + 4], T[MGF_LANES][SHASIZE/8];
+    const unsigned char *pm[MGF_LANES];
+    unsigned char *pt[MGF_LANES];
+    size_t hLen = SHASIZE/8, off, len;
+    uint32_t i, c;
+    int l, n;
+
+    for (l = 0; l < MGF_LANES; l++) {
+        memcpy(msg[l], mgfSeed, seedLen);
+        pm[l] = msg[l];
+        pt[l] = T[l];
+    }
+    for (i = 0; i < count; i += n) {
+        n = (count - i < MGF_LANES) ? (int)(count - i) : MGF_LANES;
+        for (l = 0; l < n; l++) {
+            c = i + l;
+            msg[l][seedLen] = (c >> 24) & 0xff;
+            msg[l][seedLen+1] = (c >> 16) & 0xff;
+            msg[l][seedLen+2] = (c >> 8) & 0xff;
+            msg[l][seedLen+3] = c & 0xff;
+        }
+        hash_mb(pm, (unsigned int)(seedLen + 4), pt, n);
+
+        for (l = 0; l < n; l++) {
+            off = (size_t)(i + l) * hLen;
+            len = (maskLen - off < hLen) ? maskLen - off : hLen;
+            for (size_t j = 0; j < len; j++)
+                buf[off + j] ^= T[l][j];
+        }
+    }
+    return 0;
+}
+
 /*
  * Copyright 2020. Heekuck Oh, all rights reserved
  * A mask generation function based on a hash function
+ * MGF1(mgfSeed, maskLen)을 만들어 buf에 XOR한다. 즉 buf = buf ^ mask이다.
+ * mgfSeed는 한 번만 해시 문맥에 넣고, 카운터 C마다 그 문맥을 복사하여 C만 이어서 넣는다.
+ * 마스크는 블록마다 바로 buf에 XOR하므로 별도의 mask 버퍼나 힙 할당이 필요 없다.
+ * PSS처럼 mgfSeed가 hLen 이하이면 mgf_xor_mb()로 여러 카운터를 동시에 해시한다.
+ * If maskLen > 2^32*hLen, then returns -1, otherwise 0.
  */
-static unsigned char *mgf(const unsigned char *mgfSeed, size_t seedLen, unsigned char *mask, size_t maskLen)
+static int mgf_xor(const unsigned char *mgfSeed, size_t seedLen, unsigned char *buf, size_t maskLen)
 {
-    uint32_t i, count, c;
-    size_t hLen;
-    unsigned char *mgfIn, *m;
-    
+    pss_hash_ctx seed, ctx;
+    uint32_t i, count;
+    size_t hLen, len;
+    unsigned char C[4], T[SHASIZE/8];
+
     /*
      * Check if maskLen > 2^32*hLen
      */
     hLen = SHASIZE/8;
     if (maskLen > 0x0100000000*hLen)
-        return NULL;
-    /*
-     * Generate octet string mask
-     */
-    if ((mgfIn = (unsigned char *)malloc(seedLen+4)) == NULL)
-        return NULL;
-    memcpy(mgfIn, mgfSeed, seedLen);
+        return -1;
     count = maskLen/hLen + (maskLen%hLen ? 1 : 0);
-    if ((m = (unsigned char *)malloc(count*hLen)) == NULL)
-        return NULL;
+    INSTR_BEGIN(INSTR_MGF);
+    if (seedLen <= hLen) {
+        mgf_xor_mb(mgfSeed, seedLen, buf, maskLen, count);
+        INSTR_END(INSTR_MGF);
+        return 0;
+    }
+
+    hash_init(&seed);
+    hash_update(&seed, mgfSeed, seedLen);
     /*
      * Convert i to an octet string C of length 4 octets
-     * Concatenate the hash of the seed mgfSeed and C to the octet string T:
-     *       T = T || Hash(mgfSeed || C)
+     * XOR the hash of the seed mgfSeed and C into buf:
+     *       buf = buf ^ (T = T || Hash(mgfSeed || C))
      */
     for (i = 0; i < count; i++) {
-        c = i;
-        mgfIn[seedLen+3] = c & 0x000000ff; c >>= 8;
-        mgfIn[seedLen+2] = c & 0x000000ff; c >>= 8;
-        mgfIn[seedLen+1] = c & 0x000000ff; c >>= 8;
-        mgfIn[seedLen] = c & 0x000000ff;
-        (*sha)(mgfIn, seedLen+4, m+i*hLen);
+        C[0] = (i >> 24) & 0xff;
+        C[1] = (i >> 16) & 0xff;
+        C[2] = (i >> 8) & 0xff;
+        C[3] = i & 0xff;
+        ctx = seed;
+        hash_update(&ctx, C, 4);
+        hash_final(&ctx, T);
+
+        len = (maskLen - i*hLen < hLen) ? maskLen - i*hLen : hLen;
+        for (size_t j = 0; j < len; j++)
+            buf[i*hLen + j] ^= T[j];
     }
-    /*
-     * Copy the mask and free memory
-     */
-    memcpy(mask, m, maskLen);
-    free(mgfIn); free(m);
-    return mask;
+    INSTR_END(INSTR_MGF);
+    return 0;
 }
 
 /*
- * rsassa_pss_sign - RSA Signature Scheme with Appendix
+ * rsa_pss_stream_init() - starts hashing a message that is given in pieces
  */
-int rsassa_pss_sign(const void *m, size_t mLen, const void *d, const void *n, void *s)
+void rsa_pss_stream_init(rsa_pss_stream *ctx)
 {
-    // SHA224, SHA256에서 hash function의 input이 너무 길면 EM_MSG_TOO_LONG return
-    if (((SHASIZE || 224) || (SHASIZE || 256)) && mLen > 0x1fffffffffffffff)
-        return EM_MSG_TOO_LONG;
+    hash_init(&ctx->h);
+    ctx->len = 0;
+    ctx->used = 0;
+}
 
-    unsigned char mHash[SHASIZE/8];
-    unsigned char mgf_Hash[DB_LEN];
+/*
+ * stream_blocks() - feeds whole blocks into the hash context
+ * sha*_update()의 길이는 unsigned int이므로 2^30 바이트씩 나누어 넣는다.
+ * SHA-224/256에서 SHA extensions을 쓸 수 있으면 sha2.c를 거치지 않고 h[]를 바로 갱신한다.
+ * 문맥의 ctx->h.len은 항상 0으로 유지된다.
+ */
+static void stream_blocks(rsa_pss_stream *ctx, const unsigned char *m, size_t len)
+{
+    size_t chunk;
+
+#if SHASIZE <= 256
+    // SHA extensions이 있으면 압축 함수를 직접 호출함
+    if (sha2_accel_features() & SHA2_SHANI) {
+        sha256_ni_transform(ctx->h.h, m, len / SHA_BLOCKSIZE);
+        return;
+    }
+#endif
+    while (len > 0) {
+        chunk = (len < ((size_t)1 << 30)) ? len : ((size_t)1 << 30);
+        hash_update(&ctx->h, m, (unsigned int)chunk);
+        m += chunk;
+        len -= chunk;
+    }
+}
+
+/*
+ * rsa_pss_stream_update() - adds mLen bytes of the message
+ */
+void rsa_pss_stream_update(rsa_pss_stream *ctx, const void *_m, size_t mLen)
+{
+    const unsigned char *m = _m;
+    size_t n;
+
+    ctx->len += mLen;
+
+    // 남아 있던 조각을 한 블록으로 채움
+    if (ctx->used > 0) {
+        n = SHA_BLOCKSIZE - ctx->used;
+        if (mLen < n) {
+            memcpy(ctx->buf + ctx->used, m, mLen);
+            ctx->used += mLen;
+            return;
+        }
+        memcpy(ctx->buf + ctx->used, m, n);
+        stream_blocks(ctx, ctx->buf, SHA_BLOCKSIZE);
+        m += n; mLen -= n;
+        ctx->used = 0;
+    }
+
+    // 나머지 중 블록 단위는 바로 넣고 남는 조각만 보관
+    n = mLen - mLen % SHA_BLOCKSIZE;
+    stream_blocks(ctx, m, n);
+    memcpy(ctx->buf, m + n, mLen - n);
+    ctx->used = mLen - n;
+}
+
+/*
+ * rsa_pss_stream_digest() - pads the message with its 64-bit bit length and outputs mHash
+ * SHA-384/512의 길이 필드는 128 비트이지만 상위 64 비트는 항상 0이다.
+ */
+static void rsa_pss_stream_digest(rsa_pss_stream *ctx, unsigned char *mHash)
+{
+    unsigned char pad[2*SHA_BLOCKSIZE];
+    size_t padLen;
+    uint64_t bits = ctx->len << 3;
+
+    padLen = (ctx->used + 1 + SHA_BLOCKSIZE/8 <= SHA_BLOCKSIZE) ? SHA_BLOCKSIZE : 2*SHA_BLOCKSIZE;
+    memset(pad, 0, padLen);
+    memcpy(pad, ctx->buf, ctx->used);
+    pad[ctx->used] = 0x80;
+    for (int i=0; i<8; i++)
+        pad[padLen-1-i] = (bits >> (8*i)) & 0xff;
+    stream_blocks(ctx, pad, padLen);
+
+    // 해시 값은 h[]를 big-endian으로 풀어서 얻음
+#if SHASIZE <= 256
+    for (int i=0; i<SHASIZE/32; i++)
+        for (int j=0; j<4; j++)
+            mHash[4*i+j] = (ctx->h.h[i] >> (24 - 8*j)) & 0xff;
+#else
+    for (int i=0; i<SHASIZE/64; i++)
+        for (int j=0; j<8; j++)
+            mHash[8*i+j] = (ctx->h.h[i] >> (56 - 8*j)) & 0xff;
+#endif
+}
+
+/*
+ * rsa_pss_hash() - computes mHash = Hash(m)
+ * sha2.c는 길이를 32 비트 비트 수로 다루므로 2^29 바이트 이상이면 스트림 방식으로 해시한다.
+ */
+void rsa_pss_hash(const void *m, size_t mLen, unsigned char *mHash)
+{
+    rsa_pss_stream ctx;
+    INSTR_BEGIN(INSTR_HASH);
+
+    if (mLen < ((size_t)1 << 29))
+        sha(m, mLen, mHash);
+    else {
+        rsa_pss_stream_init(&ctx);
+        rsa_pss_stream_update(&ctx, m, mLen);
+        rsa_pss_stream_digest(&ctx, mHash);
+    }
+    INSTR_END(INSTR_HASH);
+}
+
+/*
+ * rsa_pss_hash_mb() - computes mHash[i] = Hash(m[i]) for count messages of the same length len
+ */
+void rsa_pss_hash_mb(const unsigned char *const *m, unsigned int len, unsigned char *const *mHash, int count)
+{
+    hash_mb(m, len, mHash, count);
+}
+
+/*
+ * rsa_pss_hash_mb_prefix() - computes mHash[i] = Hash(prefix || m[i]) without copying m[i]
+ * plen은 해시의 블록 크기보다 작아야 한다.
+ */
+void rsa_pss_hash_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *m,
+                            unsigned int len, unsigned char *const *mHash, int count)
+{
+    hash_mb_prefix(prefix, plen, m, len, mHash, count);
+}
+
+/*
+ * pss_encode - EMSA-PSS encoding of mHash into EM (RSAKEYSIZE/8 bytes)
+ * 모든 서명 함수가 함께 사용한다. domain은 M'의 padding1 마지막 바이트로 들어간다 (rsa_pss.h 참고).
+ */
+static int pss_encode(const unsigned char *mHash, int domain, unsigned char *EM)
+{
     unsigned char MPrime[2*(SHASIZE/8)+8];
     unsigned char salt[SHASIZE/8];
     unsigned char H[SHASIZE/8];
-    unsigned char DB[DB_LEN];
-    unsigned char EM[RSAKEYSIZE/8];
-
-    // m을 hash하여 mHash 획득
-    sha(m, mLen, mHash);
 
     // salt를 random number로 채움
-    for (int i=0; i<SHASIZE/8; i++){
-        salt[i] = arc4random() & 255;
-    }    
+    drbg_bytes(salt, SHASIZE/8);
 
-    // MPrime의 처음 8 bytes는 0x00로 채우고 이후 mHash, salt를 이어붙임
+    // MPrime의 처음 8 bytes는 0x00 (마지막 byte는 domain)로 채우고 이후 mHash, salt를 이어붙임
     memset(MPrime, 0x00, 8);
+    MPrime[7] = (unsigned char)domain;
     memcpy(MPrime + 8, mHash, SHASIZE/8);
     memcpy(MPrime + 8 + SHASIZE/8, salt, SHASIZE/8);
 
@@ -203,57 +1103,113 @@ int rsassa_pss_sign(const void *m, size_t mLen, const void *d, const void *n, vo
     memcpy(EM + DB_LEN, H, SHASIZE/8);
     memset(EM + DB_LEN + SHASIZE/8, 0xbc, 1);
 
-    // DB 구성, 0으로 계속 padding하다가 salt 바로 앞 bit를 1로 설정하여 salt 구분
-    memset(DB, 0x00, PS_LEN-1);
-    memset(DB+PS_LEN-1, 0x01, 1);
-    memcpy(DB+PS_LEN, salt, SHASIZE/8);
+    // EM 앞부분에 DB 구성, 0으로 계속 padding하다가 salt 바로 앞 bit를 1로 설정하여 salt 구분
+    memset(EM, 0x00, PS_LEN-1);
+    memset(EM+PS_LEN-1, 0x01, 1);
+    memcpy(EM+PS_LEN, salt, SHASIZE/8);
 
-    // mgf로 mgf_Hash 생성
-    mgf(H, SHASIZE/8, mgf_Hash, DB_LEN);
-
-    // DB와 mgf_Hash를 XOR하여 EM 구성
-    for (int i=0; i<DB_LEN; i++){
-        EM[i] = DB[i] ^ mgf_Hash[i];
-    }
+    // mgf 마스크를 DB에 바로 XOR하여 maskedDB 구성
+    mgf_xor(H, SHASIZE/8, EM, DB_LEN);
 
     // EM의 맨 처음 bit가 1일 시 0으로 변경 
     if ((EM[0] >> 7) == 1)
         EM[0] &= 0x7f;
 
-    // EM을 (d, n)으로 서명
+    return 0;
+}
+
+/*
+ * rsassa_pss_sign - RSA Signature Scheme with Appendix
+ */
+int rsassa_pss_sign(const void *m, size_t mLen, const void *d, const void *n, void *s)
+{
+    unsigned char mHash[SHASIZE/8];
+    unsigned char EM[RSAKEYSIZE/8];
+    int ret;
+
+    // SHA224, SHA256에서 hash function의 input이 너무 길면 EM_MSG_TOO_LONG return
+    if (((SHASIZE || 224) || (SHASIZE || 256)) && mLen > 0x1fffffffffffffff)
+        return EM_MSG_TOO_LONG;
+
+    // m을 hash하여 mHash 획득
+    rsa_pss_hash(m, mLen, mHash);
+
+    INSTR_BEGIN(INSTR_PSS_SIGN);
+    if ((ret = pss_encode(mHash, PSS_DOMAIN_MESSAGE, EM)) != 0)
+        return ret;
+
+    // EM을 (d, n)으로 블라인딩하여 서명
     // 이때 RSA 데이터 값이 modulus n보다 크거나 같다면 EM_MSG_OUT_OF_RANGE return
-    if (rsa_cipher(EM, d, n))
-        return EM_MSG_OUT_OF_RANGE;
+    if ((ret = rsa_cipher_blind(EM, RSAKEYSIZE/8, d, n)) != 0)
+        return ret;
 
     // EM을 s에 복사
     memcpy(s, EM, RSAKEYSIZE/8);
+    INSTR_END(INSTR_PSS_SIGN);
 
     return 0;
 }
 
 /*
- * rsassa_pss_verify - RSA Signature Scheme with Appendix
+ * rsassa_pss_sign_hash() - signs the message hash mHash with a CRT private key
  */
-int rsassa_pss_verify(const void *m, size_t mLen, const void *e, const void *n, const void *s)
+int rsassa_pss_sign_hash(const unsigned char *mHash, const rsa_private_key *key, void *s)
+{
+    return rsassa_pss_sign_hash_domain(mHash, PSS_DOMAIN_MESSAGE, key, s);
+}
+
+/*
+ * rsassa_pss_sign_hash_domain() - signs mHash in the signing domain domain (PSS_DOMAIN_*)
+ */
+int rsassa_pss_sign_hash_domain(const unsigned char *mHash, int domain, const rsa_private_key *key, void *s)
 {
     unsigned char EM[RSAKEYSIZE/8];
-    unsigned char maskedDB[DB_LEN];
+    int ret;
+
+    // 다른 크기로 가져온 키는 rsassa_pss_sign_key_ex()로 서명해야 함
+    if (key->bits != RSAKEYSIZE)
+        return EM_INVALID_KEY;
+    INSTR_BEGIN(INSTR_PSS_SIGN);
+    if ((ret = pss_encode(mHash, domain, EM)) != 0)
+        return ret;
+
+    // EM을 CRT 개인키로 서명
+    if (rsa_cipher_crt(EM, RSAKEYSIZE/8, key))
+        return EM_MSG_OUT_OF_RANGE;
+
+    memcpy(s, EM, RSAKEYSIZE/8);
+    INSTR_END(INSTR_PSS_SIGN);
+
+    return 0;
+}
+
+/*
+ * rsassa_pss_sign_key - RSA Signature Scheme with Appendix using a CRT private key
+ * 서명 결과는 rsassa_pss_sign()과 같은 형식이며 rsassa_pss_verify()로 검증한다.
+ */
+int rsassa_pss_sign_key(const void *m, size_t mLen, const rsa_private_key *key, void *s)
+{
+    unsigned char mHash[SHASIZE/8];
+
+    if (mLen > 0x1fffffffffffffff)
+        return EM_MSG_TOO_LONG;
+
+    rsa_pss_hash(m, mLen, mHash);
+    return rsassa_pss_sign_hash(mHash, key, s);
+}
+
+/*
+ * pss_decode - EMSA-PSS verification of the recovered encoded message EM against mHash
+ * 모든 검증 함수가 함께 사용한다. domain은 서명할 때와 같아야 한다.
+ */
+static int pss_decode(const unsigned char *mHash, int domain, const unsigned char *EM)
+{
     unsigned char DB[DB_LEN];
-    unsigned char mgf_Hash[DB_LEN];
     unsigned char H[SHASIZE/8];
     unsigned char salt[SHASIZE/8];
-    unsigned char mHash[SHASIZE/8];
     unsigned char HPrime[SHASIZE/8];
     unsigned char MPrime[2*(SHASIZE/8)+8];
 
-    // s를 EM에 복사
-    memcpy(EM, s, RSAKEYSIZE/8);
-
-    // EM을 (e, n)으로 검증
-    // 이때 RSA 데이터 값이 modulus n보다 크거나 같다면 EM_MSG_OUT_OF_RANGE return
-    if (rsa_cipher(EM, e, n))
-        return EM_MSG_OUT_OF_RANGE;
-
     // EM의 마지막 byte가 0xbc가 아니면 EM_INVALID_LAST return
     if (EM[RSAKEYSIZE/8 - 1] != 0xbc)
         return EM_INVALID_LAST;
@@ -263,20 +1219,15 @@ int rsassa_pss_verify(const void *m, size_t mLen, const void *e, const void *n,
         return EM_INVALID_INIT;
 
     // EM에서 maskedDB, H를 추출
-    memcpy(maskedDB, EM, DB_LEN);
+    memcpy(DB, EM, DB_LEN);
     memcpy(H, EM + DB_LEN, SHASIZE/8);
 
-    // mgf로 mgf_Hash 복구
-    mgf(H, SHASIZE/8, mgf_Hash, DB_LEN);
+    // mgf 마스크를 maskedDB에 바로 XOR하여 DB 복구
+    mgf_xor(H, SHASIZE/8, DB, DB_LEN);
 
     // DB의 첫 byte를 항상 0으로 설정
     DB[0] = 0x00;
 
-    // maskedDB와 mgf_Hash를 XOR하여 DB 구성
-    for (int i=1; i<DB_LEN; i++){
-        DB[i] = maskedDB[i] ^ mgf_Hash[i];
-    }
-
     // DB의 pad가 0x000...01이 아니라면 EM_INVALID_PD2 return
     for (int i=0; i<PS_LEN-1; i++){
         if ((DB[i] ^ 0x00) != 0)
@@ -289,11 +1240,9 @@ int rsassa_pss_verify(const void *m, size_t mLen, const void *e, const void *n,
     // DB로부터 salt 추출
     memcpy(salt, DB + PS_LEN, SHASIZE/8);
 
-    // m을 hash하여 mHash 획득
-    sha(m, mLen, mHash);
-
-    // MPrime의 첫 8 bytes는 0, 그 이후 mHash, salt를 이어붙임
+    // MPrime의 첫 8 bytes는 0 (마지막 byte는 domain), 그 이후 mHash, salt를 이어붙임
     memset(MPrime, 0x00, 8);
+    MPrime[7] = (unsigned char)domain;
     memcpy(MPrime + 8, mHash, SHASIZE/8);
     memcpy(MPrime + 8 + SHASIZE/8, salt, SHASIZE/8);
 
@@ -308,3 +1257,157 @@ int rsassa_pss_verify(const void *m, size_t mLen, const void *e, const void *n,
     return 0;
 }
 
+/*
+ * rsassa_pss_verify - RSA Signature Scheme with Appendix
+ */
+int rsassa_pss_verify(const void *m, size_t mLen, const void *e, const void *n, const void *s)
+{
+    unsigned char EM[RSAKEYSIZE/8];
+    unsigned char mHash[SHASIZE/8];
+    int ret;
+
+    // s를 EM에 복사
+    memcpy(EM, s, RSAKEYSIZE/8);
+
+    // EM을 (e, n)으로 검증
+    // 이때 RSA 데이터 값이 modulus n보다 크거나 같다면 EM_MSG_OUT_OF_RANGE return
+    INSTR_BEGIN(INSTR_PSS_VERIFY);
+    if (rsa_cipher(EM, e, n))
+        return EM_MSG_OUT_OF_RANGE;
+
+    // m을 hash하여 mHash 획득
+    rsa_pss_hash(m, mLen, mHash);
+
+    ret = pss_decode(mHash, PSS_DOMAIN_MESSAGE, EM);
+    INSTR_END(INSTR_PSS_VERIFY);
+    return ret;
+}
+
+/*
+ * rsassa_pss_verify_hash() - verifies s against the message hash mHash with an imported public key
+ */
+int rsassa_pss_verify_hash(const unsigned char *mHash, const rsa_public_key *key, const void *s)
+{
+    return rsassa_pss_verify_hash_domain(mHash, PSS_DOMAIN_MESSAGE, key, s);
+}
+
+/*
+ * rsassa_pss_verify_hash_domain() - verifies s against mHash in the signing domain domain
+ */
+int rsassa_pss_verify_hash_domain(const unsigned char *mHash, int domain, const rsa_public_key *key, const void *s)
+{
+    unsigned char EM[RSAKEYSIZE/8];
+    int ret;
+
+    if (key->bits != RSAKEYSIZE)
+        return EM_INVALID_KEY;
+    memcpy(EM, s, RSAKEYSIZE/8);
+
+    INSTR_BEGIN(INSTR_PSS_VERIFY);
+    if ((ret = rsa_cipher_pub(EM, key)) != 0)
+        return ret;
+
+    ret = pss_decode(mHash, domain, EM);
+    INSTR_END(INSTR_PSS_VERIFY);
+    return ret;
+}
+
+/*
+ * rsassa_pss_verify_key - RSA Signature Scheme with Appendix using an imported public key
+ * 공개키 변환과 mpz 할당 없이 스레드별 작업 공간에서 검증한다.
+ */
+int rsassa_pss_verify_key(const void *m, size_t mLen, const rsa_public_key *key, const void *s)
+{
+    unsigned char mHash[SHASIZE/8];
+
+    rsa_pss_hash(m, mLen, mHash);
+    return rsassa_pss_verify_hash(mHash, key, s);
+}
+
+/*
+ * rsassa_pss_sign_final - signs the message accumulated in ctx
+ * rsa_pss_stream_update()로 나누어 넣은 메시지 전체에 대한 서명을 만든다.
+ * 서명 결과는 같은 메시지를 rsassa_pss_sign()으로 서명한 것과 같은 형식이다.
+ */
+int rsassa_pss_sign_final(rsa_pss_stream *ctx, const rsa_private_key *key, void *s)
+{
+    unsigned char mHash[SHASIZE/8];
+
+    if (ctx->len > 0x1fffffffffffffff)
+        return EM_MSG_TOO_LONG;
+
+    rsa_pss_stream_digest(ctx, mHash);
+    return rsassa_pss_sign_hash(mHash, key, s);
+}
+
+/*
+ * rsassa_pss_verify_final - verifies s against the message accumulated in ctx
+ */
+int rsassa_pss_verify_final(rsa_pss_stream *ctx, const rsa_public_key *key, const void *s)
+{
+    unsigned char mHash[SHASIZE/8];
+
+    rsa_pss_stream_digest(ctx, mHash);
+    return rsassa_pss_verify_hash(mHash, key, s);
+}
+
+/*
+ * stream_file() - feeds the whole file at path into ctx
+ * PSS_FILE_CHUNK 크기의 버퍼 하나로 끝까지 읽으므로 파일 크기와 상관없이 메모리 사용량이 일정하다.
+ * 파일을 열거나 읽지 못하면 EM_FILE_ERROR, 버퍼를 할당하지 못하면 EM_NO_MEMORY를 리턴한다.
+ */
+static int stream_file(const char *path, rsa_pss_stream *ctx)
+{
+    unsigned char *buf;
+    ssize_t len;
+    int fd, ret = 0;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return EM_FILE_ERROR;
+    if ((buf = malloc(PSS_FILE_CHUNK)) == NULL) {
+        close(fd);
+        return EM_NO_MEMORY;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    rsa_pss_stream_init(ctx);
+    while ((len = read(fd, buf, PSS_FILE_CHUNK)) != 0) {
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            ret = EM_FILE_ERROR;
+            break;
+        }
+        rsa_pss_stream_update(ctx, buf, len);
+    }
+
+    free(buf);
+    close(fd);
+    return ret;
+}
+
+/*
+ * rsassa_pss_sign_file - signs the contents of the file at path
+ */
+int rsassa_pss_sign_file(const char *path, const rsa_private_key *key, void *s)
+{
+    rsa_pss_stream ctx;
+    int ret;
+
+    if ((ret = stream_file(path, &ctx)) != 0)
+        return ret;
+    return rsassa_pss_sign_final(&ctx, key, s);
+}
+
+/*
+ * rsassa_pss_verify_file - verifies s against the contents of the file at path
+ */
+int rsassa_pss_verify_file(const char *path, const rsa_public_key *key, const void *s)
+{
+    rsa_pss_stream ctx;
+    int ret;
+
+    if ((ret = stream_file(path, &ctx)) != 0)
+        return ret;
+    return rsassa_pss_verify_final(&ctx, key, s);
+}
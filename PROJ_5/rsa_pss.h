@@ -5,9 +5,14 @@
 #ifndef RSA_PSS_H
 #define RSA_PSS_H
 
+#include <stdint.h>
+#include <gmp.h>
 #include "sha2.h"
 
 #define RSAKEYSIZE 2048
+#define RSA_MAX_KEYSIZE 4096        /* rsa_generate_key_ex(), *_import_ex()가 받는 최대 키 크기 */
+#define RSA_MAX_PRIMES 4            /* 다중 소수 RSA에서 n의 소인수 개수의 최댓값 */
+#define RSA_PRIME_LEN(bits, k) ((((bits) + (k) - 1) / (k) + 7) / 8)     /* k개 소수 키에서 소수 하나의 바이트 수 */
 #define SHA256
 
 #if defined(SHA224)
@@ -28,11 +33,125 @@
 #define EM_INVALID_PD2 6
 #define EM_HASH_MISMATCH 7
 
+#define EM_INVALID_KEY 8
+#define EM_FILE_ERROR 9
+#define EM_INVALID_PARAMS 10
+#define EM_CORRUPT 11
+#define EM_NO_MEMORY 12             /* 작업 공간이나 키 구조체를 할당하지 못함 (입력과 무관) */
+#define EM_FAULT 13                 /* CRT 서명을 e로 되돌린 값이 입력과 다름 (오류 주입이나 하드웨어 오류) */
+
+/*
+ * 서명 영역 : EMSA-PSS의 M' = padding1 (8 바이트) || mHash || salt에서 padding1의 마지막 바이트
+ * 일반 PSS는 RFC 8017대로 0이고, 다른 방식으로 mHash를 만드는 모드는 자기 값을 써서
+ * 같은 키로 만든 서명이 다른 모드에서 검증되지 않게 한다.
+ */
+#define PSS_DOMAIN_MESSAGE 0x00     /* 메시지 해시 (RFC 8017) */
+#define PSS_DOMAIN_MERKLE 0x02      /* rsa_merkle.h의 트리 해시 */
+
 #define DB_LEN RSAKEYSIZE/8 - SHASIZE/8 - 1
 #define PS_LEN DB_LEN - SHASIZE/8
 
+#if SHASIZE <= 256
+typedef sha256_ctx pss_hash_ctx;
+#define SHA_BLOCKSIZE SHA256_BLOCK_SIZE
+#else
+typedef sha512_ctx pss_hash_ctx;
+#define SHA_BLOCKSIZE SHA512_BLOCK_SIZE
+#endif
+
+#define PSS_FILE_CHUNK (1 << 20)    /* 파일 서명/검증에서 한 번에 읽는 바이트 수 */
+
+/*
+ * rsa_private_key - 한 번 가져온 뒤 계속 재사용하는 개인키
+ * 서명할 때마다 octet string을 변환하지 않고, CRT로 절반 크기의 지수승 두 번을 수행한다.
+ * 지수승은 mpz_powm_sec()과 입력 블라인딩으로 부채널 공격에 대비하고, 결과는 e로 다시 지수승하여
+ * 입력과 비교한다 (한쪽 CRT 결과만 틀린 서명이 나가면 gcd로 n이 인수분해됨).
+ * 다중 소수 키(RFC 8017 3.2)이면 p = r_1, q = r_2이고 셋째 소수부터 r_i, d_i, t_i를 따로 둔다.
+ */
+struct rsa_blinding;
+
+typedef struct {
+    mpz_t n, e, p, q;
+    mpz_t dP;       /* d mod (p-1) */
+    mpz_t dQ;       /* d mod (q-1) */
+    mpz_t qInv;     /* q^-1 mod p */
+    int nprimes;    /* 소수의 개수 u */
+    mpz_t r[RSA_MAX_PRIMES-2];      /* r_i (i = 3, ..., u) */
+    mpz_t d[RSA_MAX_PRIMES-2];      /* d_i = d mod (r_i - 1) */
+    mpz_t t[RSA_MAX_PRIMES-2];      /* t_i = (r_1 * ... * r_(i-1))^-1 mod r_i */
+    int bits;       /* 키 크기 */
+    struct rsa_blinding *blind;     /* 블라인딩 쌍 (r^e, r^-1) */
+} rsa_private_key;
+
+/*
+ * rsa_public_key - 한 번 가져온 뒤 계속 재사용하는 공개키
+ * e = 65537이면 mpz_powm 대신 제곱 16번과 곱셈 1번으로 검증한다.
+ */
+typedef struct {
+    mpz_t n, e;
+    int f4;         /* e = 65537 (F4)이면 1 */
+    int bits;       /* 키 크기 */
+    unsigned char fp[SHASIZE/8];    /* 키 지문 Hash(e || n) */
+} rsa_public_key;
+
+/*
+ * rsa_pss_stream - 메시지를 나누어 넣으며 해시하는 서명/검증 문맥
+ * sha2.c는 메시지 길이를 32 비트로 세므로, 해시 문맥에는 블록 단위로만 넣고
+ * 길이와 마지막 패딩은 여기서 64 비트로 직접 관리한다.
+ */
+typedef struct {
+    pss_hash_ctx h;
+    uint64_t len;                           /* 지금까지 넣은 전체 바이트 수 */
+    size_t used;                            /* buf에 남아 있는 바이트 수 */
+    unsigned char buf[SHA_BLOCKSIZE];
+} rsa_pss_stream;
+
+/*
+ * rsa_scratch - 공개키 연산과 octet 키 지수승에 쓰는 스레드별 mpz 작업 공간
+ * rsa_scratch_get()은 호출한 스레드의 공간을 리턴하며, 처음 부를 때 RSA_MAX_KEYSIZE의 두 배 크기로
+ * 할당하고 (실패하면 NULL) 스레드가 끝나면 해제한다. 함수 하나가 쓰고 리턴하기 전에 다 써야 한다.
+ * crt[]는 rsa_cipher_crt()만 쓰므로 m, x, t를 쓰는 도중에 서명해도 된다.
+ */
+typedef struct {
+    mpz_t m, x, t;
+    mpz_t crt[7 + RSA_MAX_PRIMES - 2];
+    mpz_t ba, bb;                   /* rsa_cipher_blind()의 블라인딩 쌍 A, A^-d (mod n) */
+    unsigned char bfp[SHASIZE/8];   /* 쌍을 만든 키의 Hash(d || n) */
+    int bvalid;                     /* 쌍이 있으면 1 */
+} rsa_scratch;
+
 void rsa_generate_key(void *e, void *d, void *n, int mode);
+void rsa_generate_key_crt(void *e, void *d, void *n, void *p, void *q, int mode);
+int rsa_generate_key_ex(int bits, void *e, void *d, void *n, void *p, void *q, int mode);
+int rsa_generate_key_mp(int bits, int nprimes, void *e, void *d, void *n, void *primes, int mode);
+int rsa_private_key_import(rsa_private_key *key, const void *d, const void *n, const void *p, const void *q);
+int rsa_private_key_import_ex(rsa_private_key *key, int bits, const void *d, const void *n, const void *p, const void *q);
+int rsa_private_key_import_mp(rsa_private_key *key, int bits, int nprimes, const void *d, const void *n, const void *primes);
+int rsa_private_key_set_blinding(rsa_private_key *key, const mpz_t a, const mpz_t ai);
+void rsa_private_key_clear(rsa_private_key *key);
+int rsa_cipher_crt(void *m, size_t len, const rsa_private_key *key);
+int rsa_cipher_blind(void *m, size_t len, const void *d, const void *n);
+rsa_scratch *rsa_scratch_get(void);
 int rsassa_pss_sign(const void *m, size_t mLen, const void *d, const void *n, void *s);
+int rsassa_pss_sign_key(const void *m, size_t mLen, const rsa_private_key *key, void *s);
+int rsassa_pss_sign_hash(const unsigned char *mHash, const rsa_private_key *key, void *s);
+int rsassa_pss_sign_hash_domain(const unsigned char *mHash, int domain, const rsa_private_key *key, void *s);
+int rsa_public_key_import(rsa_public_key *key, const void *e, const void *n);
+int rsa_public_key_import_ex(rsa_public_key *key, int bits, const void *e, const void *n);
+void rsa_public_key_clear(rsa_public_key *key);
 int rsassa_pss_verify(const void *m, size_t mLen, const void *e, const void *n, const void *s);
+int rsassa_pss_verify_key(const void *m, size_t mLen, const rsa_public_key *key, const void *s);
+int rsassa_pss_verify_hash(const unsigned char *mHash, const rsa_public_key *key, const void *s);
+int rsassa_pss_verify_hash_domain(const unsigned char *mHash, int domain, const rsa_public_key *key, const void *s);
+void rsa_pss_hash(const void *m, size_t mLen, unsigned char *mHash);
+void rsa_pss_hash_mb(const unsigned char *const *m, unsigned int len, unsigned char *const *mHash, int count);
+void rsa_pss_hash_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *m,
+                            unsigned int len, unsigned char *const *mHash, int count);
+void rsa_pss_stream_init(rsa_pss_stream *ctx);
+void rsa_pss_stream_update(rsa_pss_stream *ctx, const void *m, size_t mLen);
+int rsassa_pss_sign_final(rsa_pss_stream *ctx, const rsa_private_key *key, void *s);
+int rsassa_pss_verify_final(rsa_pss_stream *ctx, const rsa_public_key *key, const void *s);
+int rsassa_pss_sign_file(const char *path, const rsa_private_key *key, void *s);
+int rsassa_pss_verify_file(const char *path, const rsa_public_key *key, const void *s);
 
 #endif
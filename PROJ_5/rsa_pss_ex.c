@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <gmp.h>
+#include "rsa_pss_ex.h"
+#include "sha2_accel.h"
+#include "rsa_bn.h"
+#include "drbg.h"
+
+#include <bsd/stdlib.h>
+
+#define PSS_MGF_LANES 8
+#define PSS_NAME(name, b, h) PSS_NAME2(name, b, h)
+#define PSS_NAME2(name, b, h) name##_##b##_##h
+
+/*
+ * (키 크기, 해시) 쌍마다 rsa_pss_ex_impl.h를 한 번씩 포함하여 특화된 함수를 만든다.
+ */
+#define PSS_BITS 2048
+#define PSS_HASH 224
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 256
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 384
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 512
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#undef PSS_BITS
+
+#define PSS_BITS 3072
+#define PSS_HASH 224
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 256
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 384
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 512
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#undef PSS_BITS
+
+#define PSS_BITS 4096
+#define PSS_HASH 224
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 256
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 384
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#define PSS_HASH 512
+#include "rsa_pss_ex_impl.h"
+#undef PSS_HASH
+#undef PSS_BITS
+
+/*
+ * 쌍마다 만든 함수의 표, 호출마다 한 번만 찾고 이후에는 특화된 코드만 실행된다.
+ */
+struct pss_impl {
+    int bits, hash;
+    int (*sign)(const void *, size_t, const void *, const void *, void *);
+    int (*verify)(const void *, size_t, const void *, const void *, const void *);
+    int (*sign_key)(const void *, size_t, const rsa_private_key *, void *);
+    int (*verify_key)(const void *, size_t, const rsa_public_key *, const void *);
+};
+
+#define PSS_IMPL(b, h) { b, h, PSS_NAME(sign, b, h), PSS_NAME(verify, b, h), \
+                         PSS_NAME(sign_key, b, h), PSS_NAME(verify_key, b, h) }
+
+static const struct pss_impl pss_impl[] = {
+    PSS_IMPL(2048, 224), PSS_IMPL(2048, 256), PSS_IMPL(2048, 384), PSS_IMPL(2048, 512),
+    PSS_IMPL(3072, 224), PSS_IMPL(3072, 256), PSS_IMPL(3072, 384), PSS_IMPL(3072, 512),
+    PSS_IMPL(4096, 224), PSS_IMPL(4096, 256), PSS_IMPL(4096, 384), PSS_IMPL(4096, 512),
+};
+
+static const struct pss_impl *pss_find(int bits, int hash)
+{
+    for (size_t i = 0; i < sizeof(pss_impl) / sizeof(pss_impl[0]); i++)
+        if (pss_impl[i].bits == bits && pss_impl[i].hash == hash)
+            return &pss_impl[i];
+    return NULL;
+}
+
+/*
+ * rsa_pss_params_supported() - returns 1 if the (key size, hash) pair has an implementation
+ */
+int rsa_pss_params_supported(const rsa_pss_params *prm)
+{
+    return pss_find(prm->bits, prm->hash) != NULL;
+}
+
+/*
+ * rsassa_pss_sign_ex() - rsassa_pss_sign() with the key size and hash given by prm
+ * d, n, s는 prm->bits/8 바이트이다. 지원하지 않는 쌍이면 EM_INVALID_PARAMS를 리턴한다.
+ */
+int rsassa_pss_sign_ex(const rsa_pss_params *prm, const void *m, size_t mLen, const void *d, const void *n, void *s)
+{
+    const struct pss_impl *impl = pss_find(prm->bits, prm->hash);
+
+    if (impl == NULL)
+        return EM_INVALID_PARAMS;
+    return impl->sign(m, mLen, d, n, s);
+}
+
+/*
+ * rsassa_pss_verify_ex() - rsassa_pss_verify() with the key size and hash given by prm
+ */
+int rsassa_pss_verify_ex(const rsa_pss_params *prm, const void *m, size_t mLen, const void *e, const void *n, const void *s)
+{
+    const struct pss_impl *impl = pss_find(prm->bits, prm->hash);
+
+    if (impl == NULL)
+        return EM_INVALID_PARAMS;
+    return impl->verify(m, mLen, e, n, s);
+}
+
+/*
+ * rsassa_pss_sign_key_ex() - signs with a key imported by rsa_private_key_import_ex()
+ * 키 크기는 key->bits를 따르고 해시는 hash로 고른다.
+ */
+int rsassa_pss_sign_key_ex(int hash, const void *m, size_t mLen, const rsa_private_key *key, void *s)
+{
+    const struct pss_impl *impl = pss_find(key->bits, hash);
+
+    if (impl == NULL)
+        return EM_INVALID_PARAMS;
+    return impl->sign_key(m, mLen, key, s);
+}
+
+/*
+ * rsassa_pss_verify_key_ex() - verifies with a key imported by rsa_public_key_import_ex()
+ */
+int rsassa_pss_verify_key_ex(int hash, const void *m, size_t mLen, const rsa_public_key *key, const void *s)
+{
+    const struct pss_impl *impl = pss_find(key->bits, hash);
+
+    if (impl == NULL)
+        return EM_INVALID_PARAMS;
+    return impl->verify_key(m, mLen, key, s);
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_PSS_EX_H
+#define RSA_PSS_EX_H
+
+#include "rsa_pss.h"
+
+/*
+ * 실행 중에 고르는 키 크기와 해시
+ * rsa_pss.h의 RSAKEYSIZE, SHA*는 기존 API의 기본값으로 남고, 아래 API는 호출마다 값을 받는다.
+ * 지원하는 쌍은 {2048, 3072, 4096} x {224, 256, 384, 512}이며, 쌍마다 따로 만든 코드로 처리한다.
+ */
+typedef struct {
+    int bits;       /* RSA 키 크기 */
+    int hash;       /* SHA-2 출력 비트 수 */
+} rsa_pss_params;
+
+int rsa_pss_params_supported(const rsa_pss_params *prm);
+int rsassa_pss_sign_ex(const rsa_pss_params *prm, const void *m, size_t mLen, const void *d, const void *n, void *s);
+int rsassa_pss_verify_ex(const rsa_pss_params *prm, const void *m, size_t mLen, const void *e, const void *n, const void *s);
+int rsassa_pss_sign_key_ex(int hash, const void *m, size_t mLen, const rsa_private_key *key, void *s);
+int rsassa_pss_verify_key_ex(int hash, const void *m, size_t mLen, const rsa_public_key *key, const void *s);
+
+#endif
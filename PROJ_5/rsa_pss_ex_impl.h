@@ -0,0 +1,312 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * (키 크기, 해시) 한 쌍에 특화된 RSASSA-PSS 구현
+ * 포함 가드가 없으며, rsa_pss_ex.c가 PSS_BITS와 PSS_HASH를 정의한 뒤 쌍마다 한 번씩 포함한다.
+ * 모든 버퍼 크기가 상수이므로 스택에 잡히고, 해시 함수도 포인터를 거치지 않고 직접 호출된다.
+ * 만들어지는 함수는 sign_<bits>_<hash>, verify_..., sign_key_..., verify_key_...이다.
+ */
+#define PSS_KLEN (PSS_BITS/8)
+#define PSS_HLEN (PSS_HASH/8)
+#define PSS_DBLEN (PSS_KLEN - PSS_HLEN - 1)
+#define PSS_PSLEN (PSS_DBLEN - PSS_HLEN)
+#define PSS_FN(name) PSS_NAME(name, PSS_BITS, PSS_HASH)
+
+#if PSS_HASH == 224
+#define PSS_CTX sha224_ctx
+#define PSS_INIT sha224_init
+#define PSS_UPDATE sha224_update
+#define PSS_ONE sha224_ni
+#define PSS_MB sha224_mb
+#define PSS_BLOCK SHA224_BLOCK_SIZE
+#define PSS_WORD 4
+#elif PSS_HASH == 256
+#define PSS_CTX sha256_ctx
+#define PSS_INIT sha256_init
+#define PSS_UPDATE sha256_update
+#define PSS_ONE sha256_ni
+#define PSS_MB sha256_mb
+#define PSS_BLOCK SHA256_BLOCK_SIZE
+#define PSS_WORD 4
+#elif PSS_HASH == 384
+#define PSS_CTX sha384_ctx
+#define PSS_INIT sha384_init
+#define PSS_UPDATE sha384_update
+#define PSS_ONE sha384
+#define PSS_MB sha384_mb
+#define PSS_BLOCK SHA384_BLOCK_SIZE
+#define PSS_WORD 8
+#else
+#define PSS_CTX sha512_ctx
+#define PSS_INIT sha512_init
+#define PSS_UPDATE sha512_update
+#define PSS_ONE sha512
+#define PSS_MB sha512_mb
+#define PSS_BLOCK SHA512_BLOCK_SIZE
+#define PSS_WORD 8
+#endif
+
+/*
+ * hash() - computes mHash = Hash(m)
+ * 2^29 바이트 이상이면 rsa_pss_stream과 같이 블록 단위로 넣고 64 비트 길이로 직접 패딩한다.
+ */
+static void PSS_FN(hash)(const void *m, size_t mLen, unsigned char *mHash)
+{
+    const unsigned char *p = m;
+    unsigned char pad[2*PSS_BLOCK];
+    size_t full, chunk, rem, padLen;
+    uint64_t bits = (uint64_t)mLen << 3;
+    PSS_CTX ctx;
+
+    if (mLen < ((size_t)1 << 29)) {
+        PSS_ONE(p, (unsigned int)mLen, mHash);
+        return;
+    }
+    PSS_INIT(&ctx);
+    full = mLen - mLen % PSS_BLOCK;
+    for (size_t off = 0; off < full; off += chunk) {
+        chunk = (full - off < ((size_t)1 << 30)) ? full - off : ((size_t)1 << 30);
+        PSS_UPDATE(&ctx, p + off, (unsigned int)chunk);
+    }
+    rem = mLen - full;
+    padLen = (rem + 1 + PSS_BLOCK/8 <= PSS_BLOCK) ? PSS_BLOCK : 2*PSS_BLOCK;
+    memset(pad, 0, padLen);
+    memcpy(pad, p + full, rem);
+    pad[rem] = 0x80;
+    for (int i=0; i<8; i++)
+        pad[padLen-1-i] = (bits >> (8*i)) & 0xff;
+    PSS_UPDATE(&ctx, pad, (unsigned int)padLen);
+
+    for (int i=0; i<PSS_HLEN; i++)
+        mHash[i] = (ctx.h[i / PSS_WORD] >> (8 * (PSS_WORD - 1 - i % PSS_WORD))) & 0xff;
+}
+
+/*
+ * mgf_xor() - XORs MGF1(H, DB_LEN) into DB, PSS_MGF_LANES counters per multi-buffer call
+ */
+static void PSS_FN(mgf_xor)(const unsigned char *H, unsigned char *DB)
+{
+    unsigned char msg[PSS_MGF_LANES][PSS_HLEN + 4], T[PSS_MGF_LANES][PSS_HLEN];
+    const unsigned char *pm[PSS_MGF_LANES];
+    unsigned char *pt[PSS_MGF_LANES];
+    int count = (PSS_DBLEN + PSS_HLEN - 1) / PSS_HLEN;
+    int i, l, n, off, len;
+
+    for (l = 0; l < PSS_MGF_LANES; l++) {
+        memcpy(msg[l], H, PSS_HLEN);
+        pm[l] = msg[l];
+        pt[l] = T[l];
+    }
+    for (i = 0; i < count; i += n) {
+        n = (count - i < PSS_MGF_LANES) ? count - i : PSS_MGF_LANES;
+        for (l = 0; l < n; l++) {
+            msg[l][PSS_HLEN] = 0;
+            msg[l][PSS_HLEN+1] = 0;
+            msg[l][PSS_HLEN+2] = ((i + l) >> 8) & 0xff;
+            msg[l][PSS_HLEN+3] = (i + l) & 0xff;
+        }
+        PSS_MB(pm, PSS_HLEN + 4, pt, n);
+        for (l = 0; l < n; l++) {
+            off = (i + l) * PSS_HLEN;
+            len = (PSS_DBLEN - off < PSS_HLEN) ? PSS_DBLEN - off : PSS_HLEN;
+            for (int j = 0; j < len; j++)
+                DB[off + j] ^= T[l][j];
+        }
+    }
+}
+
+/*
+ * encode() - EMSA-PSS encoding of mHash into EM (PSS_KLEN bytes), salt length = hLen
+ */
+static int PSS_FN(encode)(const unsigned char *mHash, unsigned char *EM)
+{
+    unsigned char MPrime[8 + 2*PSS_HLEN];
+    unsigned char *salt = MPrime + 8 + PSS_HLEN;
+
+    if (2*PSS_HLEN + 2 > PSS_KLEN)
+        return EM_HASH_TOO_LONG;
+
+    // MPrime = 0x00 * 8 || mHash || salt, H = Hash(MPrime)
+    memset(MPrime, 0x00, 8);
+    memcpy(MPrime + 8, mHash, PSS_HLEN);
+    drbg_bytes(salt, PSS_HLEN);
+    PSS_ONE(MPrime, sizeof(MPrime), EM + PSS_DBLEN);
+    EM[PSS_KLEN - 1] = 0xbc;
+
+    // DB = PS || 0x01 || salt를 EM 앞부분에 만들고 마스크를 XOR
+    memset(EM, 0x00, PSS_PSLEN - 1);
+    EM[PSS_PSLEN - 1] = 0x01;
+    memcpy(EM + PSS_PSLEN, salt, PSS_HLEN);
+    PSS_FN(mgf_xor)(EM + PSS_DBLEN, EM);
+    EM[0] &= 0x7f;
+
+    return 0;
+}
+
+/*
+ * decode() - EMSA-PSS verification of EM against mHash
+ */
+static int PSS_FN(decode)(const unsigned char *mHash, const unsigned char *EM)
+{
+    unsigned char DB[PSS_DBLEN];
+    unsigned char MPrime[8 + 2*PSS_HLEN];
+    unsigned char HPrime[PSS_HLEN];
+    const unsigned char *H = EM + PSS_DBLEN;
+
+    if (EM[PSS_KLEN - 1] != 0xbc)
+        return EM_INVALID_LAST;
+    if (EM[0] & 0x80)
+        return EM_INVALID_INIT;
+
+    memcpy(DB, EM, PSS_DBLEN);
+    PSS_FN(mgf_xor)(H, DB);
+    DB[0] = 0x00;
+
+    for (int i=0; i<PSS_PSLEN-1; i++)
+        if (DB[i] != 0x00)
+            return EM_INVALID_PD2;
+    if (DB[PSS_PSLEN-1] != 0x01)
+        return EM_INVALID_PD2;
+
+    memset(MPrime, 0x00, 8);
+    memcpy(MPrime + 8, mHash, PSS_HLEN);
+    memcpy(MPrime + 8 + PSS_HLEN, DB + PSS_PSLEN, PSS_HLEN);
+    PSS_ONE(MPrime, sizeof(MPrime), HPrime);
+
+    if (memcmp(H, HPrime, PSS_HLEN) != 0)
+        return EM_HASH_MISMATCH;
+    return 0;
+}
+
+/*
+ * cipher() - computes EM^e mod n for octet strings e, n (verification only)
+ * mpz 값은 rsa_scratch_get()의 스레드별 공간 (m = EM, x = e, t = n)에 두므로 호출마다 할당하지 않는다.
+ * 개인키 지수로 서명할 때는 블라인딩하는 rsa_cipher_blind()를 쓴다.
+ */
+static int PSS_FN(cipher)(unsigned char *EM, const void *_k, const void *_n)
+{
+    rsa_scratch *w;
+    int ret = 0;
+#ifdef RSA_BN_FIXED
+    rsa_bn_ctx ctx;
+
+    if (rsa_bn_init(&ctx, _n, PSS_KLEN) == 0)
+        return rsa_bn_powm(EM, EM, _k, PSS_KLEN, &ctx);
+#endif
+
+    if ((w = rsa_scratch_get()) == NULL)
+        return EM_NO_MEMORY;
+    mpz_import(w->m, PSS_KLEN, 1, 1, 1, 0, EM);
+    mpz_import(w->x, PSS_KLEN, 1, 1, 1, 0, _k);
+    mpz_import(w->t, PSS_KLEN, 1, 1, 1, 0, _n);
+    if (mpz_cmp(w->m, w->t) >= 0)
+        ret = EM_MSG_OUT_OF_RANGE;
+    else {
+        mpz_powm(w->m, w->m, w->x, w->t);
+        mpz_export(EM, NULL, 1, PSS_KLEN, 1, 0, w->m);
+    }
+    return ret;
+}
+
+/*
+ * cipher_pub() - computes EM^e mod n with the public key, 16 squarings and a multiply for F4
+ * rsa_pss.c의 rsa_cipher_pub()과 같이 스레드별 작업 공간 (m, x, t)에서 계산한다.
+ */
+static int PSS_FN(cipher_pub)(unsigned char *EM, const rsa_public_key *key)
+{
+    rsa_scratch *w;
+
+    if ((w = rsa_scratch_get()) == NULL)
+        return EM_NO_MEMORY;
+    mpz_import(w->m, PSS_KLEN, 1, 1, 1, 0, EM);
+    if (mpz_cmp(w->m, key->n) >= 0)
+        return EM_MSG_OUT_OF_RANGE;
+    if (key->f4) {
+        mpz_set(w->x, w->m);
+        for (int i=0; i<16; i++) {
+            mpz_mul(w->t, w->x, w->x);
+            mpz_tdiv_r(w->x, w->t, key->n);
+        }
+        mpz_mul(w->t, w->x, w->m);
+        mpz_tdiv_r(w->x, w->t, key->n);
+    }
+    else
+        mpz_powm(w->x, w->m, key->e, key->n);
+    mpz_export(EM, NULL, 1, PSS_KLEN, 1, 0, w->x);
+    return 0;
+}
+
+static int PSS_FN(sign)(const void *m, size_t mLen, const void *d, const void *n, void *s)
+{
+    unsigned char mHash[PSS_HLEN];
+    unsigned char EM[PSS_KLEN];
+    int ret;
+
+    if (PSS_HASH <= 256 && mLen > 0x1fffffffffffffff)
+        return EM_MSG_TOO_LONG;
+    PSS_FN(hash)(m, mLen, mHash);
+    if ((ret = PSS_FN(encode)(mHash, EM)) != 0)
+        return ret;
+    if ((ret = rsa_cipher_blind(EM, PSS_KLEN, d, n)) != 0)
+        return ret;
+    memcpy(s, EM, PSS_KLEN);
+    return 0;
+}
+
+static int PSS_FN(verify)(const void *m, size_t mLen, const void *e, const void *n, const void *s)
+{
+    unsigned char mHash[PSS_HLEN];
+    unsigned char EM[PSS_KLEN];
+    int ret;
+
+    memcpy(EM, s, PSS_KLEN);
+    if ((ret = PSS_FN(cipher)(EM, e, n)) != 0)
+        return ret;
+    PSS_FN(hash)(m, mLen, mHash);
+    return PSS_FN(decode)(mHash, EM);
+}
+
+static int PSS_FN(sign_key)(const void *m, size_t mLen, const rsa_private_key *key, void *s)
+{
+    unsigned char mHash[PSS_HLEN];
+    unsigned char EM[PSS_KLEN];
+    int ret;
+
+    if (PSS_HASH <= 256 && mLen > 0x1fffffffffffffff)
+        return EM_MSG_TOO_LONG;
+    PSS_FN(hash)(m, mLen, mHash);
+    if ((ret = PSS_FN(encode)(mHash, EM)) != 0)
+        return ret;
+    if ((ret = rsa_cipher_crt(EM, PSS_KLEN, key)) != 0)
+        return ret;
+    memcpy(s, EM, PSS_KLEN);
+    return 0;
+}
+
+static int PSS_FN(verify_key)(const void *m, size_t mLen, const rsa_public_key *key, const void *s)
+{
+    unsigned char mHash[PSS_HLEN];
+    unsigned char EM[PSS_KLEN];
+    int ret;
+
+    memcpy(EM, s, PSS_KLEN);
+    if ((ret = PSS_FN(cipher_pub)(EM, key)) != 0)
+        return ret;
+    PSS_FN(hash)(m, mLen, mHash);
+    return PSS_FN(decode)(mHash, EM);
+}
+
+#undef PSS_KLEN
+#undef PSS_HLEN
+#undef PSS_DBLEN
+#undef PSS_PSLEN
+#undef PSS_FN
+#undef PSS_CTX
+#undef PSS_INIT
+#undef PSS_UPDATE
+#undef PSS_ONE
+#undef PSS_MB
+#undef PSS_BLOCK
+#undef PSS_WORD
@@ -0,0 +1,845 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * RSASSA-PSS 서명 데몬
+ * 시작할 때 키를 만들거나 (-k, -b) 미리 계산한 키 저장소 (-K, rsa_keystore.h)를 열어
+ * rsa_private_key/rsa_public_key로 한 번만 가져온 뒤, Unix 소켓으로 들어오는 서명/검증 요청을 작업 스레드 풀에서 처리한다. 프로토콜은 rsa_signd.h 참고.
+ * 연결마다 스레드 하나가 요청을 읽어 큐에 넣고, 작업 스레드는 큐에서 최대 SIGND_BATCH개씩 꺼내 처리한 뒤
+ * 응답을 그 연결의 스레드에 넘긴다. 응답을 소켓에 쓰는 것은 연결 스레드뿐이므로, 응답을 읽지 않는
+ * 클라이언트가 있어도 작업 스레드는 막히지 않는다.
+ * 소켓은 이 사용자만 쓸 수 있는 디렉터리에 0600으로 만들고, 연결한 프로세스의 uid가 데몬과 같거나
+ * root가 아니면 연결을 바로 닫는다. 기본 경로는 signd_socket_path() (rsa_signd.h)이다.
+ * 꺼낸 요청 중 기본 키 크기와 해시의 검증 요청은 rsassa_pss_verify_batch()로 한 번에 검증한다.
+ * 저장소의 키 번호는 저장소 색인 순서 (rsa_keystore_conv -l이 출력하는 순서)이고, 공개키만 있는 키로는 서명하지 않는다.
+ * 주기마다, 그리고 종료할 때 ops/s와 지연 시간의 p50/p99를 표준 오류로 출력한다.
+ * 종료할 때는 새 연결을 막고 모든 연결의 읽기 쪽을 닫아 더 읽지 않기를 기다린 뒤, 큐에 남은 요청을
+ * 처리하고 작업 스레드를 끝내며, 연결 스레드가 남은 응답을 다 쓰기를 기다린다.
+ * -DINSTRUMENT ../PROJ_3/instr.c를 더해 빌드하면 종료할 때 함수별 계측 결과도 출력한다.
+ *
+ * gcc -O2 -pthread -I../PROJ_2 -I../PROJ_3 -o rsa_signd rsa_signd.c rsa_pss.c rsa_pss_ex.c rsa_batch.c rsa_keystore.c rsa_prime.c rsa_bn.c sha2_accel.c sha2.c ../PROJ_2/drbg.c ../PROJ_2/aes.c -lgmp -lbsd
+ * ./rsa_signd [-s socket] [-k 키 수] [-b 키 크기] [-K 키 저장소] [-t 작업 스레드 수] [-B 배치 크기] [-i 출력 주기(초)]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "rsa_pss_ex.h"
+#include "rsa_batch.h"
+#include "rsa_keystore.h"
+#include "rsa_signd.h"
+#include "instr.h"
+
+#include <bsd/stdlib.h>
+
+/*
+ * signd_key - 미리 가져온 키 하나
+ */
+struct signd_key {
+    int bits;
+    int has_priv;                   /* 개인키가 있으면 1 */
+    unsigned char e[RSA_MAX_KEYSIZE/8], n[RSA_MAX_KEYSIZE/8];
+    rsa_private_key priv;
+    rsa_public_key pub;
+};
+
+/*
+ * conn - 클라이언트 연결, 연결 스레드가 만들고 지운다
+ * 연결 스레드는 읽는 동안 conns 목록에 있으므로 종료할 때 읽기 쪽을 닫을 수 있고, 읽기를 마친 뒤에도
+ * 처리 중인 요청 (pending)의 응답을 다 쓸 때까지 남는다. 작업 스레드는 응답을 채운 요청을 out에 붙이고
+ * wake (eventfd)로 연결 스레드를 깨운다.
+ */
+struct conn {
+    int fd;
+    int wake;
+    int pending;                    /* 큐에 넣었지만 아직 응답이 넘어오지 않은 요청 수 */
+    struct req *out, *out_tail;     /* 쓸 응답, lock으로 보호 */
+    pthread_mutex_t lock;
+    struct conn *prev, *next;       /* 읽는 중인 연결 목록, conns_lock으로 보호 */
+};
+
+/*
+ * req - 요청 하나, 응답 프레임도 여기에 채워 연결 스레드에 넘기므로 작업 스레드는 메모리를 잡지 않는다
+ */
+struct req {
+    struct conn *c;
+    signd_hdr h;
+    double t0;                      /* 요청을 다 읽은 시각 */
+    struct req *next;               /* 작업 큐나 conn의 out 목록 */
+    size_t rlen;
+    unsigned char reply[SIGND_HDR_LEN + 2*RSA_MAX_KEYSIZE/8];
+    unsigned char buf[];
+};
+
+/*
+ * worker - 작업 스레드 하나의 통계, lat는 최근 지연 시간을 돌아가며 덮어쓴다
+ */
+struct worker {
+    pthread_t tid;
+    pthread_mutex_t lock;
+    uint64_t ops, batches;
+    size_t nlat;
+    double lat[SIGND_LAT_SAMPLES];
+};
+
+static struct signd_key *keys;
+static int nkeys;
+static rsa_keystore ks;
+static int ks_open;
+
+static struct conn *conns;
+static int nreaders, nconns;        /* 읽는 중인 연결 수, 살아 있는 연결 스레드 수 */
+static pthread_mutex_t conns_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t conns_cond = PTHREAD_COND_INITIALIZER;
+
+static struct req *qhead, *qtail;
+static pthread_mutex_t qlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qcond = PTHREAD_COND_INITIALIZER;
+static int stopping;
+
+static struct worker *workers;
+static int nworkers, batch_max = SIGND_BATCH;
+static double start_time;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * read_full(), write_full() - read or write exactly len bytes, returning -1 on EOF or error
+ */
+static int read_full(int fd, void *_buf, size_t len)
+{
+    unsigned char *buf = _buf;
+    ssize_t r;
+
+    while (len > 0) {
+        r = read(fd, buf, len);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return -1;
+        buf += r;
+        len -= r;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void *_buf, size_t len)
+{
+    const unsigned char *buf = _buf;
+    ssize_t r;
+
+    while (len > 0) {
+        r = send(fd, buf, len, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return -1;
+        buf += r;
+        len -= r;
+    }
+    return 0;
+}
+
+/*
+ * frame() - packs one response frame into buf and returns its length
+ */
+static size_t frame(unsigned char *buf, const signd_hdr *req, int code, const void *out, size_t len)
+{
+    signd_hdr h = *req;
+
+    h.code = (uint8_t)code;
+    h.len = (uint32_t)len;
+    signd_hdr_pack(buf, &h);
+    if (len > 0)
+        memcpy(buf + SIGND_HDR_LEN, out, len);
+    return SIGND_HDR_LEN + len;
+}
+
+/*
+ * reply() - hands the response to r to its connection's thread
+ * 넘긴 뒤에는 연결 스레드가 r과 연결을 지울 수 있으므로 둘 다 다시 건드리지 않는다.
+ */
+static void reply(struct req *r, int code, const void *out, size_t len)
+{
+    struct conn *c = r->c;
+
+    r->rlen = frame(r->reply, &r->h, code, out, len);
+    r->next = NULL;
+    pthread_mutex_lock(&c->lock);
+    if (c->out_tail)
+        c->out_tail->next = r;
+    else
+        c->out = r;
+    c->out_tail = r;
+    c->pending--;
+    eventfd_write(c->wake, 1);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/*
+ * cmp_double() - qsort comparator
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * stats_collect() - sums the worker counters and computes p50/p99 over the recent latencies
+ */
+static void stats_collect(signd_stats *s)
+{
+    double *lat = malloc(nworkers * sizeof(double) * SIGND_LAT_SAMPLES);
+    size_t n = 0, m;
+
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < nworkers; i++) {
+        pthread_mutex_lock(&workers[i].lock);
+        s->ops += workers[i].ops;
+        s->batches += workers[i].batches;
+        m = workers[i].nlat < SIGND_LAT_SAMPLES ? workers[i].nlat : SIGND_LAT_SAMPLES;
+        if (lat)
+            memcpy(lat + n, workers[i].lat, m * sizeof(double));
+        pthread_mutex_unlock(&workers[i].lock);
+        n += m;
+    }
+    if (lat && n > 0) {
+        qsort(lat, n, sizeof(double), cmp_double);
+        s->p50_ns = (uint64_t)(lat[n / 2] * 1e9);
+        s->p99_ns = (uint64_t)(lat[n * 99 / 100] * 1e9);
+    }
+    s->uptime_ns = (uint64_t)((now() - start_time) * 1e9);
+    free(lat);
+}
+
+/*
+ * process_batch() - runs up to SIGND_BATCH requests taken from the queue and hands back the responses
+ * 서명과 기본 값이 아닌 검증은 하나씩, 기본 키 크기와 해시의 검증은 모아서 한 번에 처리한다.
+ */
+static void process_batch(struct worker *w, struct req **r, int n)
+{
+    unsigned char buf[SIGND_BATCH][2*RSA_MAX_KEYSIZE/8];
+    rsa_verify_item item[SIGND_BATCH];
+    int idx[SIGND_BATCH], result[SIGND_BATCH], code[SIGND_BATCH];
+    size_t len[SIGND_BATCH];
+    struct signd_key *k;
+    signd_stats st;
+    int nv = 0, hash;
+    double t;
+
+    for (int i = 0; i < n; i++) {
+        signd_hdr *h = &r[i]->h;
+
+        code[i] = 0;
+        len[i] = 0;
+        k = (h->key < nkeys) ? &keys[h->key] : NULL;
+        hash = h->code ? h->code * 8 : SHASIZE;
+        switch (h->op) {
+        case SIGND_SIGN:
+            if (k == NULL) {
+                code[i] = SIGND_EBADKEY;
+                break;
+            }
+            if (!k->has_priv) {
+                code[i] = EM_INVALID_KEY;
+                break;
+            }
+            code[i] = rsassa_pss_sign_key_ex(hash, r[i]->buf, h->len, &k->priv, buf[i]);
+            if (code[i] == 0)
+                len[i] = k->bits / 8;
+            break;
+        case SIGND_VERIFY:
+            if (k == NULL) {
+                code[i] = SIGND_EBADKEY;
+                break;
+            }
+            if (h->len < (uint32_t)k->bits / 8) {
+                code[i] = EM_INVALID_PARAMS;
+                break;
+            }
+            if (k->bits == RSAKEYSIZE && hash == SHASIZE) {
+                item[nv].s = r[i]->buf;
+                item[nv].m = r[i]->buf + k->bits / 8;
+                item[nv].mLen = h->len - k->bits / 8;
+                item[nv].key = &k->pub;
+                idx[nv++] = i;
+            } else {
+                code[i] = rsassa_pss_verify_key_ex(hash, r[i]->buf + k->bits / 8, h->len - k->bits / 8,
+                                                   &k->pub, r[i]->buf);
+            }
+            break;
+        case SIGND_PUBKEY:
+            if (k == NULL) {
+                code[i] = SIGND_EBADKEY;
+                break;
+            }
+            memcpy(buf[i], k->e, k->bits / 8);
+            memcpy(buf[i] + k->bits / 8, k->n, k->bits / 8);
+            len[i] = 2 * k->bits / 8;
+            break;
+        case SIGND_STATS:
+            stats_collect(&st);
+            signd_stats_pack(buf[i], &st);
+            len[i] = SIGND_STATS_LEN;
+            break;
+        default:
+            code[i] = SIGND_EBADOP;
+        }
+    }
+
+    // 모은 검증 요청은 길이가 같은 메시지끼리 멀티 버퍼로 해시됨
+    if (nv > 0) {
+        rsassa_pss_verify_batch(item, nv, result, 1, NULL, NULL);
+        for (int j = 0; j < nv; j++)
+            code[idx[j]] = result[j];
+    }
+
+    // 응답을 넘기면 r[i]는 연결 스레드가 지우므로 지연 시간을 먼저 기록
+    t = now();
+    pthread_mutex_lock(&w->lock);
+    for (int i = 0; i < n; i++)
+        w->lat[w->nlat++ % SIGND_LAT_SAMPLES] = t - r[i]->t0;
+    w->ops += n;
+    w->batches++;
+    pthread_mutex_unlock(&w->lock);
+
+    for (int i = 0; i < n; i++)
+        reply(r[i], code[i], buf[i], len[i]);
+}
+
+static void *worker_run(void *arg)
+{
+    struct worker *w = arg;
+    struct req *batch[SIGND_BATCH];
+    int n;
+
+    while (1) {
+        pthread_mutex_lock(&qlock);
+        while (qhead == NULL && !stopping)
+            pthread_cond_wait(&qcond, &qlock);
+        // 종료할 때는 큐에 남은 요청을 모두 처리한 뒤 끝낸다
+        if (qhead == NULL) {
+            pthread_mutex_unlock(&qlock);
+            break;
+        }
+        for (n = 0; n < batch_max && qhead != NULL; n++) {
+            batch[n] = qhead;
+            qhead = qhead->next;
+        }
+        if (qhead == NULL)
+            qtail = NULL;
+        pthread_mutex_unlock(&qlock);
+        process_batch(w, batch, n);
+    }
+    return NULL;
+}
+
+static void enqueue(struct req *r)
+{
+    r->next = NULL;
+    pthread_mutex_lock(&qlock);
+    if (qtail)
+        qtail->next = r;
+    else
+        qhead = r;
+    qtail = r;
+    pthread_cond_signal(&qcond);
+    pthread_mutex_unlock(&qlock);
+}
+
+/*
+ * read_request() - reads one request frame and queues it, returning -1 when the connection stops reading
+ * 너무 긴 요청이 오면 오류를 응답하고 더 읽지 않는다. 메모리가 부족하면 내용을 버리고 오류를 응답한다.
+ * 이 두 응답은 연결 스레드가 직접 쓴다.
+ */
+static int read_request(struct conn *c)
+{
+    unsigned char hdr[SIGND_HDR_LEN], skip[4096];
+    struct req *r;
+    signd_hdr h;
+    size_t left, m;
+
+    if (read_full(c->fd, hdr, sizeof(hdr)) < 0)
+        return -1;
+    signd_hdr_unpack(hdr, &h);
+    if (h.len > SIGND_MAX_MSG) {
+        write_full(c->fd, hdr, frame(hdr, &h, SIGND_ETOOLONG, NULL, 0));
+        return -1;
+    }
+    r = malloc(sizeof(struct req) + h.len);
+    if (r == NULL) {
+        for (left = h.len; left > 0; left -= m) {
+            m = left < sizeof(skip) ? left : sizeof(skip);
+            if (read_full(c->fd, skip, m) < 0)
+                return -1;
+        }
+        return write_full(c->fd, hdr, frame(hdr, &h, SIGND_ENOMEM, NULL, 0));
+    }
+    if (read_full(c->fd, r->buf, h.len) < 0) {
+        free(r);
+        return -1;
+    }
+    r->c = c;
+    r->h = h;
+    r->t0 = now();
+    pthread_mutex_lock(&c->lock);
+    c->pending++;
+    pthread_mutex_unlock(&c->lock);
+    enqueue(r);
+    return 0;
+}
+
+/*
+ * conn_unlist() - takes a connection that stopped reading off the conns list
+ */
+static void conn_unlist(struct conn *c)
+{
+    pthread_mutex_lock(&conns_lock);
+    if (c->prev)
+        c->prev->next = c->next;
+    else
+        conns = c->next;
+    if (c->next)
+        c->next->prev = c->prev;
+    nreaders--;
+    pthread_cond_broadcast(&conns_cond);
+    pthread_mutex_unlock(&conns_lock);
+}
+
+/*
+ * conn_run() - one connection: reads requests and writes the responses the workers hand back
+ * 소켓과 wake를 함께 poll()하다가 요청이 오면 읽고, 응답이 넘어오면 쓴다. 쓰기가 실패하면 (상대가
+ * 끊음) 남은 응답은 버린다. 읽기를 마치면 conns 목록에서 빠지고, 처리 중인 요청이 모두 돌아오면 끝난다.
+ */
+static void *conn_run(void *arg)
+{
+    struct conn *c = arg;
+    struct pollfd pfd[2];
+    struct req *r, *next;
+    int reading = 1, broken = 0, done;
+    eventfd_t v;
+
+    pfd[0].fd = c->fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = c->wake;
+    pfd[1].events = POLLIN;
+    while (1) {
+        pthread_mutex_lock(&c->lock);
+        r = c->out;
+        c->out = c->out_tail = NULL;
+        done = !reading && c->pending == 0;
+        pthread_mutex_unlock(&c->lock);
+        for (; r != NULL; r = next) {
+            next = r->next;
+            if (!broken && write_full(c->fd, r->reply, r->rlen) < 0)
+                broken = 1;
+            free(r);
+        }
+        if (done)
+            break;
+        if (reading && broken) {
+            reading = 0;
+            conn_unlist(c);
+            continue;
+        }
+        // 읽기를 마친 뒤에는 소켓을 빼고 wake만 기다림
+        pfd[0].fd = reading ? c->fd : -1;
+        if (poll(pfd, 2, -1) < 0)
+            continue;
+        if (pfd[1].revents & POLLIN)
+            eventfd_read(c->wake, &v);
+        if (reading && (pfd[0].revents & (POLLIN | POLLHUP | POLLERR)) && read_request(c) < 0) {
+            reading = 0;
+            conn_unlist(c);
+        }
+    }
+    close(c->fd);
+    close(c->wake);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+    pthread_mutex_lock(&conns_lock);
+    nconns--;
+    pthread_cond_broadcast(&conns_cond);
+    pthread_mutex_unlock(&conns_lock);
+    return NULL;
+}
+
+/*
+ * peer_allowed() - accepts only peers running as the daemon's user or root (SO_PEERCRED)
+ */
+static int peer_allowed(int fd)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        perror("signd: SO_PEERCRED");
+        return 0;
+    }
+    if (cred.uid != geteuid() && cred.uid != 0) {
+        fprintf(stderr, "signd: rejected connection from uid %u (pid %d)\n", (unsigned)cred.uid, (int)cred.pid);
+        return 0;
+    }
+    return 1;
+}
+
+static void *acceptor(void *arg)
+{
+    int lfd = *(int *)arg, fd;
+    pthread_attr_t attr;
+    pthread_t tid;
+    struct conn *c;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (1) {
+        fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        if (!peer_allowed(fd) || (c = calloc(1, sizeof(struct conn))) == NULL) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        if ((c->wake = eventfd(0, EFD_CLOEXEC)) < 0) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        pthread_mutex_init(&c->lock, NULL);
+        // 연결 스레드를 만들기 전에 목록에 넣어야 종료할 때 빠지는 연결이 없음
+        pthread_mutex_lock(&conns_lock);
+        c->prev = NULL;
+        c->next = conns;
+        if (conns)
+            conns->prev = c;
+        conns = c;
+        nreaders++;
+        nconns++;
+        if (pthread_create(&tid, &attr, conn_run, c) != 0) {
+            conns = c->next;
+            if (conns)
+                conns->prev = NULL;
+            nreaders--;
+            nconns--;
+            pthread_mutex_unlock(&conns_lock);
+            pthread_mutex_destroy(&c->lock);
+            close(c->wake);
+            close(fd);
+            free(c);
+            continue;
+        }
+        pthread_mutex_unlock(&conns_lock);
+    }
+    pthread_attr_destroy(&attr);
+    return NULL;
+}
+
+/*
+ * report() - prints the throughput since the previous report and the latency percentiles
+ */
+static void report(uint64_t *last_ops, double *last_t)
+{
+    signd_stats st;
+    double t;
+
+    stats_collect(&st);
+    t = now();
+    fprintf(stderr, "signd: %10.0f ops/s   p50 %9.1f us   p99 %9.1f us   %5.2f req/batch   %llu ops\n",
+            (st.ops - *last_ops) / (t - *last_t), st.p50_ns / 1e3, st.p99_ns / 1e3,
+            st.batches ? (double)st.ops / st.batches : 0.0, (unsigned long long)st.ops);
+    *last_ops = st.ops;
+    *last_t = t;
+}
+
+static int load_keys(int count, int bits)
+{
+    unsigned char d[RSA_MAX_KEYSIZE/8], p[RSA_MAX_KEYSIZE/16], q[RSA_MAX_KEYSIZE/16];
+    int ret = 0;
+
+    keys = calloc(count, sizeof(struct signd_key));
+    if (keys == NULL)
+        return -1;
+    for (nkeys = 0; nkeys < count; nkeys++) {
+        struct signd_key *k = &keys[nkeys];
+
+        k->bits = bits;
+        k->has_priv = 1;
+        if (rsa_generate_key_ex(bits, k->e, d, k->n, p, q, 0) != 0 ||
+            rsa_private_key_import_ex(&k->priv, bits, d, k->n, p, q) != 0) {
+            ret = -1;
+            break;
+        }
+        if (rsa_public_key_import_ex(&k->pub, bits, k->e, k->n) != 0) {
+            rsa_private_key_clear(&k->priv);
+            ret = -1;
+            break;
+        }
+    }
+    // 개인키는 rsa_private_key 안에만 남긴다
+    explicit_bzero(d, sizeof(d));
+    explicit_bzero(p, sizeof(p));
+    explicit_bzero(q, sizeof(q));
+    return ret;
+}
+
+/*
+ * load_keystore() - takes every key of a keystore made by rsa_keystore_conv
+ * 키는 매핑된 저장소를 그대로 가리키므로 저장소는 종료할 때까지 열어 둔다.
+ * PUBKEY 응답에 쓰는 e, n은 키 크기/8 바이트 octet string으로 한 번 내보내 둔다.
+ */
+static int load_keystore(const char *path)
+{
+    int ret;
+
+    if ((ret = rsa_keystore_open(&ks, path)) != 0) {
+        fprintf(stderr, "signd: %s: cannot open keystore (%d)\n", path, ret);
+        return -1;
+    }
+    ks_open = 1;
+    if (ks.count < 1 || ks.count > 65536 || (keys = calloc(ks.count, sizeof(struct signd_key))) == NULL) {
+        fprintf(stderr, "signd: %s: %d keys\n", path, ks.count);
+        return -1;
+    }
+    for (nkeys = 0; nkeys < ks.count; nkeys++) {
+        struct signd_key *k = &keys[nkeys];
+        size_t klen;
+
+        if ((ret = rsa_keystore_public(&ks, nkeys, &k->pub)) != 0)
+            break;
+        k->bits = k->pub.bits;
+        klen = k->bits / 8;
+        if (k->bits > RSA_MAX_KEYSIZE || mpz_sizeinbase(k->pub.e, 256) > klen) {
+            ret = EM_INVALID_KEY;
+            break;
+        }
+        mpz_export(k->e + klen - mpz_sizeinbase(k->pub.e, 256), NULL, 1, 1, 1, 0, k->pub.e);
+        mpz_export(k->n, NULL, 1, 1, 1, 0, k->pub.n);
+        if (ks.index[nkeys].flags & RSA_KS_PRIVATE) {
+            if ((ret = rsa_keystore_private(&ks, nkeys, &k->priv)) != 0)
+                break;
+            k->has_priv = 1;
+        }
+    }
+    if (ret != 0) {
+        fprintf(stderr, "signd: %s: key %d (%d)\n", path, nkeys, ret);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * socket_dir_ok() - checks that only this user (or root) can write to the directory holding path
+ * 그래야 다른 사용자가 소켓을 지우거나 바꿔치지 못한다. create가 1이면 없는 디렉터리를 0700으로 만든다.
+ * /tmp처럼 모두가 쓸 수 있는 디렉터리나 심볼릭 링크는 거부한다.
+ */
+static int socket_dir_ok(const char *path, int create)
+{
+    char dir[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    char *slash;
+    struct stat st;
+
+    strcpy(dir, path);
+    if ((slash = strrchr(dir, '/')) == NULL)
+        strcpy(dir, ".");
+    else if (slash == dir)
+        dir[1] = '\0';
+    else
+        *slash = '\0';
+    if (create && mkdir(dir, 0700) < 0 && errno != EEXIST) {
+        fprintf(stderr, "signd: %s: %s\n", dir, strerror(errno));
+        return 0;
+    }
+    if (lstat(dir, &st) < 0) {
+        fprintf(stderr, "signd: %s: %s\n", dir, strerror(errno));
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode) || (st.st_uid != geteuid() && st.st_uid != 0) || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+        fprintf(stderr, "signd: %s: socket directory must be owned by this user and writable only by it\n", dir);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * remove_stale() - removes a socket left at path by an earlier run of this user
+ * 경로에 있는 것이 이 사용자의 소켓이 아니거나, 다른 데몬이 아직 듣고 있으면 지우지 않고 0을 리턴한다.
+ */
+static int remove_stale(const struct sockaddr_un *addr)
+{
+    struct stat st;
+    int fd, live;
+
+    if (lstat(addr->sun_path, &st) < 0)
+        return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode) || st.st_uid != geteuid()) {
+        fprintf(stderr, "signd: %s exists and is not this user's socket\n", addr->sun_path);
+        return 0;
+    }
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return 0;
+    live = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(fd);
+    if (live) {
+        fprintf(stderr, "signd: another daemon is listening on %s\n", addr->sun_path);
+        return 0;
+    }
+    return unlink(addr->sun_path) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static char defpath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    const char *path = NULL, *store = NULL;
+    struct conn *c;
+    int count = 1, bits = RSAKEYSIZE, interval = 5, opt, lfd;
+    struct sockaddr_un addr;
+    struct timespec ts;
+    pthread_t acc;
+    sigset_t set;
+    mode_t mask;
+    uint64_t last_ops = 0;
+    double last_t;
+
+    nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    while ((opt = getopt(argc, argv, "s:k:b:K:t:B:i:")) != -1) {
+        switch (opt) {
+        case 's': path = optarg; break;
+        case 'k': count = atoi(optarg); break;
+        case 'b': bits = atoi(optarg); break;
+        case 'K': store = optarg; break;
+        case 't': nworkers = atoi(optarg); break;
+        case 'B': batch_max = atoi(optarg); break;
+        case 'i': interval = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s socket] [-k keys] [-b bits] [-K keystore] [-t threads] [-B batch] [-i seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (path == NULL && signd_socket_path(defpath, sizeof(defpath)) == 0)
+        path = defpath;
+    if (count < 1 || count > 65536 || nworkers < 1 || batch_max < 1 || batch_max > SIGND_BATCH || interval < 1 ||
+        path == NULL || strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "signd: invalid option\n");
+        return 1;
+    }
+
+    // SIGINT, SIGTERM은 모든 스레드에서 막고 main에서만 sigtimedwait()로 받는다
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    if (store != NULL) {
+        if (load_keystore(store) < 0)
+            return 1;
+    } else if (load_keys(count, bits) < 0) {
+        fprintf(stderr, "signd: cannot create %d-bit keys\n", bits);
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (!socket_dir_ok(path, path == defpath) || !remove_stale(&addr))
+        return 1;
+    // 소켓 파일은 bind()가 만들 때부터 0600이어야 함
+    lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    mask = umask(0177);
+    if (lfd < 0 || bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("signd");
+        return 1;
+    }
+    umask(mask);
+    if (listen(lfd, 128) < 0) {
+        perror("signd");
+        unlink(path);
+        return 1;
+    }
+
+    start_time = last_t = now();
+    workers = calloc(nworkers, sizeof(struct worker));
+    if (workers == NULL) {
+        perror("signd");
+        return 1;
+    }
+    for (int i = 0; i < nworkers; i++) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        if (pthread_create(&workers[i].tid, NULL, worker_run, &workers[i]) != 0) {
+            perror("signd");
+            return 1;
+        }
+    }
+    if (pthread_create(&acc, NULL, acceptor, &lfd) != 0) {
+        perror("signd");
+        return 1;
+    }
+    if (store != NULL)
+        fprintf(stderr, "signd: %d keys from %s, %d workers, batch %d, listening on %s\n",
+                nkeys, store, nworkers, batch_max, path);
+    else
+        fprintf(stderr, "signd: %d x %d-bit keys, %d workers, batch %d, listening on %s\n",
+                nkeys, bits, nworkers, batch_max, path);
+
+    ts.tv_sec = interval;
+    ts.tv_nsec = 0;
+    while (sigtimedwait(&set, NULL, &ts) < 0)
+        if (errno == EAGAIN)
+            report(&last_ops, &last_t);
+
+    // 새 연결을 막고, 모든 연결이 읽기를 마친 뒤 큐에 남은 요청을 처리하고 마지막 통계를 출력
+    shutdown(lfd, SHUT_RDWR);
+    close(lfd);
+    pthread_join(acc, NULL);
+    unlink(path);
+    // 읽기 쪽을 닫으면 read()가 EOF를 돌려주므로 연결 스레드는 더 넣지 않음 (응답은 계속 씀)
+    pthread_mutex_lock(&conns_lock);
+    for (c = conns; c != NULL; c = c->next)
+        shutdown(c->fd, SHUT_RD);
+    while (nreaders > 0)
+        pthread_cond_wait(&conns_cond, &conns_lock);
+    pthread_mutex_unlock(&conns_lock);
+    pthread_mutex_lock(&qlock);
+    stopping = 1;
+    pthread_cond_broadcast(&qcond);
+    pthread_mutex_unlock(&qlock);
+    for (int i = 0; i < nworkers; i++)
+        pthread_join(workers[i].tid, NULL);
+    pthread_mutex_lock(&conns_lock);
+    while (nconns > 0)
+        pthread_cond_wait(&conns_cond, &conns_lock);
+    pthread_mutex_unlock(&conns_lock);
+    report(&last_ops, &last_t);
+    instr_dump(stderr);
+
+    for (int i = 0; i < nkeys; i++) {
+        if (keys[i].has_priv)
+            rsa_private_key_clear(&keys[i].priv);
+        rsa_public_key_clear(&keys[i].pub);
+    }
+    if (ks_open)
+        rsa_keystore_close(&ks);
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef RSA_SIGND_H
+#define RSA_SIGND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * 서명 데몬 프로토콜 (rsa_signd.c, rsa_signd_load.c)
+ * Unix 도메인 스트림 소켓 위에서 12 바이트 헤더와 len 바이트 내용으로 된 프레임을 주고받는다.
+ * 정수는 모두 big-endian이다. 요청을 응답을 기다리지 않고 연달아 보낼 수 있으며,
+ * 응답은 처리가 끝난 순서로 오므로 id로 요청과 짝을 맞춘다.
+ *
+ *   요청 : op(1) hash(1) key(2) id(4) len(4) | 내용
+ *   응답 : op(1) code(1) key(2) id(4) len(4) | 내용
+ *
+ *   SIGND_SIGN    내용 = 메시지                     응답 = 서명 (키 크기/8 바이트)
+ *   SIGND_VERIFY  내용 = 서명 (키 크기/8) || 메시지  응답 = 없음, code가 검증 결과
+ *   SIGND_PUBKEY  내용 = 없음                       응답 = e || n (각각 키 크기/8 바이트)
+ *   SIGND_STATS   내용 = 없음                       응답 = signd_stats를 big-endian으로 직렬화한 값
+ *
+ * hash는 SHA-2 출력 비트 수를 8로 나눈 값(28, 32, 48, 64)이고 0이면 SHASIZE를 쓴다.
+ * code는 0이면 성공, EM_* 값이면 rsa_pss 함수의 오류, SIGND_E* 값이면 프로토콜 오류이다.
+ *
+ * 소켓은 데몬을 실행한 사용자만 쓸 수 있는 디렉터리 (signd_socket_path() 참고)에 0600으로 만들고,
+ * 데몬은 연결한 프로세스의 uid가 자기와 같거나 root일 때만 요청을 받는다.
+ */
+#define SIGND_SOCKET_NAME "rsa_signd.sock"
+#define SIGND_HDR_LEN 12
+#define SIGND_MAX_MSG (1 << 20)     /* 요청 내용의 최대 길이 */
+#define SIGND_BATCH 16              /* 작업 스레드가 큐에서 한 번에 꺼내는 최대 요청 수 */
+#define SIGND_LAT_SAMPLES 8192      /* 작업 스레드마다 백분위수 계산에 남기는 최근 지연 시간 수 */
+
+#define SIGND_SIGN 1
+#define SIGND_VERIFY 2
+#define SIGND_PUBKEY 3
+#define SIGND_STATS 4
+
+#define SIGND_EBADOP 0x80           /* 알 수 없는 op */
+#define SIGND_EBADKEY 0x81          /* 없는 키 번호 */
+#define SIGND_ETOOLONG 0x82         /* len > SIGND_MAX_MSG */
+#define SIGND_ENOMEM 0x83           /* 메모리 부족 */
+
+typedef struct {
+    uint8_t op;
+    uint8_t code;                   /* 요청에서는 hash, 응답에서는 결과 코드 */
+    uint16_t key;
+    uint32_t id;
+    uint32_t len;
+} signd_hdr;
+
+/*
+ * signd_stats - 데몬이 시작된 뒤의 누적 통계, 지연 시간은 요청을 다 읽은 때부터 응답을 연결 스레드에 넘긴 때까지
+ */
+typedef struct {
+    uint64_t ops;                   /* 처리한 요청 수 */
+    uint64_t batches;               /* 작업 스레드가 큐에서 꺼낸 횟수 */
+    uint64_t p50_ns, p99_ns;        /* 최근 지연 시간의 중앙값과 99번째 백분위수 */
+    uint64_t uptime_ns;
+} signd_stats;
+
+#define SIGND_STATS_LEN 40
+
+/*
+ * signd_socket_path() - writes the default socket path into buf, returning -1 if it does not fit
+ * $XDG_RUNTIME_DIR가 있으면 그 아래, 없으면 /tmp/rsa_signd-<uid> 아래의 rsa_signd.sock이다.
+ * /tmp 아래 디렉터리는 데몬이 0700으로 만들고, 다른 사용자가 미리 만들어 둔 것이면 데몬이 거부한다.
+ */
+static inline int signd_socket_path(char *buf, size_t len)
+{
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    int r;
+
+    if (dir != NULL && dir[0] == '/')
+        r = snprintf(buf, len, "%s/%s", dir, SIGND_SOCKET_NAME);
+    else
+        r = snprintf(buf, len, "/tmp/rsa_signd-%u/%s", (unsigned)getuid(), SIGND_SOCKET_NAME);
+    return (r < 0 || (size_t)r >= len) ? -1 : 0;
+}
+
+static inline void signd_put32(unsigned char *p, uint32_t x)
+{
+    p[0] = x >> 24; p[1] = x >> 16; p[2] = x >> 8; p[3] = x;
+}
+
+static inline uint32_t signd_get32(const unsigned char *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline void signd_hdr_pack(unsigned char *p, const signd_hdr *h)
+{
+    p[0] = h->op;
+    p[1] = h->code;
+    p[2] = h->key >> 8;
+    p[3] = h->key;
+    signd_put32(p + 4, h->id);
+    signd_put32(p + 8, h->len);
+}
+
+static inline void signd_hdr_unpack(const unsigned char *p, signd_hdr *h)
+{
+    h->op = p[0];
+    h->code = p[1];
+    h->key = (uint16_t)(p[2] << 8 | p[3]);
+    h->id = signd_get32(p + 4);
+    h->len = signd_get32(p + 8);
+}
+
+static inline void signd_stats_pack(unsigned char *p, const signd_stats *s)
+{
+    const uint64_t v[5] = { s->ops, s->batches, s->p50_ns, s->p99_ns, s->uptime_ns };
+
+    for (int i = 0; i < 5; i++) {
+        signd_put32(p + 8*i, (uint32_t)(v[i] >> 32));
+        signd_put32(p + 8*i + 4, (uint32_t)v[i]);
+    }
+}
+
+static inline void signd_stats_unpack(const unsigned char *p, signd_stats *s)
+{
+    uint64_t v[5];
+
+    for (int i = 0; i < 5; i++)
+        v[i] = (uint64_t)signd_get32(p + 8*i) << 32 | signd_get32(p + 8*i + 4);
+    s->ops = v[0];
+    s->batches = v[1];
+    s->p50_ns = v[2];
+    s->p99_ns = v[3];
+    s->uptime_ns = v[4];
+}
+
+#endif
@@ -0,0 +1,334 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+/*
+ * rsa_signd 부하 생성기
+ * 연결마다 스레드 하나가 요청을 depth개까지 응답을 기다리지 않고 보내며, 정해진 시간 동안
+ * 응답 하나를 받을 때마다 새 요청 하나를 보낸다. 요청을 보낸 때부터 응답을 받은 때까지의
+ * 지연 시간을 모아 ops/s와 p50/p99/p99.9를 출력하고, 마지막에 데몬 쪽 통계도 받아 출력한다.
+ * 연결마다 처음 받은 서명은 SIGND_PUBKEY로 받은 공개키로 직접 검증해 본다.
+ *
+ * gcc -O2 -pthread -I../PROJ_2 -I../PROJ_3 -o rsa_signd_load rsa_signd_load.c rsa_pss.c rsa_pss_ex.c rsa_prime.c rsa_bn.c sha2_accel.c sha2.c ../PROJ_2/drbg.c ../PROJ_2/aes.c -lgmp -lbsd
+ * ./rsa_signd_load [-s socket] [-o sign|verify|mix] [-c 연결 수] [-d 연결당 동시 요청 수]
+ *                  [-T 시간(초)] [-m 메시지 길이] [-k 키 수] [-h 해시 비트 수]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "rsa_pss_ex.h"
+#include "rsa_signd.h"
+
+#include <bsd/stdlib.h>
+
+#define LOAD_MAX_DEPTH 256
+
+struct client {
+    pthread_t tid;
+    int id;
+    double *lat;                    /* 응답마다의 지연 시간 */
+    size_t nlat, cap;
+    size_t errors;                  /* code가 0이 아닌 응답 수 */
+    int checked;                    /* 직접 검증한 서명이 맞으면 1, 틀리면 -1 */
+};
+
+static const char *path;
+static int op = SIGND_SIGN, depth = 8, seconds = 5, nkeys = 1, hash;
+static size_t mlen = 256;
+static double deadline;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int read_full(int fd, void *_buf, size_t len)
+{
+    unsigned char *buf = _buf;
+    ssize_t r;
+
+    while (len > 0) {
+        r = read(fd, buf, len);
+        if (r <= 0)
+            return -1;
+        buf += r;
+        len -= r;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void *_buf, size_t len)
+{
+    const unsigned char *buf = _buf;
+    ssize_t r;
+
+    while (len > 0) {
+        r = send(fd, buf, len, MSG_NOSIGNAL);
+        if (r < 0)
+            return -1;
+        buf += r;
+        len -= r;
+    }
+    return 0;
+}
+
+static int connect_signd(void)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * call() - sends one request and waits for its response; out receives at most cap bytes
+ * 응답의 code를 리턴하고, 통신 오류이면 -1을 리턴한다.
+ */
+static int call(int fd, int op, int key, const void *in, size_t len, void *out, size_t cap, size_t *outlen)
+{
+    unsigned char hdr[SIGND_HDR_LEN];
+    signd_hdr h = { (uint8_t)op, (uint8_t)(hash / 8), (uint16_t)key, 0, (uint32_t)len };
+
+    signd_hdr_pack(hdr, &h);
+    if (write_full(fd, hdr, sizeof(hdr)) < 0 || (len > 0 && write_full(fd, in, len) < 0))
+        return -1;
+    if (read_full(fd, hdr, sizeof(hdr)) < 0)
+        return -1;
+    signd_hdr_unpack(hdr, &h);
+    if (h.len > cap || (h.len > 0 && read_full(fd, out, h.len) < 0))
+        return -1;
+    if (outlen)
+        *outlen = h.len;
+    return h.code;
+}
+
+static void record(struct client *cl, double t)
+{
+    double *p;
+
+    if (cl->nlat == cl->cap) {
+        p = realloc(cl->lat, (cl->cap ? 2 * cl->cap : 4096) * sizeof(double));
+        if (p == NULL)
+            return;
+        cl->lat = p;
+        cl->cap = cl->cap ? 2 * cl->cap : 4096;
+    }
+    cl->lat[cl->nlat++] = t;
+}
+
+/*
+ * client_run() - one connection: prepares a signed message per key, then keeps depth requests in flight
+ * 검증 요청에 쓸 서명은 시작할 때 데몬에게 서명받아 둔다. mix는 서명과 검증을 번갈아 보낸다.
+ */
+static void *client_run(void *arg)
+{
+    struct client *cl = arg;
+    unsigned char pub[2*RSA_MAX_KEYSIZE/8], hdr[SIGND_HDR_LEN], *frame, *sig, *resp;
+    double sent[LOAD_MAX_DEPTH];
+    int free_slot[LOAD_MAX_DEPTH];
+    size_t klen, plen, flen;
+    uint32_t next = 0;
+    int fd, outstanding = 0, kop, code, bits, slot;
+    signd_hdr h;
+    rsa_public_key key;
+
+    fd = connect_signd();
+    if (fd < 0) {
+        perror("connect");
+        return NULL;
+    }
+    // 공개키를 받아 키 크기를 알아낸다
+    if (call(fd, SIGND_PUBKEY, 0, NULL, 0, pub, sizeof(pub), &plen) != 0) {
+        fprintf(stderr, "load: SIGND_PUBKEY failed\n");
+        close(fd);
+        return NULL;
+    }
+    klen = plen / 2;
+    bits = (int)klen * 8;
+
+    // frame[k]는 키 k에 보낼 검증 요청의 내용 (서명 || 메시지)
+    flen = klen + mlen;
+    frame = malloc(nkeys * flen);
+    resp = malloc(klen);
+    if (frame == NULL || resp == NULL) {
+        close(fd);
+        free(frame);
+        return NULL;
+    }
+    for (int k = 0; k < nkeys; k++) {
+        sig = frame + k * flen;
+        arc4random_buf(sig + klen, mlen);
+        if (call(fd, SIGND_SIGN, k, sig + klen, mlen, sig, klen, NULL) != 0) {
+            fprintf(stderr, "load: cannot sign with key %d\n", k);
+            close(fd);
+            free(frame);
+            free(resp);
+            return NULL;
+        }
+    }
+    // 받은 공개키가 잘못되었으면 검증하지 않고 실패로 기록
+    if ((code = rsa_public_key_import_ex(&key, bits, pub, pub + klen)) != 0)
+        fprintf(stderr, "load: invalid public key from SIGND_PUBKEY (%d)\n", code);
+    else
+        code = rsassa_pss_verify_key_ex(hash ? hash : SHASIZE, frame + klen, mlen, &key, frame);
+    cl->checked = (code == 0) ? 1 : -1;
+    rsa_public_key_clear(&key);
+
+    // 응답이 순서 없이 오므로 비어 있는 sent[] 자리를 id의 하위 8 비트에 실어 보낸다
+    for (int i = 0; i < depth; i++)
+        free_slot[i] = i;
+    while (1) {
+        // depth개가 될 때까지 요청을 보낸다
+        while (outstanding < depth && now() < deadline) {
+            int k = next % nkeys;
+
+            slot = free_slot[depth - 1 - outstanding];
+            kop = (op == 0) ? ((next & 1) ? SIGND_VERIFY : SIGND_SIGN) : op;
+            h.op = (uint8_t)kop;
+            h.code = (uint8_t)(hash / 8);
+            h.key = (uint16_t)k;
+            h.id = next << 8 | (uint32_t)slot;
+            h.len = (uint32_t)(kop == SIGND_VERIFY ? flen : mlen);
+            signd_hdr_pack(hdr, &h);
+            sent[slot] = now();
+            if (write_full(fd, hdr, sizeof(hdr)) < 0 ||
+                write_full(fd, kop == SIGND_VERIFY ? frame + k * flen : frame + k * flen + klen, h.len) < 0)
+                goto out;
+            next++;
+            outstanding++;
+        }
+        if (outstanding == 0)
+            break;
+        if (read_full(fd, hdr, sizeof(hdr)) < 0)
+            break;
+        signd_hdr_unpack(hdr, &h);
+        if (h.len > klen || (h.len > 0 && read_full(fd, resp, h.len) < 0))
+            break;
+        slot = h.id & 0xff;
+        record(cl, now() - sent[slot]);
+        if (h.code != 0)
+            cl->errors++;
+        outstanding--;
+        free_slot[depth - 1 - outstanding] = slot;
+    }
+out:
+    close(fd);
+    free(frame);
+    free(resp);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+    static char defpath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int nconn = 4, opt, fd, bad = 0;
+    struct client *cl;
+    size_t total = 0, errors = 0, n = 0;
+    unsigned char buf[SIGND_STATS_LEN];
+    double *lat, start, elapsed;
+    signd_stats st;
+
+    while ((opt = getopt(argc, argv, "s:o:c:d:T:m:k:h:")) != -1) {
+        switch (opt) {
+        case 's': path = optarg; break;
+        case 'o':
+            op = !strcmp(optarg, "sign") ? SIGND_SIGN : !strcmp(optarg, "verify") ? SIGND_VERIFY :
+                 !strcmp(optarg, "mix") ? 0 : -1;
+            break;
+        case 'c': nconn = atoi(optarg); break;
+        case 'd': depth = atoi(optarg); break;
+        case 'T': seconds = atoi(optarg); break;
+        case 'm': mlen = (size_t)atol(optarg); break;
+        case 'k': nkeys = atoi(optarg); break;
+        case 'h': hash = atoi(optarg); break;
+        default:
+            op = -1;
+        }
+    }
+    if (op < 0 || nconn < 1 || depth < 1 || depth > LOAD_MAX_DEPTH || seconds < 1 || nkeys < 1 ||
+        mlen > SIGND_MAX_MSG - RSA_MAX_KEYSIZE/8 || (hash && hash != 224 && hash != 256 && hash != 384 && hash != 512)) {
+        fprintf(stderr, "usage: %s [-s socket] [-o sign|verify|mix] [-c conns] [-d depth] [-T seconds] "
+                "[-m msglen] [-k keys] [-h 224|256|384|512]\n", argv[0]);
+        return 1;
+    }
+    if (path == NULL) {
+        if (signd_socket_path(defpath, sizeof(defpath)) < 0) {
+            fprintf(stderr, "client: socket path too long\n");
+            return 1;
+        }
+        path = defpath;
+    }
+
+    cl = calloc(nconn, sizeof(struct client));
+    if (cl == NULL)
+        return 1;
+    start = now();
+    deadline = start + seconds;
+    for (int i = 0; i < nconn; i++) {
+        cl[i].id = i;
+        pthread_create(&cl[i].tid, NULL, client_run, &cl[i]);
+    }
+    for (int i = 0; i < nconn; i++) {
+        pthread_join(cl[i].tid, NULL);
+        total += cl[i].nlat;
+        errors += cl[i].errors;
+        if (cl[i].checked < 0)
+            bad++;
+    }
+    elapsed = now() - start;
+
+    lat = malloc((total ? total : 1) * sizeof(double));
+    if (lat == NULL)
+        return 1;
+    for (int i = 0; i < nconn; i++) {
+        memcpy(lat + n, cl[i].lat, cl[i].nlat * sizeof(double));
+        n += cl[i].nlat;
+        free(cl[i].lat);
+    }
+    qsort(lat, n, sizeof(double), cmp_double);
+
+    printf("%d conns x depth %d, %zu-byte messages, %.1f s\n", nconn, depth, mlen, elapsed);
+    printf("client: %10.0f ops/s   p50 %9.1f us   p99 %9.1f us   p99.9 %9.1f us   %zu ops, %zu errors\n",
+           n / elapsed, n ? lat[n / 2] * 1e6 : 0, n ? lat[n * 99 / 100] * 1e6 : 0,
+           n ? lat[n * 999 / 1000] * 1e6 : 0, n, errors);
+    if (bad)
+        printf("client: %d connections received a signature that does not verify locally\n", bad);
+
+    fd = connect_signd();
+    if (fd >= 0 && call(fd, SIGND_STATS, 0, NULL, 0, buf, sizeof(buf), NULL) == 0) {
+        signd_stats_unpack(buf, &st);
+        printf("server: %10.0f ops/s   p50 %9.1f us   p99 %9.1f us   %5.2f req/batch   %llu ops (since start)\n",
+               st.uptime_ns ? st.ops / (st.uptime_ns / 1e9) : 0, st.p50_ns / 1e3, st.p99_ns / 1e3,
+               st.batches ? (double)st.ops / st.batches : 0.0, (unsigned long long)st.ops);
+    }
+    if (fd >= 0)
+        close(fd);
+    free(lat);
+    free(cl);
+    return bad || errors ? 1 : 0;
+}
@@ -0,0 +1,657 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "sha2_accel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA2_X86
+#endif
+
+static const uint32 K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static const uint64 K512[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL};
+
+static const uint32 H224[8] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4};
+static const uint32 H256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+static const uint64 H384[8] = {
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+    0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL};
+static const uint64 H512[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+
+/*
+ * CPU 기능 확인
+ * features가 -1이면 아직 확인하지 않은 상태이다. 여러 스레드가 동시에 확인해도 같은 값을 쓰므로 문제없다.
+ */
+static int features = -1;
+static int allowed = SHA2_SHANI | SHA2_AVX2;
+
+int sha2_accel_features(void)
+{
+#ifdef SHA2_X86
+    unsigned int a, b, c, d, lo, hi;
+    int f = 0;
+
+    if (features >= 0)
+        return features & allowed;
+
+    if (__get_cpuid(1, &a, &b, &c, &d)) {
+        int ssse3 = (c >> 9) & 1, sse41 = (c >> 19) & 1;
+        int osxsave = (c >> 27) & 1, avx = (c >> 28) & 1;
+
+        if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+            if (((b >> 29) & 1) && ssse3 && sse41)
+                f |= SHA2_SHANI;
+            // AVX2는 운영체제가 YMM 레지스터를 저장해 주는지도 확인해야 함
+            if (((b >> 5) & 1) && osxsave && avx) {
+                __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+                if ((lo & 6) == 6)
+                    f |= SHA2_AVX2;
+            }
+        }
+    }
+    features = f;
+    return features & allowed;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * sha2_accel_restrict() - limits the backends in use to mask (for testing and benchmarks)
+ */
+void sha2_accel_restrict(int mask)
+{
+    allowed = mask;
+}
+
+static void unpack32(uint32 x, unsigned char *p)
+{
+    p[0] = x >> 24; p[1] = x >> 16; p[2] = x >> 8; p[3] = x;
+}
+
+static void unpack64(uint64 x, unsigned char *p)
+{
+    unpack32((uint32)(x >> 32), p);
+    unpack32((uint32)x, p + 4);
+}
+
+/*
+ * pad_tail() - builds the final padded block(s) of a len-byte message whose tail is given
+ * 블록 크기 bs, 길이 필드 lbytes (8 또는 16)에 맞게 0x80, 0, 비트 길이를 붙이고 블록 수를 리턴한다.
+ */
+static int pad_tail(unsigned char *out, const unsigned char *tail, size_t tailLen, uint64 len, size_t bs, size_t lbytes)
+{
+    size_t padLen = (tailLen + 1 + lbytes <= bs) ? bs : 2*bs;
+
+    memset(out, 0, padLen);
+    memcpy(out, tail, tailLen);
+    out[tailLen] = 0x80;
+    unpack64(len << 3, out + padLen - 8);
+    return (int)(padLen / bs);
+}
+
+/*
+ * head_block() - fills buf with the prefix pfx followed by the start of m, returns the bytes of m taken
+ * plen + len이 블록 크기 bs 이상이면 buf는 꽉 찬 첫 블록이 되고, 작으면 m 전체가 들어가 pad_tail()의 입력이 된다.
+ */
+static size_t head_block(unsigned char *buf, const unsigned char *pfx, size_t plen, const unsigned char *m,
+                         size_t len, size_t bs)
+{
+    size_t k = (plen + len >= bs) ? bs - plen : len;
+
+    memcpy(buf, pfx, plen);
+    memcpy(buf + plen, m, k);
+    return k;
+}
+
+#ifdef SHA2_X86
+/*
+ * sha256_ni_transform() - SHA-256 compression of nblocks 64-byte blocks with SHA extensions
+ * 상태 h[]는 sha256_ctx.h와 같은 순서(a, b, ..., h)이며, 명령어가 요구하는 ABEF/CDGH 배치로 바꿔서 계산한다.
+ * 메시지 스케줄은 W[4g..4g+3]을 레지스터 네 개에 돌려 가며 sha256msg1/msg2로 만든다.
+ */
+__attribute__((target("sha,sse4.1")))
+void sha256_ni_transform(uint32 *h, const unsigned char *data, size_t nblocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, msg, tmp, abef, cdgh;
+    __m128i w[4];
+
+    tmp = _mm_loadu_si128((const __m128i *)&h[0]);
+    state1 = _mm_loadu_si128((const __m128i *)&h[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xb1);             /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1b);       /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);       /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);    /* CDGH */
+
+    for (; nblocks > 0; nblocks--, data += 64) {
+        abef = state0;
+        cdgh = state1;
+
+        for (int g = 0; g < 16; g++) {
+            if (g < 4)
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16*g)), mask);
+
+            msg = _mm_add_epi32(w[g & 3], _mm_loadu_si128((const __m128i *)&K256[4*g]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g <= 14) {
+                tmp = _mm_alignr_epi8(w[g & 3], w[(g-1) & 3], 4);
+                w[(g+1) & 3] = _mm_add_epi32(w[(g+1) & 3], tmp);
+                w[(g+1) & 3] = _mm_sha256msg2_epu32(w[(g+1) & 3], w[g & 3]);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0e);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (g >= 1 && g <= 12)
+                w[(g-1) & 3] = _mm_sha256msg1_epu32(w[(g-1) & 3], w[g & 3]);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);          /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xb1);       /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);    /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);       /* HGFE */
+    _mm_storeu_si128((__m128i *)&h[0], state0);
+    _mm_storeu_si128((__m128i *)&h[4], state1);
+}
+
+/*
+ * 8-lane SHA-256 : ymm 레지스터의 32 비트 원소 i가 i번째 메시지의 워드이다.
+ */
+#define ROR32(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32-(n)))
+#define SHR32(x, n) _mm256_srli_epi32(x, n)
+
+/*
+ * load8x8() - loads eight words at byte offset off of each lane and transposes them
+ * 결과 w[t]는 모든 레인의 t번째 워드를 big-endian으로 읽은 값이다.
+ */
+__attribute__((target("avx2")))
+static void load8x8(__m256i *w, const unsigned char *const *blk, size_t off)
+{
+    const __m256i bswap = _mm256_set_epi8(12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3,
+                                          12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3);
+    __m256i r[8], t[8], u[8];
+
+    for (int l = 0; l < 8; l++)
+        r[l] = _mm256_loadu_si256((const __m256i *)(blk[l] + off));
+    for (int l = 0; l < 8; l += 2) {
+        t[l] = _mm256_unpacklo_epi32(r[l], r[l+1]);
+        t[l+1] = _mm256_unpackhi_epi32(r[l], r[l+1]);
+    }
+    for (int l = 0; l < 8; l += 4) {
+        u[l] = _mm256_unpacklo_epi64(t[l], t[l+2]);
+        u[l+1] = _mm256_unpackhi_epi64(t[l], t[l+2]);
+        u[l+2] = _mm256_unpacklo_epi64(t[l+1], t[l+3]);
+        u[l+3] = _mm256_unpackhi_epi64(t[l+1], t[l+3]);
+    }
+    for (int i = 0; i < 4; i++) {
+        w[i] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i+4], 0x20), bswap);
+        w[i+4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[i], u[i+4], 0x31), bswap);
+    }
+}
+
+/*
+ * sha256_x8_block() - one SHA-256 compression for each of eight lanes
+ */
+__attribute__((target("avx2")))
+static void sha256_x8_block(__m256i *st, const unsigned char *const *blk, size_t off)
+{
+    __m256i w[16], s[8], t1, t2;
+
+    load8x8(w, blk, off);
+    load8x8(w + 8, blk, off + 32);
+    for (int i = 0; i < 8; i++)
+        s[i] = st[i];
+
+    for (int t = 0; t < 64; t++) {
+        if (t >= 16) {
+            __m256i w15 = w[(t-15) & 15], w2 = w[(t-2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROR32(w15, 7), ROR32(w15, 18)), SHR32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROR32(w2, 17), ROR32(w2, 19)), SHR32(w2, 10));
+            w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t-7) & 15], s1));
+        }
+        // T1 = h + S1(e) + Ch(e, f, g) + K[t] + W[t]
+        t1 = _mm256_xor_si256(_mm256_xor_si256(ROR32(s[4], 6), ROR32(s[4], 11)), ROR32(s[4], 25));
+        t1 = _mm256_add_epi32(t1, _mm256_xor_si256(s[6], _mm256_and_si256(s[4], _mm256_xor_si256(s[5], s[6]))));
+        t1 = _mm256_add_epi32(t1, _mm256_add_epi32(s[7], _mm256_set1_epi32(K256[t])));
+        t1 = _mm256_add_epi32(t1, w[t & 15]);
+        // T2 = S0(a) + Maj(a, b, c)
+        t2 = _mm256_xor_si256(_mm256_xor_si256(ROR32(s[0], 2), ROR32(s[0], 13)), ROR32(s[0], 22));
+        t2 = _mm256_add_epi32(t2, _mm256_or_si256(_mm256_and_si256(s[0], s[1]),
+                                                  _mm256_and_si256(s[2], _mm256_or_si256(s[0], s[1]))));
+        s[7] = s[6]; s[6] = s[5]; s[5] = s[4];
+        s[4] = _mm256_add_epi32(s[3], t1);
+        s[3] = s[2]; s[2] = s[1]; s[1] = s[0];
+        s[0] = _mm256_add_epi32(t1, t2);
+    }
+
+    for (int i = 0; i < 8; i++)
+        st[i] = _mm256_add_epi32(st[i], s[i]);
+}
+
+/*
+ * sha256_x8() - hashes pfx || m[l] for eight len-byte messages with initial value iv
+ * 접두어 (plen 바이트, 블록보다 짧음)가 있으면 첫 블록만 레인마다 따로 만들고, 나머지는 메시지에서 바로 읽는다.
+ */
+__attribute__((target("avx2")))
+static void sha256_x8(const uint32 *iv, const unsigned char *pfx, unsigned int plen, const unsigned char *const *m,
+                      unsigned int len, unsigned char *const *digest, int dLen)
+{
+    unsigned char head[8][SHA256_BLOCK_SIZE], tail[8][2*SHA256_BLOCK_SIZE];
+    const unsigned char *p[8], *q[8];
+    uint32 out[8][8];
+    __m256i st[8];
+    uint64 total = (uint64)plen + len;
+    size_t k = 0, rem, full;
+    int nb = 0;
+
+    for (int i = 0; i < 8; i++)
+        st[i] = _mm256_set1_epi32(iv[i]);
+
+    if (plen > 0) {
+        for (int l = 0; l < 8; l++) {
+            k = head_block(head[l], pfx, plen, m[l], len, SHA256_BLOCK_SIZE);
+            p[l] = head[l];
+        }
+        if (total >= SHA256_BLOCK_SIZE)
+            sha256_x8_block(st, p, 0);
+    }
+    rem = len - k;
+    full = rem / SHA256_BLOCK_SIZE * SHA256_BLOCK_SIZE;
+    for (int l = 0; l < 8; l++)
+        q[l] = m[l] + k;
+    for (size_t off = 0; off < full; off += SHA256_BLOCK_SIZE)
+        sha256_x8_block(st, q, off);
+
+    for (int l = 0; l < 8; l++) {
+        if (plen > 0 && total < SHA256_BLOCK_SIZE)
+            nb = pad_tail(tail[l], head[l], total, total, SHA256_BLOCK_SIZE, 8);
+        else
+            nb = pad_tail(tail[l], q[l] + full, rem - full, total, SHA256_BLOCK_SIZE, 8);
+        p[l] = tail[l];
+    }
+    for (int b = 0; b < nb; b++)
+        sha256_x8_block(st, p, b * SHA256_BLOCK_SIZE);
+
+    for (int i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i *)out[i], st[i]);
+    for (int l = 0; l < 8; l++)
+        for (int i = 0; i < dLen/4; i++)
+            unpack32(out[i][l], digest[l] + 4*i);
+}
+
+/*
+ * 4-lane SHA-512 : ymm 레지스터의 64 비트 원소 i가 i번째 메시지의 워드이다.
+ */
+#define ROR64(x, n) _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64-(n)))
+#define SHR64(x, n) _mm256_srli_epi64(x, n)
+
+/*
+ * load4x4() - loads four 64-bit words at byte offset off of each lane and transposes them
+ */
+__attribute__((target("avx2")))
+static void load4x4(__m256i *w, const unsigned char *const *blk, size_t off)
+{
+    const __m256i bswap = _mm256_set_epi8(8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7,
+                                          8,9,10,11,12,13,14,15, 0,1,2,3,4,5,6,7);
+    __m256i r[4], t[4];
+
+    for (int l = 0; l < 4; l++)
+        r[l] = _mm256_loadu_si256((const __m256i *)(blk[l] + off));
+    t[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+    t[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+    t[2] = _mm256_unpacklo_epi64(r[2], r[3]);
+    t[3] = _mm256_unpackhi_epi64(r[2], r[3]);
+    w[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[0], t[2], 0x20), bswap);
+    w[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[1], t[3], 0x20), bswap);
+    w[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[0], t[2], 0x31), bswap);
+    w[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(t[1], t[3], 0x31), bswap);
+}
+
+/*
+ * sha512_x4_block() - one SHA-512 compression for each of four lanes
+ */
+__attribute__((target("avx2")))
+static void sha512_x4_block(__m256i *st, const unsigned char *const *blk, size_t off)
+{
+    __m256i w[16], s[8], t1, t2;
+
+    for (int i = 0; i < 4; i++)
+        load4x4(w + 4*i, blk, off + 32*i);
+    for (int i = 0; i < 8; i++)
+        s[i] = st[i];
+
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            __m256i w15 = w[(t-15) & 15], w2 = w[(t-2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(ROR64(w15, 1), ROR64(w15, 8)), SHR64(w15, 7));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(ROR64(w2, 19), ROR64(w2, 61)), SHR64(w2, 6));
+            w[t & 15] = _mm256_add_epi64(_mm256_add_epi64(w[t & 15], s0), _mm256_add_epi64(w[(t-7) & 15], s1));
+        }
+        t1 = _mm256_xor_si256(_mm256_xor_si256(ROR64(s[4], 14), ROR64(s[4], 18)), ROR64(s[4], 41));
+        t1 = _mm256_add_epi64(t1, _mm256_xor_si256(s[6], _mm256_and_si256(s[4], _mm256_xor_si256(s[5], s[6]))));
+        t1 = _mm256_add_epi64(t1, _mm256_add_epi64(s[7], _mm256_set1_epi64x((long long)K512[t])));
+        t1 = _mm256_add_epi64(t1, w[t & 15]);
+        t2 = _mm256_xor_si256(_mm256_xor_si256(ROR64(s[0], 28), ROR64(s[0], 34)), ROR64(s[0], 39));
+        t2 = _mm256_add_epi64(t2, _mm256_or_si256(_mm256_and_si256(s[0], s[1]),
+                                                  _mm256_and_si256(s[2], _mm256_or_si256(s[0], s[1]))));
+        s[7] = s[6]; s[6] = s[5]; s[5] = s[4];
+        s[4] = _mm256_add_epi64(s[3], t1);
+        s[3] = s[2]; s[2] = s[1]; s[1] = s[0];
+        s[0] = _mm256_add_epi64(t1, t2);
+    }
+
+    for (int i = 0; i < 8; i++)
+        st[i] = _mm256_add_epi64(st[i], s[i]);
+}
+
+/*
+ * sha512_x4() - hashes pfx || m[l] for four len-byte messages with initial value iv
+ * 길이 필드는 128 비트이지만 unsigned int 길이에서는 상위 64 비트가 항상 0이다.
+ */
+__attribute__((target("avx2")))
+static void sha512_x4(const uint64 *iv, const unsigned char *pfx, unsigned int plen, const unsigned char *const *m,
+                      unsigned int len, unsigned char *const *digest, int dLen)
+{
+    unsigned char head[4][SHA512_BLOCK_SIZE], tail[4][2*SHA512_BLOCK_SIZE];
+    const unsigned char *p[4], *q[4];
+    uint64 out[8][4];
+    __m256i st[8];
+    uint64 total = (uint64)plen + len;
+    size_t k = 0, rem, full;
+    int nb = 0;
+
+    for (int i = 0; i < 8; i++)
+        st[i] = _mm256_set1_epi64x((long long)iv[i]);
+
+    if (plen > 0) {
+        for (int l = 0; l < 4; l++) {
+            k = head_block(head[l], pfx, plen, m[l], len, SHA512_BLOCK_SIZE);
+            p[l] = head[l];
+        }
+        if (total >= SHA512_BLOCK_SIZE)
+            sha512_x4_block(st, p, 0);
+    }
+    rem = len - k;
+    full = rem / SHA512_BLOCK_SIZE * SHA512_BLOCK_SIZE;
+    for (int l = 0; l < 4; l++)
+        q[l] = m[l] + k;
+    for (size_t off = 0; off < full; off += SHA512_BLOCK_SIZE)
+        sha512_x4_block(st, q, off);
+
+    for (int l = 0; l < 4; l++) {
+        if (plen > 0 && total < SHA512_BLOCK_SIZE)
+            nb = pad_tail(tail[l], head[l], total, total, SHA512_BLOCK_SIZE, 16);
+        else
+            nb = pad_tail(tail[l], q[l] + full, rem - full, total, SHA512_BLOCK_SIZE, 16);
+        p[l] = tail[l];
+    }
+    for (int b = 0; b < nb; b++)
+        sha512_x4_block(st, p, b * SHA512_BLOCK_SIZE);
+
+    for (int i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i *)out[i], st[i]);
+    for (int l = 0; l < 4; l++)
+        for (int i = 0; i < dLen/8; i++)
+            unpack64(out[i][l], digest[l] + 8*i);
+}
+#else
+/*
+ * sha256_ni_transform() - not available off x86
+ * sha2_accel_features()가 SHA2_SHANI를 켜지 않으므로 불리면 안 된다. 해시를 건너뛰지 않도록 멈춘다.
+ */
+void sha256_ni_transform(uint32 *h, const unsigned char *blocks, size_t nblocks)
+{
+    (void)h; (void)blocks; (void)nblocks;
+    abort();
+}
+#endif /* SHA2_X86 */
+
+/*
+ * sha256_ni_iv() - one-shot SHA-224/256 of pfx || message on SHA extensions with initial value iv
+ */
+static void sha256_ni_iv(const uint32 *iv, const unsigned char *pfx, unsigned int plen,
+                         const unsigned char *message, unsigned int len, unsigned char *digest, int dLen)
+{
+    unsigned char head[SHA256_BLOCK_SIZE], tail[2*SHA256_BLOCK_SIZE];
+    uint32 h[8];
+    uint64 total = (uint64)plen + len;
+    size_t k = 0, full;
+    int nb;
+
+    memcpy(h, iv, sizeof(h));
+    if (plen > 0) {
+        k = head_block(head, pfx, plen, message, len, SHA256_BLOCK_SIZE);
+        if (total < SHA256_BLOCK_SIZE) {
+            nb = pad_tail(tail, head, total, total, SHA256_BLOCK_SIZE, 8);
+            sha256_ni_transform(h, tail, nb);
+            goto out;
+        }
+        sha256_ni_transform(h, head, 1);
+        message += k;
+        len -= k;
+    }
+    full = len / SHA256_BLOCK_SIZE;
+    sha256_ni_transform(h, message, full);
+    nb = pad_tail(tail, message + full*SHA256_BLOCK_SIZE, len % SHA256_BLOCK_SIZE, total, SHA256_BLOCK_SIZE, 8);
+    sha256_ni_transform(h, tail, nb);
+out:
+    for (int i = 0; i < dLen/4; i++)
+        unpack32(h[i], digest + 4*i);
+}
+
+/*
+ * sha224_ni(), sha256_ni() - same interface as sha224(), sha256() in sha2.c
+ * SHA extensions이 없으면 sha2.c로 계산한다.
+ */
+void sha224_ni(const unsigned char *message, unsigned int len, unsigned char *digest)
+{
+    if (sha2_accel_features() & SHA2_SHANI)
+        sha256_ni_iv(H224, NULL, 0, message, len, digest, SHA224_DIGEST_SIZE);
+    else
+        sha224(message, len, digest);
+}
+
+void sha256_ni(const unsigned char *message, unsigned int len, unsigned char *digest)
+{
+    if (sha2_accel_features() & SHA2_SHANI)
+        sha256_ni_iv(H256, NULL, 0, message, len, digest, SHA256_DIGEST_SIZE);
+    else
+        sha256(message, len, digest);
+}
+
+/*
+ * one_prefix() - hashes pfx || m for one message without copying m
+ * SHA-224/256은 SHA extensions이 있으면 그것으로, 없으면 sha2.c의 문맥 API로 접두어와 메시지를 이어서 해시한다.
+ */
+static void one_prefix(const unsigned char *pfx, unsigned int plen, const unsigned char *m, unsigned int len,
+                       unsigned char *digest, int dLen)
+{
+    sha256_ctx c256;
+    sha512_ctx c512;
+
+    if (dLen <= SHA256_DIGEST_SIZE && (sha2_accel_features() & SHA2_SHANI)) {
+        sha256_ni_iv(dLen == SHA224_DIGEST_SIZE ? H224 : H256, pfx, plen, m, len, digest, dLen);
+        return;
+    }
+    switch (dLen) {
+    case SHA224_DIGEST_SIZE:
+        sha224_init(&c256);
+        sha224_update(&c256, pfx, plen);
+        sha224_update(&c256, m, len);
+        sha224_final(&c256, digest);
+        break;
+    case SHA256_DIGEST_SIZE:
+        sha256_init(&c256);
+        sha256_update(&c256, pfx, plen);
+        sha256_update(&c256, m, len);
+        sha256_final(&c256, digest);
+        break;
+    case SHA384_DIGEST_SIZE:
+        sha384_init(&c512);
+        sha384_update(&c512, pfx, plen);
+        sha384_update(&c512, m, len);
+        sha384_final(&c512, digest);
+        break;
+    default:
+        sha512_init(&c512);
+        sha512_update(&c512, pfx, plen);
+        sha512_update(&c512, m, len);
+        sha512_final(&c512, digest);
+    }
+}
+
+/*
+ * mb256() - multi-buffer SHA-224/256 dispatcher
+ * 8개가 모두 찬 묶음은 AVX2로 처리한다. 남은 메시지는 SHA extensions이 있으면 하나씩 처리하는 것이
+ * 빠르고(측정상 7개 이하), 없으면 모자라는 레인을 첫 메시지로 채워 AVX2로 처리한 뒤 결과를 버린다.
+ */
+static void mb256(const uint32 *iv, void (*one)(const unsigned char *, unsigned int, unsigned char *),
+                  const unsigned char *pfx, unsigned int plen, const unsigned char *const *m, unsigned int len,
+                  unsigned char *const *digest, int count, int dLen)
+{
+    int i = 0;
+
+#ifdef SHA2_X86
+    int f = sha2_accel_features();
+
+    if (f & SHA2_AVX2) {
+        unsigned char junk[8][SHA256_DIGEST_SIZE];
+        const unsigned char *pm[8];
+        unsigned char *pd[8];
+
+        for (; i + 8 <= count; i += 8)
+            sha256_x8(iv, pfx, plen, m + i, len, digest + i, dLen);
+        if (!(f & SHA2_SHANI) && count - i > 1) {
+            for (int l = 0; l < 8; l++) {
+                pm[l] = (i + l < count) ? m[i+l] : m[i];
+                pd[l] = (i + l < count) ? digest[i+l] : junk[l];
+            }
+            sha256_x8(iv, pfx, plen, pm, len, pd, dLen);
+            return;
+        }
+    }
+#endif
+    (void)iv;
+    for (; i < count; i++)
+        if (plen > 0)
+            one_prefix(pfx, plen, m[i], len, digest[i], dLen);
+        else
+            one(m[i], len, digest[i]);
+}
+
+void sha224_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count)
+{
+    mb256(H224, sha224_ni, NULL, 0, message, len, digest, count, SHA224_DIGEST_SIZE);
+}
+
+void sha224_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count)
+{
+    mb256(H224, sha224_ni, prefix, plen, message, len, digest, count, SHA224_DIGEST_SIZE);
+}
+
+void sha256_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count)
+{
+    mb256(H256, sha256_ni, NULL, 0, message, len, digest, count, SHA256_DIGEST_SIZE);
+}
+
+void sha256_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count)
+{
+    mb256(H256, sha256_ni, prefix, plen, message, len, digest, count, SHA256_DIGEST_SIZE);
+}
+
+/*
+ * mb512() - multi-buffer SHA-384/512 dispatcher, 4개씩 AVX2로 처리
+ */
+static void mb512(const uint64 *iv, void (*one)(const unsigned char *, unsigned int, unsigned char *),
+                  const unsigned char *pfx, unsigned int plen, const unsigned char *const *m, unsigned int len,
+                  unsigned char *const *digest, int count, int dLen)
+{
+    int i = 0;
+
+#ifdef SHA2_X86
+    if ((sha2_accel_features() & SHA2_AVX2) && count > 1) {
+        unsigned char junk[4][SHA512_DIGEST_SIZE];
+        const unsigned char *pm[4];
+        unsigned char *pd[4];
+
+        for (; i < count; i += 4) {
+            for (int l = 0; l < 4; l++) {
+                pm[l] = (i + l < count) ? m[i+l] : m[i];
+                pd[l] = (i + l < count) ? digest[i+l] : junk[l];
+            }
+            sha512_x4(iv, pfx, plen, pm, len, pd, dLen);
+        }
+        return;
+    }
+#endif
+    (void)iv;
+    for (; i < count; i++)
+        if (plen > 0)
+            one_prefix(pfx, plen, m[i], len, digest[i], dLen);
+        else
+            one(m[i], len, digest[i]);
+}
+
+void sha384_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count)
+{
+    mb512(H384, sha384, NULL, 0, message, len, digest, count, SHA384_DIGEST_SIZE);
+}
+
+void sha384_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count)
+{
+    mb512(H384, sha384, prefix, plen, message, len, digest, count, SHA384_DIGEST_SIZE);
+}
+
+void sha512_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count)
+{
+    mb512(H512, sha512, NULL, 0, message, len, digest, count, SHA512_DIGEST_SIZE);
+}
+
+void sha512_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count)
+{
+    mb512(H512, sha512, prefix, plen, message, len, digest, count, SHA512_DIGEST_SIZE);
+}
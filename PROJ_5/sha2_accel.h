@@ -0,0 +1,51 @@
+/*
+ * Copyright 2020, 2021. Heekuck Oh, all rights reserved
+ * 이 프로그램은 한양대학교 ERICA 소프트웨어학부 재학생을 위한 교육용으로 제작되었습니다.
+ */
+#ifndef SHA2_ACCEL_H
+#define SHA2_ACCEL_H
+
+#include <stddef.h>
+#include "sha2.h"
+
+/*
+ * sha2.c 위에 얹는 하드웨어 가속 SHA-2
+ * SHA2_SHANI : Intel SHA extensions으로 SHA-224/256 압축 함수를 수행
+ * SHA2_AVX2 : 서로 다른 메시지를 AVX2 레인에 하나씩 올려 SHA-224/256은 8개, SHA-384/512는 4개를 동시에 해시
+ * 지원 여부는 처음 사용할 때 CPUID로 확인하며, 지원하지 않으면 sha2.c로 계산한다.
+ */
+#define SHA2_SHANI 0x01
+#define SHA2_AVX2 0x02
+
+#define SHA256_MB_LANES 8
+#define SHA512_MB_LANES 4
+
+int sha2_accel_features(void);
+void sha2_accel_restrict(int mask);
+
+void sha256_ni_transform(uint32 *h, const unsigned char *blocks, size_t nblocks);
+void sha224_ni(const unsigned char *message, unsigned int len, unsigned char *digest);
+void sha256_ni(const unsigned char *message, unsigned int len, unsigned char *digest);
+
+/*
+ * 멀티 버퍼 해시 : 길이가 모두 len인 count개의 메시지 message[i]를 해시하여 digest[i]에 저장한다.
+ */
+void sha224_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count);
+void sha256_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count);
+void sha384_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count);
+void sha512_mb(const unsigned char *const *message, unsigned int len, unsigned char *const *digest, int count);
+
+/*
+ * 접두어 멀티 버퍼 해시 : 모든 메시지 앞에 같은 접두어 prefix (plen 바이트)를 붙인 prefix || message[i]를
+ * 해시한다. 메시지를 복사하지 않으며, plen은 블록 크기 (SHA-224/256은 64, SHA-384/512는 128)보다 작아야 한다.
+ */
+void sha224_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count);
+void sha256_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count);
+void sha384_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count);
+void sha512_mb_prefix(const unsigned char *prefix, unsigned int plen, const unsigned char *const *message,
+                      unsigned int len, unsigned char *const *digest, int count);
+
+#endif